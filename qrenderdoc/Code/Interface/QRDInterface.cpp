@@ -106,6 +106,12 @@ CaptureSettings::operator QVariant() const
   opts[lit("refAllResources")] = options.refAllResources;
   opts[lit("captureAllCmdLists")] = options.captureAllCmdLists;
   opts[lit("debugOutputMute")] = options.debugOutputMute;
+  opts[lit("hitchCaptureThreshold")] = options.hitchCaptureThreshold;
+  opts[lit("hitchCaptureMedianFactor")] = options.hitchCaptureMedianFactor;
+  opts[lit("hitchCaptureCooldown")] = options.hitchCaptureCooldown;
+  opts[lit("hitchCaptureMaxCount")] = options.hitchCaptureMaxCount;
+  opts[lit("captureCompression")] = (uint32_t)options.captureCompression;
+  opts[lit("captureCompressionLevel")] = options.captureCompressionLevel;
   ret[lit("options")] = opts;
 
   ret[lit("queuedFrameCap")] = queuedFrameCap;
@@ -149,6 +155,35 @@ CaptureSettings::CaptureSettings(const QVariant &v)
   options.refAllResources = opts[lit("refAllResources")].toBool();
   options.captureAllCmdLists = opts[lit("captureAllCmdLists")].toBool();
   options.debugOutputMute = opts[lit("debugOutputMute")].toBool();
+  // hitch captures were added later, so keep the defaults if older settings don't have them
+  if(opts.contains(lit("hitchCaptureThreshold")))
+  {
+    options.hitchCaptureThreshold = opts[lit("hitchCaptureThreshold")].toFloat();
+    options.hitchCaptureMedianFactor = opts[lit("hitchCaptureMedianFactor")].toFloat();
+    options.hitchCaptureCooldown = opts[lit("hitchCaptureCooldown")].toUInt();
+    options.hitchCaptureMaxCount = opts[lit("hitchCaptureMaxCount")].toUInt();
+  }
+  else
+  {
+    CaptureOptions defaults;
+    RENDERDOC_GetDefaultCaptureOptions(&defaults);
+    options.hitchCaptureThreshold = defaults.hitchCaptureThreshold;
+    options.hitchCaptureMedianFactor = defaults.hitchCaptureMedianFactor;
+    options.hitchCaptureCooldown = defaults.hitchCaptureCooldown;
+    options.hitchCaptureMaxCount = defaults.hitchCaptureMaxCount;
+  }
+  if(opts.contains(lit("captureCompression")))
+  {
+    options.captureCompression = (SectionFlags)opts[lit("captureCompression")].toUInt();
+    options.captureCompressionLevel = opts[lit("captureCompressionLevel")].toUInt();
+  }
+  else
+  {
+    CaptureOptions defaults;
+    RENDERDOC_GetDefaultCaptureOptions(&defaults);
+    options.captureCompression = defaults.captureCompression;
+    options.captureCompressionLevel = defaults.captureCompressionLevel;
+  }
 
   if(data.contains(lit("queuedFrameCap")))
     queuedFrameCap = data[lit("queuedFrameCap")].toUInt();
@@ -156,12 +156,14 @@ DEFINE_SAFE_EQUALITY(APIEvent)
 DEFINE_SAFE_EQUALITY(Bindpoint)
 DEFINE_SAFE_EQUALITY(BufferDescription)
 DEFINE_SAFE_EQUALITY(CaptureFileFormat)
+DEFINE_SAFE_EQUALITY(ChunkLoadStatistics)
 DEFINE_SAFE_EQUALITY(ConstantBlock)
 DEFINE_SAFE_EQUALITY(DebugMessage)
 DEFINE_SAFE_EQUALITY(EnvironmentModification)
 DEFINE_SAFE_EQUALITY(EventUsage)
 DEFINE_SAFE_EQUALITY(PathEntry)
 DEFINE_SAFE_EQUALITY(PixelModification)
+DEFINE_SAFE_EQUALITY(PixelRegionHistory)
 DEFINE_SAFE_EQUALITY(ResourceDescription)
 DEFINE_SAFE_EQUALITY(ResourceId)
 DEFINE_SAFE_EQUALITY(LineColumnInfo)
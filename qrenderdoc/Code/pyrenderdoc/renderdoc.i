@@ -303,12 +303,14 @@ TEMPLATE_ARRAY_INSTANTIATE(rdcarray, APIEvent)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, Bindpoint)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, BufferDescription)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, CaptureFileFormat)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ChunkLoadStatistics)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ConstantBlock)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, DebugMessage)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, EnvironmentModification)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, EventUsage)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PathEntry)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PixelModification)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, PixelRegionHistory)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ResourceDescription)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ResourceId)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, LineColumnInfo)
@@ -325,6 +327,8 @@ TEMPLATE_ARRAY_INSTANTIATE(rdcarray, DebugVariableReference)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, SourceVariableMapping)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, SigParameter)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, TextureDescription)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, TextureSave)
+TEMPLATE_ARRAY_INSTANTIATE(rdcarray, CallProfileEntry)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, ShaderEntryPoint)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, Viewport)
 TEMPLATE_ARRAY_INSTANTIATE(rdcarray, Scissor)
@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include "apidefs.h"
 #include "rdcstr.h"
+#include "replay_enums.h"
 #include "stringise.h"
 
 typedef uint8_t byte;
@@ -204,6 +205,59 @@ Default - enabled
 ``False`` - API debugging is displayed as normal.
 )");
   bool debugOutputMute;
+
+  DOCUMENT(R"(Automatically capture the frame after one which takes longer than this many
+milliseconds, to catch intermittent hitches without anyone watching the program.
+
+``0`` disables the absolute threshold.
+
+Default - 0 milliseconds
+)");
+  float hitchCaptureThreshold;
+
+  DOCUMENT(R"(Automatically capture the frame after one which takes longer than this multiple of
+the median time of recent frames. This can be combined with :data:`hitchCaptureThreshold`, in which
+case a frame exceeding either triggers a capture.
+
+``0`` disables the relative threshold.
+
+Default - 0
+)");
+  float hitchCaptureMedianFactor;
+
+  DOCUMENT(R"(The minimum number of frames to wait after a hitch triggers a capture before another
+hitch can trigger one.
+
+Default - 60 frames
+)");
+  uint32_t hitchCaptureCooldown;
+
+  DOCUMENT(R"(The maximum number of captures that hitches can trigger over the program's lifetime.
+
+``0`` indicates no limit.
+
+Default - 1 capture
+)");
+  uint32_t hitchCaptureMaxCount;
+
+  DOCUMENT(R"(How to compress the frame data when the application writes a capture.
+
+:data:`SectionFlags.LZ4Compressed` is fastest to write, :data:`SectionFlags.ZstdCompressed` gives
+smaller captures at a higher CPU cost, and :data:`SectionFlags.NoFlags` stores the data
+uncompressed.
+
+Default - :data:`SectionFlags.LZ4Compressed`
+)");
+  SectionFlags captureCompression;
+
+  DOCUMENT(R"(The zstd level to compress captures with, when :data:`captureCompression` is
+:data:`SectionFlags.ZstdCompressed`. From 1 (fastest) to 19 (smallest).
+
+``0`` uses the ``Zstd.CompressionLevel`` config setting.
+
+Default - 0
+)");
+  uint32_t captureCompressionLevel;
 };
 
 DECLARE_REFLECTION_STRUCT(CaptureOptions);
@@ -540,6 +540,46 @@ struct NewChildData
 
 DECLARE_REFLECTION_STRUCT(NewChildData);
 
+DOCUMENT("The CPU overhead recorded for a single API entry point on a target.");
+struct CallProfileEntry
+{
+  DOCUMENT("");
+  CallProfileEntry() = default;
+  CallProfileEntry(const CallProfileEntry &) = default;
+  CallProfileEntry &operator=(const CallProfileEntry &) = default;
+
+  bool operator==(const CallProfileEntry &o) const
+  {
+    return name == o.name && callCount == o.callCount && totalMicroseconds == o.totalMicroseconds &&
+           serialisedBytes == o.serialisedBytes;
+  }
+  bool operator<(const CallProfileEntry &o) const
+  {
+    if(!(name == o.name))
+      return name < o.name;
+    if(!(callCount == o.callCount))
+      return callCount < o.callCount;
+    if(!(totalMicroseconds == o.totalMicroseconds))
+      return totalMicroseconds < o.totalMicroseconds;
+    if(!(serialisedBytes == o.serialisedBytes))
+      return serialisedBytes < o.serialisedBytes;
+    return false;
+  }
+  DOCUMENT("The name of the API entry point.");
+  rdcstr name;
+  DOCUMENT("The number of times the entry point was called.");
+  uint64_t callCount = 0;
+  DOCUMENT(R"(The total time spent inside RenderDoc's wrapper for the entry point, in microseconds.
+
+This includes the time spent in the driver's implementation of the function.
+)");
+  double totalMicroseconds = 0.0;
+  DOCUMENT("The number of bytes serialised by calls to the entry point.");
+  uint64_t serialisedBytes = 0;
+};
+
+DECLARE_REFLECTION_STRUCT(CallProfileEntry);
+
 DOCUMENT("A message from a target control connection.");
 struct TargetControlMessage
 {
@@ -568,6 +608,11 @@ or has finished, it will be -1.0
 
   DOCUMENT("The number of the capturable windows");
   uint32_t capturableWindowCount = 0;
+
+  DOCUMENT(R"(The per-entry point overhead recorded on the target, as a list of
+:class:`CallProfileEntry`.
+)");
+  rdcarray<CallProfileEntry> callProfile;
 };
 
 DECLARE_REFLECTION_STRUCT(TargetControlMessage);
@@ -1159,6 +1159,79 @@ struct FrameStatistics
 
 DECLARE_REFLECTION_STRUCT(FrameStatistics);
 
+DOCUMENT("Timings for processing one type of chunk while loading a capture.");
+struct ChunkLoadStatistics
+{
+  DOCUMENT("");
+  ChunkLoadStatistics() = default;
+  ChunkLoadStatistics(const ChunkLoadStatistics &) = default;
+  ChunkLoadStatistics &operator=(const ChunkLoadStatistics &) = default;
+
+  bool operator==(const ChunkLoadStatistics &o) const
+  {
+    return name == o.name && count == o.count && totalSize == o.totalSize &&
+           totalTime == o.totalTime;
+  }
+  bool operator<(const ChunkLoadStatistics &o) const
+  {
+    if(!(name == o.name))
+      return name < o.name;
+    if(!(count == o.count))
+      return count < o.count;
+    if(!(totalSize == o.totalSize))
+      return totalSize < o.totalSize;
+    if(!(totalTime == o.totalTime))
+      return totalTime < o.totalTime;
+    return false;
+  }
+
+  DOCUMENT("The name of the chunk type.");
+  rdcstr name;
+
+  DOCUMENT("How many chunks of this type were processed.");
+  uint32_t count = 0;
+
+  DOCUMENT("The total size in bytes of the chunks of this type.");
+  uint64_t totalSize = 0;
+
+  DOCUMENT(R"(The total time in milliseconds spent processing chunks of this type. This includes the
+time spent reading their data from the capture.
+)");
+  double totalTime = 0.0;
+};
+
+DECLARE_REFLECTION_STRUCT(ChunkLoadStatistics);
+
+DOCUMENT(R"(Timings in milliseconds for the phases of loading a capture for replay.
+
+The phases overlap, since data is read and decompressed as chunks are processed, so they don't sum to
+the total load time.
+)");
+struct LoadStatistics
+{
+  DOCUMENT("");
+  LoadStatistics() = default;
+  LoadStatistics(const LoadStatistics &) = default;
+  LoadStatistics &operator=(const LoadStatistics &) = default;
+
+  DOCUMENT("The time spent reading the capture's data from disk.");
+  double fileReadTime = 0.0;
+
+  DOCUMENT("The time spent decompressing the capture's data, or 0 if it isn't compressed.");
+  double decompressTime = 0.0;
+
+  DOCUMENT("The total time spent processing chunks, including any reading and decompression.");
+  double chunkProcessingTime = 0.0;
+
+  DOCUMENT("The time spent processing chunks that create resources' initial contents.");
+  double initialContentsTime = 0.0;
+
+  DOCUMENT("A list of :class:`ChunkLoadStatistics` with timings for each type of chunk processed.");
+  rdcarray<ChunkLoadStatistics> chunks;
+};
+
+DECLARE_REFLECTION_STRUCT(LoadStatistics);
+
 DOCUMENT(R"(Contains frame-level global information
 
 .. data:: NoFrameNumber
@@ -1218,6 +1291,9 @@ this counts the frame number when the capture was made.
   DOCUMENT("A list of debug messages that are not associated with any particular event.");
   rdcarray<DebugMessage> debugMessages;
 
+  DOCUMENT("The :class:`timings <LoadStatistics>` for loading the capture for replay.");
+  LoadStatistics loadStatistics;
+
   static const uint32_t NoFrameNumber = ~0U;
 };
 
@@ -1838,6 +1914,41 @@ pixel.
 
 DECLARE_REFLECTION_STRUCT(PixelModification);
 
+DOCUMENT("The modifications to one pixel, as part of fetching the history of a region.");
+struct PixelRegionHistory
+{
+  DOCUMENT("");
+  PixelRegionHistory() = default;
+  PixelRegionHistory(const PixelRegionHistory &) = default;
+  PixelRegionHistory &operator=(const PixelRegionHistory &) = default;
+
+  bool operator==(const PixelRegionHistory &o) const
+  {
+    return x == o.x && y == o.y && modifications == o.modifications;
+  }
+  bool operator<(const PixelRegionHistory &o) const
+  {
+    if(!(y == o.y))
+      return y < o.y;
+    if(!(x == o.x))
+      return x < o.x;
+    if(!(modifications == o.modifications))
+      return modifications < o.modifications;
+    return false;
+  }
+  DOCUMENT("The x co-ordinate of the pixel.");
+  uint32_t x = 0;
+  DOCUMENT("The y co-ordinate of the pixel.");
+  uint32_t y = 0;
+
+  DOCUMENT(R"(The list of :class:`PixelModification` events for this pixel, in the same form as
+returned by :meth:`ReplayController.PixelHistory`.
+)");
+  rdcarray<PixelModification> modifications;
+};
+
+DECLARE_REFLECTION_STRUCT(PixelRegionHistory);
+
 DOCUMENT("Contains the bytes and metadata describing a thumbnail.");
 struct Thumbnail
 {
@@ -665,6 +665,10 @@ textures are bound as outputs.
 
   DOCUMENT(R"(Retrieve the values of a specified set of counters.
 
+Results are cached per counter, and counters that were already fetched in this session or that are
+present in the capture's :attr:`SectionType.AnalysisCache` section are not recomputed. While any
+resource is replaced, e.g. with an edited shader, results are always recomputed and aren't cached.
+
 :param list counters: The list of :class:`GPUCounter` to fetch results for.
 :return: The list of counter results generated.
 :rtype: ``list`` of :class:`CounterResult`
@@ -829,6 +833,37 @@ bucket when the pixel values are divided between ``minval`` and ``maxval``.
   virtual rdcarray<PixelModification> PixelHistory(ResourceId texture, uint32_t x, uint32_t y,
                                                    const Subresource &sub, CompType typeCast) = 0;
 
+  DOCUMENT(R"(Retrieve the history of modifications to every pixel in a rectangular region, up to
+the current event.
+
+This returns the same information as calling :meth:`PixelHistory` on each pixel in turn, but where
+the API supports it the whole region is processed together in the same number of replays as a
+single pixel.
+
+.. note::
+  When processing a region at once, the reasons a fragment failed fixed-function tests such as
+  depth or stencil testing are determined for the region as a whole. A test is only reported as
+  failed for a pixel if it failed for every pixel in the region, so to get the precise reason a
+  particular pixel was rejected use :meth:`PixelHistory` on that pixel.
+
+:param ResourceId texture: The texture to search for modifications.
+:param int x: The x co-ordinate of the top-left of the region.
+:param int y: The y co-ordinate of the top-left of the region.
+:param int width: The width of the region. The region is clamped to the texture's dimensions.
+:param int height: The height of the region. The region is clamped to the texture's dimensions.
+:param Subresource sub: The subresource within this texture to use.
+:param CompType typeCast: If possible interpret the texture with this type instead of its normal
+  type. If set to :data:`CompType.Typeless` then no cast is applied, otherwise where allowed the
+  texture data will be reinterpreted - e.g. from unsigned integers to floats, or to unsigned
+  normalised values.
+:return: The history of each pixel in the region, in row-major order.
+:rtype: ``list`` of :class:`PixelRegionHistory`
+)");
+  virtual rdcarray<PixelRegionHistory> PixelHistoryRegion(ResourceId texture, uint32_t x,
+                                                          uint32_t y, uint32_t width,
+                                                          uint32_t height, const Subresource &sub,
+                                                          CompType typeCast) = 0;
+
   DOCUMENT(R"(Retrieve a debugging trace from running a vertex shader.
 
 :param int vertid: The vertex ID as a 0-based index up to the number of vertices in the draw.
@@ -899,6 +934,18 @@ completed, further calls will return an empty list.
 )");
   virtual rdcarray<EventUsage> GetUsage(ResourceId id) = 0;
 
+  DOCUMENT(R"(Serialise the analysis results computed so far, along with any loaded from the
+capture, so that they can be stored in the capture for next time.
+
+The returned data should be written to the capture with :meth:`CaptureFile.WriteSection` as a
+section of type :attr:`SectionType.AnalysisCache`. It will be loaded automatically the next time
+the capture is opened, if it is replayed with the same API, GPU driver and RenderDoc version.
+
+:return: The serialised analysis cache contents.
+:rtype: bytes
+)");
+  virtual bytebuf GetAnalysisCache() = 0;
+
   DOCUMENT(R"(Retrieve the contents of a constant block by reading from memory or their source
 otherwise.
 
@@ -929,6 +976,19 @@ texture to something compatible with the target file format.
 )");
   virtual bool SaveTexture(const TextureSave &saveData, const char *path) = 0;
 
+  DOCUMENT(R"(Save several textures to files on disk in one call. This is equivalent to calling
+:meth:`SaveTexture` for each one in turn, but converting and encoding each texture can happen in
+parallel and overlap with reading back the next one.
+
+:param list saveData: The list of :class:`TextureSave` configuration settings for each texture.
+:param list paths: The ``str`` path on disk to save each texture to. Must be the same length as
+  :paramref:`saveData`.
+:return: ``True`` if every texture was saved successfully, ``False`` otherwise.
+:rtype: ``bool``
+)");
+  virtual bool SaveTextures(const rdcarray<TextureSave> &saveData,
+                            const rdcarray<rdcstr> &paths) = 0;
+
   DOCUMENT(R"(Retrieve the generated data from one of the geometry processing shader stages.
 
 :param int instance: The index of the instance to retrieve data for, or 0 for non-instanced draws.
@@ -1067,6 +1127,34 @@ The details of the types of messages that can be received are listed under
   DOCUMENT("Cycle the currently active window if there are more windows to capture.");
   virtual void CycleActiveWindow() = 0;
 
+  DOCUMENT(R"(Enable or disable profiling of the CPU overhead of each API entry point on the target.
+
+Profiling is disabled by default. While enabled, the target records how many times each entry point
+is called, how long is spent in it and how many bytes it serialises. This is recorded whether or not
+a capture is in progress, so it can be used to measure the overhead while idle.
+
+:param bool enabled: Whether profiling should be enabled.
+)");
+  virtual void SetCallProfiling(bool enabled) = 0;
+
+  DOCUMENT(R"(Request the table of per-entry point overhead recorded since profiling was enabled or
+the last reset. The table arrives later as a message of type
+:attr:`TargetControlMessageType.CallProfile`.
+
+:param bool reset: If ``True``, the counts are reset on the target once they have been sent.
+)");
+  virtual void RequestCallProfile(bool reset) = 0;
+
+  DOCUMENT(R"(Change the capture options on the target while it is running. Options which only take
+effect at initialisation, such as :data:`CaptureOptions.apiValidation` or
+:data:`CaptureOptions.hookIntoChildren`, will not apply until a new device is created.
+
+This can be used to enable automatic hitch captures on a program that is already running.
+
+:param CaptureOptions opts: The new capture options.
+)");
+  virtual void SetCaptureOptions(const CaptureOptions &opts) = 0;
+
 protected:
   ITargetControl() = default;
   ~ITargetControl() = default;
@@ -1421,6 +1509,28 @@ representation back to native RDC.
   virtual ReplayStatus Convert(const char *filename, const char *filetype, const SDFile *file,
                                RENDERDOC_ProgressCallback progress) = 0;
 
+  DOCUMENT(R"(Saves the currently loaded capture to disk with its deduplicated initial contents
+moved to a different place.
+
+Captures can store the unique blocks of their initial contents in a shared store directory, to save
+space when many captures of the same content are made. Such captures are not standalone, so before
+moving one to another machine it can be packed to put the blocks it uses back inside it, or a
+standalone capture can be unpacked into a store.
+
+It is invalid to call this function if :meth:`OpenFile` has not previously been called to open the
+file.
+
+:param str filename: The filename to save to. This must be different from the loaded file.
+:param str storePath: The store directory to move the blocks into, or empty to store them in the
+  capture.
+:param ProgressCallback progress: A callback that will be repeatedly called with an updated progress
+  value. Can be ``None`` if no progress is desired.
+:return: The status of the operation, whether it succeeded or failed (and how it failed).
+:rtype: ReplayStatus
+)");
+  virtual ReplayStatus RelocateContentBlocks(const char *filename, const char *storePath,
+                                             RENDERDOC_ProgressCallback progress) = 0;
+
   DOCUMENT(R"(Returns the human-readable error string for the last error received.
 
 The error string is not reset by calling this function so it's safe to call multiple times. However
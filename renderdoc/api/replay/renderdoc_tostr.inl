@@ -1005,6 +1005,8 @@ rdcstr DoStringise(const SectionType &el)
     STRINGISE_ENUM_CLASS_NAMED(ResourceRenames, "renderdoc/ui/resrenames");
     STRINGISE_ENUM_CLASS_NAMED(AMDRGPProfile, "amd/rgp/profile");
     STRINGISE_ENUM_CLASS_NAMED(ExtendedThumbnail, "renderdoc/internal/exthumb");
+    STRINGISE_ENUM_CLASS_NAMED(AnalysisCache, "renderdoc/internal/analysiscache");
+    STRINGISE_ENUM_CLASS_NAMED(ContentBlocks, "renderdoc/internal/contentblocks");
   }
   END_ENUM_STRINGISE();
 }
@@ -86,6 +86,24 @@ version of RenderDoc that addes a new section type. They should be considered eq
   lossless.
 
   The name for this section will be "renderdoc/internal/exthumb".
+
+.. data:: AnalysisCache
+
+  This section contains cached results of analysing the capture, such as counter results and
+  resource usage, so that they don't have to be recomputed when the capture is opened again. The
+  results are only used when replaying with the same API, GPU driver and RenderDoc version that
+  computed them. See :meth:`ReplayController.GetAnalysisCache`.
+
+  The name for this section will be "renderdoc/internal/analysiscache".
+
+.. data:: ContentBlocks
+
+  This section contains the unique blocks of deduplicated resource initial contents, which the frame
+  capture refers to by hash. The blocks may instead be held in a store directory on disk shared
+  between captures, in which case this section only contains the index of blocks and the path to
+  the store. See :meth:`CaptureFile.RelocateContentBlocks`.
+
+  The name for this section will be "renderdoc/internal/contentblocks".
 )");
 enum class SectionType : uint32_t
 {
@@ -98,6 +116,8 @@ enum class SectionType : uint32_t
   ResourceRenames,
   AMDRGPProfile,
   ExtendedThumbnail,
+  AnalysisCache,
+  ContentBlocks,
   Count,
 };
 
@@ -3467,6 +3487,15 @@ DOCUMENT(R"(The type of message received from or sent to an application target c
 .. data:: CaptureProgress
 
   Progress update on an on-going frame capture.
+
+.. data:: CapturableWindowCount
+
+  The number of capturable windows has changed.
+
+.. data:: CallProfile
+
+  The table of per-entry point overhead that was requested with
+  :meth:`TargetControl.RequestCallProfile`.
 )");
 enum class TargetControlMessageType : uint32_t
 {
@@ -3479,7 +3508,8 @@ enum class TargetControlMessageType : uint32_t
   RegisterAPI,
   NewChild,
   CaptureProgress,
-  CapturableWindowCount
+  CapturableWindowCount,
+  CallProfile,
 };
 
 DECLARE_REFLECTION_ENUM(TargetControlMessageType);
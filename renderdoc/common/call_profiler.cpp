@@ -0,0 +1,309 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "call_profiler.h"
+#include "api/replay/renderdoc_replay.h"
+#include "common/threading.h"
+
+namespace CallProfiler
+{
+volatile int32_t Active = 0;
+
+struct CallStats
+{
+  uint64_t calls;
+  uint64_t ticks;
+  uint64_t bytes;
+};
+
+// stats are stored in fixed-size blocks that are never reallocated, so that other threads can read
+// them while the owning thread keeps adding entry points. New blocks are published under the
+// registry lock, but the counters themselves are only written by the owning thread and read without
+// synchronisation so a fetched table may be very slightly stale.
+static const uint32_t BlockSize = 256;
+static const uint32_t MaxBlocks = 64;
+
+struct Registry
+{
+  Threading::CriticalSection lock;
+  rdcarray<rdcstr> names;
+  rdcarray<ThreadTable *> threads;
+  // totals from the tables of threads that have exited
+  rdcarray<CallStats> exited;
+  rdcarray<CallStats> baseline;
+};
+
+static Registry &GetRegistry()
+{
+  // deliberately leaked, threads may still be calling in during shutdown
+  static Registry *reg = new Registry;
+  return *reg;
+}
+
+struct ThreadTable
+{
+  CallStats *blocks[MaxBlocks] = {};
+  uint32_t current = ~0U;
+
+  CallStats *Get(uint32_t index)
+  {
+    uint32_t b = index / BlockSize;
+
+    if(blocks[b] == NULL)
+    {
+      CallStats *block = new CallStats[BlockSize];
+      memset(block, 0, sizeof(CallStats) * BlockSize);
+
+      SCOPED_LOCK(GetRegistry().lock);
+      blocks[b] = block;
+    }
+
+    return &blocks[b][index % BlockSize];
+  }
+
+  // adds this table's counts into totals, which must already cover every registered entry point
+  void AddTo(rdcarray<CallStats> &totals) const
+  {
+    for(uint32_t b = 0; b < MaxBlocks && b * BlockSize < totals.size(); b++)
+    {
+      const CallStats *block = blocks[b];
+      if(block == NULL)
+        continue;
+
+      for(uint32_t i = 0; i < BlockSize && b * BlockSize + i < totals.size(); i++)
+      {
+        CallStats &total = totals[b * BlockSize + i];
+        total.calls += block[i].calls;
+        total.ticks += block[i].ticks;
+        total.bytes += block[i].bytes;
+      }
+    }
+  }
+};
+
+// the thread's table, and whether the thread has exited. These are trivially destructible so they
+// can still be checked by anything profiled during the rest of the thread's teardown.
+static thread_local ThreadTable *threadTable = NULL;
+static thread_local bool threadExited = false;
+
+// destroyed when the thread exits, folding the thread's counts into the registry so that threads
+// which come and go don't each leak a table.
+struct ThreadTableReclaimer
+{
+  ~ThreadTableReclaimer()
+  {
+    Registry &reg = GetRegistry();
+
+    {
+      SCOPED_LOCK(reg.lock);
+
+      reg.exited.resize(reg.names.size());
+      threadTable->AddTo(reg.exited);
+      reg.threads.removeOne(threadTable);
+    }
+
+    for(CallStats *block : threadTable->blocks)
+      delete[] block;
+    delete threadTable;
+
+    threadTable = NULL;
+    threadExited = true;
+  }
+};
+
+static ThreadTable *GetThreadTable()
+{
+  if(threadTable == NULL && !threadExited)
+  {
+    static thread_local ThreadTableReclaimer reclaimer;
+
+    threadTable = new ThreadTable;
+
+    Registry &reg = GetRegistry();
+    SCOPED_LOCK(reg.lock);
+    reg.threads.push_back(threadTable);
+  }
+
+  return threadTable;
+}
+
+void SetEnabled(bool enabled)
+{
+  Atomic::CmpExch32(&Active, enabled ? 0 : 1, enabled ? 1 : 0);
+}
+
+uint32_t RegisterEntryPoint(const char *name)
+{
+  Registry &reg = GetRegistry();
+
+  SCOPED_LOCK(reg.lock);
+
+  int32_t idx = reg.names.indexOf(name);
+  if(idx >= 0)
+    return (uint32_t)idx;
+
+  if(reg.names.size() >= BlockSize * MaxBlocks)
+  {
+    RDCERR("Too many profiled entry points, %s will not be recorded", name);
+    return ~0U;
+  }
+
+  reg.names.push_back(name);
+  return uint32_t(reg.names.size() - 1);
+}
+
+ThreadTable *Begin(uint32_t index, uint32_t &prev)
+{
+  if(index == ~0U)
+    return NULL;
+
+  ThreadTable *table = GetThreadTable();
+  if(table == NULL)
+    return NULL;
+
+  prev = table->current;
+  table->current = index;
+  return table;
+}
+
+void End(ThreadTable *table, uint32_t index, uint32_t prev, uint64_t ticks)
+{
+  CallStats *stats = table->Get(index);
+  stats->calls++;
+  stats->ticks += ticks;
+  table->current = prev;
+}
+
+void RecordBytes(uint64_t bytes)
+{
+  if(!IsEnabled())
+    return;
+
+  ThreadTable *table = GetThreadTable();
+  if(table == NULL || table->current == ~0U)
+    return;
+
+  table->Get(table->current)->bytes += bytes;
+}
+
+rdcarray<CallProfileEntry> Fetch(bool reset)
+{
+  Registry &reg = GetRegistry();
+
+  SCOPED_LOCK(reg.lock);
+
+  rdcarray<CallStats> totals = reg.exited;
+  totals.resize(reg.names.size());
+
+  for(ThreadTable *table : reg.threads)
+    table->AddTo(totals);
+
+  // entry points registered after the last reset have an implicit zero baseline
+  reg.baseline.resize(totals.size());
+
+  const double ticksToMicro = 1000.0 / Timing::GetTickFrequency();
+
+  rdcarray<CallProfileEntry> ret;
+  for(size_t i = 0; i < totals.size(); i++)
+  {
+    const CallStats &base = reg.baseline[i];
+
+    if(totals[i].calls == base.calls)
+      continue;
+
+    CallProfileEntry entry;
+    entry.name = reg.names[i];
+    entry.callCount = totals[i].calls - base.calls;
+    entry.totalMicroseconds = double(totals[i].ticks - base.ticks) * ticksToMicro;
+    entry.serialisedBytes = totals[i].bytes - base.bytes;
+    ret.push_back(entry);
+  }
+
+  if(reset)
+    reg.baseline = totals;
+
+  return ret;
+}
+};
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Call profiler across exiting threads", "[callprofiler]")
+{
+  CallProfiler::Registry &reg = CallProfiler::GetRegistry();
+
+  size_t numThreads = 0;
+  {
+    SCOPED_LOCK(reg.lock);
+    numThreads = reg.threads.size();
+  }
+
+  bool wasEnabled = CallProfiler::IsEnabled();
+  CallProfiler::SetEnabled(true);
+
+  uint32_t index = CallProfiler::RegisterEntryPoint("CallProfilerTest");
+
+  rdcarray<Threading::ThreadHandle> threads;
+  for(int t = 0; t < 4; t++)
+  {
+    threads.push_back(Threading::CreateThread([index]() {
+      for(int i = 0; i < 10; i++)
+      {
+        CallProfiler::Scope scope(index);
+        CallProfiler::RecordBytes(3);
+      }
+    }));
+  }
+
+  for(Threading::ThreadHandle t : threads)
+  {
+    Threading::JoinThread(t);
+    Threading::CloseThread(t);
+  }
+
+  CallProfiler::SetEnabled(wasEnabled);
+
+  // the exited threads' tables are gone, but their counts remain
+  {
+    SCOPED_LOCK(reg.lock);
+    CHECK(reg.threads.size() == numThreads);
+  }
+
+  uint64_t calls = 0, bytes = 0;
+  for(const CallProfileEntry &entry : CallProfiler::Fetch(false))
+  {
+    if(entry.name == "CallProfilerTest")
+    {
+      calls = entry.callCount;
+      bytes = entry.serialisedBytes;
+    }
+  }
+
+  CHECK(calls == 40);
+  CHECK(bytes == 40 * 3);
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
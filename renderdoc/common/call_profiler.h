@@ -0,0 +1,96 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "common/common.h"
+#include "os/os_specific.h"
+
+struct CallProfileEntry;
+
+// lightweight opt-in instrumentation of API entry points while capturing. Each instrumented
+// function registers itself once by name, then each call records its count, wall-clock time and
+// the bytes of any chunk serialised during it into a table owned by the calling thread, so there
+// is no contention between application threads. The tables are summed across threads on request,
+// and a thread's table is folded into the totals when it exits.
+//
+// When profiling is disabled the cost of a call is a single flag check.
+namespace CallProfiler
+{
+extern volatile int32_t Active;
+
+inline bool IsEnabled()
+{
+  return Active != 0;
+}
+
+void SetEnabled(bool enabled);
+
+// returns a stable index for the named entry point. Registering the same name twice returns the
+// same index.
+uint32_t RegisterEntryPoint(const char *name);
+
+struct ThreadTable;
+
+// marks the entry point as the innermost one being profiled on this thread, returning the thread's
+// table and the previous innermost entry point so it can be restored by End()
+ThreadTable *Begin(uint32_t index, uint32_t &prev);
+void End(ThreadTable *table, uint32_t index, uint32_t prev, uint64_t ticks);
+
+// attributes bytes to the innermost entry point being profiled on this thread, if any
+void RecordBytes(uint64_t bytes);
+
+// sums the per-thread tables and returns every entry point that has been called since the last
+// reset. If reset is true, the returned counts become the new baseline.
+rdcarray<CallProfileEntry> Fetch(bool reset);
+
+class Scope
+{
+public:
+  Scope(uint32_t index)
+  {
+    if(IsEnabled())
+    {
+      m_Index = index;
+      m_Table = Begin(index, m_Prev);
+      m_Start = Timing::GetTick();
+    }
+  }
+  ~Scope()
+  {
+    if(m_Table)
+      End(m_Table, m_Index, m_Prev, Timing::GetTick() - m_Start);
+  }
+
+private:
+  ThreadTable *m_Table = NULL;
+  uint32_t m_Index = ~0U;
+  uint32_t m_Prev = ~0U;
+  uint64_t m_Start = 0;
+};
+};
+
+#define SCOPED_CALL_PROFILE(name)                                                               \
+  static const uint32_t CONCAT(callprofidx, __LINE__) = CallProfiler::RegisterEntryPoint(name); \
+  CallProfiler::Scope CONCAT(callprofscope, __LINE__)(CONCAT(callprofidx, __LINE__));
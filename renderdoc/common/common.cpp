@@ -251,6 +251,249 @@ uint64_t Log2Floor(uint64_t value)
 static rdcstr logfile;
 static FileIO::LogFileHandle *logfileHandle = NULL;
 
+static bool log_output_enabled = false;
+
+// log lines are queued into a ring that any thread can write to without taking a lock, and are
+// written out in batches by a background thread so that logging doesn't cost a syscall per line on
+// the thread that logged. Space is reserved by moving the write cursor with a compare-exchange, so
+// records are in the order they were logged in, and each one is committed once its text has been
+// copied in. Reading stops at the first record that isn't committed yet to keep that order.
+struct LogRecord
+{
+  // 0 while the record is being written, then RecordText or RecordPadding once it's committed
+  volatile int32_t state;
+  LogType type;
+  // length of the text following the record, not including its NUL terminator
+  uint32_t length;
+  // offset into the text of the message without its prefix
+  uint32_t msgOffset;
+};
+
+class LogRing
+{
+public:
+  static const int32_t RecordText = 1;
+  // the space at the end of the ring skipped by a record that didn't fit before wrapping
+  static const int32_t RecordPadding = 2;
+
+  // size must be a power of two
+  LogRing(uint32_t size) : m_Size(size)
+  {
+    m_Data = AllocAlignedBuffer(size, sizeof(LogRecord));
+    memset(m_Data, 0, size);
+  }
+  ~LogRing() { FreeAlignedBuffer(m_Data); }
+  // anything longer than this won't be queued and must be written out directly
+  uint32_t MaxLength() const { return uint32_t(m_Size / 4); }
+  // returns false if there isn't enough space free, and the ring must be drained before retrying
+  bool Push(LogType type, const char *text, uint32_t length, uint32_t msgOffset)
+  {
+    const int64_t recordSize = RecordSize(length);
+
+    int64_t write, skip;
+    for(;;)
+    {
+      write = Atomic::ExchAdd64(&m_Write, 0);
+      int64_t read = Atomic::ExchAdd64(&m_Read, 0);
+
+      // records never wrap, if this one doesn't fit before the end of the ring skip to the start
+      skip = m_Size - (write & (m_Size - 1));
+      if(skip >= recordSize)
+        skip = 0;
+
+      if(write + skip + recordSize - read > m_Size)
+        return false;
+
+      if(Atomic::CmpExch64(&m_Write, write, write + skip + recordSize) == write)
+        break;
+    }
+
+    if(skip > 0)
+    {
+      Atomic::CmpExch32(&GetRecord(write)->state, 0, RecordPadding);
+      write += skip;
+    }
+
+    LogRecord *record = GetRecord(write);
+    record->type = type;
+    record->length = length;
+    record->msgOffset = msgOffset;
+    char *dst = (char *)(record + 1);
+    memcpy(dst, text, length);
+    dst[length] = 0;
+
+    // the compare-exchange is a full barrier, so the record is complete before it's committed
+    Atomic::CmpExch32(&record->state, 0, RecordText);
+
+    return true;
+  }
+
+  // passes each committed record in order to the callback, then frees their space. Only one thread
+  // may drain at once.
+  template <typename Callback>
+  void Drain(Callback callback)
+  {
+    const int64_t start = Atomic::ExchAdd64(&m_Read, 0);
+    const int64_t write = Atomic::ExchAdd64(&m_Write, 0);
+
+    int64_t read = start;
+    while(read < write)
+    {
+      LogRecord *record = GetRecord(read);
+
+      int32_t state = Atomic::CmpExch32(&record->state, 0, 0);
+
+      // stop at the first record that's still being written
+      if(state == 0)
+        break;
+
+      int64_t recordSize;
+      if(state == RecordText)
+      {
+        callback(*record, (const char *)(record + 1));
+        recordSize = RecordSize(record->length);
+      }
+      else
+      {
+        recordSize = m_Size - (read & (m_Size - 1));
+      }
+
+      // clear the space so that a record reserved here later reads as uncommitted until it's
+      // written, wherever it starts.
+      memset(record, 0, (size_t)recordSize);
+
+      read += recordSize;
+    }
+
+    if(read != start)
+      Atomic::ExchAdd64(&m_Read, read - start);
+  }
+
+private:
+  static int64_t RecordSize(uint32_t length)
+  {
+    return sizeof(LogRecord) + AlignUp<int64_t>(length + 1, sizeof(LogRecord));
+  }
+
+  LogRecord *GetRecord(int64_t pos) { return (LogRecord *)(m_Data + (pos & (m_Size - 1))); }
+  const int64_t m_Size;
+  byte *m_Data;
+
+  // the cursors only ever increase, their position in the ring is masked by the size
+  volatile int64_t m_Write = 0;
+  volatile int64_t m_Read = 0;
+};
+
+struct LogQueue
+{
+  LogQueue() : ring(1024 * 1024) {}
+  LogRing ring;
+
+  // held while draining the ring and writing out, or changing the log file
+  Threading::CriticalSection flushLock;
+  rdcstr batch;
+
+  Threading::ThreadHandle flusher = 0;
+  volatile int32_t flusherRunning = 0;
+  volatile int32_t flusherExit = 0;
+  // set while there's a crash handler to flush the queue if we crash
+  volatile int32_t asyncAllowed = 0;
+};
+
+static LogQueue &GetLogQueue()
+{
+  // never destroyed, so that logging keeps working during static destruction
+  static LogQueue *queue = new LogQueue();
+  return *queue;
+}
+
+static void WriteLogOutput(LogType type, const char *text, const char *msg)
+{
+#if ENABLED(OUTPUT_LOG_TO_DEBUG_OUT)
+  OSUtility::WriteOutput(OSUtility::Output_DebugMon, text);
+#endif
+#if ENABLED(OUTPUT_LOG_TO_STDOUT)
+  // don't output debug messages to stdout/stderr
+  if(type != LogType::Debug && log_output_enabled)
+    OSUtility::WriteOutput(OSUtility::Output_StdOut, msg);
+#endif
+#if ENABLED(OUTPUT_LOG_TO_STDERR)
+  // don't output debug messages to stdout/stderr
+  if(type != LogType::Debug && log_output_enabled)
+    OSUtility::WriteOutput(OSUtility::Output_StdErr, msg);
+#endif
+}
+
+// must be called with the flush lock held
+static void DrainLogQueue(LogQueue &queue)
+{
+  queue.ring.Drain([&queue](const LogRecord &record, const char *text) {
+    WriteLogOutput(record.type, text, text + record.msgOffset);
+#if ENABLED(OUTPUT_LOG_TO_DISK)
+    queue.batch.append(text, record.length);
+#endif
+  });
+
+#if ENABLED(OUTPUT_LOG_TO_DISK)
+  if(logfileHandle && !queue.batch.empty())
+    FileIO::logfile_append(logfileHandle, queue.batch.c_str(), queue.batch.size());
+#endif
+
+  queue.batch.clear();
+}
+
+static void FlushLogQueue()
+{
+  LogQueue &queue = GetLogQueue();
+  SCOPED_LOCK(queue.flushLock);
+  DrainLogQueue(queue);
+}
+
+static void LogFlusherThread()
+{
+  LogQueue &queue = GetLogQueue();
+
+  while(Atomic::CmpExch32(&queue.flusherExit, 0, 0) == 0)
+  {
+    FlushLogQueue();
+    Threading::Sleep(10);
+  }
+
+  Atomic::CmpExch32(&queue.flusherRunning, 1, 0);
+}
+
+// must be called with a log file open
+static void StartLogFlusher(LogQueue &queue)
+{
+  if(Atomic::CmpExch32(&queue.asyncAllowed, 0, 0) == 0)
+    return;
+
+  if(Atomic::CmpExch32(&queue.flusherRunning, 0, 1) == 0)
+  {
+    Atomic::CmpExch32(&queue.flusherExit, 1, 0);
+    queue.flusher = Threading::CreateThread(&LogFlusherThread);
+  }
+}
+
+static void StopLogFlusher(LogQueue &queue)
+{
+  // stop the flusher, giving it a moment to notice. It isn't joined since this can be called while
+  // the module is being unloaded, and from then on everything is written out synchronously.
+  if(queue.flusher)
+  {
+    Atomic::CmpExch32(&queue.flusherExit, 0, 1);
+
+    for(int i = 0; i < 50 && Atomic::CmpExch32(&queue.flusherRunning, 0, 0) != 0; i++)
+      Threading::Sleep(1);
+
+    Atomic::CmpExch32(&queue.flusherRunning, 1, 0);
+
+    Threading::DetachThread(queue.flusher);
+    Threading::CloseThread(queue.flusher);
+    queue.flusher = 0;
+  }
+}
+
 const char *rdclog_getfilename()
 {
   return logfile.c_str();
@@ -258,19 +501,33 @@ const char *rdclog_getfilename()
 
 void rdclog_filename(const char *filename)
 {
+  LogQueue &queue = GetLogQueue();
+
   rdcstr previous = logfile;
 
+  {
+    SCOPED_LOCK(queue.flushLock);
+
+    // anything logged so far goes to the old file
+    DrainLogQueue(queue);
+
+    FileIO::logfile_close(logfileHandle, NULL);
+
+    logfileHandle = NULL;
+  }
+
   logfile = "";
   if(filename && filename[0])
     logfile = filename;
 
-  FileIO::logfile_close(logfileHandle, NULL);
-
-  logfileHandle = NULL;
-
   if(!logfile.empty())
   {
-    logfileHandle = FileIO::logfile_open(logfile.c_str());
+    // opening can log, so don't hold the lock until there's a handle to set
+    FileIO::LogFileHandle *handle = FileIO::logfile_open(logfile.c_str());
+
+    SCOPED_LOCK(queue.flushLock);
+
+    logfileHandle = handle;
 
     if(logfileHandle && previous.c_str())
     {
@@ -282,11 +539,14 @@ void rdclog_filename(const char *filename)
 
       FileIO::Delete(previous.c_str());
     }
+
+    DrainLogQueue(queue);
+
+    if(logfileHandle)
+      StartLogFlusher(queue);
   }
 }
 
-static bool log_output_enabled = false;
-
 void rdclog_enableoutput()
 {
   log_output_enabled = true;
@@ -294,44 +554,97 @@ void rdclog_enableoutput()
 
 void rdclog_closelog(const char *filename)
 {
+  LogQueue &queue = GetLogQueue();
+
+  StopLogFlusher(queue);
+
+  SCOPED_LOCK(queue.flushLock);
+
+  DrainLogQueue(queue);
+
   log_output_enabled = false;
   FileIO::logfile_close(logfileHandle, filename);
+  logfileHandle = NULL;
 }
 
 void rdclog_flush()
 {
+  FlushLogQueue();
 }
 
-void rdclogprint_int(LogType type, const char *fullMsg, const char *msg)
+void rdclog_asyncwrites(bool enable)
 {
-  static Threading::CriticalSection *lock = new Threading::CriticalSection();
+  LogQueue &queue = GetLogQueue();
 
-  SCOPED_LOCK(*lock);
+  if(enable)
+  {
+    Atomic::CmpExch32(&queue.asyncAllowed, 0, 1);
 
-#if ENABLED(OUTPUT_LOG_TO_DEBUG_OUT)
-  OSUtility::WriteOutput(OSUtility::Output_DebugMon, fullMsg);
-#endif
-#if ENABLED(OUTPUT_LOG_TO_STDOUT)
-  // don't output debug messages to stdout/stderr
-  if(type != LogType::Debug && log_output_enabled)
-    OSUtility::WriteOutput(OSUtility::Output_StdOut, msg);
-#endif
-#if ENABLED(OUTPUT_LOG_TO_STDERR)
-  // don't output debug messages to stdout/stderr
-  if(type != LogType::Debug && log_output_enabled)
-    OSUtility::WriteOutput(OSUtility::Output_StdErr, msg);
-#endif
-#if ENABLED(OUTPUT_LOG_TO_DISK)
-  if(logfileHandle)
+    SCOPED_LOCK(queue.flushLock);
+    if(logfileHandle)
+      StartLogFlusher(queue);
+  }
+  else
   {
-    // strlen used as byte length - str is UTF-8 so this is NOT number of characters
-    FileIO::logfile_append(logfileHandle, fullMsg, strlen(fullMsg));
+    Atomic::CmpExch32(&queue.asyncAllowed, 1, 0);
+
+    StopLogFlusher(queue);
+    FlushLogQueue();
   }
+}
+
+void rdclog_crashflush()
+{
+  LogQueue &queue = GetLogQueue();
+
+  if(queue.flushLock.Trylock())
+  {
+    DrainLogQueue(queue);
+    queue.flushLock.Unlock();
+  }
+}
+
+void rdclogprint_int(LogType type, const char *fullMsg, const char *msg)
+{
+  LogQueue &queue = GetLogQueue();
+
+  size_t length = strlen(fullMsg);
+  // msg is always the end of fullMsg, without the prefix
+  size_t msgLength = strlen(msg);
+  uint32_t msgOffset = msgLength <= length ? uint32_t(length - msgLength) : 0;
+
+  // lines are only queued while the flusher thread is running to write them out, which is only
+  // when a crash handler can flush the queue. Otherwise queueing would just add a copy to writing
+  // each line out on this thread, so it's written directly as before. Lines too large to queue are
+  // also written directly, after everything queued before them.
+  if(Atomic::CmpExch32(&queue.flusherRunning, 0, 0) == 0 || length > queue.ring.MaxLength())
+  {
+    SCOPED_LOCK(queue.flushLock);
+
+    DrainLogQueue(queue);
+
+    WriteLogOutput(type, fullMsg, msg);
+#if ENABLED(OUTPUT_LOG_TO_DISK)
+    if(logfileHandle)
+    {
+      // strlen used as byte length - str is UTF-8 so this is NOT number of characters
+      FileIO::logfile_append(logfileHandle, fullMsg, length);
+    }
 #endif
+    return;
+  }
+
+  // if the ring is full, make space by writing it out on this thread
+  while(!queue.ring.Push(type, fullMsg, uint32_t(length), msgOffset))
+    FlushLogQueue();
+
+  // errors are written out immediately in case we're about to crash. If the flusher stopped since
+  // this line was queued, there's nothing else to write it out.
+  if(type >= LogType::Error || Atomic::CmpExch32(&queue.flusherRunning, 0, 0) == 0)
+    FlushLogQueue();
 }
 
 const int rdclog_outBufSize = 4 * 1024;
-static char rdclog_outputBuffer[rdclog_outBufSize + 3];
 
 static void write_newline(char *output)
 {
@@ -376,13 +689,11 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
       "Debug  ", "Log    ", "Warning", "Error  ", "Fatal  ",
   };
 
-  static Threading::CriticalSection *lock = new Threading::CriticalSection();
-
-  SCOPED_LOCK(*lock);
-
-  rdclog_outputBuffer[rdclog_outBufSize] = rdclog_outputBuffer[0] = 0;
+  // formatted on the stack so that threads logging at once don't contend
+  char outputBuffer[rdclog_outBufSize + 3];
+  outputBuffer[rdclog_outBufSize] = outputBuffer[0] = 0;
 
-  char *output = rdclog_outputBuffer;
+  char *output = outputBuffer;
   size_t available = rdclog_outBufSize;
 
   char *base = output;
@@ -420,7 +731,7 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
 
   output += numWritten;
 
-  // we overran the static buffer. This is a 4k buffer so we won't be hitting this case often - just
+  // we overran the stack buffer. This is a 4k buffer so we won't be hitting this case often - just
   // do the simple thing of allocating a temporary, print again, and re-assigning.
   char *oversizedBuffer = NULL;
   if(totalWritten > rdclog_outBufSize)
@@ -501,3 +812,177 @@ void rdclog_direct(time_t utcTime, uint32_t pid, LogType type, const char *proje
 
   SAFE_DELETE_ARRAY(oversizedBuffer);
 }
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+#include "common/formatting.h"
+#include "common/timing.h"
+
+TEST_CASE("Test log ring", "[common]")
+{
+  // small enough that it wraps and fills up many times over
+  LogRing ring(4096);
+
+  const int32_t numThreads = 8;
+  const int32_t numLines = 2000;
+
+  volatile int32_t producing = numThreads;
+  rdcarray<int32_t> lastLine;
+  lastLine.fill(numThreads, -1);
+  int32_t outOfOrder = 0, badText = 0, count = 0;
+
+  auto consume = [&](const LogRecord &record, const char *text) {
+    int32_t thread = -1, line = -1;
+    if(sscanf(text, "prefix - thread %d line %d", &thread, &line) != 2 || thread < 0 ||
+       thread >= numThreads || strlen(text) != record.length ||
+       strncmp(text + record.msgOffset, "thread", 6) != 0)
+    {
+      badText++;
+      return;
+    }
+
+    if(line != lastLine[thread] + 1)
+      outOfOrder++;
+    lastLine[thread] = line;
+    count++;
+  };
+
+  rdcarray<Threading::ThreadHandle> threads;
+  for(int32_t t = 0; t < numThreads; t++)
+  {
+    threads.push_back(Threading::CreateThread([&ring, &producing, t]() {
+      // vary the length of the lines so they wrap at different points
+      rdcstr padding;
+      padding.resize(200);
+      for(char &c : padding)
+        c = 'x';
+
+      for(int32_t i = 0; i < numLines; i++)
+      {
+        rdcstr text = StringFormat::Fmt("prefix - thread %d line %d %s\n", t, i,
+                                        padding.substr(0, i % 200).c_str());
+        while(!ring.Push(LogType::Comment, text.c_str(), (uint32_t)text.size(), 9))
+          Threading::Sleep(0);
+      }
+      Atomic::Dec32(&producing);
+    }));
+  }
+
+  while(Atomic::CmpExch32(&producing, 0, 0) != 0)
+    ring.Drain(consume);
+
+  for(Threading::ThreadHandle t : threads)
+  {
+    Threading::JoinThread(t);
+    Threading::CloseThread(t);
+  }
+
+  ring.Drain(consume);
+
+  CHECK(badText == 0);
+  CHECK(outOfOrder == 0);
+  CHECK(count == numThreads * numLines);
+}
+
+// not run by default, use "[benchmark]" to run it
+TEST_CASE("Concurrent logging", "[.][benchmark][common]")
+{
+  const uint32_t numLines = 20000;
+
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/renderdoc_log_benchmark.log";
+
+  for(uint32_t numThreads = 1; numThreads <= 16; numThreads *= 2)
+  {
+    FileIO::LogFileHandle *handle = FileIO::logfile_open(filename.c_str());
+
+    // each line written out under a lock on the thread that logged it, as is done whenever the
+    // flusher thread isn't running
+    Threading::CriticalSection lock;
+
+    auto runThreads = [numThreads](std::function<void()> work) {
+      rdcarray<Threading::ThreadHandle> threads;
+      for(uint32_t t = 0; t < numThreads; t++)
+        threads.push_back(Threading::CreateThread(work));
+      for(Threading::ThreadHandle t : threads)
+      {
+        Threading::JoinThread(t);
+        Threading::CloseThread(t);
+      }
+    };
+
+    const char line[] =
+        "RDOC 001234: [12:34:56]         core.cpp( 123) - Log     - benchmark line\n";
+    const uint32_t length = sizeof(line) - 1;
+
+    PerformanceTimer timer;
+    runThreads([&]() {
+      for(uint32_t i = 0; i < numLines; i++)
+      {
+        SCOPED_LOCK(lock);
+        FileIO::logfile_append(handle, line, length);
+      }
+    });
+    double lockedMS = timer.GetMilliseconds();
+
+    // queueing with no flusher thread, so each thread writes out the queue after every line. This
+    // is the cost that writing directly avoids
+    LogRing unflushedRing(1024 * 1024);
+    rdcstr unflushedBatch;
+    timer.Restart();
+    runThreads([&]() {
+      for(uint32_t i = 0; i < numLines; i++)
+      {
+        while(!unflushedRing.Push(LogType::Comment, line, length, 0))
+          Threading::Sleep(0);
+
+        SCOPED_LOCK(lock);
+        unflushedRing.Drain([&unflushedBatch](const LogRecord &record, const char *text) {
+          unflushedBatch.append(text, record.length);
+        });
+        FileIO::logfile_append(handle, unflushedBatch.c_str(), unflushedBatch.size());
+        unflushedBatch.clear();
+      }
+    });
+    double unflushedMS = timer.GetMilliseconds();
+
+    LogRing ring(1024 * 1024);
+    volatile int32_t producing = 1;
+    rdcstr batch;
+    Threading::ThreadHandle flusher = Threading::CreateThread([&]() {
+      auto consume = [&batch](const LogRecord &record, const char *text) {
+        batch.append(text, record.length);
+      };
+      while(Atomic::CmpExch32(&producing, 0, 0) != 0)
+      {
+        ring.Drain(consume);
+        FileIO::logfile_append(handle, batch.c_str(), batch.size());
+        batch.clear();
+        Threading::Sleep(1);
+      }
+      ring.Drain(consume);
+      FileIO::logfile_append(handle, batch.c_str(), batch.size());
+    });
+
+    timer.Restart();
+    runThreads([&]() {
+      for(uint32_t i = 0; i < numLines; i++)
+        while(!ring.Push(LogType::Comment, line, length, 0))
+          Threading::Sleep(0);
+    });
+    double queuedMS = timer.GetMilliseconds();
+
+    Atomic::Dec32(&producing);
+    Threading::JoinThread(flusher);
+    Threading::CloseThread(flusher);
+    double flushedMS = timer.GetMilliseconds();
+
+    FileIO::logfile_close(handle, filename.c_str());
+
+    RDCLOG("%u threads: locked %.2f ms, queued without flusher %.2f ms, queued %.2f ms (%.2f ms "
+           "until written)",
+           numThreads, lockedMS, unflushedMS, queuedMS, flushedMS);
+  }
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -347,6 +347,12 @@ const char *rdclog_getfilename();
 void rdclog_filename(const char *filename);
 void rdclog_enableoutput();
 void rdclog_closelog(const char *filename);
+// allow log output to be queued and written out by a background thread. This is only enabled while
+// a crash handler is installed that can flush the queue, otherwise output is written immediately.
+void rdclog_asyncwrites(bool enable);
+// flush the log from a crash handler. Skipped if another thread is mid-flush, as it may be the one
+// that crashed.
+void rdclog_crashflush();
 
 #define RDCLOGFILE(fn) rdclog_filename(fn)
 #define RDCGETLOGFILE() rdclog_getfilename()
@@ -0,0 +1,505 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "jobsystem.h"
+#include "common/formatting.h"
+
+namespace Threading
+{
+struct JobData
+{
+  JobData(JobSystem *sys, std::function<void()> &&f) : system(sys), func(std::move(f)) {}
+  JobSystem *system;
+  std::function<void()> func;
+  PendingWork *pending = NULL;
+
+  volatile int32_t refCount = 1;
+  // starts at 1 while dependencies are being registered, so the job can't be queued early
+  volatile int32_t remainingDeps = 1;
+  volatile int32_t complete = 0;
+  volatile int32_t cancelled = 0;
+
+  // protects dependants, and ensures that a dependant is either added before completion (and
+  // notified) or sees the job as complete
+  SpinLock lock;
+  rdcarray<JobData *> dependants;
+};
+
+static void AddRef(JobData *job)
+{
+  Atomic::Inc32(&job->refCount);
+}
+
+static void Release(JobData *job)
+{
+  if(Atomic::Dec32(&job->refCount) == 0)
+    delete job;
+}
+
+static bool IsSet(const volatile int32_t &flag)
+{
+  return Atomic::CmpExch32((volatile int32_t *)&flag, 0, 0) != 0;
+}
+
+// TLS slots for the worker owning this thread (if any), and the job currently executing on it.
+// These are shared by all job systems.
+static uint64_t WorkerSlot()
+{
+  static uint64_t slot = AllocateTLSSlot();
+  return slot;
+}
+
+static uint64_t CurrentJobSlot()
+{
+  static uint64_t slot = AllocateTLSSlot();
+  return slot;
+}
+
+Job::Job(const Job &o) : m_Data(o.m_Data)
+{
+  if(m_Data)
+    AddRef(m_Data);
+}
+
+Job &Job::operator=(const Job &o)
+{
+  if(o.m_Data)
+    AddRef(o.m_Data);
+  if(m_Data)
+    Release(m_Data);
+  m_Data = o.m_Data;
+  return *this;
+}
+
+Job::~Job()
+{
+  if(m_Data)
+    Release(m_Data);
+}
+
+bool Job::IsComplete() const
+{
+  return m_Data == NULL || IsSet(m_Data->complete);
+}
+
+bool Job::IsCancelled() const
+{
+  return m_Data && IsSet(m_Data->cancelled);
+}
+
+void Job::Cancel()
+{
+  if(m_Data)
+    Atomic::CmpExch32(&m_Data->cancelled, 0, 1);
+}
+
+void Job::Wait() const
+{
+  if(m_Data)
+    m_Data->system->WaitFor(m_Data);
+}
+
+void JobSystem::JobQueue::Push(JobData *job)
+{
+  ScopedSpinLock scoped(lock);
+  jobs.push_back(job);
+}
+
+JobData *JobSystem::JobQueue::PopBack()
+{
+  ScopedSpinLock scoped(lock);
+  if(head >= jobs.size())
+    return NULL;
+
+  JobData *ret = jobs.back();
+  jobs.pop_back();
+
+  if(head == jobs.size())
+  {
+    jobs.clear();
+    head = 0;
+  }
+
+  return ret;
+}
+
+JobData *JobSystem::JobQueue::PopFront()
+{
+  ScopedSpinLock scoped(lock);
+  if(head >= jobs.size())
+    return NULL;
+
+  JobData *ret = jobs[head++];
+
+  if(head == jobs.size())
+  {
+    jobs.clear();
+    head = 0;
+  }
+
+  return ret;
+}
+
+JobSystem::JobSystem(uint32_t numWorkers)
+{
+  // ensure the TLS slots are allocated before any worker might race to do it
+  WorkerSlot();
+  CurrentJobSlot();
+
+  m_Workers.resize(numWorkers);
+  for(uint32_t i = 0; i < numWorkers; i++)
+  {
+    m_Workers[i] = new Worker;
+    m_Workers[i]->system = this;
+    m_Workers[i]->index = i;
+  }
+
+  // start threads once all workers exist, since they can steal from each other immediately
+  for(Worker *w : m_Workers)
+    w->thread = CreateThread([w]() { w->system->WorkerMain(w); });
+}
+
+JobSystem::~JobSystem()
+{
+  // let any outstanding work finish, since jobs may reference data owned by whoever queued them
+  while(IsSet(m_Queued))
+  {
+    if(!RunOne(NULL))
+      Sleep(0);
+  }
+
+  SignalShutdown();
+
+  for(Worker *w : m_Workers)
+  {
+    JoinThread(w->thread);
+    CloseThread(w->thread);
+    delete w;
+  }
+}
+
+void JobSystem::SignalShutdown()
+{
+  Atomic::CmpExch32(&m_Shutdown, 0, 1);
+  m_Wake.Release(GetNumWorkers());
+
+  CancelQueued();
+}
+
+void JobSystem::CancelQueued()
+{
+  // nothing still queued will run now, but it must still complete so that anything waiting on it
+  // - including pending work - isn't left hanging
+  while(JobData *job = Dequeue(NULL))
+  {
+    Atomic::CmpExch32(&job->cancelled, 0, 1);
+    job->func = std::function<void()>();
+    Complete(job);
+    Release(job);
+  }
+}
+
+Job JobSystem::Submit(std::function<void()> func, const rdcarray<Job> &dependencies,
+                      PendingWork *pending)
+{
+  // the initial reference belongs to the returned handle
+  JobData *job = new JobData(this, std::move(func));
+
+  if(pending)
+  {
+    pending->Begin();
+    job->pending = pending;
+  }
+
+  for(const Job &dep : dependencies)
+  {
+    JobData *d = dep.m_Data;
+    if(d == NULL)
+      continue;
+
+    ScopedSpinLock scoped(d->lock);
+    if(IsSet(d->complete))
+    {
+      if(IsSet(d->cancelled))
+        Atomic::CmpExch32(&job->cancelled, 0, 1);
+    }
+    else
+    {
+      AddRef(job);
+      d->dependants.push_back(job);
+      Atomic::Inc32(&job->remainingDeps);
+    }
+  }
+
+  if(Atomic::Dec32(&job->remainingDeps) == 0)
+    Enqueue(job);
+
+  return Job(job);
+}
+
+void JobSystem::Wait(const rdcarray<Job> &jobs)
+{
+  for(const Job &job : jobs)
+    job.Wait();
+}
+
+void JobSystem::ParallelFor(uint32_t count, std::function<void(uint32_t)> func, uint32_t grainSize)
+{
+  grainSize = RDCMAX(1U, grainSize);
+
+  uint32_t numBatches = (count + grainSize - 1) / grainSize;
+
+  // a few batches per thread is enough to balance the load, more just adds overhead
+  numBatches = RDCMIN(numBatches, (GetNumWorkers() + 1) * 4);
+
+  if(numBatches <= 1 || m_Workers.empty())
+  {
+    for(uint32_t i = 0; i < count; i++)
+      func(i);
+    return;
+  }
+
+  uint32_t batchSize = (count + numBatches - 1) / numBatches;
+
+  rdcarray<Job> jobs;
+  jobs.reserve(numBatches);
+
+  for(uint32_t begin = 0; begin < count; begin += batchSize)
+  {
+    uint32_t end = RDCMIN(count, begin + batchSize);
+    jobs.push_back(Submit([&func, begin, end]() {
+      for(uint32_t i = begin; i < end; i++)
+        func(i);
+    }));
+  }
+
+  Wait(jobs);
+}
+
+bool JobSystem::IsCancelled()
+{
+  JobData *job = (JobData *)GetTLSValue(CurrentJobSlot());
+  return job && IsSet(job->cancelled);
+}
+
+JobSystem::Worker *JobSystem::CurrentWorker()
+{
+  Worker *w = (Worker *)GetTLSValue(WorkerSlot());
+  return (w && w->system == this) ? w : NULL;
+}
+
+void JobSystem::Enqueue(JobData *job)
+{
+  AddRef(job);
+
+  Worker *w = CurrentWorker();
+  if(w)
+    w->queue.Push(job);
+  else
+    m_Shared.Push(job);
+
+  Atomic::Inc32(&m_Queued);
+
+  // after shutdown nothing will dequeue the job to run it, e.g. when a job that was already running
+  // completes and releases its dependants
+  if(IsSet(m_Shutdown))
+  {
+    CancelQueued();
+    return;
+  }
+
+  if(m_Workers.empty())
+  {
+    // with no workers, run jobs here. If we're inside a job already then whoever is running it will
+    // pick this one up once it's done, which avoids recursing arbitrarily deep through dependencies
+    if(GetTLSValue(CurrentJobSlot()) == NULL)
+    {
+      while(RunOne(NULL))
+      {
+      }
+    }
+  }
+  else if(IsSet(m_Sleeping))
+  {
+    m_Wake.Release();
+  }
+}
+
+JobData *JobSystem::Dequeue(Worker *worker)
+{
+  JobData *ret = NULL;
+
+  if(worker)
+    ret = worker->queue.PopBack();
+
+  if(ret == NULL)
+    ret = m_Shared.PopFront();
+
+  // try to steal, starting from the next worker along so that thieves spread out
+  uint32_t start = worker ? worker->index + 1 : 0;
+  for(uint32_t i = 0; ret == NULL && i < m_Workers.size(); i++)
+  {
+    Worker *victim = m_Workers[(start + i) % m_Workers.size()];
+    if(victim != worker)
+      ret = victim->queue.PopFront();
+  }
+
+  if(ret)
+    Atomic::Dec32(&m_Queued);
+
+  return ret;
+}
+
+bool JobSystem::RunOne(Worker *worker)
+{
+  JobData *job = Dequeue(worker);
+  if(job == NULL)
+    return false;
+
+  Execute(job);
+  return true;
+}
+
+void JobSystem::Execute(JobData *job)
+{
+  void *prev = GetTLSValue(CurrentJobSlot());
+  SetTLSValue(CurrentJobSlot(), job);
+
+  if(!IsSet(job->cancelled))
+    job->func();
+
+  // release anything captured as soon as possible
+  job->func = std::function<void()>();
+
+  SetTLSValue(CurrentJobSlot(), prev);
+
+  Complete(job);
+
+  // release the queue's reference
+  Release(job);
+}
+
+void JobSystem::Complete(JobData *job)
+{
+  rdcarray<JobData *> dependants;
+
+  {
+    ScopedSpinLock scoped(job->lock);
+    Atomic::CmpExch32(&job->complete, 0, 1);
+    dependants.swap(job->dependants);
+  }
+
+  if(job->pending)
+    job->pending->End();
+
+  bool cancelled = IsSet(job->cancelled);
+
+  for(JobData *d : dependants)
+  {
+    if(cancelled)
+      Atomic::CmpExch32(&d->cancelled, 0, 1);
+
+    if(Atomic::Dec32(&d->remainingDeps) == 0)
+      Enqueue(d);
+
+    Release(d);
+  }
+}
+
+void JobSystem::WaitFor(JobData *job)
+{
+  Worker *w = CurrentWorker();
+
+  // help with other work rather than idling. This may or may not include the job itself
+  while(!IsSet(job->complete))
+  {
+    if(!RunOne(w))
+      Sleep(0);
+  }
+}
+
+void JobSystem::WorkerMain(Worker *worker)
+{
+  SetTLSValue(WorkerSlot(), worker);
+  SetCurrentThreadName(StringFormat::Fmt("RenderDoc job worker %u", worker->index));
+
+  uint32_t idle = 0;
+
+  while(!IsSet(m_Shutdown))
+  {
+    if(RunOne(worker))
+    {
+      idle = 0;
+      continue;
+    }
+
+    // spin briefly in case more work is about to arrive, then go to sleep until it does
+    if(++idle < 64)
+    {
+      Sleep(0);
+      continue;
+    }
+
+    Atomic::Inc32(&m_Sleeping);
+
+    // re-check after announcing we're going to sleep, since a job queued before then wouldn't have
+    // woken anyone
+    if(!IsSet(m_Queued) && !IsSet(m_Shutdown))
+      m_Wake.Wait();
+
+    Atomic::Dec32(&m_Sleeping);
+
+    idle = 0;
+  }
+
+  SetTLSValue(WorkerSlot(), NULL);
+}
+
+ScopedJobBatch::ScopedJobBatch(ScopedJobBatch *&publish, JobSystem *jobs)
+    : m_Publish(publish), m_Jobs(jobs)
+{
+  if(m_Jobs)
+    m_Publish = this;
+}
+
+void ScopedJobBatch::Submit(std::function<void()> func, PendingWork *pending)
+{
+  m_Submitted.push_back(m_Jobs->Submit(func, {}, pending));
+
+  // don't accumulate handles indefinitely for long scopes
+  if(m_Submitted.size() >= 1024)
+    m_Submitted.removeIf([](const Job &j) { return j.IsComplete(); });
+}
+
+void ScopedJobBatch::Finish()
+{
+  if(m_Jobs)
+    m_Jobs->Wait(m_Submitted);
+
+  m_Submitted.clear();
+
+  if(m_Publish == this)
+    m_Publish = NULL;
+}
+};
@@ -0,0 +1,168 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include "common/threading.h"
+
+namespace Threading
+{
+struct JobData;
+class JobSystem;
+
+// a reference-counted handle to a job submitted to a JobSystem. Handles can be copied and
+// discarded freely, the job runs regardless of whether anything is still referencing it.
+class Job
+{
+public:
+  Job() = default;
+  Job(const Job &o);
+  Job(Job &&o) : m_Data(o.m_Data) { o.m_Data = NULL; }
+  Job &operator=(const Job &o);
+  ~Job();
+
+  bool IsValid() const { return m_Data != NULL; }
+  // returns true once the job has either run, or been skipped because it was cancelled
+  bool IsComplete() const;
+  bool IsCancelled() const;
+
+  // if the job hasn't started yet it will be skipped, along with anything that depends on it. A
+  // job that is already running can poll JobSystem::IsCancelled() to stop early.
+  void Cancel();
+
+  // wait for the job to complete, executing other jobs on this thread in the meantime. Waiting on
+  // an invalid handle returns immediately.
+  void Wait() const;
+
+private:
+  friend class JobSystem;
+  explicit Job(JobData *data) : m_Data(data) {}
+  JobData *m_Data = NULL;
+};
+
+// a work-stealing scheduler for CPU jobs. Each worker has its own queue, which it pushes jobs
+// onto and pops them from in LIFO order so that jobs spawned by a job run while their data is still
+// hot. Jobs submitted from other threads go onto a shared FIFO queue, and idle workers steal from
+// the front of each other's queues.
+//
+// With no workers, jobs execute on the submitting thread as soon as their dependencies are met,
+// before Submit() returns.
+class JobSystem
+{
+public:
+  JobSystem(uint32_t numWorkers);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  uint32_t GetNumWorkers() const { return (uint32_t)m_Workers.size(); }
+  // submit a job that runs once all of its dependencies have completed. If any dependency was
+  // cancelled, the job is cancelled too. If pending is specified, it is marked as busy until the
+  // job completes - whether it ran, was cancelled, or was dropped at shutdown.
+  Job Submit(std::function<void()> func, const rdcarray<Job> &dependencies = {},
+             PendingWork *pending = NULL);
+
+  // wait for all of the given jobs, executing other jobs on this thread in the meantime
+  void Wait(const rdcarray<Job> &jobs);
+
+  // call func(i) for each i in [0, count), distributed across the workers in batches of at least
+  // grainSize iterations. Returns once all iterations have completed.
+  void ParallelFor(uint32_t count, std::function<void(uint32_t)> func, uint32_t grainSize = 1);
+
+  // returns true if the job currently executing on this thread has been cancelled
+  static bool IsCancelled();
+
+  // tell workers to exit without waiting for them, for when joining threads isn't safe e.g. during
+  // module unloading. Any jobs not yet started are cancelled, and the system can't be used again.
+  void SignalShutdown();
+
+private:
+  friend class Job;
+
+  struct JobQueue
+  {
+    SpinLock lock;
+    rdcarray<JobData *> jobs;
+    size_t head = 0;
+
+    void Push(JobData *job);
+    JobData *PopBack();
+    JobData *PopFront();
+  };
+
+  struct Worker
+  {
+    JobSystem *system;
+    uint32_t index;
+    ThreadHandle thread;
+    JobQueue queue;
+  };
+
+  void WorkerMain(Worker *worker);
+  Worker *CurrentWorker();
+
+  void Enqueue(JobData *job);
+  JobData *Dequeue(Worker *worker);
+  bool RunOne(Worker *worker);
+  void Execute(JobData *job);
+  void Complete(JobData *job);
+  void CancelQueued();
+  void WaitFor(JobData *job);
+
+  rdcarray<Worker *> m_Workers;
+  JobQueue m_Shared;
+  Semaphore m_Wake;
+
+  // number of jobs sitting in any queue, and number of workers asleep waiting for one
+  volatile int32_t m_Queued = 0;
+  volatile int32_t m_Sleeping = 0;
+  volatile int32_t m_Shutdown = 0;
+};
+
+// collects jobs submitted over a scope, such as while loading a capture, so that they can be waited
+// on together. While alive the batch is published through a pointer, so code deep inside e.g. chunk
+// processing can submit work to it without needing it passed down. Without a job system the
+// pointer stays NULL and callers should do the work inline.
+class ScopedJobBatch
+{
+public:
+  ScopedJobBatch(ScopedJobBatch *&publish, JobSystem *jobs);
+  ~ScopedJobBatch() { Finish(); }
+  ScopedJobBatch(const ScopedJobBatch &) = delete;
+  ScopedJobBatch &operator=(const ScopedJobBatch &) = delete;
+
+  // if pending is specified, it is marked as busy until the job completes
+  void Submit(std::function<void()> func, PendingWork *pending = NULL);
+
+  // wait for all submitted work to complete and stop publishing the batch
+  void Finish();
+
+private:
+  ScopedJobBatch *&m_Publish;
+  JobSystem *m_Jobs;
+  rdcarray<Job> m_Submitted;
+};
+};
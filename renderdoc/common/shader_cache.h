@@ -24,13 +24,56 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
+#include "api/replay/version.h"
 #include "common/common.h"
+#include "common/formatting.h"
 #include "os/os_specific.h"
+#include "zstd/xxhash.h"
 
-template <typename ResultType, typename ShaderCallbacks>
+// a strong hash of shader bytes, used to key persistent caches that are shared between captures.
+// Unlike the 32-bit hashes used for our own built-in shaders, a collision here would silently hand
+// back data for a different application shader, so we use two 64-bit hashes of the content.
+struct ShaderContentHash
+{
+  uint64_t hash[2] = {0, 0};
+
+  bool operator<(const ShaderContentHash &o) const
+  {
+    if(hash[0] != o.hash[0])
+      return hash[0] < o.hash[0];
+    return hash[1] < o.hash[1];
+  }
+  bool operator==(const ShaderContentHash &o) const
+  {
+    return hash[0] == o.hash[0] && hash[1] == o.hash[1];
+  }
+  bool operator!=(const ShaderContentHash &o) const { return !(*this == o); }
+};
+
+// hash data, optionally chained on from a previous hash so that e.g. entry point and stage can be
+// mixed into the hash of the shader bytes.
+inline ShaderContentHash HashShaderContent(const void *data, size_t length,
+                                           const ShaderContentHash &seed = ShaderContentHash())
+{
+  ShaderContentHash ret;
+  ret.hash[0] = XXH64(data, length, seed.hash[0] ^ 0x52656e646572446fULL);
+  ret.hash[1] = XXH64(data, length, seed.hash[1] ^ (0x6353686164657273ULL + length));
+  return ret;
+}
+
+// caches of data that our own code produces, such as reflection, are only valid for the build that
+// wrote them. This mixes the build's commit hash into such a cache's version number, so a cache
+// from any other build is discarded on load.
+inline uint32_t GetBuildCacheVersion(uint32_t versionNumber)
+{
+  return versionNumber ^ uint32_t(XXH64(GitVersionHash, strlen(GitVersionHash), 0));
+}
+
+template <typename KeyType, typename ResultType, typename ShaderCallbacks>
 bool LoadShaderCache(const char *filename, const uint32_t magicNumber, const uint32_t versionNumber,
-                     std::map<uint32_t, ResultType> &resultCache, const ShaderCallbacks &callbacks)
+                     std::map<KeyType, ResultType> &resultCache, const ShaderCallbacks &callbacks)
 {
   rdcstr shadercache = FileIO::GetAppFolderFilename(filename);
 
@@ -70,9 +113,8 @@ bool LoadShaderCache(const char *filename, const uint32_t magicNumber, const uin
     {
       uint32_t numentries = header[2];
 
-      // assume at least 16 bytes for any cache entry. 8 bytes for hash and length, and 8 bytes
-      // data.
-      if(numentries > cachelen / 16LLU)
+      // assume at least 8 bytes of data for any cache entry, on top of the hash and length.
+      if(numentries > cachelen / (sizeof(KeyType) + sizeof(uint32_t) + 8LLU))
       {
         RDCERR("Invalid shader cache - more entries %u than are feasible in a %llu byte cache",
                numentries, cachelen);
@@ -86,16 +128,17 @@ bool LoadShaderCache(const char *filename, const uint32_t magicNumber, const uin
 
         for(uint32_t i = 0; i < numentries; i++)
         {
-          if((size_t)bufsize < sizeof(uint32_t))
+          if((size_t)bufsize < sizeof(KeyType))
           {
             RDCERR("Invalid shader cache - truncated, not enough data for shader hash");
             ret = false;
             break;
           }
 
-          uint32_t hash = *(uint32_t *)ptr;
-          ptr += sizeof(uint32_t);
-          bufsize -= sizeof(uint32_t);
+          KeyType hash;
+          memcpy(&hash, ptr, sizeof(KeyType));
+          ptr += sizeof(KeyType);
+          bufsize -= sizeof(KeyType);
 
           if((size_t)bufsize < sizeof(uint32_t))
           {
@@ -150,13 +193,17 @@ bool LoadShaderCache(const char *filename, const uint32_t magicNumber, const uin
   return ret;
 }
 
-template <typename ResultType, typename ShaderCallbacks>
+template <typename KeyType, typename ResultType, typename ShaderCallbacks>
 void SaveShaderCache(const char *filename, uint32_t magicNumber, uint32_t versionNumber,
-                     const std::map<uint32_t, ResultType> &cache, const ShaderCallbacks &callbacks)
+                     const std::map<KeyType, ResultType> &cache, const ShaderCallbacks &callbacks)
 {
   rdcstr shadercache = FileIO::GetAppFolderFilename(filename);
 
-  FILE *f = FileIO::fopen(shadercache.c_str(), "wb");
+  // write to a temporary file and move it into place once complete, so that a crash or another
+  // process saving at the same time can never leave a truncated cache behind for the next load.
+  rdcstr tmpcache = StringFormat::Fmt("%s.%u.tmp", shadercache.c_str(), Process::GetCurrentPID());
+
+  FILE *f = FileIO::fopen(tmpcache.c_str(), "wb");
 
   if(!f)
   {
@@ -171,7 +218,7 @@ void SaveShaderCache(const char *filename, uint32_t magicNumber, uint32_t versio
 
   for(auto it = cache.begin(); it != cache.end(); ++it)
   {
-    uint32_t hash = it->first;
+    const KeyType &hash = it->first;
     uint32_t len = callbacks.GetSize(it->second);
     const byte *data = callbacks.GetData(it->second);
     FileIO::fwrite(&hash, 1, sizeof(hash), f);
@@ -183,5 +230,53 @@ void SaveShaderCache(const char *filename, uint32_t magicNumber, uint32_t versio
 
   FileIO::fclose(f);
 
+  if(!FileIO::Move(tmpcache.c_str(), shadercache.c_str(), true))
+  {
+    RDCERR("Error moving shader cache into place");
+    FileIO::Delete(tmpcache.c_str());
+    return;
+  }
+
   RDCDEBUG("Successfully wrote %u shaders to shader cache", numentries);
 }
+
+// evict the least recently used entries from a cache until its total size is below maxSize bytes.
+// The callbacks must implement GetLastUse() returning a monotonically increasing timestamp.
+template <typename KeyType, typename ResultType, typename ShaderCallbacks>
+void TrimShaderCache(std::map<KeyType, ResultType> &cache, uint64_t maxSize,
+                     const ShaderCallbacks &callbacks)
+{
+  uint64_t totalSize = 0;
+
+  rdcarray<rdcpair<uint64_t, KeyType>> entries;
+  entries.reserve(cache.size());
+
+  for(auto it = cache.begin(); it != cache.end(); ++it)
+  {
+    totalSize += sizeof(KeyType) + sizeof(uint32_t) + callbacks.GetSize(it->second);
+    entries.push_back({callbacks.GetLastUse(it->second), it->first});
+  }
+
+  if(totalSize <= maxSize)
+    return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const rdcpair<uint64_t, KeyType> &a, const rdcpair<uint64_t, KeyType> &b) {
+              return a.first < b.first;
+            });
+
+  size_t evicted = 0;
+
+  for(size_t i = 0; i < entries.size() && totalSize > maxSize; i++)
+  {
+    auto it = cache.find(entries[i].second);
+
+    totalSize -= sizeof(KeyType) + sizeof(uint32_t) + callbacks.GetSize(it->second);
+
+    callbacks.Destroy(it->second);
+    cache.erase(it);
+    evicted++;
+  }
+
+  RDCDEBUG("Evicted %zu least recently used entries from shader cache", evicted);
+}
@@ -110,6 +110,29 @@ public:
 private:
   SpinLock *m_Spin = NULL;
 };
+
+// tracks asynchronous work outstanding on an object, so that consumers of the results only need to
+// wait when they actually use them before the work has completed.
+class PendingWork
+{
+public:
+  PendingWork() = default;
+  // copies don't inherit any work from the source object
+  PendingWork(const PendingWork &) {}
+  PendingWork &operator=(const PendingWork &) { return *this; }
+  ~PendingWork() { Wait(); }
+  void Begin() { Atomic::Inc32(&m_Count); }
+  void End() { Atomic::Dec32(&m_Count); }
+  bool IsPending() const { return Atomic::CmpExch32(&m_Count, 0, 0) != 0; }
+  void Wait() const
+  {
+    while(IsPending())
+      Threading::Sleep(0);
+  }
+
+private:
+  mutable volatile int32_t m_Count = 0;
+};
 };
 
 #define SCOPED_LOCK(cs) Threading::ScopedLock CONCAT(scopedlock, __LINE__)(&cs);
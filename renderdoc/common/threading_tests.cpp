@@ -22,7 +22,9 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include "common/jobsystem.h"
 #include "common/threading.h"
+#include "common/timing.h"
 #include "os/os_specific.h"
 
 #if ENABLED(ENABLE_UNIT_TESTS)
@@ -71,4 +73,240 @@ TEST_CASE("Test spin lock", "[threading]")
   CHECK(finalValue == value);
 }
 
+TEST_CASE("Test job system", "[threading]")
+{
+  SECTION("No workers")
+  {
+    Threading::JobSystem jobs(0);
+
+    CHECK(jobs.GetNumWorkers() == 0);
+
+    int order = 0;
+    int a = -1, b = -1;
+
+    // jobs run immediately on this thread
+    Threading::Job jobA = jobs.Submit([&]() { a = order++; });
+    CHECK(jobA.IsComplete());
+    CHECK(a == 0);
+
+    Threading::Job jobB = jobs.Submit([&]() { b = order++; }, {jobA});
+    CHECK(jobB.IsComplete());
+    CHECK(b == 1);
+
+    // jobs submitted from inside a job run once the outer job is done
+    int inner = -1, outer = -1;
+    jobs.Submit([&]() {
+      jobs.Submit([&]() { inner = order++; });
+      outer = order++;
+    });
+    CHECK(outer == 2);
+    CHECK(inner == 3);
+
+    rdcarray<uint32_t> values;
+    values.resize(100);
+    jobs.ParallelFor(100, [&values](uint32_t i) { values[i] = i * 2; });
+    for(uint32_t i = 0; i < 100; i++)
+      CHECK(values[i] == i * 2);
+  };
+
+  SECTION("Parallel for")
+  {
+    Threading::JobSystem jobs(4);
+
+    for(uint32_t grain : {1U, 7U, 1000U})
+    {
+      rdcarray<int32_t> visited;
+      visited.resize(10000);
+
+      jobs.ParallelFor(10000, [&visited](uint32_t i) { Atomic::Inc32(&visited[i]); }, grain);
+
+      uint32_t wrong = 0;
+      for(int32_t v : visited)
+        wrong += (v != 1) ? 1 : 0;
+      CHECK(wrong == 0);
+    }
+  };
+
+  SECTION("Nested jobs")
+  {
+    Threading::JobSystem jobs(4);
+
+    volatile int32_t count = 0;
+
+    // every job spawns more, which go onto the worker's own queue and must be stolen to balance
+    rdcarray<Threading::Job> outer;
+    for(int i = 0; i < 16; i++)
+    {
+      outer.push_back(jobs.Submit([&jobs, &count]() {
+        rdcarray<Threading::Job> inner;
+        for(int j = 0; j < 64; j++)
+          inner.push_back(jobs.Submit([&count]() { Atomic::Inc32(&count); }));
+        jobs.Wait(inner);
+      }));
+    }
+
+    jobs.Wait(outer);
+
+    CHECK(count == 16 * 64);
+  };
+
+  SECTION("Dependencies")
+  {
+    Threading::JobSystem jobs(4);
+
+    // a diamond, with the top blocked until everything has been submitted
+    volatile int32_t start = 0;
+    volatile int32_t order = 0;
+    int32_t top = -1, left = -1, right = -1, bottom = -1;
+
+    Threading::Job jobTop = jobs.Submit([&]() {
+      while(Atomic::CmpExch32(&start, 0, 0) == 0)
+        Threading::Sleep(0);
+      top = Atomic::Inc32(&order);
+    });
+    Threading::Job jobLeft = jobs.Submit([&]() { left = Atomic::Inc32(&order); }, {jobTop});
+    Threading::Job jobRight = jobs.Submit([&]() { right = Atomic::Inc32(&order); }, {jobTop});
+    Threading::Job jobBottom =
+        jobs.Submit([&]() { bottom = Atomic::Inc32(&order); }, {jobLeft, jobRight});
+
+    CHECK_FALSE(jobBottom.IsComplete());
+
+    Atomic::Inc32(&start);
+    jobBottom.Wait();
+
+    CHECK(jobTop.IsComplete());
+    CHECK(jobLeft.IsComplete());
+    CHECK(jobRight.IsComplete());
+    CHECK(top == 1);
+    CHECK(left > top);
+    CHECK(right > top);
+    CHECK(bottom == 4);
+
+    // depending on something already complete is fine
+    bool ran = false;
+    jobs.Submit([&ran]() { ran = true; }, {jobBottom}).Wait();
+    CHECK(ran);
+  };
+
+  SECTION("Cancellation")
+  {
+    Threading::JobSystem jobs(2);
+
+    volatile int32_t start = 0;
+    bool ranDependant = false, ranSecond = false;
+
+    Threading::Job blocker = jobs.Submit([&start]() {
+      while(Atomic::CmpExch32(&start, 0, 0) == 0)
+        Threading::Sleep(0);
+    });
+    Threading::Job dependant = jobs.Submit([&]() { ranDependant = true; }, {blocker});
+    Threading::Job second = jobs.Submit([&]() { ranSecond = true; }, {dependant});
+
+    dependant.Cancel();
+    Atomic::Inc32(&start);
+
+    second.Wait();
+
+    CHECK(dependant.IsComplete());
+    CHECK(dependant.IsCancelled());
+    CHECK(second.IsCancelled());
+    CHECK_FALSE(blocker.IsCancelled());
+    CHECK_FALSE(ranDependant);
+    CHECK_FALSE(ranSecond);
+
+    // a running job can notice it's been cancelled
+    volatile int32_t running = 0;
+    Threading::Job spinner = jobs.Submit([&running]() {
+      Atomic::Inc32(&running);
+      while(!Threading::JobSystem::IsCancelled())
+        Threading::Sleep(0);
+    });
+
+    while(Atomic::CmpExch32(&running, 0, 0) == 0)
+      Threading::Sleep(0);
+
+    spinner.Cancel();
+    spinner.Wait();
+
+    CHECK(spinner.IsCancelled());
+    CHECK_FALSE(Threading::JobSystem::IsCancelled());
+  };
+
+  SECTION("Pending work")
+  {
+    Threading::JobSystem jobs(1);
+
+    volatile int32_t start = 0, running = 0;
+    bool ran = false;
+
+    // occupy the only worker, so that anything else stays queued
+    Threading::Job blocker = jobs.Submit([&]() {
+      Atomic::Inc32(&running);
+      while(Atomic::CmpExch32(&start, 0, 0) == 0)
+        Threading::Sleep(0);
+    });
+
+    while(Atomic::CmpExch32(&running, 0, 0) == 0)
+      Threading::Sleep(0);
+
+    // a cancelled job still ends its pending work
+    Threading::PendingWork cancelledWork;
+    Threading::Job cancelled = jobs.Submit([&ran]() { ran = true; }, {blocker}, &cancelledWork);
+    CHECK(cancelledWork.IsPending());
+    cancelled.Cancel();
+
+    // as does a job which is still queued at shutdown
+    Threading::PendingWork droppedWork;
+    Threading::ScopedJobBatch *published = NULL;
+    Threading::ScopedJobBatch batch(published, &jobs);
+    batch.Submit([&ran]() { ran = true; }, &droppedWork);
+    CHECK(droppedWork.IsPending());
+
+    jobs.SignalShutdown();
+    droppedWork.Wait();
+    CHECK_FALSE(droppedWork.IsPending());
+
+    Atomic::Inc32(&start);
+    cancelledWork.Wait();
+    CHECK_FALSE(cancelledWork.IsPending());
+
+    batch.Finish();
+    CHECK_FALSE(ran);
+  };
+}
+
+// not run by default, use "[benchmark]" to run it
+TEST_CASE("Job system scaling", "[.][benchmark][threading]")
+{
+  const uint32_t count = 1 << 12;
+
+  // some arbitrary CPU-bound work that the compiler can't remove
+  rdcarray<uint64_t> results;
+  results.resize(count);
+  auto work = [&results](uint32_t i) {
+    uint64_t x = i + 1;
+    for(int j = 0; j < 20000; j++)
+      x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    results[i] = x;
+  };
+
+  double baseline = 0.0;
+
+  uint32_t cores = Threading::NumberOfCores();
+
+  for(uint32_t workers = 0; workers < cores; workers = workers ? workers * 2 : 1)
+  {
+    Threading::JobSystem jobs(workers);
+
+    PerformanceTimer timer;
+    jobs.ParallelFor(count, work, 16);
+    double ms = timer.GetMilliseconds();
+
+    if(workers == 0)
+      baseline = ms;
+
+    RDCLOG("%u workers: %.2f ms (%.2fx)", workers, ms, baseline / ms);
+  }
+}
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -27,6 +27,7 @@
 
 #include <stdarg.h>
 #include <stdint.h>
+#include <algorithm>
 #include "os/os_specific.h"
 #include "common.h"
 
@@ -64,6 +65,13 @@ public:
     m_TotalTime += m_FrameTimes.back();
     m_HighPrecisionTimer.Restart();
 
+    // the rolling window is kept separately, since m_FrameTimes is cleared every second
+    if(m_RecentFrameTimes.size() < RollingWindowSize)
+      m_RecentFrameTimes.push_back(m_FrameTimes.back());
+    else
+      m_RecentFrameTimes[m_RecentFrameIdx] = m_FrameTimes.back();
+    m_RecentFrameIdx = (m_RecentFrameIdx + 1) % RollingWindowSize;
+
     // update every second
     if(m_TotalTime > 1000.0)
     {
@@ -91,9 +99,44 @@ public:
   double GetAvgFrameTime() const { return m_AvgFrametime; }
   double GetMinFrameTime() const { return m_MinFrametime; }
   double GetMaxFrameTime() const { return m_MaxFrametime; }
+  // the time of the most recently completed frame
+  double GetLastFrameTime() const
+  {
+    return m_RecentFrameTimes.empty()
+               ? 0.0
+               : m_RecentFrameTimes[(m_RecentFrameIdx + RollingWindowSize - 1) % RollingWindowSize];
+  }
+
+  // the times of up to the last RollingWindowSize frames, oldest first
+  rdcarray<double> GetRecentFrameTimes() const
+  {
+    if(m_RecentFrameTimes.size() < RollingWindowSize)
+      return m_RecentFrameTimes;
+
+    rdcarray<double> ret;
+    ret.reserve(RollingWindowSize);
+    ret.append(m_RecentFrameTimes.data() + m_RecentFrameIdx, RollingWindowSize - m_RecentFrameIdx);
+    ret.append(m_RecentFrameTimes.data(), m_RecentFrameIdx);
+    return ret;
+  }
+
+  double GetMedianFrameTime() const
+  {
+    if(m_RecentFrameTimes.empty())
+      return 0.0;
+
+    rdcarray<double> sorted = m_RecentFrameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+  }
+
+  static const size_t RollingWindowSize = 64;
+
 private:
   PerformanceTimer m_HighPrecisionTimer;
   rdcarray<double> m_FrameTimes;
+  rdcarray<double> m_RecentFrameTimes;
+  size_t m_RecentFrameIdx = 0;
   double m_TotalTime;
   double m_AvgFrametime;
   double m_MinFrametime;
@@ -28,6 +28,7 @@
 #include <algorithm>
 #include "api/replay/version.h"
 #include "common/common.h"
+#include "common/jobsystem.h"
 #include "common/threading.h"
 #include "hooks/hooks.h"
 #include "maths/formatpacking.h"
@@ -37,6 +38,7 @@
 #include "stb/stb_image_write.h"
 #include "strings/string_utils.h"
 #include "crash_handler.h"
+#include "settings.h"
 
 #include "api/replay/renderdoc_tostr.inl"
 
@@ -44,6 +46,11 @@
 
 #include "replay/renderdoc_serialise.inl"
 
+RDOC_CONFIG(uint32_t, Replay_JobWorkerThreads, 8,
+            "The number of worker threads used for parallel processing in the replay "
+            "application, limited to one less than the number of CPU cores. Set to 0 to run all "
+            "work on the threads that request it.");
+
 void LogReplayOptions(const ReplayOptions &opts)
 {
   RDCLOG("%s API validation during replay", (opts.apiValidation ? "Enabling" : "Not enabling"));
@@ -295,10 +302,15 @@ void RenderDoc::RecreateCrashHandler()
 
   if(m_ExHandler)
     m_ExHandler->RegisterMemoryRegion(this, sizeof(RenderDoc));
+
+  // log output can only be queued when the crash handler will write it out if we crash
+  rdclog_asyncwrites(m_ExHandler != NULL);
 }
 
 void RenderDoc::UnloadCrashHandler()
 {
+  rdclog_asyncwrites(false);
+
   if(m_ExHandler)
     m_ExHandler->UnregisterMemoryRegion(this);
 
@@ -456,6 +468,14 @@ void RenderDoc::Initialise()
     RDCLOGOUTPUT();
 
   ProcessConfig();
+
+  // when capturing we don't want to compete with the application for CPU time, so any jobs are run
+  // on the thread that submits them
+  uint32_t numWorkers = 0;
+  if(IsReplayApp())
+    numWorkers = RDCMIN(Replay_JobWorkerThreads, Threading::NumberOfCores() - 1);
+
+  m_JobSystem = new Threading::JobSystem(numWorkers);
 }
 
 RenderDoc::~RenderDoc()
@@ -496,6 +516,17 @@ RenderDoc::~RenderDoc()
     m_RemoteThread = 0;
   }
 
+  if(m_JobSystem)
+  {
+    // similarly we can't join any job worker threads here. This is only reached with workers if
+    // the replay application didn't shut down the replay, so tell them to exit and leak the rest.
+    if(m_JobSystem->GetNumWorkers() > 0)
+      m_JobSystem->SignalShutdown();
+    else
+      delete m_JobSystem;
+    m_JobSystem = NULL;
+  }
+
   delete m_Config;
 
   Process::Shutdown();
@@ -660,6 +691,9 @@ void RenderDoc::ShutdownReplay()
   for(auto it = m_ShutdownFunctions.begin(); it != m_ShutdownFunctions.end(); ++it)
     (*it)();
   m_ShutdownFunctions.clear();
+
+  // any remaining jobs are finished here, while it's still safe to join threads
+  SAFE_DELETE(m_JobSystem);
 }
 
 void RenderDoc::RegisterShutdownFunction(ShutdownFunction func)
@@ -744,6 +778,11 @@ void RenderDoc::StartFrameCapture(void *dev, void *wnd)
   IFrameCapturer *frameCap = MatchFrameCapturer(dev, wnd);
   if(frameCap)
   {
+    // the captured frame is slower to record, if it gets its own tick it shouldn't count as a hitch
+    m_Hitch.ignoreNextFrame = true;
+    m_Hitch.captureNotes.swap(m_Hitch.pendingNotes);
+    m_Hitch.pendingNotes.clear();
+
     frameCap->StartFrameCapture(dev, wnd);
     m_CapturesActive++;
   }
@@ -770,6 +809,8 @@ bool RenderDoc::EndFrameCapture(void *dev, void *wnd)
   {
     bool ret = frameCap->EndFrameCapture(dev, wnd);
     m_CapturesActive--;
+    // the capture has been written by now, and the next tick's frame time includes that
+    m_Hitch.ignoreNextFrame = true;
     return ret;
   }
   return false;
@@ -782,6 +823,7 @@ bool RenderDoc::DiscardFrameCapture(void *dev, void *wnd)
   {
     bool ret = frameCap->DiscardFrameCapture(dev, wnd);
     m_CapturesActive--;
+    m_Hitch.ignoreNextFrame = true;
     return ret;
   }
   return false;
@@ -814,6 +856,11 @@ void RenderDoc::Tick()
 
   m_FrameTimer.UpdateTimers();
 
+  if(m_Hitch.ignoreNextFrame)
+    m_Hitch.ignoreNextFrame = false;
+  else
+    CheckHitchCapture();
+
   if(!prev_focus && cur_focus)
   {
     CycleActiveWindow();
@@ -827,6 +874,59 @@ void RenderDoc::Tick()
   prev_cap = cur_cap;
 }
 
+void RenderDoc::CheckHitchCapture()
+{
+  if(m_Hitch.cooldown > 0)
+    m_Hitch.cooldown--;
+
+  const float threshold = m_Options.hitchCaptureThreshold;
+  const float factor = m_Options.hitchCaptureMedianFactor;
+
+  if(threshold <= 0.0f && factor <= 0.0f)
+    return;
+
+  if(m_Hitch.cooldown > 0 || m_Cap > 0 || m_CapturesActive > 0)
+    return;
+
+  if(m_Options.hitchCaptureMaxCount > 0 && m_Hitch.count >= m_Options.hitchCaptureMaxCount)
+    return;
+
+  const double frameTime = m_FrameTimer.GetLastFrameTime();
+  rdcarray<double> recent = m_FrameTimer.GetRecentFrameTimes();
+
+  const double median = m_FrameTimer.GetMedianFrameTime();
+
+  bool hitch = threshold > 0.0f && frameTime > threshold;
+
+  // don't trust the median until there's a reasonable history to take it from
+  if(factor > 0.0f && recent.size() >= 16)
+    hitch |= frameTime > median * factor;
+
+  if(!hitch)
+    return;
+
+  m_Hitch.cooldown = m_Options.hitchCaptureCooldown;
+  m_Hitch.count++;
+
+  RDCLOG("Triggering capture after %.2lf ms frame (median %.2lf ms)", frameTime, median);
+
+  rdcstr recentTimes;
+  for(size_t i = 0; i < recent.size(); i++)
+  {
+    if(i > 0)
+      recentTimes += ", ";
+    recentTimes += StringFormat::Fmt("%.2lf", recent[i]);
+  }
+
+  m_Hitch.pendingNotes = StringFormat::Fmt(
+      "{\"comments\":\"Captured automatically after a %.2lf ms frame, with a median of %.2lf ms "
+      "over the last %zu frames.\",\"hitchFrameTime\":\"%.2lf\","
+      "\"hitchMedianFrameTime\":\"%.2lf\",\"hitchRecentFrameTimes\":\"%s\"}",
+      frameTime, median, recent.size(), frameTime, median, recentTimes.c_str());
+
+  TriggerCapture(1);
+}
+
 void RenderDoc::CycleActiveWindow()
 {
   m_Cap = 0;
@@ -1158,6 +1258,7 @@ RDCFile *RenderDoc::CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePi
   }
 
   ret->SetData(driver, ToStr(driver).c_str(), OSUtility::GetMachineIdent(), &outPng);
+  ret->SetFrameCaptureCompression(m_Options.captureCompression, m_Options.captureCompressionLevel);
 
   FileIO::CreateParentDirectory(m_CurrentLogFile);
 
@@ -1648,6 +1749,21 @@ void RenderDoc::FinishCaptureWriting(RDCFile *rdc, uint32_t frameNumber)
       delete w;
     }
 
+    // record why the capture was made, if a hitch triggered it
+    if(!m_Hitch.captureNotes.empty())
+    {
+      SectionProperties props = {};
+      props.type = SectionType::Notes;
+      props.version = 1;
+      StreamWriter *w = rdc->WriteSection(props);
+
+      w->Write(m_Hitch.captureNotes.data(), m_Hitch.captureNotes.size());
+
+      w->Finish();
+
+      delete w;
+    }
+
     RDCLOG("Written to disk: %s", m_CurrentLogFile.c_str());
 
     CaptureData cap(m_CurrentLogFile, Timing::GetUnixTimestamp(), rdc->GetDriver(), frameNumber);
@@ -60,6 +60,11 @@ namespace Callstack
 class StackResolver;
 }
 
+namespace Threading
+{
+class JobSystem;
+}
+
 struct ICrashHandler
 {
   virtual ~ICrashHandler() {}
@@ -440,6 +445,7 @@ public:
   void RecreateCrashHandler();
   void UnloadCrashHandler();
   ICrashHandler *GetCrashHandler() const { return m_ExHandler; }
+  Threading::JobSystem *GetJobSystem() const { return m_JobSystem; }
   void ResamplePixels(const FramePixels &in, RDCThumb &out);
   void EncodePixelsPNG(const RDCThumb &in, RDCThumb &out);
   RDCFile *CreateRDC(RDCDriver driver, uint32_t frameNum, const FramePixels &fp);
@@ -583,6 +589,8 @@ private:
 
   void SyncAvailableGPUThread();
 
+  void CheckHitchCapture();
+
   static RenderDoc *m_Inst;
 
   bool m_Replay;
@@ -598,6 +606,19 @@ private:
 
   FrameTimer m_FrameTimer;
 
+  // state for captures triggered automatically by slow frames
+  struct
+  {
+    // the frame timed at the next tick includes capture overhead - recording the captured frame or
+    // writing the capture out once it ends - so shouldn't be considered
+    bool ignoreNextFrame = false;
+    uint32_t cooldown = 0;
+    uint32_t count = 0;
+    // notes describing the hitch, for the capture it triggers and then for the capture in progress
+    rdcstr pendingNotes;
+    rdcstr captureNotes;
+  } m_Hitch;
+
   rdcstr m_LoggingFilename;
 
   rdcstr m_Target;
@@ -702,6 +723,8 @@ private:
 
   ICrashHandler *m_ExHandler;
 
+  Threading::JobSystem *m_JobSystem = NULL;
+
   void ProcessConfig();
 
   SDObject *FindConfigSetting(const rdcstr &name);
@@ -87,7 +87,7 @@ public:
     RDCLOG("Connecting to server %s", m_PipeName.c_str());
 
     m_ExHandler = new google_breakpad::ExceptionHandler(
-        StringFormat::UTF82Wide(dumpFolder).c_str(), NULL, NULL, NULL,
+        StringFormat::UTF82Wide(dumpFolder).c_str(), &FlushLogBeforeDump, NULL, NULL,
         google_breakpad::ExceptionHandler::HANDLER_ALL, dumpType,
         StringFormat::UTF82Wide(m_PipeName).c_str(), &custom);
 
@@ -102,7 +102,7 @@ public:
       CreateCrashHandlingServer();
 
       m_ExHandler = new google_breakpad::ExceptionHandler(
-          StringFormat::UTF82Wide(dumpFolder).c_str(), NULL, NULL, NULL,
+          StringFormat::UTF82Wide(dumpFolder).c_str(), &FlushLogBeforeDump, NULL, NULL,
           google_breakpad::ExceptionHandler::HANDLER_ALL, dumpType,
           StringFormat::UTF82Wide(m_PipeName).c_str(), &custom);
 
@@ -163,6 +163,13 @@ private:
   rdcstr m_PipeName;
   google_breakpad::ExceptionHandler *m_ExHandler;
 
+  // write out any queued log lines so the log sent with the dump is complete
+  static bool FlushLogBeforeDump(void *, EXCEPTION_POINTERS *, MDRawAssertionInfo *)
+  {
+    rdclog_crashflush();
+    return true;
+  }
+
   rdcstr NewPipeName()
   {
     return StringFormat::Fmt("\\\\.\\pipe\\RenderDocBreakpadServer%llu", Timing::GetTick());
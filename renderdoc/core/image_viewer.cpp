@@ -257,6 +257,13 @@ public:
   {
     return rdcarray<PixelModification>();
   }
+  rdcarray<PixelRegionHistory> PixelHistoryRegion(rdcarray<EventUsage> events, ResourceId target,
+                                                  uint32_t x, uint32_t y, uint32_t width,
+                                                  uint32_t height, const Subresource &sub,
+                                                  CompType typeCast)
+  {
+    return rdcarray<PixelRegionHistory>();
+  }
   ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid, uint32_t idx)
   {
     return new ShaderDebugTrace();
@@ -34,18 +34,35 @@
 #include "replay/replay_controller.h"
 #include "serialise/rdcfile.h"
 #include "serialise/serialiser.h"
+#include "serialise/shmio.h"
 #include "strings/string_utils.h"
 #include "replay_proxy.h"
 
 RDOC_CONFIG(uint32_t, RemoteServer_TimeoutMS, 5000,
             "Timeout in milliseconds for remote server operations.");
 
+RDOC_CONFIG(bool, RemoteServer_SharedMemoryTransfer, true,
+            "When the remote server is on the same machine, pass texture and buffer contents "
+            "through shared memory instead of compressing them and sending them over the socket.");
+
+RDOC_CONFIG(uint32_t, RemoteServer_SharedMemoryTransferMB, 32,
+            "The size in MB of the shared memory used to pass data to and from a remote server on "
+            "the same machine. Larger transfers are streamed through it.");
+
 RDOC_DEBUG_CONFIG(bool, RemoteServer_DebugLogging, false,
                   "Where possible (i.e. it is completely unambiguous) replace register names with "
                   "high-level variable names.");
 
+// incremented whenever packets are added or changed within a release, so that client and server
+// builds which don't speak the same packets refuse each other at the handshake.
+//  1 - added eReplayProxy_PixelHistoryRegion
+//  2 - added eRemoteServer_SharedMemoryTransfer
+//  3 - added a request ID to every replay proxy packet, echoed back in its response
+static const uint32_t RemoteServerProtocolRevision = 3;
+
 static const uint32_t RemoteServerProtocolVersion =
-    uint32_t(RENDERDOC_VERSION_MAJOR * 1000) | RENDERDOC_VERSION_MINOR;
+    ((uint32_t(RENDERDOC_VERSION_MAJOR * 1000) | RENDERDOC_VERSION_MINOR) << 8) |
+    RemoteServerProtocolRevision;
 
 enum RemoteServerPacket
 {
@@ -79,6 +96,7 @@ enum RemoteServerPacket
   eRemoteServer_GetSectionContents,
   eRemoteServer_WriteSection,
   eRemoteServer_GetAvailableGPUs,
+  eRemoteServer_SharedMemoryTransfer,
   eRemoteServer_RemoteServerCount,
 };
 
@@ -122,6 +140,7 @@ rdcstr DoStringise(const RemoteServerPacket &el)
     STRINGISE_ENUM_NAMED(eRemoteServer_GetSectionContents, "GetSectionContents");
     STRINGISE_ENUM_NAMED(eRemoteServer_WriteSection, "WriteSection");
     STRINGISE_ENUM_NAMED(eRemoteServer_GetAvailableGPUs, "GetAvailableGPUs");
+    STRINGISE_ENUM_NAMED(eRemoteServer_SharedMemoryTransfer, "SharedMemoryTransfer");
     STRINGISE_ENUM_NAMED(eRemoteServer_RemoteServerCount, "RemoteServerCount");
   }
   END_ENUM_STRINGISE();
@@ -444,6 +463,42 @@ static void ActiveRemoteClientThread(ClientThread *threadData,
         SERIALISE_ELEMENT(gpus);
       }
     }
+    else if(type == eRemoteServer_SharedMemoryTransfer)
+    {
+      rdcstr name;
+      uint64_t capacity = 0, key = 0;
+
+      {
+        READ_DATA_SCOPE();
+        SERIALISE_ELEMENT(name);
+        SERIALISE_ELEMENT(capacity);
+        SERIALISE_ELEMENT(key);
+      }
+
+      reader.EndChunk();
+
+      // this fails if the client isn't on this machine, even if it thinks it's connected locally
+      // e.g. through a forwarded port
+      SharedMemoryRing *ring = NULL;
+      if(proxy && RemoteServer_SharedMemoryTransfer)
+        ring = SharedMemoryRing::Open(name, capacity, key);
+
+      bool success = (ring != NULL);
+
+      if(ring)
+      {
+        RDCLOG("Using %llu MB of shared memory for data transfers", capacity / (1024 * 1024));
+
+        ring->SetTimeout(RemoteServer_TimeoutMS);
+        proxy->SetSharedMemoryTransfer(ring);
+      }
+
+      {
+        WRITE_DATA_SCOPE();
+        SCOPED_SERIALISE_CHUNK(eRemoteServer_SharedMemoryTransfer);
+        SERIALISE_ELEMENT(success);
+      }
+    }
     else if(type == eRemoteServer_ShutdownServer)
     {
       reader.EndChunk();
@@ -550,6 +605,9 @@ static void ActiveRemoteClientThread(ClientThread *threadData,
 
           if(status == ReplayStatus::Succeeded && remoteDriver)
           {
+            // the proxy's requests can be pipelined ahead of its responses, and only this thread
+            // uses the socket
+            client->SetQueueIncomingWhileSending(true);
             proxy = new ReplayProxy(reader, writer, remoteDriver, replayDriver, previewWindow);
           }
         }
@@ -1637,7 +1695,11 @@ rdcpair<ReplayStatus, IReplayController *> RemoteServer::OpenCapture(
 
   ReplayController *rend = new ReplayController();
 
+  // the proxy pipelines requests ahead of their responses, so incoming data must be queued while
+  // sending. Only the replay thread uses this connection while the capture is open
+  m_Socket->SetQueueIncomingWhileSending(true);
   ReplayProxy *proxy = new ReplayProxy(*reader, *writer, proxyDriver);
+  proxy->SetSharedMemoryTransfer(OpenSharedMemoryTransfer());
   status = rend->SetDevice(proxy);
 
   if(status != ReplayStatus::Succeeded)
@@ -1698,6 +1760,68 @@ rdcstr RemoteServer::DriverName()
   return driverName;
 }
 
+SharedMemoryRing *RemoteServer::OpenSharedMemoryTransfer()
+{
+  if(!RemoteServer_SharedMemoryTransfer || RemoteServer_SharedMemoryTransferMB == 0)
+    return NULL;
+
+  // only try when the server looks local, the server checks that it really is
+  if(!Network::MatchIPMask(m_Socket->GetRemoteIP(), Network::MakeIP(127, 0, 0, 1),
+                           Network::MakeIP(255, 0, 0, 0)))
+    return NULL;
+
+  SharedMemoryRing *ring =
+      SharedMemoryRing::Create(uint64_t(RemoteServer_SharedMemoryTransferMB) * 1024 * 1024);
+
+  if(!ring)
+    return NULL;
+
+  rdcstr name = ring->GetName();
+  uint64_t capacity = ring->GetCapacity();
+  uint64_t key = ring->GetKey();
+
+  {
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(eRemoteServer_SharedMemoryTransfer);
+    SERIALISE_ELEMENT(name);
+    SERIALISE_ELEMENT(capacity);
+    SERIALISE_ELEMENT(key);
+  }
+
+  bool success = false;
+
+  {
+    READ_DATA_SCOPE();
+    RemoteServerPacket type = ser.ReadChunk<RemoteServerPacket>();
+
+    if(type == eRemoteServer_SharedMemoryTransfer)
+    {
+      SERIALISE_ELEMENT(success);
+    }
+    else
+    {
+      RDCERR("Unexpected response to SharedMemoryTransfer");
+    }
+
+    ser.EndChunk();
+  }
+
+  if(!success)
+  {
+    RDCLOG("Remote server couldn't open shared memory, transferring data over the network");
+    delete ring;
+    return NULL;
+  }
+
+  RDCLOG("Using %llu MB of shared memory for data transfers", capacity / (1024 * 1024));
+
+  // both sides have it mapped now, so the name isn't needed
+  ring->Unlink();
+  ring->SetTimeout(RemoteServer_TimeoutMS);
+
+  return ring;
+}
+
 rdcarray<GPUDevice> RemoteServer::GetAvailableGPUs()
 {
   if(!Connected())
@@ -36,6 +36,7 @@ enum class RDCDriver : uint32_t;
 
 class WriteSerialiser;
 class ReadSerialiser;
+class SharedMemoryRing;
 
 struct RemoteServer : public IRemoteServer
 {
@@ -100,6 +101,8 @@ public:
   virtual rdcarray<rdcstr> GetResolve(const rdcarray<uint64_t> &callstack);
 
 protected:
+  SharedMemoryRing *OpenSharedMemoryTransfer();
+
   Network::Socket *m_Socket;
   WriteSerialiser *writer;
   ReadSerialiser *reader;
@@ -27,6 +27,7 @@
 #include <list>
 #include "lz4/lz4.h"
 #include "serialise/lz4io.h"
+#include "serialise/shmio.h"
 
 template <>
 rdcstr DoStringise(const ReplayProxyPacket &el)
@@ -95,6 +96,8 @@ rdcstr DoStringise(const ReplayProxyPacket &el)
     STRINGISE_ENUM_NAMED(eReplayProxy_GetDriverInfo, "GetDriverInfo");
 
     STRINGISE_ENUM_NAMED(eReplayProxy_ContinueDebug, "ContinueDebug");
+
+    STRINGISE_ENUM_NAMED(eReplayProxy_PixelHistoryRegion, "PixelHistoryRegion");
   }
   END_ENUM_STRINGISE();
 }
@@ -102,11 +105,13 @@ rdcstr DoStringise(const ReplayProxyPacket &el)
 // utility macros for implementing proxied functions
 
 // begins a chunk with the given packet type, and if reading verifies that the
-// read type was what was expected - otherwise sets an error flag
+// read type was what was expected - otherwise sets an error flag. The response is tagged with the
+// ID of the request it answers.
 #define PACKET_HEADER(packet)                                         \
   ReplayProxyPacket p = (ReplayProxyPacket)ser.BeginChunk(packet, 0); \
   if(ser.IsReading() && p != packet)                                  \
-    m_IsErrored = true;
+    m_IsErrored = true;                                               \
+  SerialiseResponseID(ser);
 
 // begins the set of parameters. Note that we only begin a chunk when writing (sending a request to
 // the remote server), since on reading the chunk has already been begun to read the type to
@@ -120,10 +125,19 @@ rdcstr DoStringise(const ReplayProxyPacket &el)
 #define END_PARAMS()                                \
   {                                                 \
     GET_SERIALISER.Serialise("packet"_lit, packet); \
+    SerialiseRequestID(ser);                        \
     ser.EndChunk();                                 \
     CheckError(packet, expectedPacket);             \
   }
 
+// when a proxied function is pipelined on the host, its request is sent in one call and its
+// response is read in a later call. These skip the parts that don't apply to each call.
+#define PIPELINED_PARAMS() if(!m_PipelineReceive)
+
+#define PIPELINED_RETURN() \
+  if(m_PipelineSend)       \
+    return;
+
 // begin serialising a return value. We begin a chunk here in either the writing or reading case
 // since this chunk is used purely to send/receive the return value and is fully handled within the
 // function.
@@ -186,7 +200,29 @@ struct RemoteExecution
   if(m_RemoteServer)                                                  \
     return CONCAT(Proxied_, name)(m_Reader, m_Writer, ##__VA_ARGS__); \
   else                                                                \
-    return CONCAT(Proxied_, name)(m_Writer, m_Reader, ##__VA_ARGS__);
+  {                                                                   \
+    FlushPipeline();                                                  \
+    return CONCAT(Proxied_, name)(m_Writer, m_Reader, ##__VA_ARGS__); \
+  }
+
+// as above, but if a pipeline is open on the host the request is sent now and the response is only
+// read when the pipeline is flushed. Only usable for functions without output parameters or a
+// return value.
+#define PIPELINED_PROXY_FUNCTION(name, ...)                      \
+  if(!m_RemoteServer && m_PipelineDepth > 0)                     \
+  {                                                              \
+    PROXY_DEBUG("Pipelining out %s", #name);                     \
+    m_PipelineSend = true;                                       \
+    CONCAT(Proxied_, name)(m_Writer, m_Reader, ##__VA_ARGS__);   \
+    m_PipelineSend = false;                                      \
+    QueuePipelinedResponse([=]() {                               \
+      m_PipelineReceive = true;                                  \
+      CONCAT(Proxied_, name)(m_Writer, m_Reader, ##__VA_ARGS__); \
+      m_PipelineReceive = false;                                 \
+    });                                                          \
+    return;                                                      \
+  }                                                              \
+  PROXY_FUNCTION(name, ##__VA_ARGS__);
 
 ReplayProxy::~ReplayProxy()
 {
@@ -200,6 +236,30 @@ ReplayProxy::~ReplayProxy()
 
   for(auto it = m_ShaderReflectionCache.begin(); it != m_ShaderReflectionCache.end(); ++it)
     delete it->second;
+
+  SAFE_DELETE(m_SharedTransfer);
+}
+
+void ReplayProxy::SetSharedMemoryTransfer(SharedMemoryRing *ring)
+{
+  SAFE_DELETE(m_SharedTransfer);
+  m_SharedTransfer = ring;
+}
+
+Compressor *ReplayProxy::BulkDataWriter(StreamWriter *write)
+{
+  if(m_SharedTransfer)
+    return new SharedMemoryWriter(m_SharedTransfer, write, Ownership::Nothing);
+
+  return new LZ4Compressor(write, Ownership::Nothing);
+}
+
+Decompressor *ReplayProxy::BulkDataReader(StreamReader *read)
+{
+  if(m_SharedTransfer)
+    return new SharedMemoryReader(m_SharedTransfer, read, Ownership::Nothing);
+
+  return new LZ4Decompressor(read, Ownership::Nothing);
 }
 
 #pragma region Proxied Functions
@@ -842,12 +902,12 @@ void ReplayProxy::Proxied_GetBufferData(ParamSerialiser &paramser, ReturnSeriali
 
   char empty[128] = {};
 
-  // lz4 compress
+  // lz4 compress, or pass through shared memory
   if(retser.IsReading())
   {
-    ReadSerialiser ser(new StreamReader(new LZ4Decompressor(retser.GetReader(), Ownership::Nothing),
-                                        dataSize, Ownership::Stream),
-                       Ownership::Stream);
+    ReadSerialiser ser(
+        new StreamReader(BulkDataReader(retser.GetReader()), dataSize, Ownership::Stream),
+        Ownership::Stream);
 
     SERIALISE_ELEMENT(retData);
 
@@ -860,8 +920,7 @@ void ReplayProxy::Proxied_GetBufferData(ParamSerialiser &paramser, ReturnSeriali
   }
   else
   {
-    WriteSerialiser ser(new StreamWriter(new LZ4Compressor(retser.GetWriter(), Ownership::Nothing),
-                                         Ownership::Stream),
+    WriteSerialiser ser(new StreamWriter(BulkDataWriter(retser.GetWriter()), Ownership::Stream),
                         Ownership::Stream);
 
     SERIALISE_ELEMENT(retData);
@@ -920,12 +979,12 @@ void ReplayProxy::Proxied_GetTextureData(ParamSerialiser &paramser, ReturnSerial
 
   char empty[128] = {};
 
-  // lz4 compress
+  // lz4 compress, or pass through shared memory
   if(retser.IsReading())
   {
-    ReadSerialiser ser(new StreamReader(new LZ4Decompressor(retser.GetReader(), Ownership::Nothing),
-                                        dataSize, Ownership::Stream),
-                       Ownership::Stream);
+    ReadSerialiser ser(
+        new StreamReader(BulkDataReader(retser.GetReader()), dataSize, Ownership::Stream),
+        Ownership::Stream);
 
     SERIALISE_ELEMENT(data);
 
@@ -938,8 +997,7 @@ void ReplayProxy::Proxied_GetTextureData(ParamSerialiser &paramser, ReturnSerial
   }
   else
   {
-    WriteSerialiser ser(new StreamWriter(new LZ4Compressor(retser.GetWriter(), Ownership::Nothing),
-                                         Ownership::Stream),
+    WriteSerialiser ser(new StreamWriter(BulkDataWriter(retser.GetWriter()), Ownership::Stream),
                         Ownership::Stream);
 
     SERIALISE_ELEMENT(data);
@@ -1453,6 +1511,50 @@ rdcarray<PixelModification> ReplayProxy::PixelHistory(rdcarray<EventUsage> event
   PROXY_FUNCTION(PixelHistory, events, target, x, y, sub, typeCast);
 }
 
+template <typename ParamSerialiser, typename ReturnSerialiser>
+rdcarray<PixelRegionHistory> ReplayProxy::Proxied_PixelHistoryRegion(
+    ParamSerialiser &paramser, ReturnSerialiser &retser, rdcarray<EventUsage> events,
+    ResourceId target, uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+    const Subresource &sub, CompType typeCast)
+{
+  const ReplayProxyPacket expectedPacket = eReplayProxy_PixelHistoryRegion;
+  ReplayProxyPacket packet = eReplayProxy_PixelHistoryRegion;
+  rdcarray<PixelRegionHistory> ret;
+
+  {
+    BEGIN_PARAMS();
+    SERIALISE_ELEMENT(events);
+    SERIALISE_ELEMENT(target);
+    SERIALISE_ELEMENT(x);
+    SERIALISE_ELEMENT(y);
+    SERIALISE_ELEMENT(width);
+    SERIALISE_ELEMENT(height);
+    SERIALISE_ELEMENT(sub);
+    SERIALISE_ELEMENT(typeCast);
+    END_PARAMS();
+  }
+
+  {
+    REMOTE_EXECUTION();
+    if(paramser.IsReading() && !paramser.IsErrored() && !m_IsErrored)
+      ret = m_Remote->PixelHistoryRegion(events, target, x, y, width, height, sub, typeCast);
+  }
+
+  SERIALISE_RETURN(ret);
+
+  return ret;
+}
+
+rdcarray<PixelRegionHistory> ReplayProxy::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                             ResourceId target, uint32_t x,
+                                                             uint32_t y, uint32_t width,
+                                                             uint32_t height,
+                                                             const Subresource &sub,
+                                                             CompType typeCast)
+{
+  PROXY_FUNCTION(PixelHistoryRegion, events, target, x, y, width, height, sub, typeCast);
+}
+
 template <typename ParamSerialiser, typename ReturnSerialiser>
 ShaderDebugTrace *ReplayProxy::Proxied_DebugVertex(ParamSerialiser &paramser,
                                                    ReturnSerialiser &retser, uint32_t eventId,
@@ -1859,7 +1961,7 @@ void DoSerialise(SerialiserType &ser, DeltaSection &el)
 template <typename SerialiserType>
 void ReplayProxy::DeltaTransferBytes(SerialiserType &xferser, bytebuf &referenceData, bytebuf &newData)
 {
-  // lz4 compress
+  // lz4 compress, or pass through shared memory
   if(xferser.IsReading())
   {
     uint64_t uncompSize = 0;
@@ -1877,8 +1979,7 @@ void ReplayProxy::DeltaTransferBytes(SerialiserType &xferser, bytebuf &reference
 
       {
         ReadSerialiser ser(
-            new StreamReader(new LZ4Decompressor(xferser.GetReader(), Ownership::Nothing),
-                             uncompSize, Ownership::Stream),
+            new StreamReader(BulkDataReader(xferser.GetReader()), uncompSize, Ownership::Stream),
             Ownership::Stream);
 
         SERIALISE_ELEMENT(deltas);
@@ -2084,8 +2185,7 @@ void ReplayProxy::DeltaTransferBytes(SerialiserType &xferser, bytebuf &reference
 
     if(uncompSize > 0)
     {
-      WriteSerialiser ser(new StreamWriter(new LZ4Compressor(xferser.GetWriter(), Ownership::Nothing),
-                                           Ownership::Stream),
+      WriteSerialiser ser(new StreamWriter(BulkDataWriter(xferser.GetWriter()), Ownership::Stream),
                           Ownership::Stream);
 
       SERIALISE_ELEMENT(deltas);
@@ -2114,12 +2214,15 @@ void ReplayProxy::Proxied_CacheBufferData(ParamSerialiser &paramser, ReturnSeria
   const ReplayProxyPacket expectedPacket = eReplayProxy_CacheBufferData;
   ReplayProxyPacket packet = eReplayProxy_CacheBufferData;
 
+  PIPELINED_PARAMS()
   {
     BEGIN_PARAMS();
     SERIALISE_ELEMENT(buff);
     END_PARAMS();
   }
 
+  PIPELINED_RETURN();
+
   bytebuf data;
 
   {
@@ -2143,7 +2246,7 @@ void ReplayProxy::Proxied_CacheBufferData(ParamSerialiser &paramser, ReturnSeria
 
 void ReplayProxy::CacheBufferData(ResourceId buff)
 {
-  PROXY_FUNCTION(CacheBufferData, buff);
+  PIPELINED_PROXY_FUNCTION(CacheBufferData, buff);
 }
 
 template <typename ParamSerialiser, typename ReturnSerialiser>
@@ -2154,6 +2257,7 @@ void ReplayProxy::Proxied_CacheTextureData(ParamSerialiser &paramser, ReturnSeri
   const ReplayProxyPacket expectedPacket = eReplayProxy_CacheTextureData;
   ReplayProxyPacket packet = eReplayProxy_CacheTextureData;
 
+  PIPELINED_PARAMS()
   {
     BEGIN_PARAMS();
     SERIALISE_ELEMENT(tex);
@@ -2162,6 +2266,8 @@ void ReplayProxy::Proxied_CacheTextureData(ParamSerialiser &paramser, ReturnSeri
     END_PARAMS();
   }
 
+  PIPELINED_RETURN();
+
   bytebuf data;
 
   {
@@ -2187,7 +2293,7 @@ void ReplayProxy::Proxied_CacheTextureData(ParamSerialiser &paramser, ReturnSeri
 void ReplayProxy::CacheTextureData(ResourceId tex, const Subresource &sub,
                                    const GetTextureDataParams &params)
 {
-  PROXY_FUNCTION(CacheTextureData, tex, sub, params);
+  PIPELINED_PROXY_FUNCTION(CacheTextureData, tex, sub, params);
 }
 
 #pragma endregion Proxied Functions
@@ -2340,6 +2446,9 @@ void ReplayProxy::EnsureTexCached(ResourceId &texid, CompType typeCast, const Su
 
     const ProxyTextureProperties &proxy = proxyit->second;
 
+    // request every sample at once, rather than waiting for each before requesting the next
+    ScopedPipeline pipeline(this);
+
     for(uint32_t sample = 0; sample < proxy.msSamp; sample++)
     {
       Subresource s = sub;
@@ -2357,9 +2466,13 @@ void ReplayProxy::EnsureTexCached(ResourceId &texid, CompType typeCast, const Su
       GetTextureData(texid, s, params, m_ProxyTextureData[entry]);
 #endif
 
-      auto it = m_ProxyTextureData.find(sampleArrayEntry);
-      if(it != m_ProxyTextureData.end())
-        m_Proxy->SetProxyTextureData(proxy.id, s, it->second.data(), it->second.size());
+      ResourceId proxyid = proxy.id;
+
+      AfterPipeline([this, sampleArrayEntry, proxyid, s]() {
+        auto it = m_ProxyTextureData.find(sampleArrayEntry);
+        if(it != m_ProxyTextureData.end())
+          m_Proxy->SetProxyTextureData(proxyid, s, it->second.data(), it->second.size());
+      });
     }
 
     m_TextureProxyCache.insert(entry);
@@ -2390,9 +2503,11 @@ void ReplayProxy::EnsureBufCached(ResourceId bufid)
     GetBufferData(bufid, 0, 0, m_ProxyBufferData[bufid]);
 #endif
 
-    auto it = m_ProxyBufferData.find(bufid);
-    if(it != m_ProxyBufferData.end())
-      m_Proxy->SetProxyBufferData(proxyid, it->second.data(), it->second.size());
+    AfterPipeline([this, bufid, proxyid]() {
+      auto it = m_ProxyBufferData.find(bufid);
+      if(it != m_ProxyBufferData.end())
+        m_Proxy->SetProxyBufferData(proxyid, it->second.data(), it->second.size());
+    });
 
     m_BufferProxyCache.insert(bufid);
   }
@@ -2693,6 +2808,98 @@ bool ReplayProxy::CheckError(ReplayProxyPacket receivedPacket, ReplayProxyPacket
   return false;
 }
 
+template <typename SerialiserType>
+void ReplayProxy::SerialiseRequestID(SerialiserType &ser)
+{
+  // the host allocates a new ID for each request it sends, the remote server remembers it to tag
+  // the response
+  uint32_t requestID = 0;
+
+  if(ser.IsWriting())
+  {
+    requestID = ++m_LastRequestID;
+    m_OutstandingRequests.push_back(requestID);
+  }
+
+  ser.Serialise("requestID"_lit, requestID);
+
+  if(ser.IsReading())
+    m_ResponseID = requestID;
+}
+
+template <typename SerialiserType>
+void ReplayProxy::SerialiseResponseID(SerialiserType &ser)
+{
+  uint32_t requestID = m_ResponseID;
+
+  ser.Serialise("requestID"_lit, requestID);
+
+  if(ser.IsReading())
+  {
+    // responses arrive in the order requests were sent
+    uint32_t expectedID = 0;
+
+    if(!m_OutstandingRequests.empty())
+    {
+      expectedID = m_OutstandingRequests[0];
+      m_OutstandingRequests.erase(0);
+    }
+
+    if(requestID != expectedID && !m_IsErrored)
+    {
+      RDCERR("Received response to request %u, expected response to request %u", requestID,
+             expectedID);
+      m_IsErrored = true;
+    }
+  }
+}
+
+void ReplayProxy::BeginPipeline()
+{
+  m_PipelineDepth++;
+}
+
+void ReplayProxy::EndPipeline()
+{
+  RDCASSERT(m_PipelineDepth > 0);
+  m_PipelineDepth--;
+
+  if(m_PipelineDepth == 0)
+    FlushPipeline();
+}
+
+void ReplayProxy::FlushPipeline()
+{
+  if(m_PipelineQueue.empty())
+    return;
+
+  // take the queue first so anything queued while flushing runs in a later flush
+  rdcarray<std::function<void()>> queue;
+  queue.swap(m_PipelineQueue);
+  m_PipelinedRequests = 0;
+
+  for(std::function<void()> &func : queue)
+    func();
+}
+
+void ReplayProxy::QueuePipelinedResponse(std::function<void()> receive)
+{
+  m_PipelineQueue.push_back(receive);
+  m_PipelinedRequests++;
+
+  // don't let an unbounded amount of data pile up on the remote server
+  if(m_PipelinedRequests >= MaxPipelinedRequests)
+    FlushPipeline();
+}
+
+void ReplayProxy::AfterPipeline(std::function<void()> func)
+{
+  if(m_PipelineQueue.empty())
+    func();
+  else
+    m_PipelineQueue.push_back(func);
+}
+
 bool ReplayProxy::Tick(int type)
 {
   if(!m_RemoteServer)
@@ -2794,6 +3001,10 @@ bool ReplayProxy::Tick(int type)
     case eReplayProxy_PixelHistory:
       PixelHistory(rdcarray<EventUsage>(), ResourceId(), 0, 0, Subresource(), CompType::Typeless);
       break;
+    case eReplayProxy_PixelHistoryRegion:
+      PixelHistoryRegion(rdcarray<EventUsage>(), ResourceId(), 0, 0, 0, 0, Subresource(),
+                         CompType::Typeless);
+      break;
     case eReplayProxy_DisassembleShader: DisassembleShader(ResourceId(), NULL, ""); break;
     case eReplayProxy_GetDisassemblyTargets: GetDisassemblyTargets(); break;
     case eReplayProxy_GetTargetShaderEncodings: GetTargetShaderEncodings(); break;
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include <functional>
 #include "os/os_specific.h"
 #include "replay/replay_driver.h"
 #include "serialise/serialiser.h"
@@ -33,6 +34,8 @@
 // of deltas to a shared view of the previous resource contents.
 #define TRANSFER_RESOURCE_CONTENTS_DELTAS OPTION_ON
 
+class SharedMemoryRing;
+
 enum ReplayProxyPacket
 {
   // we offset these packet numbers so that it can co-exist
@@ -102,6 +105,8 @@ enum ReplayProxyPacket
   eReplayProxy_GetAvailableGPUs,
 
   eReplayProxy_ContinueDebug,
+
+  eReplayProxy_PixelHistoryRegion,
 };
 
 DECLARE_REFLECTION_ENUM(ReplayProxyPacket);
@@ -163,6 +168,10 @@ public:
   void EndRemoteExecution();
   void RemoteExecutionThreadEntry();
 
+  // takes ownership of a ring shared with the other side, to transfer bulk data through instead of
+  // the network. Must be set on both sides, or neither.
+  void SetSharedMemoryTransfer(SharedMemoryRing *ring);
+
   bool IsRemoteProxy() { return !m_RemoteServer; }
   void Shutdown() { delete this; }
   ReplayStatus ReadLogInitialisation(RDCFile *rdc, bool storeStructuredBuffers)
@@ -333,38 +342,44 @@ public:
     if(m_Proxy && cfg.position.vertexResourceId != ResourceId())
     {
       MeshDisplay proxiedCfg = cfg;
+      rdcarray<MeshFormat> secDraws = secondaryDraws;
 
-      EnsureBufCached(proxiedCfg.position.vertexResourceId);
-      if(proxiedCfg.position.vertexResourceId == ResourceId() ||
-         m_ProxyBufferIds[proxiedCfg.position.vertexResourceId] == ResourceId())
-        return;
-      proxiedCfg.position.vertexResourceId = m_ProxyBufferIds[proxiedCfg.position.vertexResourceId];
-
-      if(proxiedCfg.second.vertexResourceId != ResourceId())
       {
-        EnsureBufCached(proxiedCfg.second.vertexResourceId);
-        proxiedCfg.second.vertexResourceId = m_ProxyBufferIds[proxiedCfg.second.vertexResourceId];
-      }
+        // request all the buffers before waiting for any of their contents
+        ScopedPipeline pipeline(this);
 
-      if(proxiedCfg.position.indexResourceId != ResourceId())
-      {
-        EnsureBufCached(proxiedCfg.position.indexResourceId);
-        proxiedCfg.position.indexResourceId = m_ProxyBufferIds[proxiedCfg.position.indexResourceId];
-      }
+        EnsureBufCached(proxiedCfg.position.vertexResourceId);
+        if(proxiedCfg.position.vertexResourceId == ResourceId() ||
+           m_ProxyBufferIds[proxiedCfg.position.vertexResourceId] == ResourceId())
+          return;
+        proxiedCfg.position.vertexResourceId =
+            m_ProxyBufferIds[proxiedCfg.position.vertexResourceId];
 
-      rdcarray<MeshFormat> secDraws = secondaryDraws;
+        if(proxiedCfg.second.vertexResourceId != ResourceId())
+        {
+          EnsureBufCached(proxiedCfg.second.vertexResourceId);
+          proxiedCfg.second.vertexResourceId = m_ProxyBufferIds[proxiedCfg.second.vertexResourceId];
+        }
 
-      for(size_t i = 0; i < secDraws.size(); i++)
-      {
-        if(secDraws[i].vertexResourceId != ResourceId())
+        if(proxiedCfg.position.indexResourceId != ResourceId())
         {
-          EnsureBufCached(secDraws[i].vertexResourceId);
-          secDraws[i].vertexResourceId = m_ProxyBufferIds[secDraws[i].vertexResourceId];
+          EnsureBufCached(proxiedCfg.position.indexResourceId);
+          proxiedCfg.position.indexResourceId =
+              m_ProxyBufferIds[proxiedCfg.position.indexResourceId];
         }
-        if(secDraws[i].indexResourceId != ResourceId())
+
+        for(size_t i = 0; i < secDraws.size(); i++)
         {
-          EnsureBufCached(secDraws[i].indexResourceId);
-          secDraws[i].indexResourceId = m_ProxyBufferIds[secDraws[i].indexResourceId];
+          if(secDraws[i].vertexResourceId != ResourceId())
+          {
+            EnsureBufCached(secDraws[i].vertexResourceId);
+            secDraws[i].vertexResourceId = m_ProxyBufferIds[secDraws[i].vertexResourceId];
+          }
+          if(secDraws[i].indexResourceId != ResourceId())
+          {
+            EnsureBufCached(secDraws[i].indexResourceId);
+            secDraws[i].indexResourceId = m_ProxyBufferIds[secDraws[i].indexResourceId];
+          }
         }
       }
 
@@ -379,22 +394,29 @@ public:
     {
       MeshDisplay proxiedCfg = cfg;
 
-      EnsureBufCached(proxiedCfg.position.vertexResourceId);
-      if(proxiedCfg.position.vertexResourceId == ResourceId() ||
-         m_ProxyBufferIds[proxiedCfg.position.vertexResourceId] == ResourceId())
-        return ~0U;
-      proxiedCfg.position.vertexResourceId = m_ProxyBufferIds[proxiedCfg.position.vertexResourceId];
-
-      if(proxiedCfg.second.vertexResourceId != ResourceId())
       {
-        EnsureBufCached(proxiedCfg.second.vertexResourceId);
-        proxiedCfg.second.vertexResourceId = m_ProxyBufferIds[proxiedCfg.second.vertexResourceId];
-      }
+        // request all the buffers before waiting for any of their contents
+        ScopedPipeline pipeline(this);
 
-      if(proxiedCfg.position.indexResourceId != ResourceId())
-      {
-        EnsureBufCached(proxiedCfg.position.indexResourceId);
-        proxiedCfg.position.indexResourceId = m_ProxyBufferIds[proxiedCfg.position.indexResourceId];
+        EnsureBufCached(proxiedCfg.position.vertexResourceId);
+        if(proxiedCfg.position.vertexResourceId == ResourceId() ||
+           m_ProxyBufferIds[proxiedCfg.position.vertexResourceId] == ResourceId())
+          return ~0U;
+        proxiedCfg.position.vertexResourceId =
+            m_ProxyBufferIds[proxiedCfg.position.vertexResourceId];
+
+        if(proxiedCfg.second.vertexResourceId != ResourceId())
+        {
+          EnsureBufCached(proxiedCfg.second.vertexResourceId);
+          proxiedCfg.second.vertexResourceId = m_ProxyBufferIds[proxiedCfg.second.vertexResourceId];
+        }
+
+        if(proxiedCfg.position.indexResourceId != ResourceId())
+        {
+          EnsureBufCached(proxiedCfg.position.indexResourceId);
+          proxiedCfg.position.indexResourceId =
+              m_ProxyBufferIds[proxiedCfg.position.indexResourceId];
+        }
       }
 
       return m_Proxy->PickVertex(eventId, width, height, proxiedCfg, x, y);
@@ -522,6 +544,10 @@ public:
   IMPLEMENT_FUNCTION_PROXIED(rdcarray<PixelModification>, PixelHistory, rdcarray<EventUsage> events,
                              ResourceId target, uint32_t x, uint32_t y, const Subresource &sub,
                              CompType typeCast);
+  IMPLEMENT_FUNCTION_PROXIED(rdcarray<PixelRegionHistory>, PixelHistoryRegion,
+                             rdcarray<EventUsage> events, ResourceId target, uint32_t x, uint32_t y,
+                             uint32_t width, uint32_t height, const Subresource &sub,
+                             CompType typeCast);
   IMPLEMENT_FUNCTION_PROXIED(ShaderDebugTrace *, DebugVertex, uint32_t eventId, uint32_t vertid,
                              uint32_t instid, uint32_t idx);
   IMPLEMENT_FUNCTION_PROXIED(ShaderDebugTrace *, DebugPixel, uint32_t eventId, uint32_t x,
@@ -550,6 +576,10 @@ public:
   template <typename SerialiserType>
   void DeltaTransferBytes(SerialiserType &xferser, bytebuf &referenceData, bytebuf &newData);
 
+  // the streams bulk data is written to and read from after a return packet's header
+  Compressor *BulkDataWriter(StreamWriter *write);
+  Decompressor *BulkDataReader(StreamReader *read);
+
   void FileChanged() {}
   // will never be used
   ResourceId CreateProxyTexture(const TextureDescription &templateTex)
@@ -576,6 +606,28 @@ public:
   }
 
 private:
+  // while a pipeline is open on the host, resource cache transfers send their request immediately
+  // but their response is only read once the pipeline closes (or another call needs the
+  // connection), so several requests are in flight to the remote server at once.
+  struct ScopedPipeline
+  {
+    ScopedPipeline(ReplayProxy *proxy) : m_Proxy(proxy) { m_Proxy->BeginPipeline(); }
+    ~ScopedPipeline() { m_Proxy->EndPipeline(); }
+    ReplayProxy *m_Proxy;
+  };
+
+  void BeginPipeline();
+  void EndPipeline();
+  void FlushPipeline();
+  void QueuePipelinedResponse(std::function<void()> receive);
+  // runs func once any pipelined responses before it have been read, immediately if there are none
+  void AfterPipeline(std::function<void()> func);
+
+  template <typename SerialiserType>
+  void SerialiseRequestID(SerialiserType &ser);
+  template <typename SerialiserType>
+  void SerialiseResponseID(SerialiserType &ser);
+
   void EnsureTexCached(ResourceId &texid, CompType typeCast, const Subresource &sub);
   void RemapProxyTextureIfNeeded(TextureDescription &tex, GetTextureDataParams &params);
   void EnsureBufCached(ResourceId bufid);
@@ -707,6 +759,27 @@ private:
 
   bool m_IsErrored = false;
 
+  // the last request ID sent by the host, and the IDs of requests still waiting for a response
+  uint32_t m_LastRequestID = 0;
+  rdcarray<uint32_t> m_OutstandingRequests;
+  // the ID of the request the remote server is currently responding to
+  uint32_t m_ResponseID = 0;
+
+  // the maximum number of pipelined requests to have in flight before reading responses
+  static const uint32_t MaxPipelinedRequests = 16;
+
+  uint32_t m_PipelineDepth = 0;
+  uint32_t m_PipelinedRequests = 0;
+  // set while a pipelined proxied function is only sending its request, or only reading its
+  // response
+  bool m_PipelineSend = false;
+  bool m_PipelineReceive = false;
+  // responses to read and callbacks to run, in order, when the pipeline is flushed
+  rdcarray<std::function<void()>> m_PipelineQueue;
+
+  // if set, bulk data is passed through this instead of being compressed over the network
+  SharedMemoryRing *m_SharedTransfer = NULL;
+
   FrameRecord m_FrameRecord;
   APIProperties m_APIProps;
   std::map<ResourceId, TextureDescription> m_TextureInfo;
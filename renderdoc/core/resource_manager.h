@@ -591,6 +591,16 @@ public:
   // generate chunks for initial contents and insert.
   void InsertInitialContentsChunks(WriteSerialiser &ser);
 
+  // the number of bytes a buffer of initial contents takes in the stream, for estimating chunk
+  // sizes while initial contents chunks are being inserted. Deduplicated contents only store the
+  // hashes of their blocks.
+  uint64_t GetSerialisedContentsSize(uint64_t byteSize)
+  {
+    if(m_ContentBlocks && ContentBlockStore::IsDeduplicated(byteSize))
+      return ContentBlockStore::GetSerialisedSize(byteSize);
+    return byteSize;
+  }
+
   // for initial contents that don't need a chunk - apply them here. This allows any patching to
   // creation-time chunks to happen before they're written to disk.
   void ApplyInitialContentsNonChunks(WriteSerialiser &ser);
@@ -714,6 +724,10 @@ protected:
   // used during capture or replay - holds initial contents
   std::map<ResourceId, InitialContentDataOrChunk> m_InitialContents;
 
+  // used during capture - the content block store of the serialiser initial contents chunks are
+  // being inserted into, if any. See GetSerialisedContentsSize
+  ContentBlockStore *m_ContentBlocks = NULL;
+
   // used during capture or replay - map of resources currently alive with their real IDs, used in
   // capture and replay.
   std::map<ResourceId, WrappedResourceType> m_CurrentResourceMap;
@@ -1306,11 +1320,15 @@ void ResourceManager<Configuration>::InsertInitialContentsChunks(WriteSerialiser
     }
     else
     {
+      m_ContentBlocks = ser.GetContentBlocks();
+
       uint64_t size = GetSize_InitialState(id, it->second.data);
 
       SCOPED_SERIALISE_CHUNK(SystemChunk::InitialContents, size);
 
       Serialise_InitialState(ser, id, record, &it->second.data);
+
+      m_ContentBlocks = NULL;
     }
 
     // Reset back to empty contents, unloading the actual resource.
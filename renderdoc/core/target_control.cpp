@@ -25,6 +25,7 @@
 
 #include "android/android.h"
 #include "api/replay/renderdoc_replay.h"
+#include "common/call_profiler.h"
 #include "common/threading.h"
 #include "core/core.h"
 #include "jpeg-compressor/jpgd.h"
@@ -32,7 +33,7 @@
 #include "replay/replay_driver.h"
 #include "serialise/serialiser.h"
 
-static const uint32_t TargetControlProtocolVersion = 6;
+static const uint32_t TargetControlProtocolVersion = 8;
 
 static bool IsProtocolVersionSupported(const uint32_t protocolVersion)
 {
@@ -52,6 +53,14 @@ static bool IsProtocolVersionSupported(const uint32_t protocolVersion)
   if(protocolVersion == 5)
     return true;
 
+  // 6 -> 7 added call profiling packets
+  if(protocolVersion == 6)
+    return true;
+
+  // 7 -> 8 added capture options packet
+  if(protocolVersion == 7)
+    return true;
+
   if(protocolVersion == TargetControlProtocolVersion)
     return true;
 
@@ -72,7 +81,11 @@ enum PacketType : uint32_t
   ePacket_NewChild,
   ePacket_CaptureProgress,
   ePacket_CycleActiveWindow,
-  ePacket_CapturableWindowCount
+  ePacket_CapturableWindowCount,
+  ePacket_SetCallProfiling,
+  ePacket_RequestCallProfile,
+  ePacket_CallProfile,
+  ePacket_SetCaptureOptions,
 };
 
 DECLARE_REFLECTION_ENUM(PacketType);
@@ -95,6 +108,10 @@ rdcstr DoStringise(const PacketType &el)
     STRINGISE_ENUM_NAMED(ePacket_CaptureProgress, "Capture Progress");
     STRINGISE_ENUM_NAMED(ePacket_CycleActiveWindow, "Cycle Active Window");
     STRINGISE_ENUM_NAMED(ePacket_CapturableWindowCount, "Capturable Window Count");
+    STRINGISE_ENUM_NAMED(ePacket_SetCallProfiling, "Set Call Profiling");
+    STRINGISE_ENUM_NAMED(ePacket_RequestCallProfile, "Request Call Profile");
+    STRINGISE_ENUM_NAMED(ePacket_CallProfile, "Call Profile");
+    STRINGISE_ENUM_NAMED(ePacket_SetCaptureOptions, "Set Capture Options");
   }
   END_ENUM_STRINGISE();
 }
@@ -369,6 +386,39 @@ void RenderDoc::TargetControlClientThread(uint32_t version, Network::Socket *cli
       {
         RenderDoc::Inst().CycleActiveWindow();
       }
+      else if(type == ePacket_SetCallProfiling)
+      {
+        bool enabled = false;
+
+        READ_DATA_SCOPE();
+        SERIALISE_ELEMENT(enabled);
+
+        CallProfiler::SetEnabled(enabled);
+      }
+      else if(type == ePacket_SetCaptureOptions)
+      {
+        CaptureOptions opts;
+
+        READ_DATA_SCOPE();
+        SERIALISE_ELEMENT(opts);
+
+        RenderDoc::Inst().SetCaptureOptions(opts);
+      }
+      else if(type == ePacket_RequestCallProfile)
+      {
+        bool reset = false;
+
+        {
+          READ_DATA_SCOPE();
+          SERIALISE_ELEMENT(reset);
+        }
+
+        rdcarray<CallProfileEntry> profile = CallProfiler::Fetch(reset);
+
+        WRITE_DATA_SCOPE();
+        SCOPED_SERIALISE_CHUNK(ePacket_CallProfile);
+        SERIALISE_ELEMENT(profile);
+      }
 
       reader.EndChunk();
 
@@ -664,6 +714,48 @@ public:
       SAFE_DELETE(m_Socket);
   }
 
+  void SetCallProfiling(bool enabled)
+  {
+    if(m_Version < 7)
+      return;
+
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(ePacket_SetCallProfiling);
+
+    SERIALISE_ELEMENT(enabled);
+
+    if(ser.IsErrored())
+      SAFE_DELETE(m_Socket);
+  }
+
+  void SetCaptureOptions(const CaptureOptions &opts)
+  {
+    if(m_Version < 8)
+      return;
+
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(ePacket_SetCaptureOptions);
+
+    SERIALISE_ELEMENT(opts);
+
+    if(ser.IsErrored())
+      SAFE_DELETE(m_Socket);
+  }
+
+  void RequestCallProfile(bool reset)
+  {
+    if(m_Version < 7)
+      return;
+
+    WRITE_DATA_SCOPE();
+    SCOPED_SERIALISE_CHUNK(ePacket_RequestCallProfile);
+
+    SERIALISE_ELEMENT(reset);
+
+    if(ser.IsErrored())
+      SAFE_DELETE(m_Socket);
+  }
+
   TargetControlMessage ReceiveMessage(RENDERDOC_ProgressCallback progress)
   {
     TargetControlMessage msg;
@@ -869,6 +961,14 @@ public:
       reader.EndChunk();
       return msg;
     }
+    else if(type == ePacket_CallProfile)
+    {
+      msg.type = TargetControlMessageType::CallProfile;
+      READ_DATA_SCOPE();
+      SERIALISE_ELEMENT(msg.callProfile).Named("Call Profile"_lit);
+      reader.EndChunk();
+      return msg;
+    }
     else
     {
       RDCERR("Unexpected packed received: %d", type);
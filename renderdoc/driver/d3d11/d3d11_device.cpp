@@ -1368,6 +1368,9 @@ ReplayStatus WrappedID3D11Device::ReadLogInitialisation(RDCFile *rdc, bool store
     }
   }
 
+  FillLoadStatistics(GetReplay()->WriteFrameRecord().frameInfo.loadStatistics, chunkInfos,
+                     &GetChunkName, reader);
+
 #if ENABLED(RDOC_DEVEL)
   for(auto it = chunkInfos.begin(); it != chunkInfos.end(); ++it)
   {
@@ -1913,8 +1916,8 @@ bool WrappedID3D11Device::EndFrameCapture(void *dev, void *wnd)
     {
       SectionProperties props;
 
-      // Compress with LZ4 so that it's fast
-      props.flags = SectionFlags::LZ4Compressed;
+      // LZ4 by default so that it's fast, but can be configured to zstd for smaller captures
+      props.flags = rdc->GetFrameCaptureCompression();
       props.version = m_SectionVersion;
       props.type = SectionType::FrameCapture;
 
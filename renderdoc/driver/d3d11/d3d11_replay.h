@@ -231,6 +231,10 @@ public:
 
   rdcarray<PixelModification> PixelHistory(rdcarray<EventUsage> events, ResourceId target, uint32_t x,
                                            uint32_t y, const Subresource &sub, CompType typeCast);
+  rdcarray<PixelRegionHistory> PixelHistoryRegion(rdcarray<EventUsage> events, ResourceId target,
+                                                  uint32_t x, uint32_t y, uint32_t width,
+                                                  uint32_t height, const Subresource &sub,
+                                                  CompType typeCast);
   ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid, uint32_t idx);
   ShaderDebugTrace *DebugPixel(uint32_t eventId, uint32_t x, uint32_t y, uint32_t sample,
                                uint32_t primitive);
@@ -3696,6 +3696,16 @@ rdcarray<PixelModification> D3D12Replay::PixelHistory(rdcarray<EventUsage> event
   return {};
 }
 
+rdcarray<PixelRegionHistory> D3D12Replay::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                             ResourceId target, uint32_t x,
+                                                             uint32_t y, uint32_t width,
+                                                             uint32_t height,
+                                                             const Subresource &sub,
+                                                             CompType typeCast)
+{
+  return StandardPixelHistoryRegion(this, events, target, x, y, width, height, sub, typeCast);
+}
+
 ResourceId D3D12Replay::CreateProxyTexture(const TextureDescription &templateTex)
 {
   return ResourceId();
@@ -1180,6 +1180,10 @@ bool GLInitParams::IsSupportedVersion(uint64_t ver)
   if(ver == 0x20)
     return true;
 
+  // 0x21 -> 0x22 - initial contents can be deduplicated into a content blocks section
+  if(ver == 0x21)
+    return true;
+
   return false;
 }
 
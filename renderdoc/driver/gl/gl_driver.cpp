@@ -30,6 +30,7 @@
 #include "jpeg-compressor/jpge.h"
 #include "serialise/rdcfile.h"
 #include "strings/string_utils.h"
+#include "gl_program_cache.h"
 #include "gl_replay.h"
 
 std::map<uint64_t, GLWindowingData> WrappedOpenGL::m_ActiveContexts;
@@ -929,6 +930,7 @@ WrappedOpenGL::~WrappedOpenGL()
   m_ArrayMS.Destroy();
 
   SAFE_DELETE(m_FrameReader);
+  SAFE_DELETE(m_ProgramCache);
 
   GetResourceManager()->ClearReferencedResources();
 
@@ -2258,8 +2260,8 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
     {
       SectionProperties props;
 
-      // Compress with LZ4 so that it's fast
-      props.flags = SectionFlags::LZ4Compressed;
+      // LZ4 by default so that it's fast, but can be configured to zstd for smaller captures
+      props.flags = rdc->GetFrameCaptureCompression();
       props.version = m_SectionVersion;
       props.type = SectionType::FrameCapture;
 
@@ -2270,12 +2272,16 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
       captureWriter = new StreamWriter(StreamWriter::InvalidStream);
     }
 
+    // large initial contents are deduplicated into content blocks, written after the frame
+    ContentBlockStore *contentBlocks = rdc ? ContentBlockStore::CreateForCapture() : NULL;
+
     {
       WriteSerialiser ser(captureWriter, Ownership::Stream);
 
       ser.SetChunkMetadataRecording(m_ScratchSerialiser.GetChunkMetadataRecording());
 
       ser.SetUserData(GetResourceManager());
+      ser.SetContentBlocks(contentBlocks);
 
       {
         // we no longer use this one, but for ease of compatibility we still serialise it here. This
@@ -2361,6 +2367,10 @@ bool WrappedOpenGL::EndFrameCapture(void *dev, void *wnd)
            double(captureWriter->GetOffset()) / (1024.0 * 1024.0),
            m_CaptureTimer.GetMilliseconds() / 1000.0);
 
+    if(contentBlocks && !contentBlocks->WriteSection(rdc))
+      RDCERR("Failed to write deduplicated initial contents to the capture");
+    SAFE_DELETE(contentBlocks);
+
     RenderDoc::Inst().FinishCaptureWriting(rdc, m_CapturedFrames.back().frameNumber);
 
     m_State = CaptureState::BackgroundCapturing;
@@ -3191,6 +3201,15 @@ void WrappedOpenGL::AddResourceInitChunk(GLResource res)
   }
 }
 
+void WrappedOpenGL::AddProgramLinkParameter(GLResource program, const rdcstr &param)
+{
+  if(m_ProgramCache)
+  {
+    ProgramData &progDetails = m_Programs[GetResourceManager()->GetID(program)];
+    GLProgramCache::HashLinkParameter(progDetails.linkParams, param.c_str(), param.size());
+  }
+}
+
 bool WrappedOpenGL::HasNonDebugMarkers()
 {
   for(const APIEvent &ev : m_CurEvents)
@@ -3212,6 +3231,12 @@ ReplayStatus WrappedOpenGL::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
   if(sectionIdx < 0)
     return ReplayStatus::FileCorrupted;
 
+  ContentBlockStore contentBlocks;
+  ReplayStatus blocksStatus = contentBlocks.Open(rdc);
+
+  if(blocksStatus != ReplayStatus::Succeeded)
+    return blocksStatus;
+
   StreamReader *reader = rdc->ReadSection(sectionIdx);
 
   if(reader->IsErrored())
@@ -3225,6 +3250,9 @@ ReplayStatus WrappedOpenGL::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
   ser.SetStringDatabase(&m_StringDB);
   ser.SetUserData(GetResourceManager());
 
+  if(contentBlocks.IsOpen())
+    ser.SetContentBlocks(&contentBlocks);
+
   ser.ConfigureStructuredExport(&GetChunkName, storeStructuredBuffers);
 
   m_StructuredFile = &ser.GetStructuredFile();
@@ -3249,6 +3277,15 @@ ReplayStatus WrappedOpenGL::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
 
   uint64_t frameDataSize = 0;
 
+  // CPU-only shader processing happens on worker threads while loading. Nothing in the frame
+  // depends on it, so it's allowed to overlap with processing the frame too.
+  Threading::ScopedJobBatch shaderProcessing(
+      m_ShaderProcessing, IsStructuredExporting(m_State) ? NULL : RenderDoc::Inst().GetJobSystem());
+
+  // shader reflection and program binaries can be cached from previous loads
+  if(!IsStructuredExporting(m_State) && GLProgramCache::IsEnabled())
+    m_ProgramCache = new GLProgramCache();
+
   for(;;)
   {
     PerformanceTimer timer;
@@ -3288,6 +3325,10 @@ ReplayStatus WrappedOpenGL::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
 
       m_FrameReader = new StreamReader(reader, frameDataSize);
 
+      // all programs created before the frame have been linked, fetch their binaries together
+      if(m_ProgramCache)
+        m_ProgramCache->StorePendingBinaries();
+
       rdcarray<DebugMessage> savedDebugMessages;
 
       // save any debug messages we built up
@@ -3313,6 +3354,14 @@ ReplayStatus WrappedOpenGL::ReadLogInitialisation(RDCFile *rdc, bool storeStruct
       break;
   }
 
+  shaderProcessing.Finish();
+
+  // write out anything added to the program cache
+  SAFE_DELETE(m_ProgramCache);
+
+  FillLoadStatistics(GetReplay()->WriteFrameRecord().frameInfo.loadStatistics, chunkInfos,
+                     &GetChunkName, reader);
+
 #if ENABLED(RDOC_DEVEL)
   for(auto it = chunkInfos.begin(); it != chunkInfos.end(); ++it)
   {
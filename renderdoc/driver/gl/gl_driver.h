@@ -26,6 +26,8 @@
 #pragma once
 
 #include "common/common.h"
+#include "common/jobsystem.h"
+#include "common/shader_cache.h"
 #include "common/timing.h"
 #include "core/core.h"
 #include "driver/shaders/spirv/spirv_reflect.h"
@@ -36,6 +38,7 @@
 #include "gl_resources.h"
 
 class GLReplay;
+class GLProgramCache;
 
 namespace glslang
 {
@@ -59,7 +62,7 @@ struct GLInitParams
   rdcstr renderer, version;
 
   // check if a frame capture section version is supported
-  static const uint64_t CurrentVersion = 0x21;
+  static const uint64_t CurrentVersion = 0x22;
   static bool IsSupportedVersion(uint64_t ver);
 };
 
@@ -213,6 +216,7 @@ private:
   void AddResourceCurChunk(ResourceDescription &descr);
   void AddResourceCurChunk(ResourceId id);
   void AddResourceInitChunk(GLResource res);
+  void AddProgramLinkParameter(GLResource program, const rdcstr &param);
 
   uint32_t m_FrameCounter = 0;
   uint32_t m_NoCtxFrames;
@@ -689,6 +693,10 @@ public:
     // pre-calculated bindpoint mapping for SPIR-V shaders. NOT valid for normal GLSL shaders
     ShaderBindpointMapping mapping;
 
+    // on replay GLSL is compiled to SPIR-V for disassembly on a worker thread while loading.
+    // Anything accessing spirv or disassembly must wait on this first.
+    Threading::PendingWork spirvPending;
+
     void ProcessCompilation(WrappedOpenGL &drv, ResourceId id, GLuint realShader);
     void ProcessSPIRVCompilation(WrappedOpenGL &drv, ResourceId id, GLuint realShader,
                                  const GLchar *pEntryPoint, GLuint numSpecializationConstants,
@@ -712,6 +720,10 @@ public:
     bool linked;
     ResourceId stageShaders[6];
 
+    // hash of any state set before linking that affects the linked program, so that it can be
+    // part of the program's key in the program cache
+    ShaderContentHash linkParams;
+
     // used only when we're capturing and don't have driver-side reflection so we need to emulate
     glslang::TProgram *glslangProgram = NULL;
   };
@@ -737,6 +749,11 @@ public:
 
   std::map<ResourceId, ShaderData> m_Shaders;
   std::map<ResourceId, ProgramData> m_Programs;
+
+  // only valid while loading the capture, see ShaderData::spirvPending
+  Threading::ScopedJobBatch *m_ShaderProcessing = NULL;
+  // only valid while loading the capture, and if the program cache is enabled
+  GLProgramCache *m_ProgramCache = NULL;
   std::map<ResourceId, PipelineData> m_Pipelines;
 
   void FillReflectionArray(ResourceId program, PerStageReflections &stages)
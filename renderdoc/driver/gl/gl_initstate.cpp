@@ -959,7 +959,8 @@ uint64_t GLResourceManager::GetSize_InitialState(ResourceId resid, const GLIniti
   if(initial.type == eResBuffer)
   {
     // buffers just have their contents, no metadata needed
-    return initial.bufferLength + WriteSerialiser::GetChunkAlignment() + 16;
+    return GetSerialisedContentsSize(initial.bufferLength) + WriteSerialiser::GetChunkAlignment() +
+           16;
   }
   else if(initial.type == eResProgram)
   {
@@ -1038,7 +1039,7 @@ uint64_t GLResourceManager::GetSize_InitialState(ResourceId resid, const GLIniti
         targetcount = 6;
 
       for(int t = 0; t < targetcount; t++)
-        ret += WriteSerialiser::GetChunkAlignment() + size;
+        ret += WriteSerialiser::GetChunkAlignment() + GetSerialisedContentsSize(size);
     }
 
     return ret;
@@ -1130,7 +1131,8 @@ bool GLResourceManager::Serialise_InitialState(SerialiserType &ser, ResourceId i
 
     // not using SERIALISE_ELEMENT_ARRAY so we can deliberately avoid allocation - we serialise
     // directly into upload memory
-    ser.Serialise("BufferContents"_lit, BufferContents, BufferContentsSize, SerialiserFlags::NoFlags);
+    ser.Serialise("BufferContents"_lit, BufferContents, BufferContentsSize,
+                  SerialiserFlags::Deduplicate);
 
     if(mappedBuffer.name)
       GL.glUnmapNamedBufferEXT(mappedBuffer.name);
@@ -1633,7 +1635,8 @@ bool GLResourceManager::Serialise_InitialState(SerialiserType &ser, ResourceId i
               }
 
               // serialise without allocating memory as we already have our scratch buf sized.
-              ser.Serialise("SubresourceContents"_lit, scratchBuf, size, SerialiserFlags::NoFlags);
+              ser.Serialise("SubresourceContents"_lit, scratchBuf, size,
+                            SerialiserFlags::Deduplicate);
 
               // on replay, restore the data into the initial contents texture
               if(IsReplayingAndReading() && !ser.IsErrored())
@@ -0,0 +1,330 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "gl_program_cache.h"
+#include "common/formatting.h"
+#include "core/settings.h"
+#include "gl_driver.h"
+
+RDOC_CONFIG(bool, OpenGL_ProgramCache, false,
+            "Cache shader reflection and program binaries on disk when loading captures, to speed "
+            "up loading the same or similar captures again.");
+
+RDOC_CONFIG(uint32_t, OpenGL_ProgramCacheSizeMB, 256,
+            "Maximum size in megabytes of the on-disk cache of shader reflection and program "
+            "binaries, when OpenGL_ProgramCache is enabled.");
+
+struct GLProgramCacheCallbacks
+{
+  bool Create(uint32_t size, byte *data, GLProgramCacheBlob *ret) const
+  {
+    RDCASSERT(ret);
+
+    if(size < sizeof(uint64_t))
+      return false;
+
+    *ret = new bytebuf(data, size);
+
+    return true;
+  }
+
+  void Destroy(GLProgramCacheBlob blob) const { delete blob; }
+  uint32_t GetSize(GLProgramCacheBlob blob) const { return (uint32_t)blob->size(); }
+  const byte *GetData(GLProgramCacheBlob blob) const { return blob->data(); }
+  uint64_t GetLastUse(GLProgramCacheBlob blob) const
+  {
+    uint64_t ret;
+    memcpy(&ret, blob->data(), sizeof(ret));
+    return ret;
+  }
+} GLProgramCacheCallbacks;
+
+// a program binary entry, followed by the binary itself
+struct GLProgramBinaryHeader
+{
+  GLenum format;
+  uint32_t length;
+};
+
+bool GLProgramCache::IsEnabled()
+{
+  return OpenGL_ProgramCache && OpenGL_ProgramCacheSizeMB > 0;
+}
+
+GLProgramCache::GLProgramCache()
+{
+  rdcstr driver = StringFormat::Fmt("%s\n%s\n%s\n%s", (const char *)GL.glGetString(eGL_VENDOR),
+                                    (const char *)GL.glGetString(eGL_RENDERER),
+                                    (const char *)GL.glGetString(eGL_VERSION), GitVersionHash);
+
+  // seed shader and program keys differently, so the two kinds of entry can share one file
+  m_ShaderSeed = HashShaderContent(driver.c_str(), driver.size());
+  m_ProgramSeed = HashShaderContent("program", 7, m_ShaderSeed);
+
+  GLint numFormats = 0;
+  if(GL.glGetProgramBinary && GL.glProgramBinary)
+    GL.glGetIntegerv(eGL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  m_Binaries = numFormats > 0;
+
+  bool success = LoadShaderCache("glprograms.cache", m_CacheMagic, m_CacheVersion, m_Cache,
+                                 GLProgramCacheCallbacks);
+
+  // a missing or invalid file will be overwritten with whatever we add in this session
+  m_Dirty = !success;
+}
+
+GLProgramCache::~GLProgramCache()
+{
+  if(m_Dirty)
+  {
+    TrimShaderCache(m_Cache, uint64_t(OpenGL_ProgramCacheSizeMB) * 1024 * 1024,
+                    GLProgramCacheCallbacks);
+
+    SaveShaderCache("glprograms.cache", m_CacheMagic, m_CacheVersion, m_Cache,
+                    GLProgramCacheCallbacks);
+  }
+  else
+  {
+    for(auto it = m_Cache.begin(); it != m_Cache.end(); ++it)
+      GLProgramCacheCallbacks.Destroy(it->second);
+  }
+}
+
+ShaderContentHash GLProgramCache::HashShader(GLenum type, const rdcarray<rdcstr> &sources,
+                                             const rdcarray<rdcstr> &includePaths) const
+{
+  ShaderContentHash ret = HashShaderContent(&type, sizeof(type), m_ShaderSeed);
+  ret = HashShaderContent(&m_NamedStrings, sizeof(m_NamedStrings), ret);
+  for(const rdcstr &s : sources)
+    ret = HashShaderContent(s.c_str(), s.size(), ret);
+  // hash the number of include paths, so they can't be confused with a trailing source string
+  uint32_t numPaths = (uint32_t)includePaths.size();
+  ret = HashShaderContent(&numPaths, sizeof(numPaths), ret);
+  for(const rdcstr &p : includePaths)
+    ret = HashShaderContent(p.c_str(), p.size(), ret);
+  return ret;
+}
+
+void GLProgramCache::HashNamedString(const rdcstr &name, const rdcstr *value)
+{
+  m_NamedStrings = HashShaderContent(name.c_str(), name.size(), m_NamedStrings);
+
+  // deleting a named string is distinct from setting it to an empty string
+  uint32_t deleted = value ? 0 : 1;
+  m_NamedStrings = HashShaderContent(&deleted, sizeof(deleted), m_NamedStrings);
+
+  if(value)
+    m_NamedStrings = HashShaderContent(value->c_str(), value->size(), m_NamedStrings);
+}
+
+void GLProgramCache::HashLinkParameter(ShaderContentHash &hash, const void *data, size_t length)
+{
+  hash = HashShaderContent(data, length, hash);
+}
+
+ShaderContentHash GLProgramCache::HashProgram(const rdcarray<ShaderContentHash> &shaders,
+                                              const ShaderContentHash &linkParams) const
+{
+  ShaderContentHash ret = HashShaderContent(&linkParams, sizeof(linkParams), m_ProgramSeed);
+  return HashShaderContent(shaders.data(), shaders.byteSize(), ret);
+}
+
+bool GLProgramCache::GetReflection(const ShaderContentHash &key, ShaderReflection &refl)
+{
+  auto it = m_Cache.find(key);
+  if(it == m_Cache.end())
+    return false;
+
+  bytebuf &blob = *it->second;
+
+  {
+    ReadSerialiser ser(
+        new StreamReader(blob.data() + sizeof(uint64_t), blob.size() - sizeof(uint64_t)),
+        Ownership::Stream);
+
+    ser.ReadChunk<uint32_t>();
+    ser.Serialise("refl"_lit, refl);
+    ser.EndChunk();
+
+    if(ser.IsErrored())
+    {
+      RDCWARN("Corrupt reflection cache entry, discarding");
+
+      Discard(key);
+
+      refl = ShaderReflection();
+      return false;
+    }
+  }
+
+  Touch(it->second);
+
+  return true;
+}
+
+void GLProgramCache::SetReflection(const ShaderContentHash &key, const ShaderReflection &refl)
+{
+  StreamWriter writer(StreamWriter::DefaultScratchSize);
+
+  {
+    WriteSerialiser ser(&writer, Ownership::Nothing);
+
+    SCOPED_SERIALISE_CHUNK(1);
+    ser.Serialise("refl"_lit, (ShaderReflection &)refl);
+  }
+
+  if(writer.IsErrored())
+    return;
+
+  Store(key, MakeBlob(writer.GetData(), (size_t)writer.GetOffset()));
+}
+
+bool GLProgramCache::LinkFromBinary(const ShaderContentHash &key, GLuint program)
+{
+  if(!m_Binaries)
+    return false;
+
+  auto it = m_Cache.find(key);
+  if(it == m_Cache.end())
+    return false;
+
+  bytebuf &blob = *it->second;
+
+  GLProgramBinaryHeader header = {};
+  if(blob.size() >= sizeof(uint64_t) + sizeof(header))
+    memcpy(&header, blob.data() + sizeof(uint64_t), sizeof(header));
+
+  GLint status = 0;
+
+  if(header.length > 0 && blob.size() == sizeof(uint64_t) + sizeof(header) + header.length)
+  {
+    GL.glProgramBinary(program, header.format, blob.data() + sizeof(uint64_t) + sizeof(header),
+                       (GLsizei)header.length);
+    GL.glGetProgramiv(program, eGL_LINK_STATUS, &status);
+  }
+
+  if(status == 0)
+  {
+    RDCDEBUG("Cached program binary was rejected, discarding");
+    Discard(key);
+    return false;
+  }
+
+  Touch(it->second);
+
+  return true;
+}
+
+void GLProgramCache::StoreBinary(const ShaderContentHash &key, GLuint program)
+{
+  if(!m_Binaries)
+    return;
+
+  if(m_DeferBinaries)
+    m_PendingBinaries.push_back({key, program});
+  else
+    FetchBinary(key, program);
+}
+
+void GLProgramCache::StorePendingBinaries()
+{
+  for(const rdcpair<ShaderContentHash, GLuint> &pending : m_PendingBinaries)
+    FetchBinary(pending.first, pending.second);
+
+  m_PendingBinaries.clear();
+  m_DeferBinaries = false;
+}
+
+void GLProgramCache::FetchBinary(const ShaderContentHash &key, GLuint program)
+{
+  GLint status = 0, length = 0;
+  GL.glGetProgramiv(program, eGL_LINK_STATUS, &status);
+  if(status == 0)
+    return;
+
+  GL.glGetProgramiv(program, eGL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0)
+    return;
+
+  bytebuf data;
+  data.resize(sizeof(GLProgramBinaryHeader) + length);
+
+  GLProgramBinaryHeader header = {};
+  GLsizei written = 0;
+  GL.glGetProgramBinary(program, length, &written, &header.format,
+                        data.data() + sizeof(GLProgramBinaryHeader));
+
+  if(written <= 0)
+    return;
+
+  header.length = (uint32_t)written;
+  memcpy(data.data(), &header, sizeof(header));
+  data.resize(sizeof(GLProgramBinaryHeader) + written);
+
+  Store(key, MakeBlob(data.data(), data.size()));
+}
+
+GLProgramCacheBlob GLProgramCache::MakeBlob(const byte *data, size_t size)
+{
+  uint64_t now = Timing::GetUnixTimestamp();
+
+  GLProgramCacheBlob blob = new bytebuf();
+  blob->resize(sizeof(now) + size);
+  memcpy(blob->data(), &now, sizeof(now));
+  memcpy(blob->data() + sizeof(now), data, size);
+  return blob;
+}
+
+void GLProgramCache::Store(const ShaderContentHash &key, GLProgramCacheBlob blob)
+{
+  auto it = m_Cache.find(key);
+  if(it != m_Cache.end())
+    GLProgramCacheCallbacks.Destroy(it->second);
+
+  m_Cache[key] = blob;
+  m_Dirty = true;
+}
+
+void GLProgramCache::Touch(GLProgramCacheBlob blob)
+{
+  // only refresh the LRU timestamp once a day, so that reading a cache doesn't mean re-writing it
+  // every session.
+  uint64_t now = Timing::GetUnixTimestamp();
+  if(now > GLProgramCacheCallbacks.GetLastUse(blob) + 24 * 60 * 60)
+  {
+    memcpy(blob->data(), &now, sizeof(now));
+    m_Dirty = true;
+  }
+}
+
+void GLProgramCache::Discard(const ShaderContentHash &key)
+{
+  auto it = m_Cache.find(key);
+  if(it == m_Cache.end())
+    return;
+
+  GLProgramCacheCallbacks.Destroy(it->second);
+  m_Cache.erase(it);
+  m_Dirty = true;
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "common/shader_cache.h"
+#include "gl_common.h"
+
+// serialised cache entry, prefixed with a uint64_t timestamp of when it was last used
+typedef bytebuf *GLProgramCacheBlob;
+
+// opt-in on-disk cache used while loading a capture on replay, so that reopening it can skip work
+// that only depends on the shader sources and the driver. It holds the reflection for compiled
+// shaders and program binaries for linked programs. Keys are seeded with the driver's vendor,
+// renderer and version strings and our build's commit hash, so that entries from any other driver
+// or build are never used.
+class GLProgramCache
+{
+public:
+  GLProgramCache();
+  ~GLProgramCache();
+
+  static bool IsEnabled();
+
+  ShaderContentHash HashShader(GLenum type, const rdcarray<rdcstr> &sources,
+                               const rdcarray<rdcstr> &includePaths) const;
+  // named strings can be #included by any shader, so every change to them is chained onto the keys
+  // of shaders compiled afterwards
+  void HashNamedString(const rdcstr &name, const rdcstr *value);
+  // chains any state that affects linking, such as attribute bindings, onto a program's key
+  static void HashLinkParameter(ShaderContentHash &hash, const void *data, size_t length);
+  ShaderContentHash HashProgram(const rdcarray<ShaderContentHash> &shaders,
+                                const ShaderContentHash &linkParams) const;
+
+  bool GetReflection(const ShaderContentHash &key, ShaderReflection &refl);
+  void SetReflection(const ShaderContentHash &key, const ShaderReflection &refl);
+
+  // returns true if the program was linked from a cached binary. If the driver rejects the binary
+  // it is discarded, and the program must be linked normally.
+  bool LinkFromBinary(const ShaderContentHash &key, GLuint program);
+  // binaries of programs linked while creating resources are fetched together by
+  // StorePendingBinaries, so that checking whether each link succeeded doesn't wait on the driver
+  // to finish linking programs one at a time. Afterwards binaries are fetched immediately.
+  void StoreBinary(const ShaderContentHash &key, GLuint program);
+  void StorePendingBinaries();
+
+private:
+  static const uint32_t m_CacheMagic = 0xf00d00d8;
+  static const uint32_t m_CacheVersion = 1;
+
+  GLProgramCacheBlob MakeBlob(const byte *data, size_t size);
+  void Store(const ShaderContentHash &key, GLProgramCacheBlob blob);
+  void Touch(GLProgramCacheBlob blob);
+  void Discard(const ShaderContentHash &key);
+  void FetchBinary(const ShaderContentHash &key, GLuint program);
+
+  ShaderContentHash m_ShaderSeed, m_ProgramSeed;
+  ShaderContentHash m_NamedStrings;
+  bool m_Binaries = false;
+
+  bool m_DeferBinaries = true;
+  rdcarray<rdcpair<ShaderContentHash, GLuint>> m_PendingBinaries;
+
+  bool m_Dirty = false;
+  std::map<ShaderContentHash, GLProgramCacheBlob> m_Cache;
+};
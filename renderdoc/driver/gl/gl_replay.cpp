@@ -783,6 +783,8 @@ rdcstr GLReplay::DisassembleShader(ResourceId pipeline, const ShaderReflection *
 
   if(target == SPIRVDisassemblyTarget || target.empty())
   {
+    shaderDetails.spirvPending.Wait();
+
     rdcstr &disasm = shaderDetails.disassembly;
 
     if(disasm.empty())
@@ -3458,6 +3460,14 @@ rdcarray<PixelModification> GLReplay::PixelHistory(rdcarray<EventUsage> events,
   return {};
 }
 
+rdcarray<PixelRegionHistory> GLReplay::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                          ResourceId target, uint32_t x, uint32_t y,
+                                                          uint32_t width, uint32_t height,
+                                                          const Subresource &sub, CompType typeCast)
+{
+  return StandardPixelHistoryRegion(this, events, target, x, y, width, height, sub, typeCast);
+}
+
 ShaderDebugTrace *GLReplay::DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid,
                                         uint32_t idx)
 {
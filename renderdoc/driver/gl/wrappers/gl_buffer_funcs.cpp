@@ -403,7 +403,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferStorageEXT(SerialiserType &ser, GLuin
   SERIALISE_ELEMENT_LOCAL(buffer, BufferRes(GetCtx(), bufferHandle));
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(data, bytesize);
 
   if(ser.IsWriting())
   {
@@ -548,7 +548,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferDataEXT(SerialiserType &ser, GLuint b
   SERIALISE_ELEMENT_LOCAL(buffer, BufferRes(GetCtx(), bufferHandle));
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(data, bytesize);
 
   if(ser.IsWriting())
   {
@@ -907,7 +907,7 @@ bool WrappedOpenGL::Serialise_glNamedBufferSubDataEXT(SerialiserType &ser, GLuin
   SERIALISE_ELEMENT_LOCAL(offset, (uint64_t)offsetPtr);
 
   SERIALISE_ELEMENT_LOCAL(bytesize, (uint64_t)size);
-  SERIALISE_ELEMENT_ARRAY(data, bytesize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(data, bytesize);
 
   SERIALISE_CHECK_READ_ERRORS();
 
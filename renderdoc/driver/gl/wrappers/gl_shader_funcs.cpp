@@ -25,6 +25,7 @@
 
 #include <ctype.h>
 #include "../gl_driver.h"
+#include "../gl_program_cache.h"
 #include "../gl_shader_refl.h"
 #include "common/common.h"
 #include "driver/shaders/spirv/glslang_compile.h"
@@ -86,6 +87,9 @@ void WrappedOpenGL::ShaderData::ProcessSPIRVCompilation(WrappedOpenGL &drv, Reso
 void WrappedOpenGL::ShaderData::ProcessCompilation(WrappedOpenGL &drv, ResourceId id,
                                                    GLuint realShader)
 {
+  // if this shader was compiled before, don't race with any background work from that
+  spirvPending.Wait();
+
   FixedFunctionVertexOutputs outputUsage = {};
   if(type == eGL_VERTEX_SHADER)
     CheckVertexOutputUses(sources, outputUsage);
@@ -213,11 +217,22 @@ void WrappedOpenGL::ShaderData::ProcessCompilation(WrappedOpenGL &drv, ResourceI
     }
     else
     {
-      bool reflected = false;
+      bool reflected = false, cached = false;
+
+      ShaderContentHash cacheKey;
+      if(drv.m_ProgramCache)
+      {
+        cacheKey = drv.m_ProgramCache->HashShader(type, sources, includepaths);
+        cached = reflected = drv.m_ProgramCache->GetReflection(cacheKey, reflection);
+      }
 
+      if(cached)
+      {
+        // reflection only depends on the sources and the driver, so nothing needs to be compiled
+      }
       // if we have separate shader object support, we can create a separable program and reflect it
       // - this may or may not be emulated depending on if ARB_program_interface_query is supported.
-      if(HasExt[ARB_separate_shader_objects])
+      else if(HasExt[ARB_separate_shader_objects])
       {
         GLuint sepProg = MakeSeparableShaderProgram(drv, type, sources, NULL);
 
@@ -263,16 +278,28 @@ void WrappedOpenGL::ShaderData::ProcessCompilation(WrappedOpenGL &drv, ResourceI
 
       if(reflected)
       {
-        rdcarray<uint32_t> spirvwords;
+        if(drv.m_ProgramCache && !cached)
+          drv.m_ProgramCache->SetReflection(cacheKey, reflection);
 
         rdcspv::CompilationSettings settings(rdcspv::InputLanguage::OpenGLGLSL,
                                              rdcspv::ShaderStage(ShaderIdx(type)));
 
-        rdcstr s = rdcspv::Compile(settings, sources, spirvwords);
-        if(!spirvwords.empty())
-          spirv.Parse(spirvwords);
+        // the SPIR-V is only used for disassembly, so if we're loading it can be compiled in the
+        // background. Sources can't change without waiting for this to finish.
+        std::function<void()> compile = [this, settings]() {
+          rdcarray<uint32_t> spirvwords;
+
+          rdcstr s = rdcspv::Compile(settings, sources, spirvwords);
+          if(!spirvwords.empty())
+            spirv.Parse(spirvwords);
+          else
+            disassembly = "Disassembly to SPIR-V failed:\n\n" + s;
+        };
+
+        if(drv.m_ShaderProcessing)
+          drv.m_ShaderProcessing->Submit(compile, &spirvPending);
         else
-          disassembly = "Disassembly to SPIR-V failed:\n\n" + s;
+          compile();
 
         reflection.resourceId = id;
 
@@ -386,6 +413,8 @@ bool WrappedOpenGL::Serialise_glShaderSource(SerialiserType &ser, GLuint shaderH
 
     ResourceId liveId = GetResourceManager()->GetID(shader);
 
+    m_Shaders[liveId].spirvPending.Wait();
+
     m_Shaders[liveId].sources = sources;
 
     GL.glShaderSource(shader.name, (GLsizei)sources.size(), strs.data(), NULL);
@@ -852,7 +881,40 @@ bool WrappedOpenGL::Serialise_glLinkProgram(SerialiserType &ser, GLuint programH
       progDetails.glslangProgram = LinkProgramForReflection(glslangShaders);
     }
 
-    GL.glLinkProgram(program.name);
+    bool linked = false;
+
+    // programs can be linked from a cached binary, if all their shaders are GLSL
+    ShaderContentHash cacheKey;
+    bool useCache = m_ProgramCache != NULL;
+
+    if(useCache)
+    {
+      rdcarray<ShaderContentHash> shaderKeys;
+      for(ResourceId id : progDetails.shaders)
+      {
+        const ShaderData &shadDetails = m_Shaders[id];
+        useCache &= shadDetails.spirvWords.empty();
+        shaderKeys.push_back(m_ProgramCache->HashShader(shadDetails.type, shadDetails.sources,
+                                                        shadDetails.includepaths));
+      }
+
+      if(useCache)
+      {
+        cacheKey = m_ProgramCache->HashProgram(shaderKeys, progDetails.linkParams);
+        linked = m_ProgramCache->LinkFromBinary(cacheKey, program.name);
+
+        if(!linked)
+          GL.glProgramParameteri(program.name, eGL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+      }
+    }
+
+    if(!linked)
+    {
+      GL.glLinkProgram(program.name);
+
+      if(useCache)
+        m_ProgramCache->StoreBinary(cacheKey, program.name);
+    }
 
     AddResourceInitChunk(program);
   }
@@ -1023,6 +1085,8 @@ bool WrappedOpenGL::Serialise_glBindAttribLocation(SerialiserType &ser, GLuint p
   {
     GL.glBindAttribLocation(program.name, index, name);
 
+    AddProgramLinkParameter(program, StringFormat::Fmt("attrib %u %s", index, name));
+
     AddResourceInitChunk(program);
   }
 
@@ -1063,6 +1127,8 @@ bool WrappedOpenGL::Serialise_glBindFragDataLocation(SerialiserType &ser, GLuint
   {
     GL.glBindFragDataLocation(program.name, color, name);
 
+    AddProgramLinkParameter(program, StringFormat::Fmt("fragdata %u 0 %s", color, name));
+
     AddResourceInitChunk(program);
   }
 
@@ -1139,6 +1205,9 @@ bool WrappedOpenGL::Serialise_glBindFragDataLocationIndexed(SerialiserType &ser,
   {
     GL.glBindFragDataLocationIndexed(program.name, colorNumber, index, name);
 
+    AddProgramLinkParameter(program,
+                            StringFormat::Fmt("fragdata %u %u %s", colorNumber, index, name));
+
     AddResourceInitChunk(program);
   }
 
@@ -1183,6 +1252,11 @@ bool WrappedOpenGL::Serialise_glTransformFeedbackVaryings(SerialiserType &ser, G
   {
     GL.glTransformFeedbackVaryings(program.name, count, varyings, bufferMode);
 
+    rdcstr param = StringFormat::Fmt("xfb %u", bufferMode);
+    for(GLsizei i = 0; i < count; i++)
+      param += StringFormat::Fmt(" %s", varyings[i]);
+    AddProgramLinkParameter(program, param);
+
     AddResourceInitChunk(program);
   }
 
@@ -1224,6 +1298,8 @@ bool WrappedOpenGL::Serialise_glProgramParameteri(SerialiserType &ser, GLuint pr
   {
     GL.glProgramParameteri(program.name, pname, value);
 
+    AddProgramLinkParameter(program, StringFormat::Fmt("param %u %d", pname, value));
+
     AddResourceInitChunk(program);
   }
 
@@ -1856,6 +1932,9 @@ bool WrappedOpenGL::Serialise_glNamedStringARB(SerialiserType &ser, GLenum type,
 
     GL.glNamedStringARB(type, (GLint)name.length(), name.c_str(), (GLint)value.length(),
                         value.c_str());
+
+    if(m_ProgramCache)
+      m_ProgramCache->HashNamedString(name, &value);
   }
 
   return true;
@@ -1894,6 +1973,9 @@ bool WrappedOpenGL::Serialise_glDeleteNamedStringARB(SerialiserType &ser, GLint
     CheckReplayFunctionPresent(glDeleteNamedStringARB);
 
     GL.glDeleteNamedStringARB((GLint)name.length(), name.c_str());
+
+    if(m_ProgramCache)
+      m_ProgramCache->HashNamedString(name, NULL);
   }
 
   return true;
@@ -2271,7 +2271,7 @@ bool WrappedOpenGL::Serialise_glTextureImage1DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, 1, 1, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -2495,7 +2495,7 @@ bool WrappedOpenGL::Serialise_glTextureImage2DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, height, 1, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -2749,7 +2749,7 @@ bool WrappedOpenGL::Serialise_glTextureImage3DEXT(SerialiserType &ser, GLuint te
 
   size_t subimageSize = GetByteSize(width, height, depth, format, type);
 
-  SERIALISE_ELEMENT_ARRAY(pixels, subimageSize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(pixels, subimageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -2978,7 +2978,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage1DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3299,7 +3299,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage2DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -3560,7 +3560,7 @@ bool WrappedOpenGL::Serialise_glCompressedTextureImage3DEXT(SerialiserType &ser,
   }
 
   SERIALISE_ELEMENT(imageSize);
-  SERIALISE_ELEMENT_ARRAY(pixels, imageSize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(pixels, imageSize);
 
   SAFE_DELETE_ARRAY(unpackedPixels);
 
@@ -27,9 +27,39 @@
 #include <algorithm>
 #include "common/formatting.h"
 #include "replay/replay_driver.h"
+#include "serialise/serialiser.h"
 #include "spirv_editor.h"
 #include "spirv_op_helpers.h"
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, SPIRVInterfaceAccess &el)
+{
+  // IDs are only meaningful alongside the module they came from, serialise them as plain words
+  uint32_t ID = el.ID.value(), structID = el.structID.value();
+  ser.Serialise("ID"_lit, ID);
+  ser.Serialise("structID"_lit, structID);
+  if(ser.IsReading())
+  {
+    el.ID = rdcspv::Id::fromWord(ID);
+    el.structID = rdcspv::Id::fromWord(structID);
+  }
+
+  SERIALISE_MEMBER(structMemberIndex);
+  SERIALISE_MEMBER(accessChain);
+  SERIALISE_MEMBER(isArraySubsequentElement);
+}
+
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, SPIRVPatchData &el)
+{
+  SERIALISE_MEMBER(inputs);
+  SERIALISE_MEMBER(outputs);
+  SERIALISE_MEMBER(outTopo);
+}
+
+INSTANTIATE_SERIALISE_TYPE(SPIRVInterfaceAccess);
+INSTANTIATE_SERIALISE_TYPE(SPIRVPatchData);
+
 void FillSpecConstantVariables(ResourceId shader, const rdcarray<ShaderConstant> &invars,
                                rdcarray<ShaderVariable> &outvars,
                                const rdcarray<SpecConstant> &specInfo)
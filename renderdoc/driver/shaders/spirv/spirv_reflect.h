@@ -67,6 +67,9 @@ struct SPIRVPatchData
   Topology outTopo = Topology::Unknown;
 };
 
+DECLARE_REFLECTION_STRUCT(SPIRVInterfaceAccess);
+DECLARE_REFLECTION_STRUCT(SPIRVPatchData);
+
 namespace rdcspv
 {
 struct SourceFile
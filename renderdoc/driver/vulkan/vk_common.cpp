@@ -321,6 +321,14 @@ bool VkInitParams::IsSupportedVersion(uint64_t ver)
   if(ver == CurrentVersion)
     return true;
 
+  // 0x12 -> 0x13 - uniform memory and image initial contents are stored as a fill value
+  if(ver == 0x12)
+    return true;
+
+  // 0x11 -> 0x12 - initial contents can be deduplicated into a content blocks section
+  if(ver == 0x11)
+    return true;
+
   // 0x10 -> 0x11 - non-breaking changes to image state serialization
   if(ver == 0x10)
     return true;
@@ -351,6 +351,8 @@ enum class MemoryScope : uint8_t
   InitialContents,
   First = InitialContents,
   IndirectReadback,
+  PostVS,
+  HostInitialContents,
   Count,
 };
 
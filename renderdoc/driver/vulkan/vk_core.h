@@ -29,6 +29,7 @@
 #include "vk_common.h"
 #include "vk_info.h"
 #include "vk_manager.h"
+#include "vk_memory.h"
 #include "vk_state.h"
 
 class VulkanShaderCache;
@@ -53,7 +54,7 @@ struct VkInitParams
   uint64_t GetSerialiseSize();
 
   // check if a frame capture section version is supported
-  static const uint64_t CurrentVersion = 0x11;
+  static const uint64_t CurrentVersion = 0x13;
   static bool IsSupportedVersion(uint64_t ver);
 };
 
@@ -495,21 +496,21 @@ private:
     // -> FlushQ() ----back to freesems-------^
   } m_InternalCmds;
 
-  // Internal lumped/pooled memory allocations
+  // Internal lumped/pooled memory allocations, sub-allocated out of blocks for each memory scope.
+  VulkanMemoryAllocator m_MemoryAllocator;
 
-  // Each memory scope gets a separate vector of allocation objects. The vector contains the list of
-  // all 'base' allocations. The offset is used to indicate the current offset, and the size is the
-  // total size, thus the free space can be determined with size - offset.
-  rdcarray<MemoryAllocation> m_MemoryBlocks[arraydim<MemoryScope>()];
-
-  // Per memory scope, the size of the next allocation. This allows us to balance number of memory
-  // allocation objects with size by incrementally allocating larger blocks.
-  VkDeviceSize m_MemoryBlockSize[arraydim<MemoryScope>()] = {};
+  VkDeviceMemory AllocateMemoryBlock(uint32_t memoryTypeIndex, VkDeviceSize size);
+  void FreeMemoryBlock(VkDeviceMemory mem);
+  void LogMemoryStatistics();
 
   MemoryAllocation AllocateMemoryForResource(VkImage im, MemoryScope scope, MemoryType type);
   MemoryAllocation AllocateMemoryForResource(VkBuffer buf, MemoryScope scope, MemoryType type);
   void FreeAllMemory(MemoryScope scope);
   void FreeMemoryAllocation(MemoryAllocation alloc);
+  const MemoryScopeStatistics &GetMemoryStatistics(MemoryScope scope) const
+  {
+    return m_MemoryAllocator.GetStatistics(scope);
+  }
 
   // internal implementation - call one of the functions above
   MemoryAllocation AllocateMemoryForResource(bool buffer, VkMemoryRequirements mrq,
@@ -662,6 +663,15 @@ private:
   // above map
   rdcarray<rdcpair<VkCommandPool, VkCommandBuffer>> m_RerecordCmdList;
 
+  // once a replay is finished the re-recorded command buffers are kept here to be reset and reused
+  // by later replays, instead of being freed and allocated again. Indexed by level, then by pool.
+  std::map<VkCommandPool, rdcarray<VkCommandBuffer>> m_RecycledRerecordCmds[2];
+
+  // the file offset of each vkBeginCommandBuffer chunk, to the offset of its matching
+  // vkEndCommandBuffer. Command buffers that aren't being re-recorded are skipped over without
+  // reading any of their commands.
+  std::map<uint64_t, uint64_t> m_CmdBufferEndOffsets;
+
   // There is only a state while currently partially replaying, it's
   // undefined/empty otherwise.
   // All IDs are original IDs, not live.
@@ -761,6 +771,38 @@ private:
   std::map<ResourceId, rdcarray<EventUsage>> m_ResourceUses;
   std::map<uint32_t, EventFlags> m_EventFlags;
 
+  // state for initial contents kept in host memory, which are uploaded on demand
+  struct HostInitialContentsState
+  {
+    struct Resident
+    {
+      VkBuffer buf;
+      MemoryAllocation mem;
+      uint64_t lastUse;
+    };
+
+    // GPU copies of the contents, evicted least-recently-used first to stay within the budget
+    std::map<ResourceId, Resident> resident;
+    VkDeviceSize residentBytes = 0;
+    uint64_t useCounter = 0;
+
+    // the event being replayed up to. Resources first used after it are skipped when applying
+    // initial contents, until a partial replay goes past their first use. These are original IDs.
+    uint32_t targetEvent = ~0U;
+    rdcarray<ResourceId> skipped;
+    // set while skipped contents are being applied, so they aren't skipped again
+    bool applyingSkipped = false;
+
+    // the first event each resource is used in, including memory through its bound resources
+    std::map<ResourceId, uint32_t> firstUse;
+  } m_HostInitialContents;
+
+  // host initial contents are compressed on worker threads through this batch. It's created when
+  // loading and kept until shutdown, so compression carries on after loading has finished and only
+  // the first use of each resource's contents waits for its own work.
+  Threading::ScopedJobBatch *m_InitialContentsBatch = NULL;
+  Threading::ScopedJobBatch *m_InitialContentsProcessing = NULL;
+
   // returns thread-local temporary memory
   byte *GetTempMemory(size_t s);
   template <class T>
@@ -937,18 +979,28 @@ public:
   VulkanResourceManager *GetResourceManager() { return m_ResourceManager; }
   VulkanDebugManager *GetDebugManager() { return m_DebugManager; }
   VulkanShaderCache *GetShaderCache() { return m_ShaderCache; }
+  // the persistent pipeline cache used by all pipelines created on replay. This is unwrapped.
+  VkPipelineCache GetReplayPipelineCache();
   CaptureState GetState() { return m_State; }
   VulkanReplay *GetReplay() { return m_Replay; }
   // replay interface
   bool Prepare_InitialState(WrappedVkRes *res);
   uint64_t GetSize_InitialState(ResourceId id, const VkInitialContents &initial);
   uint64_t GetSize_SparseInitialState(ResourceId id, const VkInitialContents &initial);
+  bool IsUniformInitialState(const VkInitialContents &initial, uint32_t &value);
   template <typename SerialiserType>
   bool Serialise_InitialState(SerialiserType &ser, ResourceId id, VkResourceRecord *record,
                               const VkInitialContents *initial);
   void Create_InitialState(ResourceId id, WrappedVkRes *live, bool hasData);
   void Apply_InitialState(WrappedVkRes *live, const VkInitialContents &initial);
 
+  bool SkipHostInitialContents(ResourceId id);
+  VkBuffer GetHostInitialContentsBuffer(ResourceId id, const VkInitialContents &initial);
+  void ApplySkippedInitialContents(uint32_t endEventID);
+  void ApplySkippedInitialContents(ResourceId id);
+  void ApplyHostInitialContents(const rdcarray<ResourceId> &origIds);
+  void FreeHostInitialContents();
+
   void RemapQueueFamilyIndices(uint32_t &srcQueueFamily, uint32_t &dstQueueFamily);
   uint32_t GetQueueFamilyIndex() const { return m_QueueFamilyIdx; }
   bool ReleaseResource(WrappedVkRes *res);
@@ -81,10 +81,11 @@ public:
                                  uint32_t &indexCount);
 
   bool PixelHistorySetupResources(PixelHistoryResources &resources, VkExtent3D extent,
-                                  VkFormat format, uint32_t numEvents);
+                                  VkFormat format, VkDeviceSize bufferSize);
   bool PixelHistoryDestroyResources(const PixelHistoryResources &resources);
 
-  void PixelHistoryCopyPixel(VkCommandBuffer cmd, CopyPixelParams &p, size_t offset);
+  void PixelHistoryCopyRegion(VkCommandBuffer cmd, CopyPixelParams &p, size_t offset,
+                              size_t stencilOffset);
 
   VkImageLayout GetImageLayout(ResourceId image, VkImageAspectFlagBits aspect, uint32_t mip,
                                uint32_t slice);
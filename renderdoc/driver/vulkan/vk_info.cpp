@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "vk_info.h"
+#include "vk_shader_cache.h"
 
 VkDynamicState ConvertDynamicState(VulkanDynamicStateIndex idx)
 {
@@ -256,8 +257,8 @@ void VulkanCreationInfo::Pipeline::Init(VulkanResourceManager *resourceMan,
 
     ShaderModuleReflection &reflData = info.m_ShaderModule[shadid].m_Reflections[key];
 
-    reflData.Init(resourceMan, shadid, info.m_ShaderModule[shadid].spirv, shad.entryPoint,
-                  pCreateInfo->pStages[i].stage, shad.specialization);
+    reflData.Init(resourceMan, info, shadid, info.m_ShaderModule[shadid],
+                  shad.entryPoint, pCreateInfo->pStages[i].stage, shad.specialization);
 
     shad.refl = &reflData.refl;
     shad.mapping = &reflData.mapping;
@@ -585,8 +586,8 @@ void VulkanCreationInfo::Pipeline::Init(VulkanResourceManager *resourceMan, Vulk
 
     ShaderModuleReflection &reflData = info.m_ShaderModule[shadid].m_Reflections[key];
 
-    reflData.Init(resourceMan, shadid, info.m_ShaderModule[shadid].spirv, shad.entryPoint,
-                  pCreateInfo->stage.stage, shad.specialization);
+    reflData.Init(resourceMan, info, shadid, info.m_ShaderModule[shadid],
+                  shad.entryPoint, pCreateInfo->stage.stage, shad.specialization);
 
     shad.refl = &reflData.refl;
     shad.mapping = &reflData.mapping;
@@ -1076,13 +1077,21 @@ void VulkanCreationInfo::ShaderModule::Init(VulkanResourceManager *resourceMan,
   else
   {
     RDCASSERT(pCreateInfo->codeSize % sizeof(uint32_t) == 0);
-    spirv.Parse(rdcarray<uint32_t>((uint32_t *)(pCreateInfo->pCode),
-                                   pCreateInfo->codeSize / sizeof(uint32_t)));
+    rdcarray<uint32_t> words((uint32_t *)(pCreateInfo->pCode),
+                             pCreateInfo->codeSize / sizeof(uint32_t));
+
+    contentHash = HashShaderContent(pCreateInfo->pCode, pCreateInfo->codeSize);
+
+    if(info.m_ShaderProcessing)
+      info.m_ShaderProcessing->Submit([this, words]() { spirv.Parse(words); }, &pending);
+    else
+      spirv.Parse(words);
   }
 }
 
 void VulkanCreationInfo::ShaderModuleReflection::Init(VulkanResourceManager *resourceMan,
-                                                      ResourceId id, const rdcspv::Reflector &spv,
+                                                      const VulkanCreationInfo &info,
+                                                      ResourceId id, const ShaderModule &module,
                                                       const rdcstr &entry,
                                                       VkShaderStageFlagBits stage,
                                                       const rdcarray<SpecConstant> &specInfo)
@@ -1092,10 +1101,49 @@ void VulkanCreationInfo::ShaderModuleReflection::Init(VulkanResourceManager *res
     entryPoint = entry;
     stageIndex = StageIndex(stage);
 
-    spv.MakeReflection(GraphicsAPI::Vulkan, ShaderStage(stageIndex), entryPoint, specInfo, refl,
-                       mapping, patchData);
+    ResourceId origId = resourceMan->GetOriginalID(id);
+
+    VulkanShaderCache *reflectionCache = info.m_ReflectionCache;
+
+    // modules that weren't SPIR-V have no hash and nothing worth caching
+    ShaderContentHash key;
+    if(reflectionCache && module.contentHash != ShaderContentHash())
+    {
+      key = HashShaderContent(entry.c_str(), entry.size(), module.contentHash);
+      key = HashShaderContent(&stageIndex, sizeof(stageIndex), key);
+      for(const SpecConstant &spec : specInfo)
+      {
+        uint64_t specData[3] = {spec.specID, spec.value, spec.dataSize};
+        key = HashShaderContent(specData, sizeof(specData), key);
+      }
+    }
+
+    std::function<void()> reflect = [this, &module, reflectionCache, key, specInfo, origId]() {
+      // the module itself may not have finished parsing yet
+      module.pending.Wait();
+
+      if(key != ShaderContentHash() && reflectionCache->GetReflection(key, *this))
+      {
+        // the raw bytes aren't stored in the cache, since we have them to hand
+        rdcarray<uint32_t> spirvWords = module.spirv.GetSPIRV();
+        refl.rawBytes.assign((byte *)spirvWords.data(), spirvWords.byteSize());
+      }
+      else
+      {
+        module.spirv.MakeReflection(GraphicsAPI::Vulkan, ShaderStage(stageIndex), entryPoint,
+                                    specInfo, refl, mapping, patchData);
 
-    refl.resourceId = resourceMan->GetOriginalID(id);
+        if(key != ShaderContentHash())
+          reflectionCache->SetReflection(key, *this);
+      }
+
+      refl.resourceId = origId;
+    };
+
+    if(info.m_ShaderProcessing)
+      info.m_ShaderProcessing->Submit(reflect, &pending);
+    else
+      reflect();
   }
 }
 
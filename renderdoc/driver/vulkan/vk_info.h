@@ -24,11 +24,14 @@
 
 #pragma once
 
+#include "common/shader_cache.h"
+#include "common/jobsystem.h"
 #include "driver/shaders/spirv/spirv_reflect.h"
 #include "vk_common.h"
 #include "vk_manager.h"
 
 struct VulkanCreationInfo;
+class VulkanShaderCache;
 
 // linearised version of VkDynamicState
 enum VulkanDynamicStateIndex
@@ -168,6 +171,8 @@ struct VulkanCreationInfo
     ResourceId specialisingPipe;
   };
 
+  struct ShaderModule;
+
   struct ShaderModuleReflection
   {
     uint32_t stageIndex;
@@ -178,8 +183,11 @@ struct VulkanCreationInfo
     SPIRVPatchData patchData;
     std::map<size_t, uint32_t> instructionLines;
 
-    void Init(VulkanResourceManager *resourceMan, ResourceId id, const rdcspv::Reflector &spv,
-              const rdcstr &entry, VkShaderStageFlagBits stage,
+    // reflection may be in progress on a worker thread while loading
+    Threading::PendingWork pending;
+
+    void Init(VulkanResourceManager *resourceMan, const VulkanCreationInfo &info, ResourceId id,
+              const ShaderModule &module, const rdcstr &entry, VkShaderStageFlagBits stage,
               const rdcarray<SpecConstant> &specInfo);
 
     void PopulateDisassembly(const rdcspv::Reflector &spirv);
@@ -529,14 +537,25 @@ struct VulkanCreationInfo
       // look for one from this pipeline specifically, if it was specialised
       auto it = m_Reflections.find({entry, pipe});
       if(it != m_Reflections.end())
+      {
+        it->second.pending.Wait();
         return it->second;
+      }
 
       // if not, just return the non-specialised version
-      return m_Reflections[{entry, ResourceId()}];
+      ShaderModuleReflection &ret = m_Reflections[{entry, ResourceId()}];
+      ret.pending.Wait();
+      return ret;
     }
 
     rdcspv::Reflector spirv;
 
+    // hash of the SPIR-V words, used to look up reflection data from previous sessions
+    ShaderContentHash contentHash;
+
+    // the SPIR-V may still be being parsed on a worker thread while loading
+    Threading::PendingWork pending;
+
     rdcstr unstrippedPath;
 
     std::map<ShaderModuleReflectionKey, ShaderModuleReflection> m_Reflections;
@@ -565,6 +584,13 @@ struct VulkanCreationInfo
   // just contains the queueFamilyIndex (after remapping)
   std::map<ResourceId, uint32_t> m_Queue;
 
+  // persistent reflection cache shared between captures, only available on replay
+  VulkanShaderCache *m_ReflectionCache = NULL;
+
+  // while loading, shader modules are parsed and reflected on these workers. Anything that needs
+  // the results before loading has finished must wait on the object's pending work.
+  Threading::ScopedJobBatch *m_ShaderProcessing = NULL;
+
   void erase(ResourceId id)
   {
     m_Pipeline.erase(id);
@@ -22,9 +22,22 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include "core/settings.h"
+#include "lz4/lz4.h"
 #include "vk_core.h"
 #include "vk_debug.h"
 
+RDOC_CONFIG(uint32_t, Vulkan_HostInitialContentsBudgetMB, 0,
+            "If non-zero, large initial contents are kept in host memory and uploaded to the GPU "
+            "on demand, with at most this many MB uploaded at once. Resources that aren't used up "
+            "to the event being replayed are skipped. This allows replaying captures that need "
+            "more GPU memory than is available, at the cost of slower replays.");
+RDOC_CONFIG(uint32_t, Vulkan_HostInitialContentsMinSizeKB, 1024,
+            "The minimum size in KB of initial contents to keep in host memory, when "
+            "Vulkan_HostInitialContentsBudgetMB is enabled.");
+RDOC_CONFIG(bool, Vulkan_HostInitialContentsCompress, true,
+            "Compress initial contents kept in host memory.");
+
 // VKTODOLOW there's a lot of duplicated code in this file for creating a buffer to do
 // a memory copy and saving to disk.
 
@@ -536,6 +549,73 @@ bool WrappedVulkan::Prepare_InitialState(WrappedVkRes *res)
   return false;
 }
 
+// returns true if the contents are a single 32-bit value repeated, which vkCmdFillBuffer can write
+static bool IsUniformContents(const byte *data, uint64_t size, uint32_t &value)
+{
+  if(data == NULL || size < sizeof(uint64_t) || (size % sizeof(uint32_t)) != 0)
+    return false;
+
+  memcpy(&value, data, sizeof(value));
+
+  // compare 64 bits at a time, nearly all non-uniform contents differ within the first few words
+  const uint64_t pattern = (uint64_t(value) << 32) | value;
+  const uint64_t *words = (const uint64_t *)data;
+  const uint64_t numWords = size / sizeof(uint64_t);
+
+  for(uint64_t i = 0; i < numWords; i++)
+    if(words[i] != pattern)
+      return false;
+
+  if(size % sizeof(uint64_t))
+  {
+    uint32_t last;
+    memcpy(&last, data + size - sizeof(last), sizeof(last));
+    return last == value;
+  }
+
+  return true;
+}
+
+bool WrappedVulkan::IsUniformInitialState(const VkInitialContents &initial, uint32_t &value)
+{
+  if(initial.mem.mem == VK_NULL_HANDLE)
+    return false;
+
+  if(initial.uniformScanned)
+  {
+    value = initial.uniformValue;
+    return initial.uniformContents;
+  }
+
+  VkDevice d = GetDev();
+
+  byte *data = NULL;
+  VkResult vkr = ObjDisp(d)->MapMemory(Unwrap(d), Unwrap(initial.mem.mem), initial.mem.offs,
+                                       initial.mem.size, 0, (void **)&data);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  if(vkr != VK_SUCCESS || data == NULL)
+    return false;
+
+  VkMappedMemoryRange range = {
+      VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, Unwrap(initial.mem.mem), initial.mem.offs,
+      initial.mem.size,
+  };
+
+  vkr = ObjDisp(d)->InvalidateMappedMemoryRanges(Unwrap(d), 1, &range);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  bool ret = IsUniformContents(data, initial.mem.size, value);
+
+  ObjDisp(d)->UnmapMemory(Unwrap(d), Unwrap(initial.mem.mem));
+
+  initial.uniformScanned = true;
+  initial.uniformContents = ret;
+  initial.uniformValue = value;
+
+  return ret;
+}
+
 uint64_t WrappedVulkan::GetSize_InitialState(ResourceId id, const VkInitialContents &initial)
 {
   if(initial.type == eResDescriptorSet)
@@ -563,7 +643,12 @@ uint64_t WrappedVulkan::GetSize_InitialState(ResourceId id, const VkInitialConte
       return GetSize_SparseInitialState(id, initial);
 
     // the size primarily comes from the buffer, the size of which we conveniently have stored.
-    return uint64_t(128 + initial.mem.size + WriteSerialiser::GetChunkAlignment());
+    // Uniform contents only store the fill value.
+    uint32_t fillValue = 0;
+    uint64_t contentsSize = IsUniformInitialState(initial, fillValue) ? 0 : initial.mem.size;
+
+    return uint64_t(128 + GetResourceManager()->GetSerialisedContentsSize(contentsSize) +
+                    WriteSerialiser::GetChunkAlignment());
   }
 
   RDCERR("Unhandled resource type %s", ToStr(initial.type).c_str());
@@ -903,10 +988,26 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id,
     MemoryAllocation uploadMemory;
     VkBuffer uploadBuf = VK_NULL_HANDLE;
 
+    // or the host memory we read into instead, when the contents are uploaded on demand
+    VkHostInitialContents *hostContents = NULL;
+
+    // contents that are a single repeated 32-bit value, such as cleared memory or render targets,
+    // store only that value and are filled on the GPU on replay
+    bool UniformContents = false;
+    uint32_t FillValue = 0;
+
     // during writing, we already have the memory copied off - we just need to map it.
     if(ser.IsWriting())
     {
-      if(initial && initial->mem.mem != VK_NULL_HANDLE)
+      // if the contents were already found to be uniform when sizing the chunk, there's nothing
+      // to read back
+      if(initial && initial->mem.mem != VK_NULL_HANDLE && initial->uniformScanned &&
+         initial->uniformContents)
+      {
+        UniformContents = true;
+        FillValue = initial->uniformValue;
+      }
+      else if(initial && initial->mem.mem != VK_NULL_HANDLE)
       {
         mappedMem = initial->mem;
         vkr = ObjDisp(d)->MapMemory(Unwrap(d), Unwrap(mappedMem.mem), initial->mem.offs,
@@ -924,8 +1025,58 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id,
 
         vkr = ObjDisp(d)->InvalidateMappedMemoryRanges(Unwrap(d), 1, &range);
         RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+        // a previous scan that found them uniform was handled above
+        UniformContents =
+            !initial->uniformScanned && IsUniformContents(Contents, ContentsSize, FillValue);
       }
     }
+
+    if(ser.VersionAtLeast(0x13))
+    {
+      SERIALISE_ELEMENT(UniformContents);
+      SERIALISE_ELEMENT(FillValue);
+    }
+
+    if(IsReplayingAndReading() && UniformContents)
+    {
+      // device memory is filled directly when applied. Images still need a buffer to copy from,
+      // but it's filled on the GPU below instead of uploading the contents
+      if(type == eResImage && !ser.IsErrored())
+      {
+        VkBufferCreateInfo bufInfo = {
+            VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            NULL,
+            0,
+            ContentsSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        };
+
+        vkr = vkCreateBuffer(d, &bufInfo, NULL, &uploadBuf);
+        RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+        uploadMemory = AllocateMemoryForResource(uploadBuf, MemoryScope::InitialContents,
+                                                 MemoryType::GPULocal);
+
+        vkr = vkBindBufferMemory(d, uploadBuf, uploadMemory.mem, uploadMemory.offs);
+        RDCASSERTEQUAL(vkr, VK_SUCCESS);
+      }
+    }
+    else if(IsReplayingAndReading() && !ser.IsErrored() && Vulkan_HostInitialContentsBudgetMB > 0 &&
+            ContentsSize >= uint64_t(Vulkan_HostInitialContentsMinSizeKB) * 1024 &&
+            (type == eResDeviceMemory ||
+             m_CreationInfo.m_Image[GetResourceManager()->GetLiveID(id)].samples ==
+                 VK_SAMPLE_COUNT_1_BIT))
+    {
+      // MSAA images are excluded since they're uploaded via an array image, which needs to stay
+      // on the GPU.
+      hostContents = new VkHostInitialContents;
+      hostContents->size = ContentsSize;
+      hostContents->compressed = false;
+      hostContents->data.resize((size_t)ContentsSize);
+
+      Contents = hostContents->data.data();
+    }
     else if(IsReplayingAndReading() && !ser.IsErrored())
     {
       // create a buffer with memory attached, which we will fill with the initial contents
@@ -952,9 +1103,13 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id,
                             AlignUp(mappedMem.size, nonCoherentAtomSize), 0, (void **)&Contents);
     }
 
+    // uniform contents have no data stored
+    byte *StoredContents = UniformContents ? NULL : Contents;
+    uint64_t StoredSize = UniformContents ? 0 : ContentsSize;
+
     // not using SERIALISE_ELEMENT_ARRAY so we can deliberately avoid allocation - we serialise
     // directly into upload memory
-    ser.Serialise("Contents"_lit, Contents, ContentsSize, SerialiserFlags::NoFlags);
+    ser.Serialise("Contents"_lit, StoredContents, StoredSize, SerialiserFlags::Deduplicate);
 
     // unmap the resource we mapped before - we need to do this on read and on write.
     if(!IsStructuredExporting(m_State) && mappedMem.mem != VK_NULL_HANDLE)
@@ -979,12 +1134,88 @@ bool WrappedVulkan::Serialise_InitialState(SerialiserType &ser, ResourceId id,
 
     SERIALISE_CHECK_READ_ERRORS();
 
+    if(IsReplayingAndReading() && hostContents)
+    {
+      if(Vulkan_HostInitialContentsCompress && ContentsSize <= LZ4_MAX_INPUT_SIZE)
+      {
+        auto compress = [hostContents]() {
+          const int size = (int)hostContents->size;
+
+          bytebuf compressed;
+          compressed.resize(LZ4_compressBound(size));
+
+          int compSize =
+              LZ4_compress_default((const char *)hostContents->data.data(),
+                                   (char *)compressed.data(), size, (int)compressed.size());
+
+          // only keep the compressed data if it actually saved space
+          if(compSize > 0 && compSize < size)
+          {
+            compressed.resize(compSize);
+            hostContents->data.swap(compressed);
+            hostContents->compressed = true;
+          }
+        };
+
+        // compress in the background while loading continues. Anything that needs the contents
+        // waits for just this resource to be ready. If the job is cancelled or dropped at shutdown
+        // the pending work still ends, and the contents are simply left uncompressed
+        if(m_InitialContentsProcessing)
+          m_InitialContentsProcessing->Submit(compress, &hostContents->pending);
+        else
+          compress();
+      }
+
+      VkInitialContents initialContents(type, VkInitialContents::BufferCopy);
+      initialContents.mem.size = ContentsSize;
+      initialContents.host = hostContents;
+
+      GetResourceManager()->SetInitialContents(id, initialContents);
+    }
+    else if(IsReplayingAndReading() && UniformContents && type == eResDeviceMemory)
+    {
+      VkInitialContents initialContents(type, VkInitialContents::FillBuffer);
+      initialContents.mem.size = ContentsSize;
+      initialContents.fillValue = FillValue;
+
+      GetResourceManager()->SetInitialContents(id, initialContents);
+    }
     // if we're handling a device memory object, we're done - we note the memory object to delete at
     // the end of the program, and store the buffer to copy off in Apply
-    if(IsReplayingAndReading() && ContentsSize > 0)
+    else if(IsReplayingAndReading() && ContentsSize > 0)
     {
       ResourceId liveid = GetResourceManager()->GetLiveID(id);
 
+      if(UniformContents)
+      {
+        VkCommandBuffer cmd = GetNextCmd();
+
+        VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, NULL,
+                                              VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+        vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
+        RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+        ObjDisp(cmd)->CmdFillBuffer(Unwrap(cmd), Unwrap(uploadBuf), 0, VK_WHOLE_SIZE, FillValue);
+
+        VkBufferMemoryBarrier fillBarrier = {
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            NULL,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+            VK_QUEUE_FAMILY_IGNORED,
+            VK_QUEUE_FAMILY_IGNORED,
+            Unwrap(uploadBuf),
+            0,
+            VK_WHOLE_SIZE,
+        };
+
+        DoPipelineBarrier(cmd, 1, &fillBarrier);
+
+        vkr = ObjDisp(cmd)->EndCommandBuffer(Unwrap(cmd));
+        RDCASSERTEQUAL(vkr, VK_SUCCESS);
+      }
+
       if(type == eResDeviceMemory)
       {
         VkInitialContents initialContents(type, uploadMemory);
@@ -1530,6 +1761,16 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
 
     VkBuffer buf = initial.buf;
 
+    if(initial.host)
+    {
+      if(SkipHostInitialContents(id))
+        return;
+
+      buf = GetHostInitialContentsBuffer(id, initial);
+      if(buf == VK_NULL_HANDLE)
+        return;
+    }
+
     VkCommandBuffer cmd = GetNextCmd();
 
     vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
@@ -1757,6 +1998,12 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
   }
   else if(type == eResDeviceMemory)
   {
+    // this must be checked before the memory is marked as initialised below
+    if(initial.host && SkipHostInitialContents(id))
+      return;
+
+    const bool fill = (initial.tag == VkInitialContents::FillBuffer);
+
     Intervals<InitReqType> resetReq;
     ResourceId orig = GetResourceManager()->GetOriginalID(id);
     MemRefs *memRefs = GetResourceManager()->FindMemRefs(orig);
@@ -1805,6 +2052,21 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
       return;    // no copy or clear required
     }
 
+    // only upload contents kept on the host if something is going to be copied from them
+    if(initial.host)
+    {
+      for(auto it = resetReq.begin(); it != resetReq.end(); it++)
+      {
+        if(it->value() == eInitReq_Copy && it->start() < initial.mem.size)
+        {
+          srcBuf = GetHostInitialContentsBuffer(id, initial);
+          if(srcBuf == VK_NULL_HANDLE)
+            return;
+          break;
+        }
+      }
+    }
+
     VkCommandBuffer cmd = GetNextCmd();
 
     vkr = ObjDisp(cmd)->BeginCommandBuffer(Unwrap(cmd), &beginInfo);
@@ -1827,7 +2089,20 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
           ObjDisp(cmd)->CmdFillBuffer(Unwrap(cmd), Unwrap(dstBuf), start, size, 0);
           fillCount++;
           break;
-        case eInitReq_Copy: regions.push_back({start, start, size}); break;
+        case eInitReq_Copy:
+          if(fill)
+          {
+            if(finish >= initial.mem.size)
+              size = VK_WHOLE_SIZE;
+            ObjDisp(cmd)->CmdFillBuffer(Unwrap(cmd), Unwrap(dstBuf), start, size,
+                                        initial.fillValue);
+            fillCount++;
+          }
+          else
+          {
+            regions.push_back({start, start, size});
+          }
+          break;
         default: break;
       }
     }
@@ -1849,3 +2124,274 @@ void WrappedVulkan::Apply_InitialState(WrappedVkRes *live, const VkInitialConten
     RDCERR("Unhandled resource type %d", type);
   }
 }
+
+bool WrappedVulkan::SkipHostInitialContents(ResourceId id)
+{
+  HostInitialContentsState &state = m_HostInitialContents;
+
+  if(state.targetEvent == ~0U || state.applyingSkipped || IsLoading(m_State))
+    return false;
+
+  if(state.firstUse.empty())
+  {
+    for(auto it = m_ResourceUses.begin(); it != m_ResourceUses.end(); ++it)
+    {
+      if(it->second.empty())
+        continue;
+
+      uint32_t first = it->second[0].eventId;
+      for(const EventUsage &u : it->second)
+        first = RDCMIN(first, u.eventId);
+
+      // memory is used through the resources bound to it, as well as directly
+      rdcarray<ResourceId> ids = {it->first};
+
+      ResourceId orig = GetResourceManager()->GetOriginalID(it->first);
+      for(ResourceId parent : GetResourceDesc(orig).parentResources)
+        if(GetResourceManager()->HasLiveResource(parent))
+          ids.push_back(GetResourceManager()->GetLiveID(parent));
+
+      for(ResourceId r : ids)
+      {
+        auto use = state.firstUse.find(r);
+        if(use == state.firstUse.end())
+          state.firstUse[r] = first;
+        else
+          use->second = RDCMIN(use->second, first);
+      }
+    }
+  }
+
+  // resources without any recorded use could be accessed in ways we don't track, so they're always
+  // applied
+  auto it = state.firstUse.find(id);
+  if(it == state.firstUse.end() || it->second <= state.targetEvent)
+    return false;
+
+  state.skipped.push_back(GetResourceManager()->GetOriginalID(id));
+  return true;
+}
+
+VkBuffer WrappedVulkan::GetHostInitialContentsBuffer(ResourceId id,
+                                                     const VkInitialContents &initial)
+{
+  HostInitialContentsState &state = m_HostInitialContents;
+
+  auto it = state.resident.find(id);
+  if(it != state.resident.end())
+  {
+    it->second.lastUse = ++state.useCounter;
+    return it->second.buf;
+  }
+
+  const VkHostInitialContents &host = *initial.host;
+
+  // the contents may still be being compressed after loading
+  host.pending.Wait();
+
+  const VkDeviceSize budget = VkDeviceSize(Vulkan_HostInitialContentsBudgetMB) * 1024 * 1024;
+
+  if(!state.resident.empty() && state.residentBytes + host.size > budget)
+  {
+    // copies that were already recorded might read from the buffers we evict, so wait for them
+    SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+    SubmitCmds();
+    FlushQ();
+    SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+
+    while(!state.resident.empty() && state.residentBytes + host.size > budget)
+    {
+      auto lru = state.resident.begin();
+      for(auto r = state.resident.begin(); r != state.resident.end(); ++r)
+        if(r->second.lastUse < lru->second.lastUse)
+          lru = r;
+
+      vkDestroyBuffer(GetDev(), lru->second.buf, NULL);
+      FreeMemoryAllocation(lru->second.mem);
+
+      state.residentBytes -= lru->second.mem.size;
+      state.resident.erase(lru);
+    }
+  }
+
+  VkDevice d = GetDev();
+
+  VkBufferCreateInfo bufInfo = {
+      VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      NULL,
+      0,
+      host.size,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+  };
+
+  HostInitialContentsState::Resident resident;
+
+  VkResult vkr = vkCreateBuffer(d, &bufInfo, NULL, &resident.buf);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  resident.mem =
+      AllocateMemoryForResource(resident.buf, MemoryScope::HostInitialContents, MemoryType::Upload);
+
+  if(resident.mem.mem == VK_NULL_HANDLE)
+  {
+    RDCERR("Couldn't allocate %llu bytes to upload initial contents for %s", host.size,
+           ToStr(id).c_str());
+    vkDestroyBuffer(d, resident.buf, NULL);
+    return VK_NULL_HANDLE;
+  }
+
+  vkr = vkBindBufferMemory(d, resident.buf, resident.mem.mem, resident.mem.offs);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  const VkDeviceSize nonCoherentAtomSize = GetDeviceProps().limits.nonCoherentAtomSize;
+
+  byte *ptr = NULL;
+  vkr = ObjDisp(d)->MapMemory(Unwrap(d), Unwrap(resident.mem.mem), resident.mem.offs,
+                              AlignUp(resident.mem.size, nonCoherentAtomSize), 0, (void **)&ptr);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  if(ptr)
+  {
+    if(host.compressed)
+    {
+      int ret = LZ4_decompress_safe((const char *)host.data.data(), (char *)ptr,
+                                    (int)host.data.size(), (int)host.size);
+
+      if(ret != (int)host.size)
+        RDCERR("Failed to decompress initial contents for %s", ToStr(id).c_str());
+    }
+    else
+    {
+      memcpy(ptr, host.data.data(), (size_t)host.size);
+    }
+
+    VkMappedMemoryRange range = {
+        VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        NULL,
+        Unwrap(resident.mem.mem),
+        resident.mem.offs,
+        AlignUp(resident.mem.size, nonCoherentAtomSize),
+    };
+
+    vkr = ObjDisp(d)->FlushMappedMemoryRanges(Unwrap(d), 1, &range);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+    ObjDisp(d)->UnmapMemory(Unwrap(d), Unwrap(resident.mem.mem));
+  }
+
+  resident.lastUse = ++state.useCounter;
+
+  state.residentBytes += resident.mem.size;
+  state.resident[id] = resident;
+
+  return resident.buf;
+}
+
+void WrappedVulkan::ApplySkippedInitialContents(uint32_t endEventID)
+{
+  HostInitialContentsState &state = m_HostInitialContents;
+
+  if(state.skipped.empty() || endEventID <= state.targetEvent)
+    return;
+
+  // anything first used up to the new target is applied now. Nothing has touched these resources
+  // yet in this replay so it's as if they were applied at the start.
+  state.targetEvent = endEventID;
+
+  rdcarray<ResourceId> skipped;
+  skipped.swap(state.skipped);
+
+  rdcarray<ResourceId> apply;
+
+  for(ResourceId orig : skipped)
+  {
+    if(state.firstUse[GetResourceManager()->GetLiveID(orig)] > endEventID)
+      state.skipped.push_back(orig);
+    else
+      apply.push_back(orig);
+  }
+
+  ApplyHostInitialContents(apply);
+}
+
+void WrappedVulkan::ApplySkippedInitialContents(ResourceId id)
+{
+  HostInitialContentsState &state = m_HostInitialContents;
+
+  if(state.skipped.empty())
+    return;
+
+  // the resource is being read directly, e.g. to display it. It hasn't been used yet in this replay
+  // so its contents are the initial contents. Those live in the image itself, or in the memory
+  // bound to a buffer.
+  ResourceId orig = GetResourceManager()->GetOriginalID(id);
+
+  rdcarray<ResourceId> ids = {orig};
+  ids.append(GetResourceDesc(orig).parentResources);
+
+  rdcarray<ResourceId> apply;
+
+  for(ResourceId r : ids)
+  {
+    int32_t idx = state.skipped.indexOf(r);
+    if(idx >= 0)
+    {
+      state.skipped.erase(idx);
+      apply.push_back(r);
+    }
+  }
+
+  ApplyHostInitialContents(apply);
+}
+
+void WrappedVulkan::ApplyHostInitialContents(const rdcarray<ResourceId> &origIds)
+{
+  HostInitialContentsState &state = m_HostInitialContents;
+
+  if(origIds.empty())
+    return;
+
+  rdcarray<ResourceId> images;
+
+  state.applyingSkipped = true;
+
+  for(ResourceId orig : origIds)
+  {
+    VkInitialContents initial = GetResourceManager()->GetInitialContents(orig);
+
+    Apply_InitialState(GetResourceManager()->GetLiveResource(orig), initial);
+
+    if(initial.type == eResImage)
+      images.push_back(GetResourceManager()->GetLiveID(orig));
+  }
+
+  state.applyingSkipped = false;
+
+  // restore the applied images to their state at the start of the frame, as ApplyInitialContents
+  // does
+  for(ResourceId id : images)
+  {
+    auto it = m_ImageStates.find(id);
+    if(it != m_ImageStates.end())
+      it->second.LockWrite()->ResetToOldState(m_cleanupImageBarriers, GetImageTransitionInfo());
+  }
+
+  SubmitAndFlushImageStateBarriers(m_setupImageBarriers);
+  SubmitCmds();
+  FlushQ();
+  SubmitAndFlushImageStateBarriers(m_cleanupImageBarriers);
+}
+
+void WrappedVulkan::FreeHostInitialContents()
+{
+  HostInitialContentsState &state = m_HostInitialContents;
+
+  for(auto it = state.resident.begin(); it != state.resident.end(); ++it)
+  {
+    vkDestroyBuffer(GetDev(), it->second.buf, NULL);
+    FreeMemoryAllocation(it->second.mem);
+  }
+
+  state.resident.clear();
+  state.residentBytes = 0;
+}
@@ -74,6 +74,19 @@ struct SparseImageInitState
 
 DECLARE_REFLECTION_STRUCT(SparseImageInitState);
 
+// initial contents kept in host memory instead of on the GPU, uploaded on demand when they're
+// applied. See Vulkan_HostInitialContentsBudgetMB.
+struct VkHostInitialContents
+{
+  bytebuf data;
+  // the size of the contents - data is smaller if it's compressed
+  uint64_t size;
+  bool compressed;
+  // set while data is being prepared in the background. Declared last so that it's destroyed
+  // first, waiting for any work before the data goes away.
+  Threading::PendingWork pending;
+};
+
 // this struct is copied around and for that reason we explicitly keep it simple and POD. The
 // lifetime of the memory allocated is controlled by the resource manager - when preparing or
 // serialising, we explicitly set the initial contents, then when the whole system is done with them
@@ -87,6 +100,8 @@ struct VkInitialContents
     ClearDepthStencilImage,
     Sparse,
     DescriptorSet,
+    // device memory filled with a single repeated 32-bit value, with no buffer of contents
+    FillBuffer,
   };
 
   VkInitialContents()
@@ -117,6 +132,7 @@ struct VkInitialContents
     SAFE_DELETE_ARRAY(descriptorSlots);
     SAFE_DELETE_ARRAY(descriptorWrites);
     SAFE_DELETE_ARRAY(descriptorInfo);
+    SAFE_DELETE(host);
 
     rm->ResourceTypeRelease(GetWrapped(buf));
     rm->ResourceTypeRelease(GetWrapped(img));
@@ -156,6 +172,18 @@ struct VkInitialContents
   MemoryAllocation mem;
   Tag tag;
 
+  // for FillBuffer contents, the value to fill with
+  uint32_t fillValue;
+
+  // when capturing, the readback in mem is scanned once for a single repeated 32-bit value and the
+  // result kept here, so that sizing and then serialising the contents don't both scan it
+  mutable bool uniformScanned;
+  mutable bool uniformContents;
+  mutable uint32_t uniformValue;
+
+  // for plain resources with contents kept in host memory, buf and mem are unused
+  VkHostInitialContents *host;
+
   // sparse resources need extra information. Which one is valid, depends on the value of type above
   union
   {
@@ -141,187 +141,347 @@ uint32_t WrappedVulkan::PhysicalDeviceData::GetMemoryIndex(uint32_t resourceComp
   return best;
 }
 
-MemoryAllocation WrappedVulkan::AllocateMemoryForResource(bool buffer, VkMemoryRequirements mrq,
-                                                          MemoryScope scope, MemoryType type)
+VulkanMemoryAllocator::~VulkanMemoryAllocator()
 {
-  const VkDeviceSize nonCoherentAtomSize = GetDeviceProps().limits.nonCoherentAtomSize;
+  // any device memory still allocated is destroyed along with the device, only our tracking needs
+  // to be freed.
+  for(MemoryScope scope : values<MemoryScope>())
+    for(Block *block : m_Blocks[(size_t)scope])
+      delete block;
+}
+
+VkDeviceSize VulkanMemoryAllocator::NextBlockSize(MemoryScope scope, VkDeviceSize size)
+{
+  VkDeviceSize &allocSize = m_BlockSize[(size_t)scope];
+
+  // we start allocating 32M, then increment each time we need a new block.
+  switch(allocSize)
+  {
+    case 0: allocSize = 32; break;
+    case 32: allocSize = 64; break;
+    case 64: allocSize = 128; break;
+    case 128:
+    case 256: allocSize = 256; break;
+    default:
+      RDCDEBUG("Unexpected previous allocation size 0x%llx bytes, allocating 256MB", allocSize);
+      allocSize = 256;
+      break;
+  }
+
+  VkDeviceSize ret = allocSize * 1024 * 1024;
+
+  if(size > ret)
+  {
+    // if we get an over-sized allocation, first try to immediately jump to the largest block
+    // size.
+    allocSize = 256;
+    ret = allocSize * 1024 * 1024;
+
+    // if it's still over-sized, just allocate precisely enough and give it a dedicated allocation
+    if(size > ret)
+    {
+      RDCDEBUG("Over-sized allocation for 0x%llx bytes", size);
+      ret = size;
+    }
+  }
+
+  return ret;
+}
 
+MemoryAllocation VulkanMemoryAllocator::Allocate(MemoryScope scope, MemoryType type, bool buffer,
+                                                 VkDeviceSize size, VkDeviceSize alignment,
+                                                 uint32_t memoryTypeBits, uint32_t memoryTypeIndex)
+{
   MemoryAllocation ret;
   ret.scope = scope;
   ret.type = type;
   ret.buffer = buffer;
-  ret.size = AlignUp(mrq.size, mrq.alignment);
-  // for ease, ensure all allocations are multiples of the non-coherent atom size, so we can
-  // invalidate/flush safely. This is at most 256 bytes which is likely already satisfied.
-  ret.size = AlignUp(ret.size, nonCoherentAtomSize);
+  ret.size = size;
 
-  RDCDEBUG("Allocating 0x%llx (0x%llx requested) with alignment 0x%llx in 0x%x for a %s (%s in %s)",
-           ret.size, mrq.size, mrq.alignment, mrq.memoryTypeBits, buffer ? "buffer" : "image",
-           ToStr(type).c_str(), ToStr(scope).c_str());
+  rdcarray<Block *> &blockList = m_Blocks[(size_t)scope];
 
-  rdcarray<MemoryAllocation> &blockList = m_MemoryBlocks[(size_t)scope];
+  // find the free range that leaves the least space behind, across all compatible blocks
+  Block *best = NULL;
+  VkDeviceSize bestRange = 0, bestOffs = 0, bestWaste = ~0ULL;
 
-  // first try to find a match
-  int i = 0;
-  for(MemoryAllocation &block : blockList)
+  for(Block *block : blockList)
   {
-    RDCDEBUG(
-        "Considering block %d: memory type %u and type %s. Total size 0x%llx, current offset "
-        "0x%llx, last alloc was %s",
-        i, block.memoryTypeIndex, ToStr(block.type).c_str(), block.size, block.offs,
-        block.buffer ? "buffer" : "image");
-    i++;
-
     // skip this block if it's not the memory type we want
-    if(ret.type != block.type || (mrq.memoryTypeBits & (1 << block.memoryTypeIndex)) == 0)
-    {
-      RDCDEBUG("block type %d or memory type %d is incompatible", block.type, block.memoryTypeIndex);
+    if(block->mem.type != type || block->mem.buffer != buffer ||
+       (memoryTypeBits & (1U << block->mem.memoryTypeIndex)) == 0)
       continue;
+
+    for(auto it = block->freeRanges.begin(); it != block->freeRanges.end(); ++it)
+    {
+      VkDeviceSize offs = AlignUp(it->first, alignment);
+      VkDeviceSize end = it->first + it->second;
+
+      if(offs + size > end)
+        continue;
+
+      VkDeviceSize waste = it->second - size;
+      if(waste < bestWaste)
+      {
+        best = block;
+        bestRange = it->first;
+        bestOffs = offs;
+        bestWaste = waste;
+      }
     }
 
-    // offs is where we can put our next sub-allocation
-    VkDeviceSize offs = block.offs;
+    // can't do better than an exact fit
+    if(bestWaste == 0)
+      break;
+  }
+
+  MemoryScopeStatistics &stats = m_Stats[(size_t)scope];
+
+  if(best == NULL)
+  {
+    VkDeviceSize blockSize = NextBlockSize(scope, size);
 
-    // if we are on a buffer/image, account for any alignment we might have to do
-    if(ret.buffer != block.buffer)
-      offs = AlignUp(offs, m_PhysicalDeviceData.props.limits.bufferImageGranularity);
+    RDCDEBUG("No available block found - allocating new block of 0x%llx bytes", blockSize);
 
-    // align as required by the resource
-    offs = AlignUp(offs, mrq.alignment);
+    best = new Block;
+    best->mem.scope = scope;
+    best->mem.type = type;
+    best->mem.buffer = buffer;
+    best->mem.memoryTypeIndex = memoryTypeIndex;
+    best->mem.size = blockSize;
+    best->mem.mem = m_AllocateBlock(memoryTypeIndex, blockSize);
 
-    if(offs > block.size)
+    if(best->mem.mem == VK_NULL_HANDLE)
     {
-      RDCDEBUG("Next offset 0x%llx would be off the end of the memory (size 0x%llx).", offs,
-               block.size);
-      continue;
+      RDCWARN("Failed to allocate 0x%llx bytes of device memory for %s", blockSize,
+              ToStr(scope).c_str());
+      delete best;
+      return MemoryAllocation();
     }
 
-    VkDeviceSize avail = block.size - offs;
+    best->freeRanges[0] = blockSize;
+    blockList.push_back(best);
 
-    RDCDEBUG("At next offset 0x%llx, there's 0x%llx bytes available for 0x%llx bytes requested",
-             offs, avail, ret.size);
+    bestRange = bestOffs = 0;
 
-    // if the allocation will fit, we've found our candidate.
-    if(ret.size <= avail)
-    {
-      // update the block offset and buffer/image bit
-      block.offs = offs + ret.size;
-      block.buffer = ret.buffer;
+    stats.blockCount++;
+    stats.blockBytes += blockSize;
+    stats.peakBlockBytes = RDCMAX(stats.peakBlockBytes, stats.blockBytes);
+  }
+
+  // carve the allocation out of the free range, leaving anything before or after it free
+  VkDeviceSize rangeEnd = bestRange + best->freeRanges[bestRange];
+  best->freeRanges.erase(bestRange);
 
-      // update our return value
-      ret.offs = offs;
-      ret.mem = block.mem;
+  if(bestOffs > bestRange)
+    best->freeRanges[bestRange] = bestOffs - bestRange;
+  if(bestOffs + size < rangeEnd)
+    best->freeRanges[bestOffs + size] = rangeEnd - (bestOffs + size);
 
-      RDCDEBUG("Allocating using this block: 0x%llx -> 0x%llx", ret.offs, block.offs);
+  best->allocations[bestOffs] = size;
 
-      // stop searching
+  ret.mem = best->mem.mem;
+  ret.offs = bestOffs;
+  ret.memoryTypeIndex = best->mem.memoryTypeIndex;
+
+  stats.allocationCount++;
+  stats.usedBytes += size;
+  stats.peakUsedBytes = RDCMAX(stats.peakUsedBytes, stats.usedBytes);
+
+  RDCDEBUG("Allocated 0x%llx bytes at 0x%llx in block of 0x%llx bytes", size, ret.offs,
+           best->mem.size);
+
+  return ret;
+}
+
+void VulkanMemoryAllocator::Free(const MemoryAllocation &alloc)
+{
+  if(alloc.mem == VK_NULL_HANDLE)
+    return;
+
+  rdcarray<Block *> &blockList = m_Blocks[(size_t)alloc.scope];
+
+  size_t idx = 0;
+  for(; idx < blockList.size(); idx++)
+    if(blockList[idx]->mem.mem == alloc.mem)
       break;
-    }
+
+  if(idx == blockList.size())
+  {
+    RDCERR("Freeing allocation not found in memory scope %s", ToStr(alloc.scope).c_str());
+    return;
   }
 
-  if(ret.mem == VK_NULL_HANDLE)
+  Block *block = blockList[idx];
+
+  auto allocIt = block->allocations.find(alloc.offs);
+  if(allocIt == block->allocations.end())
   {
-    RDCDEBUG("No available block found - allocating new block");
+    RDCERR("Freeing unknown allocation at 0x%llx", alloc.offs);
+    return;
+  }
+
+  VkDeviceSize offs = alloc.offs;
+  VkDeviceSize size = allocIt->second;
+  block->allocations.erase(allocIt);
+
+  MemoryScopeStatistics &stats = m_Stats[(size_t)alloc.scope];
+  stats.allocationCount--;
+  stats.usedBytes -= size;
 
-    VkDeviceSize &allocSize = m_MemoryBlockSize[(size_t)scope];
+  // merge with the following free range, if it's adjacent
+  auto next = block->freeRanges.lower_bound(offs);
+  if(next != block->freeRanges.end() && next->first == offs + size)
+  {
+    size += next->second;
+    next = block->freeRanges.erase(next);
+  }
 
-    // we start allocating 32M, then increment each time we need a new block.
-    switch(allocSize)
+  // and with the preceeding free range
+  if(next != block->freeRanges.begin())
+  {
+    auto prev = next;
+    --prev;
+    if(prev->first + prev->second == offs)
+    {
+      prev->second += size;
+      size = 0;
+    }
+  }
+
+  if(size > 0)
+    block->freeRanges[offs] = size;
+
+  if(!block->allocations.empty())
+    return;
+
+  // keep one empty block around so that repeatedly allocating and freeing doesn't go back to the
+  // device every time, but release any others.
+  for(size_t i = 0; i < blockList.size(); i++)
+  {
+    if(i != idx && blockList[i]->allocations.empty())
     {
-      case 0: allocSize = 32; break;
-      case 32: allocSize = 64; break;
-      case 64: allocSize = 128; break;
-      case 128:
-      case 256: allocSize = 256; break;
-      default:
-        RDCDEBUG("Unexpected previous allocation size 0x%llx bytes, allocating 256MB", allocSize);
-        allocSize = 256;
-        break;
+      ReleaseBlock(alloc.scope, idx);
+      return;
     }
+  }
+}
+
+void VulkanMemoryAllocator::ReleaseBlock(MemoryScope scope, size_t idx)
+{
+  Block *block = m_Blocks[(size_t)scope][idx];
+
+  m_FreeBlock(block->mem.mem);
+
+  MemoryScopeStatistics &stats = m_Stats[(size_t)scope];
+  stats.blockCount--;
+  stats.blockBytes -= block->mem.size;
+  for(auto it = block->allocations.begin(); it != block->allocations.end(); ++it)
+  {
+    stats.allocationCount--;
+    stats.usedBytes -= it->second;
+  }
+
+  delete block;
+  m_Blocks[(size_t)scope].erase(idx);
+}
+
+void VulkanMemoryAllocator::FreeAll(MemoryScope scope)
+{
+  while(!m_Blocks[(size_t)scope].empty())
+    ReleaseBlock(scope, m_Blocks[(size_t)scope].size() - 1);
+}
+
+MemoryAllocation WrappedVulkan::AllocateMemoryForResource(bool buffer, VkMemoryRequirements mrq,
+                                                          MemoryScope scope, MemoryType type)
+{
+  const VkDeviceSize nonCoherentAtomSize = GetDeviceProps().limits.nonCoherentAtomSize;
+
+  // for ease, ensure all allocations are multiples of the non-coherent atom size and aligned to
+  // it, so we can invalidate/flush safely. This is at most 256 bytes which is likely already
+  // satisfied.
+  VkDeviceSize alignment = RDCMAX(mrq.alignment, nonCoherentAtomSize);
+  VkDeviceSize size = AlignUp(mrq.size, alignment);
+
+  RDCDEBUG("Allocating 0x%llx (0x%llx requested) with alignment 0x%llx in 0x%x for a %s (%s in %s)",
+           size, mrq.size, mrq.alignment, mrq.memoryTypeBits, buffer ? "buffer" : "image",
+           ToStr(type).c_str(), ToStr(scope).c_str());
 
-    uint32_t memoryTypeIndex = 0;
+  // any existing block with a compatible memory type can be used
+  uint32_t compatibleTypeBits = mrq.memoryTypeBits;
 
-    // Upload heaps are sometimes limited in size. To prevent OOM issues, deselect any memory types
-    // corresponding to a small heap (<= 512MB) if there are other memory types available.
-    for(uint32_t m = 0; m < 32; m++)
+  // Upload heaps are sometimes limited in size. To prevent OOM issues, deselect any memory types
+  // corresponding to a small heap (<= 512MB) if there are other memory types available.
+  for(uint32_t m = 0; m < 32; m++)
+  {
+    if(mrq.memoryTypeBits & (1U << m))
     {
-      if(mrq.memoryTypeBits & (1U << m))
+      uint32_t heap = m_PhysicalDeviceData.memProps.memoryTypes[m].heapIndex;
+      if(m_PhysicalDeviceData.memProps.memoryHeaps[heap].size <= 512 * 1024 * 1024)
       {
-        uint32_t heap = m_PhysicalDeviceData.memProps.memoryTypes[m].heapIndex;
-        if(m_PhysicalDeviceData.memProps.memoryHeaps[heap].size <= 512 * 1024 * 1024)
+        if(mrq.memoryTypeBits > (1U << m))
         {
-          if(mrq.memoryTypeBits > (1U << m))
-          {
-            RDCDEBUG("Avoiding memory type %u due to small heap size (%llu)", i,
-                     m_PhysicalDeviceData.memProps.memoryHeaps[heap].size);
-            mrq.memoryTypeBits &= ~(1U << m);
-          }
+          RDCDEBUG("Avoiding memory type %u due to small heap size (%llu)", m,
+                   m_PhysicalDeviceData.memProps.memoryHeaps[heap].size);
+          mrq.memoryTypeBits &= ~(1U << m);
         }
       }
     }
+  }
 
-    switch(ret.type)
-    {
-      case MemoryType::Upload: memoryTypeIndex = GetUploadMemoryIndex(mrq.memoryTypeBits); break;
-      case MemoryType::GPULocal:
-        memoryTypeIndex = GetGPULocalMemoryIndex(mrq.memoryTypeBits);
-        break;
-      case MemoryType::Readback:
-        memoryTypeIndex = GetReadbackMemoryIndex(mrq.memoryTypeBits);
-        break;
-    }
+  uint32_t memoryTypeIndex = 0;
 
-    VkMemoryAllocateInfo info = {
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, allocSize * 1024 * 1024, memoryTypeIndex,
-    };
+  switch(type)
+  {
+    case MemoryType::Upload: memoryTypeIndex = GetUploadMemoryIndex(mrq.memoryTypeBits); break;
+    case MemoryType::GPULocal:
+      memoryTypeIndex = GetGPULocalMemoryIndex(mrq.memoryTypeBits);
+      break;
+    case MemoryType::Readback:
+      memoryTypeIndex = GetReadbackMemoryIndex(mrq.memoryTypeBits);
+      break;
+  }
 
-    if(ret.size > info.allocationSize)
-    {
-      // if we get an over-sized allocation, first try to immediately jump to the largest block
-      // size.
-      allocSize = 256;
-      info.allocationSize = allocSize * 1024 * 1024;
+  MemoryAllocation ret = m_MemoryAllocator.Allocate(scope, type, buffer, size, alignment,
+                                                    compatibleTypeBits, memoryTypeIndex);
 
-      // if it's still over-sized, just allocate precisely enough and give it a dedicated allocation
-      if(ret.size > info.allocationSize)
-      {
-        RDCDEBUG("Over-sized allocation for 0x%llx bytes", ret.size);
-        info.allocationSize = ret.size;
-      }
-    }
+  // ensure the returned size is accurate to what was requested, not what we padded
+  if(ret.mem != VK_NULL_HANDLE)
+    ret.size = mrq.size;
+
+  return ret;
+}
+
+VkDeviceMemory WrappedVulkan::AllocateMemoryBlock(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+  VkMemoryAllocateInfo info = {
+      VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, size, memoryTypeIndex,
+  };
 
-    RDCDEBUG("Creating new allocation of 0x%llx bytes", info.allocationSize);
+  RDCDEBUG("Creating new allocation of 0x%llx bytes", info.allocationSize);
 
-    MemoryAllocation chunk;
-    chunk.buffer = ret.buffer;
-    chunk.memoryTypeIndex = memoryTypeIndex;
-    chunk.scope = scope;
-    chunk.type = type;
-    chunk.size = info.allocationSize;
+  VkDevice d = GetDev();
 
-    // the offset starts immediately after this allocation
-    chunk.offs = ret.size;
+  VkDeviceMemory mem = VK_NULL_HANDLE;
 
-    VkDevice d = GetDev();
+  // do the actual allocation
+  VkResult vkr = ObjDisp(d)->AllocateMemory(Unwrap(d), &info, NULL, &mem);
 
-    // do the actual allocation
-    VkResult vkr = ObjDisp(d)->AllocateMemory(Unwrap(d), &info, NULL, &chunk.mem);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+  if(vkr == VK_ERROR_OUT_OF_DEVICE_MEMORY || vkr == VK_ERROR_OUT_OF_HOST_MEMORY)
+    return VK_NULL_HANDLE;
 
-    GetResourceManager()->WrapResource(Unwrap(d), chunk.mem);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    // push the new chunk
-    blockList.push_back(chunk);
+  GetResourceManager()->WrapResource(Unwrap(d), mem);
 
-    // return the first bytes in the new chunk
-    ret.offs = 0;
-    ret.mem = chunk.mem;
-  }
+  return mem;
+}
 
-  // ensure the returned size is accurate to what was requested, not what we padded
-  ret.size = mrq.size;
+void WrappedVulkan::FreeMemoryBlock(VkDeviceMemory mem)
+{
+  VkDevice d = GetDev();
 
-  return ret;
+  ObjDisp(d)->FreeMemory(Unwrap(d), Unwrap(mem), NULL);
+  GetResourceManager()->ReleaseWrappedResource(mem);
 }
 
 MemoryAllocation WrappedVulkan::AllocateMemoryForResource(VkImage im, MemoryScope scope,
@@ -348,23 +508,251 @@ MemoryAllocation WrappedVulkan::AllocateMemoryForResource(VkBuffer buf, MemorySc
 
 void WrappedVulkan::FreeAllMemory(MemoryScope scope)
 {
-  rdcarray<MemoryAllocation> &allocList = m_MemoryBlocks[(size_t)scope];
-
-  if(allocList.empty())
-    return;
+  m_MemoryAllocator.FreeAll(scope);
+}
 
-  VkDevice d = GetDev();
+void WrappedVulkan::FreeMemoryAllocation(MemoryAllocation alloc)
+{
+  m_MemoryAllocator.Free(alloc);
+}
 
-  for(MemoryAllocation alloc : allocList)
+void WrappedVulkan::LogMemoryStatistics()
+{
+  for(MemoryScope scope : values<MemoryScope>())
   {
-    ObjDisp(d)->FreeMemory(Unwrap(d), Unwrap(alloc.mem), NULL);
-    GetResourceManager()->ReleaseWrappedResource(alloc.mem);
-  }
+    const MemoryScopeStatistics &stats = m_MemoryAllocator.GetStatistics(scope);
+
+    if(stats.peakBlockBytes == 0)
+      continue;
 
-  allocList.clear();
+    RDCLOG("Internal %s memory peaked at %llu KB used out of %llu KB allocated",
+           ToStr(scope).c_str(), stats.peakUsedBytes / 1024, stats.peakBlockBytes / 1024);
+  }
 }
 
-void WrappedVulkan::FreeMemoryAllocation(MemoryAllocation alloc)
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#undef None
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Test memory sub-allocation", "[vulkan]")
 {
-  // don't do anything at the moment, we only support freeing the whole scope at once.
-}
+  // a mock device, handing out unique memory handles and tracking which blocks are live
+  std::map<uint64_t, rdcpair<uint32_t, VkDeviceSize>> blocks;
+  uint64_t nextHandle = 1;
+  bool failAllocations = false;
+
+  auto handle = [](VkDeviceMemory mem) {
+    uint64_t ret = 0;
+    memcpy(&ret, &mem, sizeof(mem));
+    return ret;
+  };
+
+  VulkanMemoryAllocator allocator;
+  allocator.SetCallbacks(
+      [&](uint32_t memoryTypeIndex, VkDeviceSize size) {
+        VkDeviceMemory mem = VK_NULL_HANDLE;
+        if(failAllocations)
+          return mem;
+        uint64_t h = nextHandle++;
+        memcpy(&mem, &h, sizeof(mem));
+        blocks[h] = {memoryTypeIndex, size};
+        return mem;
+      },
+      [&](VkDeviceMemory mem) {
+        CHECK(blocks.count(handle(mem)) == 1);
+        blocks.erase(handle(mem));
+      });
+
+  const MemoryScope scope = MemoryScope::PostVS;
+  const MemoryScopeStatistics &stats = allocator.GetStatistics(scope);
+  const VkDeviceSize MB = 1024 * 1024;
+
+  auto alloc = [&](VkDeviceSize size, VkDeviceSize alignment) {
+    return allocator.Allocate(scope, MemoryType::GPULocal, true, size, alignment, 0x3, 1);
+  };
+
+  SECTION("Small allocations share a block")
+  {
+    MemoryAllocation a = alloc(1024, 256);
+    MemoryAllocation b = alloc(1024, 256);
+    MemoryAllocation c = alloc(1024, 256);
+
+    CHECK(a.mem == b.mem);
+    CHECK(b.mem == c.mem);
+    CHECK(a.offs == 0);
+    CHECK(b.offs == 1024);
+    CHECK(c.offs == 2048);
+    CHECK(a.memoryTypeIndex == 1);
+    CHECK(a.scope == scope);
+
+    CHECK(blocks.size() == 1);
+    CHECK(blocks.begin()->second.first == 1);
+    CHECK(blocks.begin()->second.second == 32 * MB);
+
+    CHECK(stats.blockCount == 1);
+    CHECK(stats.blockBytes == 32 * MB);
+    CHECK(stats.allocationCount == 3);
+    CHECK(stats.usedBytes == 3072);
+
+    allocator.FreeAll(scope);
+  };
+
+  SECTION("Alignment padding is reused")
+  {
+    MemoryAllocation a = alloc(256, 256);
+    MemoryAllocation b = alloc(256, 4096);
+    MemoryAllocation c = alloc(512, 256);
+
+    CHECK(a.offs == 0);
+    CHECK(b.offs == 4096);
+    // the best fit is in the gap left by aligning b
+    CHECK(c.offs == 256);
+    CHECK(c.mem == a.mem);
+
+    allocator.FreeAll(scope);
+  };
+
+  SECTION("Freed space is coalesced and reused")
+  {
+    MemoryAllocation a = alloc(MB, 256);
+    MemoryAllocation b = alloc(MB, 256);
+    MemoryAllocation c = alloc(MB, 256);
+    MemoryAllocation d = alloc(MB, 256);
+
+    allocator.Free(b);
+    CHECK(stats.allocationCount == 3);
+    CHECK(stats.usedBytes == 3 * MB);
+
+    // an allocation that fits exactly goes into the hole
+    b = alloc(MB, 256);
+    CHECK(b.offs == MB);
+
+    allocator.Free(a);
+    allocator.Free(c);
+
+    // a and c aren't adjacent, so a 2MB allocation can't use them
+    MemoryAllocation e = alloc(2 * MB, 256);
+    CHECK(e.offs == 4 * MB);
+
+    // once b is freed, a b and c coalesce into one range
+    allocator.Free(b);
+    MemoryAllocation f = alloc(3 * MB, 256);
+    CHECK(f.offs == 0);
+    CHECK(f.mem == d.mem);
+
+    CHECK(blocks.size() == 1);
+    CHECK(stats.allocationCount == 3);
+    CHECK(stats.usedBytes == 6 * MB);
+    CHECK(stats.peakUsedBytes == 6 * MB);
+
+    allocator.FreeAll(scope);
+  };
+
+  SECTION("Incompatible allocations use separate blocks")
+  {
+    MemoryAllocation a = alloc(1024, 256);
+
+    // an image never shares a block with buffers
+    MemoryAllocation b = allocator.Allocate(scope, MemoryType::GPULocal, false, 1024, 256, 0x3, 1);
+    CHECK(b.mem != a.mem);
+    CHECK(b.offs == 0);
+
+    // nor do allocations of a different type
+    MemoryAllocation c = allocator.Allocate(scope, MemoryType::Readback, true, 1024, 256, 0x3, 1);
+    CHECK(c.mem != a.mem);
+    CHECK(c.mem != b.mem);
+
+    // or which can't use the block's memory type
+    MemoryAllocation d = allocator.Allocate(scope, MemoryType::GPULocal, true, 1024, 256, 0x4, 2);
+    CHECK(d.mem != a.mem);
+    CHECK(d.memoryTypeIndex == 2);
+    CHECK(blocks[handle(d.mem)].first == 2);
+
+    // but a compatible buffer goes back into the first block
+    MemoryAllocation e = allocator.Allocate(scope, MemoryType::GPULocal, true, 1024, 256, 0x6, 2);
+    CHECK(e.mem == a.mem);
+    CHECK(e.memoryTypeIndex == 1);
+
+    // other scopes have their own blocks
+    MemoryAllocation f = allocator.Allocate(MemoryScope::InitialContents, MemoryType::GPULocal,
+                                            true, 1024, 256, 0x3, 1);
+    CHECK(f.mem != a.mem);
+    CHECK(allocator.GetStatistics(MemoryScope::InitialContents).blockCount == 1);
+
+    CHECK(blocks.size() == 5);
+    CHECK(stats.blockCount == 4);
+
+    allocator.FreeAll(scope);
+    allocator.FreeAll(MemoryScope::InitialContents);
+  };
+
+  SECTION("Block sizes grow")
+  {
+    MemoryAllocation a = alloc(32 * MB, 256);
+    MemoryAllocation b = alloc(1024, 256);
+    CHECK(b.mem != a.mem);
+    CHECK(blocks[handle(b.mem)].second == 64 * MB);
+
+    // over-sized allocations get a dedicated block
+    MemoryAllocation c = alloc(300 * MB, 256);
+    CHECK(blocks[handle(c.mem)].second == 300 * MB);
+
+    CHECK(stats.blockBytes == (32 + 64 + 300) * MB);
+    CHECK(stats.peakBlockBytes == (32 + 64 + 300) * MB);
+
+    allocator.FreeAll(scope);
+  };
+
+  SECTION("Empty blocks are released")
+  {
+    MemoryAllocation a = alloc(32 * MB, 256);
+    MemoryAllocation b = alloc(64 * MB, 256);
+    MemoryAllocation c = alloc(1024, 256);
+    CHECK(blocks.size() == 3);
+
+    // the first block to become empty is kept for reuse
+    allocator.Free(a);
+    CHECK(blocks.size() == 3);
+
+    // any others are released
+    allocator.Free(b);
+    CHECK(blocks.size() == 2);
+    CHECK(stats.blockCount == 2);
+    CHECK(stats.blockBytes == (32 + 128) * MB);
+
+    a = alloc(MB, 256);
+    CHECK(a.offs == 0);
+    CHECK(blocks[handle(a.mem)].second == 32 * MB);
+    CHECK(blocks.size() == 2);
+
+    allocator.Free(a);
+    allocator.Free(c);
+    CHECK(blocks.size() == 1);
+    CHECK(stats.allocationCount == 0);
+    CHECK(stats.usedBytes == 0);
+
+    allocator.FreeAll(scope);
+  };
+
+  SECTION("Failed device allocations")
+  {
+    failAllocations = true;
+
+    MemoryAllocation a = alloc(1024, 256);
+    CHECK(a.mem == VK_NULL_HANDLE);
+    CHECK(stats.blockCount == 0);
+    CHECK(stats.allocationCount == 0);
+
+    failAllocations = false;
+  };
+
+  CHECK(blocks.empty());
+  CHECK(stats.blockCount == 0);
+  CHECK(stats.blockBytes == 0);
+  CHECK(stats.allocationCount == 0);
+  CHECK(stats.usedBytes == 0);
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
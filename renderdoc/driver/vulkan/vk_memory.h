@@ -0,0 +1,108 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include "vk_common.h"
+
+struct MemoryScopeStatistics
+{
+  // the number of device memory blocks allocated, and their total size
+  uint32_t blockCount = 0;
+  VkDeviceSize blockBytes = 0;
+
+  // the number of live sub-allocations, and the bytes they occupy including any padding
+  uint32_t allocationCount = 0;
+  VkDeviceSize usedBytes = 0;
+
+  // the highest values blockBytes and usedBytes have reached
+  VkDeviceSize peakBlockBytes = 0;
+  VkDeviceSize peakUsedBytes = 0;
+};
+
+// Sub-allocates memory for internal resources out of larger device memory blocks, with a separate
+// set of blocks for each memory scope. Each block keeps a list of its free ranges so allocations
+// can be freed individually and their space reused, with neighbouring free ranges coalesced.
+// Blocks only ever contain buffers or only images, so bufferImageGranularity never needs to be
+// considered.
+//
+// The device memory itself is allocated and freed through callbacks, which lets the allocation
+// logic be tested without a device.
+class VulkanMemoryAllocator
+{
+public:
+  typedef std::function<VkDeviceMemory(uint32_t memoryTypeIndex, VkDeviceSize size)>
+      AllocateBlockCallback;
+  typedef std::function<void(VkDeviceMemory mem)> FreeBlockCallback;
+
+  ~VulkanMemoryAllocator();
+
+  void SetCallbacks(AllocateBlockCallback allocateBlock, FreeBlockCallback freeBlock)
+  {
+    m_AllocateBlock = allocateBlock;
+    m_FreeBlock = freeBlock;
+  }
+
+  // size must already be padded as needed, and alignment must be a power of two. Existing blocks
+  // are reused if they have a memory type in memoryTypeBits, otherwise a new block is allocated
+  // with memoryTypeIndex. If the device memory can't be allocated, the returned allocation has no
+  // memory.
+  MemoryAllocation Allocate(MemoryScope scope, MemoryType type, bool buffer, VkDeviceSize size,
+                            VkDeviceSize alignment, uint32_t memoryTypeBits,
+                            uint32_t memoryTypeIndex);
+  void Free(const MemoryAllocation &alloc);
+  void FreeAll(MemoryScope scope);
+
+  const MemoryScopeStatistics &GetStatistics(MemoryScope scope) const
+  {
+    return m_Stats[(size_t)scope];
+  }
+
+private:
+  struct Block
+  {
+    // the whole device memory allocation
+    MemoryAllocation mem;
+    // offset -> size of each free range
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+    // offset -> padded size of each live sub-allocation
+    std::map<VkDeviceSize, VkDeviceSize> allocations;
+  };
+
+  VkDeviceSize NextBlockSize(MemoryScope scope, VkDeviceSize size);
+  void ReleaseBlock(MemoryScope scope, size_t idx);
+
+  AllocateBlockCallback m_AllocateBlock;
+  FreeBlockCallback m_FreeBlock;
+
+  rdcarray<Block *> m_Blocks[arraydim<MemoryScope>()];
+
+  // Per memory scope, the size in MB of the next block. This allows us to balance number of memory
+  // allocation objects with size by incrementally allocating larger blocks.
+  VkDeviceSize m_BlockSize[arraydim<MemoryScope>()] = {};
+
+  MemoryScopeStatistics m_Stats[arraydim<MemoryScope>()];
+};
@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include <float.h>
+#include <math.h>
 #include "driver/shaders/spirv/spirv_editor.h"
 #include "driver/shaders/spirv/spirv_op_helpers.h"
 #include "maths/formatpacking.h"
@@ -70,6 +71,7 @@ struct CopyPixelParams
   VkFormat srcImageFormat;
   VkImageLayout srcImageLayout;
   VkOffset3D imageOffset;
+  VkExtent2D imageExtent;
 
   VkBuffer dstBuffer;
 };
@@ -87,26 +89,66 @@ struct PixelHistoryResources
   VkDeviceMemory gpuMem;
 };
 
-struct PixelHistoryValue
-{
-  // Max size is 4 component with 8 byte component width
-  uint8_t color[32];
-  union
-  {
-    uint32_t udepth;
-    float fdepth;
-  } depth;
-  int8_t stencil;
-  uint8_t padding[3];
-};
+// The largest region processed in one batch. Larger regions are split into tiles of this size.
+static const uint32_t MaxPixelHistoryRegion = 64;
 
-struct EventInfo
+// The readback buffer holds a block of data for each event. Within a block each value that's read
+// back is stored as a plane covering every pixel in the region, tightly packed in the same way a
+// buffer-image copy of the region writes it, so a whole region is read back with the same number
+// of copies as a single pixel.
+struct PixelHistoryLayout
 {
-  PixelHistoryValue premod;
-  PixelHistoryValue postmod;
-  PixelHistoryValue shadout;
-  uint8_t dsWithoutShaderDiscard[8];
-  uint8_t dsWithShaderDiscard[8];
+  enum Plane
+  {
+    PreModColour,
+    PreModDepth,
+    PreModStencil,
+    PostModColour,
+    PostModDepth,
+    PostModStencil,
+    // number of fragments counted in the stencil buffer using a fixed colour shader that never
+    // discards
+    FragsWithoutDiscard,
+    // number of fragments counted using the original fragment shader, which might discard
+    FragsWithDiscard,
+    PlaneCount,
+  };
+
+  PixelHistoryLayout() = default;
+  PixelHistoryLayout(VkExtent2D extent, uint32_t texelSize) : colourTexelSize(texelSize)
+  {
+    numPixels = extent.width * extent.height;
+
+    // depth and stencil copies must be 4-byte aligned, colour copies aligned to the texel size
+    size_t align = RDCMAX(1U, colourTexelSize) * 4;
+
+    // depth is copied as at most 4 bytes per texel, stencil as 1 byte per texel
+    size_t colourSize = numPixels * colourTexelSize;
+    size_t depthSize = numPixels * sizeof(uint32_t);
+    size_t stencilSize = numPixels * sizeof(uint8_t);
+
+    const size_t planeSizes[PlaneCount] = {
+        colourSize, depthSize,   stencilSize, colourSize,
+        depthSize,  stencilSize, stencilSize, stencilSize,
+    };
+
+    eventSize = 0;
+    for(size_t i = 0; i < PlaneCount; i++)
+    {
+      planeOffsets[i] = eventSize;
+      eventSize += AlignUp(planeSizes[i], align);
+    }
+  }
+
+  size_t GetOffset(size_t eventIndex, Plane plane) const
+  {
+    return eventIndex * eventSize + planeOffsets[plane];
+  }
+
+  uint32_t colourTexelSize = 0;
+  uint32_t numPixels = 0;
+  size_t eventSize = 0;
+  size_t planeOffsets[PlaneCount] = {};
 };
 
 struct PipelineReplacements
@@ -308,24 +350,22 @@ private:
 // pixel history replays.
 struct VulkanPixelHistoryCallback : public VulkanDrawcallCallback
 {
-  VulkanPixelHistoryCallback(WrappedVulkan *vk, PixelHistoryShaderCache *shaderCache, uint32_t x,
-                             uint32_t y, uint32_t sampleMask, VkQueryPool occlusionPool)
+  VulkanPixelHistoryCallback(WrappedVulkan *vk, PixelHistoryShaderCache *shaderCache,
+                             const VkRect2D &region, uint32_t sampleMask, VkQueryPool occlusionPool)
       : m_pDriver(vk),
         m_ShaderCache(shaderCache),
-        m_X(x),
-        m_Y(y),
+        m_Region(region),
         m_SampleMask(sampleMask),
         m_OcclusionPool(occlusionPool)
   {
     m_pDriver->SetDrawcallCB(this);
   }
 
-  ~VulkanPixelHistoryCallback() { m_pDriver->SetDrawcallCB(NULL); }
-  // Update the given scissor to just the pixel for which pixel history was requested.
-  void ScissorToPixel(const VkViewport &view, VkRect2D &scissor)
+  virtual ~VulkanPixelHistoryCallback() { m_pDriver->SetDrawcallCB(NULL); }
+  // Update the given scissor to just the region for which pixel history was requested, limited to
+  // the pixels covered by the viewport.
+  void ScissorToRegion(const VkViewport &view, VkRect2D &scissor)
   {
-    float fx = (float)m_X;
-    float fy = (float)m_Y;
     float y_start = view.y;
     float y_end = view.y + view.height;
     if(view.height < 0)
@@ -334,43 +374,59 @@ struct VulkanPixelHistoryCallback : public VulkanDrawcallCallback
       y_end = view.y;
     }
 
-    if(fx < view.x || fy < y_start || fx >= view.x + view.width || fy >= y_end)
+    // a pixel at integer co-ordinate p is inside the viewport if start <= p < end, which is the
+    // same as ceil(start) <= p < ceil(end)
+    int32_t regionRight = m_Region.offset.x + (int32_t)m_Region.extent.width;
+    int32_t regionBottom = m_Region.offset.y + (int32_t)m_Region.extent.height;
+
+    int32_t x0 = RDCMAX(m_Region.offset.x, (int32_t)ceilf(view.x));
+    int32_t y0 = RDCMAX(m_Region.offset.y, (int32_t)ceilf(y_start));
+    int32_t x1 = RDCMIN(regionRight, (int32_t)ceilf(view.x + view.width));
+    int32_t y1 = RDCMIN(regionBottom, (int32_t)ceilf(y_end));
+
+    if(x1 <= x0 || y1 <= y0)
     {
       scissor.offset.x = scissor.offset.y = scissor.extent.width = scissor.extent.height = 0;
     }
     else
     {
-      scissor.offset.x = m_X;
-      scissor.offset.y = m_Y;
-      scissor.extent.width = scissor.extent.height = 1;
+      scissor.offset.x = x0;
+      scissor.offset.y = y0;
+      scissor.extent.width = uint32_t(x1 - x0);
+      scissor.extent.height = uint32_t(y1 - y0);
     }
   }
 
-  // Intersects the originalScissor and newScissor and writes intersection to the newScissor.
-  // newScissor always covers a single pixel, so if originalScissor does not touch that pixel
-  // returns an empty scissor.
+  // Intersects the originalScissor and newScissor and writes intersection to the newScissor. If
+  // they don't overlap, newScissor becomes empty.
   void IntersectScissors(const VkRect2D &originalScissor, VkRect2D &newScissor)
   {
-    RDCASSERT(newScissor.extent.height == 1);
-    RDCASSERT(newScissor.extent.width == 1);
-    if(originalScissor.offset.x > newScissor.offset.x ||
-       originalScissor.offset.x + originalScissor.extent.width <
-           newScissor.offset.x + newScissor.extent.width ||
-       originalScissor.offset.y > newScissor.offset.y ||
-       originalScissor.offset.y + originalScissor.extent.height <
-           newScissor.offset.y + newScissor.extent.height)
+    int64_t x0 = RDCMAX(originalScissor.offset.x, newScissor.offset.x);
+    int64_t y0 = RDCMAX(originalScissor.offset.y, newScissor.offset.y);
+    int64_t x1 = RDCMIN(int64_t(originalScissor.offset.x) + int64_t(originalScissor.extent.width),
+                        int64_t(newScissor.offset.x) + int64_t(newScissor.extent.width));
+    int64_t y1 = RDCMIN(int64_t(originalScissor.offset.y) + int64_t(originalScissor.extent.height),
+                        int64_t(newScissor.offset.y) + int64_t(newScissor.extent.height));
+
+    if(x1 <= x0 || y1 <= y0)
     {
-      // scissor does not touch our target pixel, make it empty
+      // scissor does not touch our target region, make it empty
       newScissor.offset.x = newScissor.offset.y = newScissor.extent.width =
           newScissor.extent.height = 0;
     }
+    else
+    {
+      newScissor.offset.x = int32_t(x0);
+      newScissor.offset.y = int32_t(y0);
+      newScissor.extent.width = uint32_t(x1 - x0);
+      newScissor.extent.height = uint32_t(y1 - y0);
+    }
   }
 
 protected:
   WrappedVulkan *m_pDriver;
   PixelHistoryShaderCache *m_ShaderCache;
-  uint32_t m_X;
-  uint32_t m_Y;
+  VkRect2D m_Region;
   uint32_t m_SampleMask;
   VkQueryPool m_OcclusionPool;
 };
@@ -378,13 +434,15 @@ protected:
 struct VulkanOcclusionAndStencilCallback : public VulkanPixelHistoryCallback
 {
   VulkanOcclusionAndStencilCallback(WrappedVulkan *vk, PixelHistoryShaderCache *shaderCache,
-                                    uint32_t x, uint32_t y, VkImage image, VkFormat format,
-                                    uint32_t sampleMask, VkQueryPool occlusionPool,
-                                    VkImageView stencilImageView, VkImage stencilImage,
-                                    VkBuffer dstBuffer, const rdcarray<EventUsage> &events)
-      : VulkanPixelHistoryCallback(vk, shaderCache, x, y, sampleMask, occlusionPool),
+                                    const VkRect2D &region, VkImage image, VkFormat format,
+                                    const PixelHistoryLayout &layout, uint32_t sampleMask,
+                                    VkQueryPool occlusionPool, VkImageView stencilImageView,
+                                    VkImage stencilImage, VkBuffer dstBuffer,
+                                    const rdcarray<EventUsage> &events)
+      : VulkanPixelHistoryCallback(vk, shaderCache, region, sampleMask, occlusionPool),
         m_Image(image),
         m_Format(format),
+        m_Layout(layout),
         m_DstBuffer(dstBuffer),
         m_StencilImageView(stencilImageView),
         m_StencilImage(stencilImage)
@@ -558,19 +616,13 @@ struct VulkanOcclusionAndStencilCallback : public VulkanPixelHistoryCallback
     m_pDriver->GetCmdRenderState().EndRenderPass(cmd);
 
     // Get pre-modification values
-    size_t storeOffset = m_EventIndices.size() * sizeof(EventInfo);
+    size_t eventIndex = m_EventIndices.size();
     VkImage depthImage = VK_NULL_HANDLE;
     VkFormat depthFormat = VK_FORMAT_UNDEFINED;
-    const DrawcallDescription *draw = m_pDriver->GetDrawcall(eid);
-    if(draw && draw->depthOut != ResourceId())
-    {
-      ResourceId resId = m_pDriver->GetResourceManager()->GetLiveID(draw->depthOut);
-      depthImage = m_pDriver->GetResourceManager()->GetCurrentHandle<VkImage>(resId);
-      const VulkanCreationInfo::Image &imginfo = m_pDriver->GetDebugManager()->GetImageInfo(resId);
-      depthFormat = imginfo.format;
-    }
+    GetDepthTarget(eid, depthImage, depthFormat);
+    m_DepthFormats[eid] = depthFormat;
 
-    CopyPixel(m_Image, m_Format, depthImage, depthFormat, cmd, storeOffset);
+    CopyRegion(m_Image, m_Format, depthImage, depthFormat, cmd, eventIndex, false);
 
     VulkanRenderState &pipestate = m_pDriver->GetCmdRenderState();
     ResourceId prevRenderpass = pipestate.renderPass;
@@ -589,13 +641,13 @@ struct VulkanOcclusionAndStencilCallback : public VulkanPixelHistoryCallback
 
       if(p.dynamicStates[VkDynamicViewport])
         for(uint32_t i = 0; i < pipestate.views.size(); i++)
-          ScissorToPixel(pipestate.views[i], pipestate.scissors[i]);
+          ScissorToRegion(pipestate.views[i], pipestate.scissors[i]);
 
       // Replay the draw with a fixed color shader that never discards, stencil
       // increment to count number of fragments, and an occlusion query around
       // the draw. We will get occlusion data to figure out if anything wrote to
-      // the pixel, as well as number of fragments not accounting for potential
-      // shader discard.
+      // the region, as well as the number of fragments at each pixel not
+      // accounting for potential shader discard.
       pipestate.SetFramebuffer(m_pDriver, GetResID(newFb));
       pipestate.renderPass = GetResID(newRp);
       pipestate.subpass = 0;
@@ -610,24 +662,25 @@ struct VulkanOcclusionAndStencilCallback : public VulkanPixelHistoryCallback
       params.srcImage = m_StencilImage;
       params.srcImageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
       params.srcImageFormat = VK_FORMAT_D32_SFLOAT_S8_UINT;
-      params.imageOffset.x = int32_t(m_X);
-      params.imageOffset.y = int32_t(m_Y);
+      params.imageOffset.x = m_Region.offset.x;
+      params.imageOffset.y = m_Region.offset.y;
       params.imageOffset.z = 0;
+      params.imageExtent = m_Region.extent;
       params.dstBuffer = m_DstBuffer;
       params.depthCopy = true;
       params.stencilOnly = true;
-      // Copy stencil value that indicates the number of fragments ignoring
+      // Copy stencil values that indicate the number of fragments ignoring
       // shader discard.
-      m_pDriver->GetDebugManager()->PixelHistoryCopyPixel(
-          cmd, params, storeOffset + offsetof(struct EventInfo, dsWithoutShaderDiscard));
+      m_pDriver->GetDebugManager()->PixelHistoryCopyRegion(
+          cmd, params, m_Layout.GetOffset(eventIndex, PixelHistoryLayout::FragsWithoutDiscard), 0);
 
       // Replay the draw with the original fragment shader to get the actual number
       // of fragments, accounting for potential shader discard.
       pipestate.graphics.pipeline = GetResID(replacements.originalShaderStencil);
       ReplayDraw(cmd, 0, eid, false, true);
 
-      m_pDriver->GetDebugManager()->PixelHistoryCopyPixel(
-          cmd, params, storeOffset + offsetof(struct EventInfo, dsWithShaderDiscard));
+      m_pDriver->GetDebugManager()->PixelHistoryCopyRegion(
+          cmd, params, m_Layout.GetOffset(eventIndex, PixelHistoryLayout::FragsWithDiscard), 0);
     }
 
     // Restore the state.
@@ -648,20 +701,11 @@ struct VulkanOcclusionAndStencilCallback : public VulkanPixelHistoryCallback
 
     m_pDriver->GetCmdRenderState().EndRenderPass(cmd);
 
-    size_t storeOffset = m_EventIndices.size() * sizeof(EventInfo);
     VkImage depthImage = VK_NULL_HANDLE;
     VkFormat depthFormat = VK_FORMAT_UNDEFINED;
-    const DrawcallDescription *draw = m_pDriver->GetDrawcall(eid);
-    if(draw && draw->depthOut != ResourceId())
-    {
-      ResourceId resId = m_pDriver->GetResourceManager()->GetLiveID(draw->depthOut);
-      depthImage = m_pDriver->GetResourceManager()->GetCurrentHandle<VkImage>(resId);
-      const VulkanCreationInfo::Image &imginfo = m_pDriver->GetDebugManager()->GetImageInfo(resId);
-      depthFormat = imginfo.format;
-    }
+    GetDepthTarget(eid, depthImage, depthFormat);
 
-    CopyPixel(m_Image, m_Format, depthImage, depthFormat, cmd,
-              storeOffset + offsetof(struct EventInfo, postmod));
+    CopyRegion(m_Image, m_Format, depthImage, depthFormat, cmd, m_EventIndices.size(), true);
 
     m_pDriver->GetCmdRenderState().BeginRenderPassAndApplyState(m_pDriver, cmd,
                                                                 VulkanRenderState::BindGraphics);
@@ -681,17 +725,16 @@ struct VulkanOcclusionAndStencilCallback : public VulkanPixelHistoryCallback
     if(m_Events.find(eid) == m_Events.end())
       return;
 
-    size_t storeOffset = m_EventIndices.size() * sizeof(EventInfo);
-    CopyPixel(m_Image, m_Format, VK_NULL_HANDLE, VK_FORMAT_UNDEFINED, cmd, storeOffset);
+    CopyRegion(m_Image, m_Format, VK_NULL_HANDLE, VK_FORMAT_UNDEFINED, cmd, m_EventIndices.size(),
+               false);
   }
   bool PostDispatch(uint32_t eid, VkCommandBuffer cmd)
   {
     if(m_Events.find(eid) == m_Events.end())
       return false;
 
-    size_t storeOffset = m_EventIndices.size() * sizeof(EventInfo);
-    CopyPixel(m_Image, m_Format, VK_NULL_HANDLE, VK_FORMAT_UNDEFINED, cmd,
-              storeOffset + offsetof(struct EventInfo, postmod));
+    CopyRegion(m_Image, m_Format, VK_NULL_HANDLE, VK_FORMAT_UNDEFINED, cmd, m_EventIndices.size(),
+               true);
     m_EventIndices.insert(std::make_pair(eid, m_EventIndices.size()));
     return false;
   }
@@ -750,9 +793,33 @@ struct VulkanOcclusionAndStencilCallback : public VulkanPixelHistoryCallback
     return it->second;
   }
 
+  // returns the format of the depth target whose values were read back for the event, or
+  // VK_FORMAT_UNDEFINED if no depth values were read back
+  VkFormat GetDepthFormat(uint32_t eventId)
+  {
+    auto it = m_DepthFormats.find(eventId);
+    if(it == m_DepthFormats.end())
+      return VK_FORMAT_UNDEFINED;
+    return it->second;
+  }
+
 private:
-  void CopyPixel(VkImage srcImage, VkFormat srcFormat, VkImage depthImage, VkFormat depthFormat,
-                 VkCommandBuffer cmd, size_t offset)
+  void GetDepthTarget(uint32_t eid, VkImage &depthImage, VkFormat &depthFormat)
+  {
+    const DrawcallDescription *draw = m_pDriver->GetDrawcall(eid);
+    if(draw && draw->depthOut != ResourceId())
+    {
+      ResourceId resId = m_pDriver->GetResourceManager()->GetLiveID(draw->depthOut);
+      depthImage = m_pDriver->GetResourceManager()->GetCurrentHandle<VkImage>(resId);
+      const VulkanCreationInfo::Image &imginfo = m_pDriver->GetDebugManager()->GetImageInfo(resId);
+      depthFormat = imginfo.format;
+    }
+  }
+
+  // Copies the colour and depth values for the whole region into the event's block of the
+  // readback buffer, either as the pre-modification or post-modification values.
+  void CopyRegion(VkImage srcImage, VkFormat srcFormat, VkImage depthImage, VkFormat depthFormat,
+                  VkCommandBuffer cmd, size_t eventIndex, bool postMod)
   {
     CopyPixelParams colourCopyParams = {};
     colourCopyParams.multisampled = false;    // TODO: multisampled
@@ -760,12 +827,23 @@ private:
     colourCopyParams.srcImageLayout =
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;    // TODO: image layout
     colourCopyParams.srcImageFormat = srcFormat;
-    colourCopyParams.imageOffset.x = int32_t(m_X);
-    colourCopyParams.imageOffset.y = int32_t(m_Y);
+    colourCopyParams.imageOffset.x = m_Region.offset.x;
+    colourCopyParams.imageOffset.y = m_Region.offset.y;
     colourCopyParams.imageOffset.z = 0;
+    colourCopyParams.imageExtent = m_Region.extent;
     colourCopyParams.dstBuffer = m_DstBuffer;
 
-    m_pDriver->GetDebugManager()->PixelHistoryCopyPixel(cmd, colourCopyParams, offset);
+    PixelHistoryLayout::Plane colourPlane =
+        postMod ? PixelHistoryLayout::PostModColour : PixelHistoryLayout::PreModColour;
+    PixelHistoryLayout::Plane depthPlane =
+        postMod ? PixelHistoryLayout::PostModDepth : PixelHistoryLayout::PreModDepth;
+    PixelHistoryLayout::Plane stencilPlane =
+        postMod ? PixelHistoryLayout::PostModStencil : PixelHistoryLayout::PreModStencil;
+
+    // depth targets are read back below, through the draw's depth output
+    if(!IsDepthOrStencilFormat(srcFormat))
+      m_pDriver->GetDebugManager()->PixelHistoryCopyRegion(
+          cmd, colourCopyParams, m_Layout.GetOffset(eventIndex, colourPlane), 0);
 
     if(depthImage != VK_NULL_HANDLE)
     {
@@ -774,8 +852,9 @@ private:
       depthCopyParams.srcImage = depthImage;
       depthCopyParams.srcImageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
       depthCopyParams.srcImageFormat = depthFormat;
-      m_pDriver->GetDebugManager()->PixelHistoryCopyPixel(
-          cmd, depthCopyParams, offset + offsetof(struct PixelHistoryValue, depth));
+      m_pDriver->GetDebugManager()->PixelHistoryCopyRegion(
+          cmd, depthCopyParams, m_Layout.GetOffset(eventIndex, depthPlane),
+          m_Layout.GetOffset(eventIndex, stencilPlane));
     }
   }
 
@@ -793,10 +872,7 @@ private:
       VkClearAttachment att = {};
       att.aspectMask = VK_IMAGE_ASPECT_STENCIL_BIT;
       VkClearRect rect = {};
-      rect.rect.offset.x = m_X;
-      rect.rect.offset.y = m_Y;
-      rect.rect.extent.width = 1;
-      rect.rect.extent.height = 1;
+      rect.rect = m_Region;
       rect.baseArrayLayer = 0;
       rect.layerCount = 1;
       ObjDisp(cmd)->CmdClearAttachments(Unwrap(cmd), 1, &att, 1, &rect);
@@ -892,7 +968,7 @@ private:
       {
         for(uint32_t i = 0; i < vs->viewportCount; i++)
         {
-          ScissorToPixel(vs->pViewports[i], newScissors[i]);
+          ScissorToRegion(vs->pViewports[i], newScissors[i]);
         }
         vs->pScissors = newScissors;
       }
@@ -941,6 +1017,7 @@ private:
 
   VkImage m_Image;
   VkFormat m_Format;
+  PixelHistoryLayout m_Layout;
   VkBuffer m_DstBuffer;
 
   VkImageView m_StencilImageView;
@@ -950,6 +1027,8 @@ private:
   std::map<uint32_t, EventUsage> m_Events;
   // Key is event ID, and value is an index of where the event data is stored.
   std::map<uint32_t, size_t> m_EventIndices;
+  // Key is event ID, and value is the format of the depth values read back for the event.
+  std::map<uint32_t, VkFormat> m_DepthFormats;
   // Key is event ID, and value is an index of where the occlusion result.
   std::map<uint32_t, uint32_t> m_OcclusionQueries;
   rdcarray<uint64_t> m_OcclusionResults;
@@ -962,9 +1041,10 @@ private:
 // stencil test etc).
 struct TestsFailedCallback : public VulkanPixelHistoryCallback
 {
-  TestsFailedCallback(WrappedVulkan *vk, PixelHistoryShaderCache *shaderCache, uint32_t x, uint32_t y,
-                      uint32_t sampleMask, VkQueryPool occlusionPool, rdcarray<uint32_t> events)
-      : VulkanPixelHistoryCallback(vk, shaderCache, x, y, sampleMask, occlusionPool),
+  TestsFailedCallback(WrappedVulkan *vk, PixelHistoryShaderCache *shaderCache,
+                      const VkRect2D &region, uint32_t sampleMask, VkQueryPool occlusionPool,
+                      rdcarray<uint32_t> events)
+      : VulkanPixelHistoryCallback(vk, shaderCache, region, sampleMask, occlusionPool),
         m_Events(events)
   {
   }
@@ -978,7 +1058,7 @@ struct TestsFailedCallback : public VulkanPixelHistoryCallback
     VulkanRenderState &pipestate = m_pDriver->GetCmdRenderState();
     const VulkanCreationInfo::Pipeline &p =
         m_pDriver->GetDebugManager()->GetPipelineInfo(pipestate.graphics.pipeline);
-    uint32_t eventFlags = CalculateEventFlags(p, pipestate);
+    uint32_t eventFlags = CalculateEventFlags(eid, p, pipestate);
     m_EventFlags[eid] = eventFlags;
 
     // TODO: figure out if the shader has early fragments tests turned on,
@@ -1054,8 +1134,26 @@ struct TestsFailedCallback : public VulkanPixelHistoryCallback
     return it->second;
   }
 
+  // The occlusion queries only tell us if a test failed across the whole region, but the scissor
+  // test can be evaluated exactly for each pixel on the CPU.
+  bool IsScissorClipped(uint32_t eventId, uint32_t x, uint32_t y) const
+  {
+    auto it = m_EventScissors.find(eventId);
+    if(it == m_EventScissors.end())
+      return false;
+
+    for(const VkRect2D &scissor : it->second)
+    {
+      if(int64_t(x) >= scissor.offset.x && int64_t(y) >= scissor.offset.y &&
+         int64_t(x) < int64_t(scissor.offset.x) + int64_t(scissor.extent.width) &&
+         int64_t(y) < int64_t(scissor.offset.y) + int64_t(scissor.extent.height))
+        return false;
+    }
+    return true;
+  }
+
 private:
-  uint32_t CalculateEventFlags(const VulkanCreationInfo::Pipeline &p,
+  uint32_t CalculateEventFlags(uint32_t eid, const VulkanCreationInfo::Pipeline &p,
                                const VulkanRenderState &pipestate)
   {
     uint32_t flags = 0;
@@ -1113,20 +1211,23 @@ private:
         pScissors = p.scissors.data();
         scissorCount = (uint32_t)p.scissors.size();
       }
+      m_EventScissors[eid].assign(pScissors, scissorCount);
       for(uint32_t i = 0; i < scissorCount; i++)
       {
-        const VkOffset2D &offset = pScissors[i].offset;
-        const VkExtent2D &extent = pScissors[i].extent;
-        if((m_X >= (uint32_t)offset.x) && (m_Y >= (uint32_t)offset.y) &&
-           (m_X < (offset.x + extent.width)) && (m_Y < (offset.y + extent.height)))
+        VkRect2D intersection = m_Region;
+        IntersectScissors(pScissors[i], intersection);
+        if(intersection.extent.width > 0 && intersection.extent.height > 0)
           inRegion = true;
-        else
+        if(intersection.extent.width != m_Region.extent.width ||
+           intersection.extent.height != m_Region.extent.height)
           inAllRegions = false;
       }
       if(!inRegion)
         flags |= TestMustFail_Scissor;
-      if(inAllRegions)
+      else if(inAllRegions)
         flags |= TestMustPass_Scissor;
+      else
+        flags |= TestEnabled_Scissor;
     }
 
     // Blending
@@ -1207,7 +1308,7 @@ private:
     rdcarray<VkRect2D> prevScissors = pipestate.scissors;
     if(dynamicScissor)
       for(uint32_t i = 0; i < pipestate.views.size(); i++)
-        ScissorToPixel(pipestate.views[i], pipestate.scissors[i]);
+        ScissorToRegion(pipestate.views[i], pipestate.scissors[i]);
 
     if(eventFlags & TestEnabled_Culling)
     {
@@ -1359,9 +1460,10 @@ private:
       VkRect2D *pScissors = (VkRect2D *)vs->pScissors;
       for(uint32_t i = 0; i < vs->viewportCount; i++)
       {
-        ScissorToPixel(vs->pViewports[i], pScissors[i]);
+        VkRect2D originalScissor = pScissors[i];
+        ScissorToRegion(vs->pViewports[i], pScissors[i]);
         if(pipeCreateFlags & PipelineCreationFlags_IntersectOriginalScissor)
-          IntersectScissors(vs->pScissors[i], pScissors[i]);
+          IntersectScissors(originalScissor, pScissors[i]);
       }
     }
 
@@ -1407,12 +1509,14 @@ private:
   // value: the index where occlusion query is in m_OcclusionResults
   std::map<rdcpair<uint32_t, uint32_t>, uint32_t> m_OcclusionQueries;
   std::map<uint32_t, bool> m_HasEarlyFragments;
+  // Key is event ID, value is the scissors that were active for the event.
+  std::map<uint32_t, rdcarray<VkRect2D>> m_EventScissors;
   rdcarray<uint64_t> m_OcclusionResults;
 };
 
 bool VulkanDebugManager::PixelHistorySetupResources(PixelHistoryResources &resources,
                                                     VkExtent3D extent, VkFormat format,
-                                                    uint32_t numEvents)
+                                                    VkDeviceSize bufferSize)
 {
   VkImage colorImage;
   VkImageView colorImageView;
@@ -1496,7 +1600,7 @@ bool VulkanDebugManager::PixelHistorySetupResources(PixelHistoryResources &resou
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
   VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
-  bufferInfo.size = AlignUp((uint32_t)(numEvents * sizeof(EventInfo)), 512U);
+  bufferInfo.size = AlignUp(bufferSize, (VkDeviceSize)512U);
   bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
   vkr = m_pDriver->vkCreateBuffer(m_Device, &bufferInfo, NULL, &dstBuffer);
@@ -1564,7 +1668,8 @@ bool VulkanDebugManager::PixelHistoryDestroyResources(const PixelHistoryResource
   return true;
 }
 
-void VulkanDebugManager::PixelHistoryCopyPixel(VkCommandBuffer cmd, CopyPixelParams &p, size_t offset)
+void VulkanDebugManager::PixelHistoryCopyRegion(VkCommandBuffer cmd, CopyPixelParams &p,
+                                                size_t offset, size_t stencilOffset)
 {
   rdcarray<VkBufferImageCopy> regions;
   // Check if depth image includes depth and stencil
@@ -1574,8 +1679,8 @@ void VulkanDebugManager::PixelHistoryCopyPixel(VkCommandBuffer cmd, CopyPixelPar
   region.bufferRowLength = 0;
   region.bufferImageHeight = 0;
   region.imageOffset = p.imageOffset;
-  region.imageExtent.width = 1U;
-  region.imageExtent.height = 1U;
+  region.imageExtent.width = p.imageExtent.width;
+  region.imageExtent.height = p.imageExtent.height;
   region.imageExtent.depth = 1U;
   if(!p.depthCopy)
   {
@@ -1600,7 +1705,7 @@ void VulkanDebugManager::PixelHistoryCopyPixel(VkCommandBuffer cmd, CopyPixelPar
     if(IsStencilFormat(p.srcImageFormat))
     {
       region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_STENCIL_BIT;
-      region.bufferOffset = offset + 4;
+      region.bufferOffset = (uint64_t)stencilOffset;
       regions.push_back(region);
       aspectFlags |= VK_IMAGE_ASPECT_STENCIL_BIT;
     }
@@ -1746,36 +1851,81 @@ void UpdateTestsFailed(const TestsFailedCallback *tfCb, uint32_t eventId, uint32
   }
 }
 
-void FillInColors(const EventInfo &ei, VkFormat format, PixelModification &mod)
+// Decodes the depth value of one pixel from a plane of depth values copied out of an image of the
+// given format.
+float DecodeDepth(const byte *plane, uint32_t pixel, VkFormat depthFormat)
 {
-  ResourceFormat fmt = MakeResourceFormat(format);
-
-  FloatVector premod = ConvertComponents(fmt, ei.premod.color);
-  FloatVector postmod = ConvertComponents(fmt, ei.postmod.color);
+  switch(depthFormat)
+  {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_D16_UNORM_S8_UINT: return float(((const uint16_t *)plane)[pixel]) / 65535.0f;
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+      return float(((const uint32_t *)plane)[pixel] & 0xffffff) / 16777215.0f;
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT: return ((const float *)plane)[pixel];
+    default: break;
+  }
 
-  memcpy(mod.preMod.col.floatValue, &premod.x, sizeof(premod));
-  memcpy(mod.postMod.col.floatValue, &postmod.x, sizeof(postmod));
+  return -1.0f;
 }
 
-rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> events,
-                                                       ResourceId target, uint32_t x, uint32_t y,
-                                                       const Subresource &sub, CompType typeCast)
+void FillInValue(const byte *buf, const PixelHistoryLayout &layout, size_t eventIndex, bool postMod,
+                 const ResourceFormat &fmt, VkFormat depthFormat, uint32_t pixel,
+                 ModificationValue &value)
 {
-#if 1
-  if(!events.empty())
+  PixelHistoryLayout::Plane colourPlane =
+      postMod ? PixelHistoryLayout::PostModColour : PixelHistoryLayout::PreModColour;
+  PixelHistoryLayout::Plane depthPlane =
+      postMod ? PixelHistoryLayout::PostModDepth : PixelHistoryLayout::PreModDepth;
+  PixelHistoryLayout::Plane stencilPlane =
+      postMod ? PixelHistoryLayout::PostModStencil : PixelHistoryLayout::PreModStencil;
+
+  if(layout.colourTexelSize > 0)
   {
-    VULKANNOTIMP("PixelHistory");
-    return rdcarray<PixelModification>();
+    const byte *colour =
+        buf + layout.GetOffset(eventIndex, colourPlane) + pixel * layout.colourTexelSize;
+    FloatVector col = ConvertComponents(fmt, colour);
+    memcpy(value.col.floatValue, &col.x, sizeof(col));
   }
-#endif
 
-  RDCDEBUG("PixelHistory: pixel: (%u, %u) with %u events", x, y, events.size());
-  rdcarray<PixelModification> history;
+  value.depth = -1.0f;
+  value.stencil = -1;
 
-  if(events.empty())
-    return history;
+  if(depthFormat != VK_FORMAT_UNDEFINED)
+  {
+    if(!IsStencilOnlyFormat(depthFormat))
+      value.depth = DecodeDepth(buf + layout.GetOffset(eventIndex, depthPlane), pixel, depthFormat);
+    if(IsStencilFormat(depthFormat))
+      value.stencil = buf[layout.GetOffset(eventIndex, stencilPlane) + pixel];
+  }
+}
+
+// the most occlusion queries TestsFailedCallback can use for a single draw, one for each test
+static const uint32_t MaxTestsPerDraw = 7;
+
+// Fetches the history of every pixel in a region no larger than MaxPixelHistoryRegion in each
+// dimension. All of the pixels are processed in the same replays, so this costs about the same as
+// fetching the history of a single pixel. The results are in row-major order.
+rdcarray<PixelRegionHistory> PixelHistoryBatch(WrappedVulkan *vk,
+                                               const rdcarray<EventUsage> &events,
+                                               ResourceId target, const VkRect2D &region,
+                                               const Subresource &sub)
+{
+  rdcarray<PixelRegionHistory> history;
+  history.resize(region.extent.width * region.extent.height);
+  for(uint32_t y = 0; y < region.extent.height; y++)
+  {
+    for(uint32_t x = 0; x < region.extent.width; x++)
+    {
+      history[y * region.extent.width + x].x = region.offset.x + x;
+      history[y * region.extent.width + x].y = region.offset.y + y;
+    }
+  }
+
+  VulkanDebugManager *debug = vk->GetDebugManager();
 
-  const VulkanCreationInfo::Image &imginfo = GetDebugManager()->GetImageInfo(target);
+  const VulkanCreationInfo::Image &imginfo = debug->GetImageInfo(target);
   if(imginfo.format == VK_FORMAT_UNDEFINED)
     return history;
 
@@ -1784,13 +1934,9 @@ rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> even
   uint32_t sampleIdx = sub.sample;
 
   // TODO: figure out correct aspect.
-  VkImageLayout imgLayout =
-      GetDebugManager()->GetImageLayout(target, VK_IMAGE_ASPECT_COLOR_BIT, mip, slice);
+  VkImageLayout imgLayout = debug->GetImageLayout(target, VK_IMAGE_ASPECT_COLOR_BIT, mip, slice);
   RDCASSERTNOTEQUAL(imgLayout, VK_IMAGE_LAYOUT_UNDEFINED);
 
-  // TODO: use the given type hint for typeless textures
-  SCOPED_TIMER("VkDebugManager::PixelHistory");
-
   if(sampleIdx > (uint32_t)imginfo.samples)
     sampleIdx = 0;
 
@@ -1803,27 +1949,34 @@ rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> even
   if(sampleIdx == ~0U || !multisampled)
     sampleIdx = 0;
 
-  VkDevice dev = m_pDriver->GetDev();
+  VkDevice dev = vk->GetDev();
   VkQueryPool occlusionPool;
-  CreateOcclusionPool(m_pDriver, (uint32_t)events.size(), &occlusionPool);
+  CreateOcclusionPool(vk, (uint32_t)events.size(), &occlusionPool);
+
+  // depth targets have no colour values, their values are read back as depth
+  uint32_t colourTexelSize = 0;
+  if(!IsDepthOrStencilFormat(imginfo.format))
+    colourTexelSize = GetByteSize(1, 1, 1, imginfo.format, 0);
+
+  PixelHistoryLayout layout(region.extent, colourTexelSize);
 
   PixelHistoryResources resources = {};
-  GetDebugManager()->PixelHistorySetupResources(resources, imginfo.extent, imginfo.format,
-                                                (uint32_t)events.size());
+  debug->PixelHistorySetupResources(resources, imginfo.extent, imginfo.format,
+                                    layout.eventSize * events.size());
 
-  PixelHistoryShaderCache *shaderCache = new PixelHistoryShaderCache(m_pDriver);
+  PixelHistoryShaderCache *shaderCache = new PixelHistoryShaderCache(vk);
 
   VulkanOcclusionAndStencilCallback cb(
-      m_pDriver, shaderCache, x, y, GetResourceManager()->GetCurrentHandle<VkImage>(target),
-      imginfo.format, sampleMask, occlusionPool, resources.stencilImageView, resources.stencilImage,
-      resources.dstBuffer, events);
-  m_pDriver->ReplayLog(0, events.back().eventId, eReplay_Full);
-  m_pDriver->SubmitCmds();
-  m_pDriver->FlushQ();
+      vk, shaderCache, region, vk->GetResourceManager()->GetCurrentHandle<VkImage>(target),
+      imginfo.format, layout, sampleMask, occlusionPool, resources.stencilImageView,
+      resources.stencilImage, resources.dstBuffer, events);
+  vk->ReplayLog(0, events.back().eventId, eReplay_Full);
+  vk->SubmitCmds();
+  vk->FlushQ();
 
   cb.FetchOcclusionResults();
 
-  // Gather all draw events that could have written to pixel for another replay pass,
+  // Gather all draw events that could have written to the region for another replay pass,
   // to determine if these draws failed for some reason (for ex., depth test).
   rdcarray<uint32_t> drawEvents;
   for(size_t ev = 0; ev < events.size(); ev++)
@@ -1847,82 +2000,166 @@ rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> even
   // If there are any draw events, do another replay pass, in order to figure out
   // which tests failed for each draw event.
   TestsFailedCallback *tfCb = NULL;
+  VkQueryPool tfOcclusionPool = VK_NULL_HANDLE;
   if(drawEvents.size() > 0)
   {
-    VkQueryPool tfOcclusionPool;
-    CreateOcclusionPool(m_pDriver, (uint32_t)drawEvents.size() * 6, &tfOcclusionPool);
+    CreateOcclusionPool(vk, (uint32_t)drawEvents.size() * MaxTestsPerDraw, &tfOcclusionPool);
 
-    tfCb = new TestsFailedCallback(m_pDriver, shaderCache, x, y, sampleMask, tfOcclusionPool,
-                                   drawEvents);
-    m_pDriver->ReplayLog(0, events.back().eventId, eReplay_Full);
-    m_pDriver->SubmitCmds();
-    m_pDriver->FlushQ();
+    tfCb =
+        new TestsFailedCallback(vk, shaderCache, region, sampleMask, tfOcclusionPool, drawEvents);
+    vk->ReplayLog(0, events.back().eventId, eReplay_Full);
+    vk->SubmitCmds();
+    vk->FlushQ();
     tfCb->FetchOcclusionResults();
   }
 
-  for(size_t ev = 0; ev < events.size(); ev++)
+  // Try to read memory back
+
+  byte *bufPtr = NULL;
+  VkResult vkr =
+      vk->vkMapMemory(dev, resources.bufferMemory, 0, VK_WHOLE_SIZE, 0, (void **)&bufPtr);
+  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+  ResourceFormat fmt = MakeResourceFormat(imginfo.format);
+
+  for(size_t ev = 0; ev < events.size() && bufPtr; ev++)
   {
     uint32_t eventId = events[ev].eventId;
     bool clear = (events[ev].usage == ResourceUsage::Clear);
     bool directWrite = isDirectWrite(events[ev].usage);
-    if(drawEvents.contains(events[ev].eventId) || clear || directWrite)
+    bool draw = drawEvents.contains(eventId);
+    if(!draw && !clear && !directWrite)
+      continue;
+
+    // the test results from the occlusion queries apply to the whole region
+    PixelModification mod;
+    RDCEraseEl(mod);
+
+    mod.eventId = eventId;
+    mod.directShaderWrite = directWrite;
+    mod.unboundPS = false;
+
+    uint32_t flags = 0;
+    if(draw)
     {
-      PixelModification mod;
-      RDCEraseEl(mod);
+      RDCASSERT(tfCb != NULL);
+      flags = tfCb->GetEventFlags(eventId);
+      if(flags & TestMustFail_Culling)
+        mod.backfaceCulled = true;
+      if(flags & TestMustFail_DepthTesting)
+        mod.depthTestFailed = true;
+      if(flags & TestMustFail_Scissor)
+        mod.scissorClipped = true;
+      if(flags & TestMustFail_SampleMask)
+        mod.sampleMasked = true;
+
+      UpdateTestsFailed(tfCb, eventId, flags, mod);
+    }
 
-      mod.eventId = eventId;
-      mod.directShaderWrite = directWrite;
-      mod.unboundPS = false;
+    size_t eventIndex = cb.GetEventIndex(eventId);
+    VkFormat depthFormat = cb.GetDepthFormat(eventId);
 
-      if(!clear && !directWrite)
+    const byte *fragsWithoutDiscard =
+        bufPtr + layout.GetOffset(eventIndex, PixelHistoryLayout::FragsWithoutDiscard);
+    const byte *fragsWithDiscard =
+        bufPtr + layout.GetOffset(eventIndex, PixelHistoryLayout::FragsWithDiscard);
+
+    for(uint32_t p = 0; p < layout.numPixels; p++)
+    {
+      PixelRegionHistory &pixel = history[p];
+      PixelModification pixelMod = mod;
+
+      if(draw)
       {
-        RDCASSERT(tfCb != NULL);
-        uint32_t flags = tfCb->GetEventFlags(eventId);
-        if(flags & TestMustFail_Culling)
-          mod.backfaceCulled = true;
-        if(flags & TestMustFail_DepthTesting)
-          mod.depthTestFailed = true;
-        if(flags & TestMustFail_Scissor)
-          mod.scissorClipped = true;
-        if(flags & TestMustFail_SampleMask)
-          mod.sampleMasked = true;
-
-        UpdateTestsFailed(tfCb, eventId, flags, mod);
+        // skip pixels that no fragment from this draw covered
+        if(fragsWithoutDiscard[p] == 0)
+          continue;
+
+        // the fragment counts are per-pixel, so refine the region-wide results where possible
+        pixelMod.shaderDiscarded = (fragsWithDiscard[p] == 0);
+        if(flags & TestEnabled_Scissor)
+          pixelMod.scissorClipped = tfCb->IsScissorClipped(eventId, pixel.x, pixel.y);
       }
-      history.push_back(mod);
+
+      FillInValue(bufPtr, layout, eventIndex, false, fmt, depthFormat, p, pixelMod.preMod);
+      FillInValue(bufPtr, layout, eventIndex, true, fmt, depthFormat, p, pixelMod.postMod);
+
+      pixel.modifications.push_back(pixelMod);
     }
   }
 
-  // Try to read memory back
+  vk->vkUnmapMemory(dev, resources.bufferMemory);
+  debug->PixelHistoryDestroyResources(resources);
+  ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), occlusionPool, NULL);
+  if(tfOcclusionPool != VK_NULL_HANDLE)
+    ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), tfOcclusionPool, NULL);
+  delete tfCb;
+  delete shaderCache;
 
-  void *bufPtr = NULL;
-  VkResult vkr =
-      m_pDriver->vkMapMemory(dev, resources.bufferMemory, 0, VK_WHOLE_SIZE, 0, (void **)&bufPtr);
-  RDCASSERTEQUAL(vkr, VK_SUCCESS);
+  return history;
+}
+
+rdcarray<PixelModification> VulkanReplay::PixelHistory(rdcarray<EventUsage> events,
+                                                       ResourceId target, uint32_t x, uint32_t y,
+                                                       const Subresource &sub, CompType typeCast)
+{
+  rdcarray<PixelRegionHistory> region =
+      PixelHistoryRegion(events, target, x, y, 1, 1, sub, typeCast);
 
-  EventInfo *eventsInfo = (EventInfo *)bufPtr;
+  if(region.empty())
+    return rdcarray<PixelModification>();
 
-  for(size_t h = 0; h < history.size(); h++)
-  {
-    PixelModification &mod = history[h];
+  return region[0].modifications;
+}
+
+rdcarray<PixelRegionHistory> VulkanReplay::PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                              ResourceId target, uint32_t x,
+                                                              uint32_t y, uint32_t width,
+                                                              uint32_t height,
+                                                              const Subresource &sub,
+                                                              CompType typeCast)
+{
+  RDCDEBUG("PixelHistory: region (%u, %u) %ux%u with %zu events", x, y, width, height,
+           events.size());
+  rdcarray<PixelRegionHistory> history;
 
-    const EventInfo &ei = eventsInfo[cb.GetEventIndex(mod.eventId)];
-    FillInColors(ei, imginfo.format, mod);
-    mod.preMod.depth = ei.premod.depth.fdepth;
-    mod.preMod.stencil = ei.premod.stencil;
-    mod.postMod.depth = ei.postmod.depth.fdepth;
-    mod.postMod.stencil = ei.postmod.stencil;
+  if(width == 0 || height == 0)
+    return history;
 
-    RDCDEBUG(
-        "PixelHistory event id: %u, fixed shader stencilValue = %u, original shader stencilValue = "
-        "%u",
-        mod.eventId, ei.dsWithoutShaderDiscard[0], ei.dsWithShaderDiscard[0]);
+  history.resize(width * height);
+  for(uint32_t py = 0; py < height; py++)
+  {
+    for(uint32_t px = 0; px < width; px++)
+    {
+      history[py * width + px].x = x + px;
+      history[py * width + px].y = y + py;
+    }
   }
 
-  m_pDriver->vkUnmapMemory(dev, resources.bufferMemory);
-  GetDebugManager()->PixelHistoryDestroyResources(resources);
-  ObjDisp(dev)->DestroyQueryPool(Unwrap(dev), occlusionPool, NULL);
-  delete shaderCache;
+  if(events.empty())
+    return history;
+
+  // TODO: use the given type hint for typeless textures
+  SCOPED_TIMER("VkDebugManager::PixelHistory");
+
+  // each tile costs the same number of replays as a single pixel
+  for(uint32_t ty = 0; ty < height; ty += MaxPixelHistoryRegion)
+  {
+    for(uint32_t tx = 0; tx < width; tx += MaxPixelHistoryRegion)
+    {
+      VkRect2D tile = {};
+      tile.offset.x = int32_t(x + tx);
+      tile.offset.y = int32_t(y + ty);
+      tile.extent.width = RDCMIN(MaxPixelHistoryRegion, width - tx);
+      tile.extent.height = RDCMIN(MaxPixelHistoryRegion, height - ty);
+
+      rdcarray<PixelRegionHistory> tileHistory =
+          PixelHistoryBatch(m_pDriver, events, target, tile, sub);
+
+      for(PixelRegionHistory &pixel : tileHistory)
+        history[(pixel.y - y) * width + (pixel.x - x)].modifications.swap(pixel.modifications);
+    }
+  }
 
   return history;
 }
@@ -25,6 +25,7 @@
 #include <float.h>
 #include <math.h>
 #include <algorithm>
+#include "core/settings.h"
 #include "driver/shaders/spirv/spirv_editor.h"
 #include "driver/shaders/spirv/spirv_op_helpers.h"
 #include "vk_core.h"
@@ -32,6 +33,10 @@
 #include "vk_replay.h"
 #include "vk_shader_cache.h"
 
+RDOC_CONFIG(uint32_t, Vulkan_PostVSCacheBudgetMB, 512,
+            "Budget in megabytes of GPU memory for cached post-transform mesh data. Once it's "
+            "exceeded, the data for the least recently used events is freed.");
+
 #undef None
 
 struct VkXfbQueryResult
@@ -1211,28 +1216,100 @@ static void ConvertToMeshOutputCompute(const ShaderReflection &refl, const SPIRV
   }
 }
 
-void VulkanReplay::ClearPostVSCache()
+void VulkanReplay::DestroyPostVSData(VulkanPostVSData &data)
 {
   VkDevice dev = m_Device;
 
+  if(data.vsout.idxbuf != VK_NULL_HANDLE)
+  {
+    m_pDriver->vkDestroyBuffer(dev, data.vsout.idxbuf, NULL);
+    m_pDriver->FreeMemoryAllocation(data.vsout.idxbufmem);
+  }
+  m_pDriver->vkDestroyBuffer(dev, data.vsout.buf, NULL);
+  m_pDriver->FreeMemoryAllocation(data.vsout.bufmem);
+
+  if(data.gsout.buf != VK_NULL_HANDLE)
+  {
+    m_pDriver->vkDestroyBuffer(dev, data.gsout.buf, NULL);
+    m_pDriver->FreeMemoryAllocation(data.gsout.bufmem);
+  }
+}
+
+void VulkanReplay::ClearPostVSCache()
+{
   for(auto it = m_PostVS.Data.begin(); it != m_PostVS.Data.end(); ++it)
+    DestroyPostVSData(it->second);
+
+  m_PostVS.Data.clear();
+  m_PostVS.UsedBytes = 0;
+}
+
+void VulkanReplay::AccountPostVSData(uint32_t eventId)
+{
+  auto it = m_PostVS.Data.find(eventId);
+  if(it == m_PostVS.Data.end())
+    return;
+
+  VulkanPostVSData &data = it->second;
+
+  VkBuffer bufs[] = {data.vsout.buf, data.vsout.idxbuf, data.gsout.buf};
+  for(VkBuffer buf : bufs)
   {
-    if(it->second.vsout.idxbuf != VK_NULL_HANDLE)
-    {
-      m_pDriver->vkDestroyBuffer(dev, it->second.vsout.idxbuf, NULL);
-      m_pDriver->vkFreeMemory(dev, it->second.vsout.idxbufmem, NULL);
-    }
-    m_pDriver->vkDestroyBuffer(dev, it->second.vsout.buf, NULL);
-    m_pDriver->vkFreeMemory(dev, it->second.vsout.bufmem, NULL);
+    if(buf == VK_NULL_HANDLE)
+      continue;
+
+    VkMemoryRequirements mrq = {};
+    m_pDriver->vkGetBufferMemoryRequirements(m_Device, buf, &mrq);
+    data.gpuBytes += mrq.size;
+  }
+
+  data.lastUse = ++m_PostVS.UseCounter;
+  m_PostVS.UsedBytes += data.gpuBytes;
+}
 
-    if(it->second.gsout.buf != VK_NULL_HANDLE)
+bool VulkanReplay::IsPostVSCacheFull(uint64_t priority)
+{
+  VkDeviceSize budget = VkDeviceSize(Vulkan_PostVSCacheBudgetMB) * 1024 * 1024;
+
+  if(m_PostVS.UsedBytes < budget)
+    return false;
+
+  // the cache is full, but there's room if something less important could be evicted
+  for(auto it = m_PostVS.Data.begin(); it != m_PostVS.Data.end(); ++it)
+  {
+    if(it->first != m_PostVS.Pinned && it->second.gpuBytes > 0 && it->second.lastUse < priority)
+      return false;
+  }
+
+  return true;
+}
+
+void VulkanReplay::TrimPostVSCache()
+{
+  VkDeviceSize budget = VkDeviceSize(Vulkan_PostVSCacheBudgetMB) * 1024 * 1024;
+
+  while(m_PostVS.UsedBytes > budget)
+  {
+    auto lru = m_PostVS.Data.end();
+
+    for(auto it = m_PostVS.Data.begin(); it != m_PostVS.Data.end(); ++it)
     {
-      m_pDriver->vkDestroyBuffer(dev, it->second.gsout.buf, NULL);
-      m_pDriver->vkFreeMemory(dev, it->second.gsout.bufmem, NULL);
+      // entries without any data are cheap to keep and save re-checking the event
+      if(it->first == m_PostVS.Pinned || it->second.gpuBytes == 0)
+        continue;
+
+      if(lru == m_PostVS.Data.end() || it->second.lastUse < lru->second.lastUse)
+        lru = it;
     }
-  }
 
-  m_PostVS.Data.clear();
+    // only the pinned event is left, it's allowed to exceed the budget on its own
+    if(lru == m_PostVS.Data.end())
+      break;
+
+    m_PostVS.UsedBytes -= lru->second.gpuBytes;
+    DestroyPostVSData(lru->second);
+    m_PostVS.Data.erase(lru);
+  }
 }
 
 void VulkanReplay::PatchReservedDescriptors(const VulkanStatePipeline &pipe,
@@ -1575,7 +1652,7 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
   {
     m_PostVS.Data[eventId].vsin.topo = pipeInfo.topology;
     m_PostVS.Data[eventId].vsout.buf = VK_NULL_HANDLE;
-    m_PostVS.Data[eventId].vsout.bufmem = VK_NULL_HANDLE;
+    m_PostVS.Data[eventId].vsout.bufmem = MemoryAllocation();
     m_PostVS.Data[eventId].vsout.instStride = 0;
     m_PostVS.Data[eventId].vsout.vertStride = 0;
     m_PostVS.Data[eventId].vsout.numViews = 1;
@@ -1584,7 +1661,7 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
     m_PostVS.Data[eventId].vsout.useIndices = false;
     m_PostVS.Data[eventId].vsout.hasPosOut = false;
     m_PostVS.Data[eventId].vsout.idxbuf = VK_NULL_HANDLE;
-    m_PostVS.Data[eventId].vsout.idxbufmem = VK_NULL_HANDLE;
+    m_PostVS.Data[eventId].vsout.idxbufmem = MemoryAllocation();
 
     m_PostVS.Data[eventId].vsout.topo = pipeInfo.topology;
   }
@@ -1674,14 +1751,15 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
   }
 
   VkBuffer meshBuffer = VK_NULL_HANDLE, readbackBuffer = VK_NULL_HANDLE;
-  VkDeviceMemory meshMem = VK_NULL_HANDLE, readbackMem = VK_NULL_HANDLE;
+  MemoryAllocation meshMem;
+  VkDeviceMemory readbackMem = VK_NULL_HANDLE;
 
   VkBuffer uniqIdxBuf = VK_NULL_HANDLE;
   VkDeviceMemory uniqIdxBufMem = VK_NULL_HANDLE;
   VkBufferView uniqIdxBufView = VK_NULL_HANDLE;
 
   VkBuffer rebasedIdxBuf = VK_NULL_HANDLE;
-  VkDeviceMemory rebasedIdxBufMem = VK_NULL_HANDLE;
+  MemoryAllocation rebasedIdxBufMem;
 
   uint32_t numVerts = drawcall->numIndices;
   VkDeviceSize bufSize = 0;
@@ -1936,37 +2014,34 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
     vkr = m_pDriver->vkCreateBuffer(dev, &bufInfo, NULL, &rebasedIdxBuf);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    m_pDriver->vkGetBufferMemoryRequirements(dev, rebasedIdxBuf, &mrq);
-
-    allocInfo.allocationSize = mrq.size;
-    allocInfo.memoryTypeIndex = m_pDriver->GetUploadMemoryIndex(mrq.memoryTypeBits);
-
-    vkr = m_pDriver->vkAllocateMemory(dev, &allocInfo, NULL, &rebasedIdxBufMem);
+    rebasedIdxBufMem = m_pDriver->AllocateMemoryForResource(rebasedIdxBuf, MemoryScope::PostVS,
+                                                            MemoryType::Upload);
 
-    if(vkr == VK_ERROR_OUT_OF_DEVICE_MEMORY || vkr == VK_ERROR_OUT_OF_HOST_MEMORY)
+    if(rebasedIdxBufMem.mem == VK_NULL_HANDLE)
     {
-      RDCWARN("Failed to allocate %llu bytes for rebased index buffer", mrq.size);
+      RDCWARN("Failed to allocate memory for rebased index buffer");
       return;
     }
 
+    vkr = m_pDriver->vkBindBufferMemory(dev, rebasedIdxBuf, rebasedIdxBufMem.mem,
+                                        rebasedIdxBufMem.offs);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    vkr = m_pDriver->vkBindBufferMemory(dev, rebasedIdxBuf, rebasedIdxBufMem, 0);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-    vkr = m_pDriver->vkMapMemory(m_Device, rebasedIdxBufMem, 0, VK_WHOLE_SIZE, 0, (void **)&idxData);
+    vkr = m_pDriver->vkMapMemory(m_Device, rebasedIdxBufMem.mem, rebasedIdxBufMem.offs,
+                                 VK_WHOLE_SIZE, 0, (void **)&idxData);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
     memcpy(idxData, idxdata.data(), idxdata.size());
 
     VkMappedMemoryRange rebasedRange = {
-        VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, rebasedIdxBufMem, 0, VK_WHOLE_SIZE,
+        VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, NULL, rebasedIdxBufMem.mem, rebasedIdxBufMem.offs,
+        VK_WHOLE_SIZE,
     };
 
     vkr = m_pDriver->vkFlushMappedMemoryRanges(m_Device, 1, &rebasedRange);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    m_pDriver->vkUnmapMemory(m_Device, rebasedIdxBufMem);
+    m_pDriver->vkUnmapMemory(m_Device, rebasedIdxBufMem.mem);
   }
 
   uint32_t bufStride = 0;
@@ -2427,30 +2502,25 @@ void VulkanReplay::FetchVSOut(uint32_t eventId, VulkanRenderState &state)
     vkr = m_pDriver->vkCreateBuffer(dev, &bufInfo, NULL, &readbackBuffer);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    VkMemoryRequirements mrq = {0};
-    m_pDriver->vkGetBufferMemoryRequirements(dev, meshBuffer, &mrq);
-
-    VkMemoryAllocateInfo allocInfo = {
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, mrq.size,
-        m_pDriver->GetGPULocalMemoryIndex(mrq.memoryTypeBits),
-    };
-
-    vkr = m_pDriver->vkAllocateMemory(dev, &allocInfo, NULL, &meshMem);
+    meshMem =
+        m_pDriver->AllocateMemoryForResource(meshBuffer, MemoryScope::PostVS, MemoryType::GPULocal);
 
-    if(vkr == VK_ERROR_OUT_OF_DEVICE_MEMORY || vkr == VK_ERROR_OUT_OF_HOST_MEMORY)
+    if(meshMem.mem == VK_NULL_HANDLE)
     {
-      RDCWARN("Failed to allocate %llu bytes for output vertex SSBO", mrq.size);
+      RDCWARN("Failed to allocate %llu bytes for output vertex SSBO", bufInfo.size);
       return;
     }
 
+    vkr = m_pDriver->vkBindBufferMemory(dev, meshBuffer, meshMem.mem, meshMem.offs);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    vkr = m_pDriver->vkBindBufferMemory(dev, meshBuffer, meshMem, 0);
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
+    VkMemoryRequirements mrq = {0};
     m_pDriver->vkGetBufferMemoryRequirements(dev, readbackBuffer, &mrq);
 
-    allocInfo.memoryTypeIndex = m_pDriver->GetReadbackMemoryIndex(mrq.memoryTypeBits);
+    VkMemoryAllocateInfo allocInfo = {
+        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, mrq.size,
+        m_pDriver->GetReadbackMemoryIndex(mrq.memoryTypeBits),
+    };
 
     vkr = m_pDriver->vkAllocateMemory(dev, &allocInfo, NULL, &readbackMem);
 
@@ -2716,7 +2786,7 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
   // same event is selected again
   {
     m_PostVS.Data[eventId].gsout.buf = VK_NULL_HANDLE;
-    m_PostVS.Data[eventId].gsout.bufmem = VK_NULL_HANDLE;
+    m_PostVS.Data[eventId].gsout.bufmem = MemoryAllocation();
     m_PostVS.Data[eventId].gsout.instStride = 0;
     m_PostVS.Data[eventId].gsout.vertStride = 0;
     m_PostVS.Data[eventId].gsout.numViews = 1;
@@ -2725,7 +2795,7 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
     m_PostVS.Data[eventId].gsout.useIndices = false;
     m_PostVS.Data[eventId].gsout.hasPosOut = false;
     m_PostVS.Data[eventId].gsout.idxbuf = VK_NULL_HANDLE;
-    m_PostVS.Data[eventId].gsout.idxbufmem = VK_NULL_HANDLE;
+    m_PostVS.Data[eventId].gsout.idxbufmem = MemoryAllocation();
   }
 
   if(!creationInfo.m_RenderPass[state.renderPass].subpasses[state.subpass].multiviews.empty())
@@ -2777,7 +2847,7 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
   {
     // empty vertex output signature
     m_PostVS.Data[eventId].gsout.buf = VK_NULL_HANDLE;
-    m_PostVS.Data[eventId].gsout.bufmem = VK_NULL_HANDLE;
+    m_PostVS.Data[eventId].gsout.bufmem = MemoryAllocation();
     m_PostVS.Data[eventId].gsout.instStride = 0;
     m_PostVS.Data[eventId].gsout.vertStride = 0;
     m_PostVS.Data[eventId].gsout.numViews = 1;
@@ -2786,7 +2856,7 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
     m_PostVS.Data[eventId].gsout.useIndices = false;
     m_PostVS.Data[eventId].gsout.hasPosOut = false;
     m_PostVS.Data[eventId].gsout.idxbuf = VK_NULL_HANDLE;
-    m_PostVS.Data[eventId].gsout.idxbufmem = VK_NULL_HANDLE;
+    m_PostVS.Data[eventId].gsout.idxbufmem = MemoryAllocation();
     return;
   }
 
@@ -2904,7 +2974,7 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
   }
 
   VkBuffer meshBuffer = VK_NULL_HANDLE;
-  VkDeviceMemory meshMem = VK_NULL_HANDLE;
+  MemoryAllocation meshMem;
 
   // start with bare minimum size, which might be enough if no expansion happens
   VkDeviceSize bufferSize = 0;
@@ -2920,10 +2990,10 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
     if(meshBuffer != VK_NULL_HANDLE)
     {
       m_pDriver->vkDestroyBuffer(dev, meshBuffer, NULL);
-      m_pDriver->vkFreeMemory(dev, meshMem, NULL);
+      m_pDriver->FreeMemoryAllocation(meshMem);
 
       meshBuffer = VK_NULL_HANDLE;
-      meshMem = VK_NULL_HANDLE;
+      meshMem = MemoryAllocation();
     }
 
     VkBufferCreateInfo bufInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
@@ -2938,20 +3008,13 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
     vkr = m_pDriver->vkCreateBuffer(dev, &bufInfo, NULL, &meshBuffer);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
-    VkMemoryRequirements mrq = {0};
-    m_pDriver->vkGetBufferMemoryRequirements(dev, meshBuffer, &mrq);
-
-    VkMemoryAllocateInfo allocInfo = {
-        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO, NULL, mrq.size,
-        m_pDriver->GetGPULocalMemoryIndex(mrq.memoryTypeBits),
-    };
-
-    vkr = m_pDriver->vkAllocateMemory(dev, &allocInfo, NULL, &meshMem);
+    meshMem =
+        m_pDriver->AllocateMemoryForResource(meshBuffer, MemoryScope::PostVS, MemoryType::GPULocal);
 
-    if(vkr == VK_ERROR_OUT_OF_DEVICE_MEMORY || vkr == VK_ERROR_OUT_OF_HOST_MEMORY)
+    if(meshMem.mem == VK_NULL_HANDLE)
     {
       RDCWARN("Output allocation for %llu bytes failed fetching tessellation/geometry output.",
-              mrq.size);
+              bufferSize);
 
       m_pDriver->vkDestroyBuffer(dev, meshBuffer, NULL);
 
@@ -2967,9 +3030,7 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
       return;
     }
 
-    RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-    vkr = m_pDriver->vkBindBufferMemory(dev, meshBuffer, meshMem, 0);
+    vkr = m_pDriver->vkBindBufferMemory(dev, meshBuffer, meshMem.mem, meshMem.offs);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
     VkCommandBuffer cmd = m_pDriver->GetNextCmd();
@@ -3233,7 +3294,7 @@ void VulkanReplay::FetchTessGSOut(uint32_t eventId, VulkanRenderState &state)
   m_PostVS.Data[eventId].gsout.instData = instData;
 
   m_PostVS.Data[eventId].gsout.idxbuf = VK_NULL_HANDLE;
-  m_PostVS.Data[eventId].gsout.idxbufmem = VK_NULL_HANDLE;
+  m_PostVS.Data[eventId].gsout.idxbufmem = MemoryAllocation();
 
   m_PostVS.Data[eventId].gsout.hasPosOut = true;
 
@@ -3278,34 +3339,68 @@ void VulkanReplay::InitPostVSBuffers(uint32_t eventId, VulkanRenderState &state)
 
   VkMarkerRegion::End();
 
-  // if there's no tessellation or geometry shader active, bail out now
-  if(pipeInfo.shaders[2].module == ResourceId() && pipeInfo.shaders[3].module == ResourceId())
-    return;
+  // if there's a tessellation or geometry shader active, fetch its output too
+  if(pipeInfo.shaders[2].module != ResourceId() || pipeInfo.shaders[3].module != ResourceId())
+  {
+    VkMarkerRegion::Begin(StringFormat::Fmt("FetchTessGSOut for %u", eventId));
 
-  VkMarkerRegion::Begin(StringFormat::Fmt("FetchTessGSOut for %u", eventId));
+    FetchTessGSOut(eventId, state);
 
-  FetchTessGSOut(eventId, state);
+    VkMarkerRegion::End();
+  }
 
-  VkMarkerRegion::End();
+  AccountPostVSData(eventId);
 }
 
 void VulkanReplay::InitPostVSBuffers(uint32_t eventId)
 {
+  // go through any aliasing
+  if(m_PostVS.Alias.find(eventId) != m_PostVS.Alias.end())
+    eventId = m_PostVS.Alias[eventId];
+
+  // the event fetched on its own is the one being displayed, so keep it regardless of the budget
+  m_PostVS.Pinned = eventId;
+
   InitPostVSBuffers(eventId, m_pDriver->GetRenderState());
+
+  auto it = m_PostVS.Data.find(eventId);
+  if(it != m_PostVS.Data.end())
+    it->second.lastUse = ++m_PostVS.UseCounter;
+
+  TrimPostVSCache();
+}
+
+void VulkanReplay::PrefetchPostVSBuffers(uint32_t eventId, VulkanRenderState &state,
+                                         uint64_t priority)
+{
+  // don't fetch data that would be the first thing evicted
+  if(m_PostVS.Data.find(eventId) == m_PostVS.Data.end() && IsPostVSCacheFull(priority))
+    return;
+
+  InitPostVSBuffers(eventId, state);
+
+  auto it = m_PostVS.Data.find(eventId);
+  if(it != m_PostVS.Data.end())
+    it->second.lastUse = priority;
+
+  TrimPostVSCache();
 }
 
 struct VulkanInitPostVSCallback : public VulkanDrawcallCallback
 {
-  VulkanInitPostVSCallback(WrappedVulkan *vk, const rdcarray<uint32_t> &events)
-      : m_pDriver(vk), m_Events(events)
+  VulkanInitPostVSCallback(WrappedVulkan *vk, const rdcarray<uint32_t> &events,
+                           const std::map<uint32_t, uint64_t> &priorities)
+      : m_pDriver(vk), m_Events(events), m_Priorities(priorities)
   {
     m_pDriver->SetDrawcallCB(this);
   }
   ~VulkanInitPostVSCallback() { m_pDriver->SetDrawcallCB(NULL); }
   void PreDraw(uint32_t eid, VkCommandBuffer cmd)
   {
-    if(m_Events.contains(eid))
-      m_pDriver->GetReplay()->InitPostVSBuffers(eid, m_pDriver->GetCmdRenderState());
+    auto it = m_Priorities.find(eid);
+    if(it != m_Priorities.end())
+      m_pDriver->GetReplay()->PrefetchPostVSBuffers(eid, m_pDriver->GetCmdRenderState(),
+                                                    it->second);
   }
 
   bool PostDraw(uint32_t eid, VkCommandBuffer cmd) { return false; }
@@ -3327,16 +3422,50 @@ struct VulkanInitPostVSCallback : public VulkanDrawcallCallback
 
   WrappedVulkan *m_pDriver;
   const rdcarray<uint32_t> &m_Events;
+  const std::map<uint32_t, uint64_t> &m_Priorities;
 };
 
 void VulkanReplay::InitPostVSBuffers(const rdcarray<uint32_t> &events)
 {
+  // events nearer to the one being displayed are more likely to be looked at next, so prioritise
+  // them. If the pass doesn't fit in the budget the furthest events are the ones left out. All of
+  // these priorities are higher than anything used before, so data from other passes is evicted
+  // first.
+  int32_t pinnedIdx = events.indexOf(m_PostVS.Pinned);
+  if(pinnedIdx < 0)
+    pinnedIdx = 0;
+
+  uint64_t base = m_PostVS.UseCounter + events.size();
+  m_PostVS.UseCounter = base + 1;
+
+  std::map<uint32_t, uint64_t> priorities;
+  bool allCached = true;
+  for(int32_t i = 0; i < events.count(); i++)
+  {
+    uint64_t priority = base - (uint64_t)abs(i - pinnedIdx);
+    priorities[events[i]] = priority;
+
+    uint32_t eventId = events[i];
+    if(m_PostVS.Alias.find(eventId) != m_PostVS.Alias.end())
+      eventId = m_PostVS.Alias[eventId];
+
+    auto it = m_PostVS.Data.find(eventId);
+    if(it != m_PostVS.Data.end())
+      it->second.lastUse = priority;
+    else
+      allCached = false;
+  }
+
+  // no need to replay anything if the whole pass is still cached
+  if(allCached)
+    return;
+
   // first we must replay up to the first event without replaying it. This ensures any
   // non-command buffer calls like memory unmaps etc all happen correctly before this
   // command buffer
   m_pDriver->ReplayLog(0, events.front(), eReplay_WithoutDraw);
 
-  VulkanInitPostVSCallback cb(m_pDriver, events);
+  VulkanInitPostVSCallback cb(m_pDriver, events, priorities);
 
   // now we replay the events, which are guaranteed (because we generated them in
   // GetPassEvents above) to come from the same command buffer, so the event IDs are
@@ -97,6 +97,7 @@ MeshDisplayPipelines VulkanDebugManager::CacheMeshDisplayPipelines(VkPipelineLay
     return cache;
 
   const VkDevDispatchTable *vt = ObjDisp(m_Device);
+  VkPipelineCache pipeCache = m_pDriver->GetReplayPipelineCache();
   VkResult vkr = VK_SUCCESS;
 
   // should we try and evict old pipelines from the cache here?
@@ -310,13 +311,13 @@ MeshDisplayPipelines VulkanDebugManager::CacheMeshDisplayPipelines(VkPipelineLay
     rs.polygonMode = VK_POLYGON_MODE_FILL;
   }
 
-  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), VK_NULL_HANDLE, 1, &pipeInfo, NULL,
+  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), pipeCache, 1, &pipeInfo, NULL,
                                     &cache.pipes[MeshDisplayPipelines::ePipe_Wire]);
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
   ds.depthTestEnable = true;
 
-  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), VK_NULL_HANDLE, 1, &pipeInfo, NULL,
+  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), pipeCache, 1, &pipeInfo, NULL,
                                     &cache.pipes[MeshDisplayPipelines::ePipe_WireDepth]);
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
@@ -324,13 +325,13 @@ MeshDisplayPipelines VulkanDebugManager::CacheMeshDisplayPipelines(VkPipelineLay
   rs.polygonMode = VK_POLYGON_MODE_FILL;
   ds.depthTestEnable = false;
 
-  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), VK_NULL_HANDLE, 1, &pipeInfo, NULL,
+  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), pipeCache, 1, &pipeInfo, NULL,
                                     &cache.pipes[MeshDisplayPipelines::ePipe_Solid]);
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
   ds.depthTestEnable = true;
 
-  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), VK_NULL_HANDLE, 1, &pipeInfo, NULL,
+  vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), pipeCache, 1, &pipeInfo, NULL,
                                     &cache.pipes[MeshDisplayPipelines::ePipe_SolidDepth]);
   RDCASSERTEQUAL(vkr, VK_SUCCESS);
 
@@ -343,7 +344,7 @@ MeshDisplayPipelines VulkanDebugManager::CacheMeshDisplayPipelines(VkPipelineLay
 
     vi.vertexBindingDescriptionCount = 2;
 
-    vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), VK_NULL_HANDLE, 1, &pipeInfo, NULL,
+    vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), pipeCache, 1, &pipeInfo, NULL,
                                       &cache.pipes[MeshDisplayPipelines::ePipe_Secondary]);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
   }
@@ -358,7 +359,7 @@ MeshDisplayPipelines VulkanDebugManager::CacheMeshDisplayPipelines(VkPipelineLay
 
   if(stages[2].module != VK_NULL_HANDLE && ia.topology != VK_PRIMITIVE_TOPOLOGY_POINT_LIST)
   {
-    vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), VK_NULL_HANDLE, 1, &pipeInfo, NULL,
+    vkr = vt->CreateGraphicsPipelines(Unwrap(m_Device), pipeCache, 1, &pipeInfo, NULL,
                                       &cache.pipes[MeshDisplayPipelines::ePipe_Lit]);
     RDCASSERTEQUAL(vkr, VK_SUCCESS);
   }
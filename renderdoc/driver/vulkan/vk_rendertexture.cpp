@@ -145,6 +145,8 @@ bool VulkanReplay::RenderTexture(TextureDisplay cfg)
       NULL,
   };
 
+  m_pDriver->ApplySkippedInitialContents(cfg.resourceId);
+
   LockedConstImageStateRef imageState = m_pDriver->FindConstImageState(cfg.resourceId);
   if(!imageState)
   {
@@ -439,7 +439,7 @@ ShaderReflection *VulkanReplay::GetShader(ResourceId pipeline, ResourceId shader
   // if this shader was never used in a pipeline the reflection won't be prepared. Do that now -
   // this will be ignored if it was already prepared.
   shad->second.GetReflection(entry.name, pipeline)
-      .Init(GetResourceManager(), shader, shad->second.spirv, entry.name,
+      .Init(GetResourceManager(), m_pDriver->m_CreationInfo, shader, shad->second, entry.name,
             VkShaderStageFlagBits(1 << uint32_t(entry.stage)), {});
 
   return &shad->second.GetReflection(entry.name, pipeline).refl;
@@ -947,6 +947,8 @@ void VulkanReplay::RenderHighlightBox(float w, float h, float scale)
 
 void VulkanReplay::GetBufferData(ResourceId buff, uint64_t offset, uint64_t len, bytebuf &retData)
 {
+  m_pDriver->ApplySkippedInitialContents(buff);
+
   GetDebugManager()->GetBufferData(buff, offset, len, retData);
 }
 
@@ -1966,6 +1968,8 @@ void VulkanReplay::FillCBufferVariables(ResourceId pipeline, ResourceId shader,
 void VulkanReplay::PickPixel(ResourceId texture, uint32_t x, uint32_t y, const Subresource &sub,
                              CompType typeCast, float pixel[4])
 {
+  m_pDriver->ApplySkippedInitialContents(texture);
+
   int oldW = m_DebugWidth, oldH = m_DebugHeight;
 
   m_DebugWidth = m_DebugHeight = 1;
@@ -2129,6 +2133,8 @@ void VulkanReplay::PickPixel(ResourceId texture, uint32_t x, uint32_t y, const S
 bool VulkanReplay::GetMinMax(ResourceId texid, const Subresource &sub, CompType typeCast,
                              float *minval, float *maxval)
 {
+  m_pDriver->ApplySkippedInitialContents(texid);
+
   const ImageInfo *imageInfo = NULL;
   {
     LockedConstImageStateRef state = m_pDriver->FindConstImageState(texid);
@@ -2473,6 +2479,8 @@ bool VulkanReplay::GetHistogram(ResourceId texid, const Subresource &sub, CompTy
                                 float minval, float maxval, bool channels[4],
                                 rdcarray<uint32_t> &histogram)
 {
+  m_pDriver->ApplySkippedInitialContents(texid);
+
   if(minval >= maxval)
     return false;
 
@@ -2770,6 +2778,8 @@ rdcarray<EventUsage> VulkanReplay::GetUsage(ResourceId id)
 void VulkanReplay::GetTextureData(ResourceId tex, const Subresource &sub,
                                   const GetTextureDataParams &params, bytebuf &data)
 {
+  m_pDriver->ApplySkippedInitialContents(tex);
+
   bool wasms = false;
   bool resolve = params.resolve;
 
@@ -152,7 +152,7 @@ struct VulkanPostVSData
   struct StageData
   {
     VkBuffer buf;
-    VkDeviceMemory bufmem;
+    MemoryAllocation bufmem;
     VkPrimitiveTopology topo;
 
     int32_t baseVertex;
@@ -168,7 +168,7 @@ struct VulkanPostVSData
 
     bool useIndices;
     VkBuffer idxbuf;
-    VkDeviceMemory idxbufmem;
+    MemoryAllocation idxbufmem;
     VkIndexType idxFmt;
 
     bool hasPosOut;
@@ -177,6 +177,10 @@ struct VulkanPostVSData
     float farPlane;
   } vsin, vsout, gsout;
 
+  // GPU memory used by the buffers above, and a stamp for least-recently-used eviction
+  VkDeviceSize gpuBytes = 0;
+  uint64_t lastUse = 0;
+
   VulkanPostVSData()
   {
     RDCEraseEl(vsin);
@@ -325,6 +329,9 @@ public:
   void InitPostVSBuffers(uint32_t eventId);
   void InitPostVSBuffers(uint32_t eventId, VulkanRenderState &state);
   void InitPostVSBuffers(const rdcarray<uint32_t> &passEvents);
+  // fetches an event's data as part of prefetching a pass, unless the cache is full of data that's
+  // more important than the given priority
+  void PrefetchPostVSBuffers(uint32_t eventId, VulkanRenderState &state, uint64_t priority);
 
   // indicates that EID alias is the same as eventId
   void AliasPostVSBuffers(uint32_t eventId, uint32_t alias) { m_PostVS.Alias[alias] = eventId; }
@@ -369,6 +376,10 @@ public:
 
   rdcarray<PixelModification> PixelHistory(rdcarray<EventUsage> events, ResourceId target, uint32_t x,
                                            uint32_t y, const Subresource &sub, CompType typeCast);
+  rdcarray<PixelRegionHistory> PixelHistoryRegion(rdcarray<EventUsage> events, ResourceId target,
+                                                  uint32_t x, uint32_t y, uint32_t width,
+                                                  uint32_t height, const Subresource &sub,
+                                                  CompType typeCast);
   ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid, uint32_t idx);
   ShaderDebugTrace *DebugPixel(uint32_t eventId, uint32_t x, uint32_t y, uint32_t sample,
                                uint32_t primitive);
@@ -426,6 +437,10 @@ private:
   void FetchVSOut(uint32_t eventId, VulkanRenderState &state);
   void FetchTessGSOut(uint32_t eventId, VulkanRenderState &state);
   void ClearPostVSCache();
+  void DestroyPostVSData(VulkanPostVSData &data);
+  void AccountPostVSData(uint32_t eventId);
+  bool IsPostVSCacheFull(uint64_t priority);
+  void TrimPostVSCache();
 
   void RefreshDerivedReplacements();
 
@@ -685,6 +700,13 @@ private:
 
     std::map<uint32_t, VulkanPostVSData> Data;
     std::map<uint32_t, uint32_t> Alias;
+
+    // total GPU memory used by the buffers in Data
+    VkDeviceSize UsedBytes = 0;
+    // incremented for each use, to stamp entries in Data for LRU eviction
+    uint64_t UseCounter = 0;
+    // the event most recently fetched on its own, which is never evicted
+    uint32_t Pinned = 0;
   } m_PostVS;
 
   struct Feedback
@@ -23,10 +23,20 @@
  ******************************************************************************/
 
 #include "vk_shader_cache.h"
+#include "common/jobsystem.h"
 #include "common/shader_cache.h"
+#include "core/settings.h"
 #include "data/glsl_shaders.h"
 #include "strings/string_utils.h"
 
+RDOC_CONFIG(uint32_t, Vulkan_ReflectionCacheSizeMB, 64,
+            "Maximum size in megabytes of the on-disk cache of shader reflection data that is "
+            "shared between captures. Set to 0 to disable the cache.");
+
+RDOC_CONFIG(uint32_t, Vulkan_PipelineCacheSizeMB, 256,
+            "Maximum size in megabytes of the on-disk driver pipeline cache used on replay. If the "
+            "cache grows past this it is discarded and rebuilt. Set to 0 to disable the cache.");
+
 enum class FeatureCheck
 {
   NoCheck = 0x0,
@@ -118,6 +128,74 @@ struct VulkanBlobShaderCallbacks
   const byte *GetData(SPIRVBlob blob) const { return (const byte *)blob->data(); }
 } VulkanShaderCacheCallbacks;
 
+struct VulkanReflectionCacheCallbacks
+{
+  bool Create(uint32_t size, byte *data, ReflectionBlob *ret) const
+  {
+    RDCASSERT(ret);
+
+    if(size < sizeof(uint64_t))
+      return false;
+
+    *ret = new bytebuf(data, size);
+
+    return true;
+  }
+
+  void Destroy(ReflectionBlob blob) const { delete blob; }
+  uint32_t GetSize(ReflectionBlob blob) const { return (uint32_t)blob->size(); }
+  const byte *GetData(ReflectionBlob blob) const { return blob->data(); }
+  uint64_t GetLastUse(ReflectionBlob blob) const
+  {
+    uint64_t ret;
+    memcpy(&ret, blob->data(), sizeof(ret));
+    return ret;
+  }
+} VulkanReflectionCacheCallbacks;
+
+template <typename SerialiserType>
+static void SerialiseCachedReflection(SerialiserType &ser,
+                                      VulkanCreationInfo::ShaderModuleReflection &el)
+{
+  SERIALISE_MEMBER(refl);
+  SERIALISE_MEMBER(mapping);
+  SERIALISE_MEMBER(patchData);
+}
+
+static uint32_t HashSPIRVSource(const rdcspv::CompilationSettings &settings, const rdcstr &src)
+{
+  uint32_t hash = strhash(src.c_str());
+
+  char typestr[3] = {'a', 'a', 0};
+  typestr[0] += (char)settings.stage;
+  typestr[1] += (char)settings.lang;
+  return strhash(typestr, hash);
+}
+
+// compiles without touching the cache, so this can be called from any thread
+static rdcstr CompileSPIRVBlob(const rdcspv::CompilationSettings &settings, const rdcstr &src,
+                               SPIRVBlob &outBlob)
+{
+  SPIRVBlob spirv = new rdcarray<uint32_t>();
+  rdcstr errors = rdcspv::Compile(settings, {src}, *spirv);
+
+  if(!errors.empty())
+  {
+    rdcstr logerror = errors;
+    if(logerror.length() > 1024)
+      logerror = logerror.substr(0, 1024) + "...";
+
+    RDCWARN("Shader compile error:\n%s", logerror.c_str());
+
+    delete spirv;
+    outBlob = NULL;
+    return errors;
+  }
+
+  outBlob = spirv;
+  return errors;
+}
+
 VulkanShaderCache::VulkanShaderCache(WrappedVulkan *driver)
 {
   // Load shader cache, if present
@@ -127,10 +205,22 @@ VulkanShaderCache::VulkanShaderCache(WrappedVulkan *driver)
   // if we failed to load from the cache
   m_ShaderCacheDirty = !success;
 
+  // application shaders are only reflected on replay
+  if(Vulkan_ReflectionCacheSizeMB > 0 && IsReplayMode(driver->GetState()))
+  {
+    success = LoadShaderCache("vkreflection.cache", m_ReflectionCacheMagic,
+                              GetBuildCacheVersion(m_ReflectionCacheVersion), m_ReflectionCache,
+                              VulkanReflectionCacheCallbacks);
+
+    // a missing or invalid file will be overwritten with whatever we add in this session
+    m_ReflectionCacheDirty = !success;
+  }
+
   m_pDriver = driver;
   m_Device = driver->GetDev();
 
-  SetCaching(true);
+  if(Vulkan_PipelineCacheSizeMB > 0 && IsReplayMode(driver->GetState()))
+    CreatePipelineCache();
 
   VkDriverInfo driverVersion = driver->GetDriverInfo();
   const VkPhysicalDeviceFeatures &features = driver->GetDeviceFeatures();
@@ -141,9 +231,19 @@ VulkanShaderCache::VulkanShaderCache(WrappedVulkan *driver)
   if(driverVersion.RunningOnMetal())
     m_GlobalDefines += "#define METAL_BACKEND\n";
 
-  rdcstr src;
-  rdcspv::CompilationSettings compileSettings;
-  compileSettings.lang = rdcspv::InputLanguage::VulkanGLSL;
+  // the sources are generated and looked up in the cache first, then any misses (e.g. on first
+  // run or after an update) are compiled in parallel, since glslang is by far the most expensive
+  // part of creating the builtin shaders.
+  struct BuiltinCompile
+  {
+    BuiltinShader builtin;
+    rdcspv::CompilationSettings settings;
+    rdcstr src;
+    uint32_t hash;
+    rdcstr errors;
+  };
+
+  rdcarray<BuiltinCompile> compiles;
 
   for(auto i : indices<BuiltinShader>())
   {
@@ -194,39 +294,91 @@ VulkanShaderCache::VulkanShaderCache(WrappedVulkan *driver)
     else if(config.builtin == BuiltinShader::TexRemapSInt)
       defines += rdcstr("#define UINT_TEX 0\n#define SINT_TEX 1\n");
 
-    src = GenerateGLSLShader(GetDynamicEmbeddedResource(config.resource), ShaderType::Vulkan, 430,
-                             defines);
+    BuiltinCompile compile;
+    compile.builtin = config.builtin;
+    compile.settings.lang = rdcspv::InputLanguage::VulkanGLSL;
+    compile.settings.stage = config.stage;
+    compile.src = GenerateGLSLShader(GetDynamicEmbeddedResource(config.resource),
+                                     ShaderType::Vulkan, 430, defines);
+    compile.hash = HashSPIRVSource(compile.settings, compile.src);
+
+    auto it = m_ShaderCache.find(compile.hash);
+    if(it != m_ShaderCache.end())
+      m_BuiltinShaderBlobs[i] = it->second;
+    else
+      compiles.push_back(compile);
+  }
+
+  {
+    auto compileFunc = [this, &compiles](uint32_t c) {
+      BuiltinCompile &compile = compiles[c];
+      compile.errors = CompileSPIRVBlob(compile.settings, compile.src,
+                                        m_BuiltinShaderBlobs[(size_t)compile.builtin]);
+    };
+
+    Threading::JobSystem *jobs = RenderDoc::Inst().GetJobSystem();
+
+    if(jobs && compiles.size() > 1)
+    {
+      jobs->ParallelFor((uint32_t)compiles.size(), compileFunc);
+    }
+    else
+    {
+      for(uint32_t c = 0; c < compiles.size(); c++)
+        compileFunc(c);
+    }
+  }
+
+  for(const BuiltinCompile &compile : compiles)
+  {
+    SPIRVBlob &blob = m_BuiltinShaderBlobs[(size_t)compile.builtin];
 
-    compileSettings.stage = config.stage;
-    rdcstr err = GetSPIRVBlob(compileSettings, src, m_BuiltinShaderBlobs[i]);
+    if(!compile.errors.empty() || blob == VK_NULL_HANDLE)
+    {
+      RDCERR("Error compiling builtin %u: %s", (uint32_t)compile.builtin, compile.errors.c_str());
+      continue;
+    }
 
-    if(!err.empty() || m_BuiltinShaderBlobs[i] == VK_NULL_HANDLE)
+    // two builtins could share identical source, in which case keep the first compiled blob
+    auto it = m_ShaderCache.find(compile.hash);
+    if(it != m_ShaderCache.end())
     {
-      RDCERR("Error compiling builtin %u: %s", (uint32_t)i, err.c_str());
+      delete blob;
+      blob = it->second;
     }
     else
     {
-      VkShaderModuleCreateInfo modinfo = {
-          VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-          NULL,
-          0,
-          m_BuiltinShaderBlobs[i]->size() * sizeof(uint32_t),
-          m_BuiltinShaderBlobs[i]->data(),
-      };
-
-      VkResult vkr =
-          driver->vkCreateShaderModule(m_Device, &modinfo, NULL, &m_BuiltinShaderModules[i]);
-      RDCASSERTEQUAL(vkr, VK_SUCCESS);
-
-      driver->GetResourceManager()->SetInternalResource(GetResID(m_BuiltinShaderModules[i]));
+      m_ShaderCache[compile.hash] = blob;
+      m_ShaderCacheDirty = true;
     }
   }
 
-  SetCaching(false);
+  for(auto i : indices<BuiltinShader>())
+  {
+    if(m_BuiltinShaderBlobs[i] == VK_NULL_HANDLE)
+      continue;
+
+    VkShaderModuleCreateInfo modinfo = {
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        NULL,
+        0,
+        m_BuiltinShaderBlobs[i]->size() * sizeof(uint32_t),
+        m_BuiltinShaderBlobs[i]->data(),
+    };
+
+    VkResult vkr =
+        driver->vkCreateShaderModule(m_Device, &modinfo, NULL, &m_BuiltinShaderModules[i]);
+    RDCASSERTEQUAL(vkr, VK_SUCCESS);
+
+    driver->GetResourceManager()->SetInternalResource(GetResID(m_BuiltinShaderModules[i]));
+  }
 }
 
 VulkanShaderCache::~VulkanShaderCache()
 {
+  if(m_PipelineCache != VK_NULL_HANDLE)
+    SavePipelineCache();
+
   if(m_ShaderCacheDirty)
   {
     SaveShaderCache("vkshaders.cache", m_ShaderCacheMagic, m_ShaderCacheVersion, m_ShaderCache,
@@ -238,21 +390,185 @@ VulkanShaderCache::~VulkanShaderCache()
       VulkanShaderCacheCallbacks.Destroy(it->second);
   }
 
+  if(m_ReflectionCacheDirty)
+  {
+    TrimShaderCache(m_ReflectionCache, uint64_t(Vulkan_ReflectionCacheSizeMB) * 1024 * 1024,
+                    VulkanReflectionCacheCallbacks);
+
+    SaveShaderCache("vkreflection.cache", m_ReflectionCacheMagic,
+                    GetBuildCacheVersion(m_ReflectionCacheVersion), m_ReflectionCache,
+                    VulkanReflectionCacheCallbacks);
+  }
+  else
+  {
+    for(auto it = m_ReflectionCache.begin(); it != m_ReflectionCache.end(); ++it)
+      VulkanReflectionCacheCallbacks.Destroy(it->second);
+  }
+
   for(size_t i = 0; i < ARRAY_COUNT(m_BuiltinShaderModules); i++)
     m_pDriver->vkDestroyShaderModule(m_Device, m_BuiltinShaderModules[i], NULL);
 }
 
+// the driver's cache data is only valid for the device and driver that produced it, so we identify
+// it and check the contents before handing it back.
+struct PipelineCacheFileHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vendorID;
+  uint32_t deviceID;
+  uint32_t driverVersion;
+  uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+  uint64_t dataSize;
+  uint64_t dataHash;
+};
+
+void VulkanShaderCache::CreatePipelineCache()
+{
+  const VkPhysicalDeviceProperties &props = m_pDriver->GetDeviceProps();
+
+  bytebuf initialData;
+
+  FILE *f = FileIO::fopen(FileIO::GetAppFolderFilename("vkpipeline.cache").c_str(), "rb");
+
+  if(f)
+  {
+    PipelineCacheFileHeader header = {};
+
+    if(FileIO::fread(&header, 1, sizeof(header), f) != sizeof(header) ||
+       header.magic != m_PipelineCacheMagic || header.version != m_PipelineCacheVersion)
+    {
+      RDCDEBUG("Out of date or invalid pipeline cache");
+    }
+    else if(header.vendorID != props.vendorID || header.deviceID != props.deviceID ||
+            header.driverVersion != props.driverVersion ||
+            memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+      RDCLOG("Pipeline cache is from a different device or driver, starting a new cache");
+    }
+    else if(header.dataSize <= uint64_t(Vulkan_PipelineCacheSizeMB) * 1024 * 1024)
+    {
+      initialData.resize((size_t)header.dataSize);
+
+      if(FileIO::fread(initialData.data(), 1, initialData.size(), f) != initialData.size() ||
+         XXH64(initialData.data(), initialData.size(), 0) != header.dataHash)
+      {
+        RDCWARN("Pipeline cache is corrupted, starting a new cache");
+        initialData.clear();
+      }
+    }
+
+    FileIO::fclose(f);
+  }
+
+  if(!initialData.empty())
+    m_PipelineCacheHash = XXH64(initialData.data(), initialData.size(), 0);
+
+  VkPipelineCacheCreateInfo cacheInfo = {
+      VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO, NULL, 0, initialData.size(), initialData.data(),
+  };
+
+  VkResult vkr =
+      ObjDisp(m_Device)->CreatePipelineCache(Unwrap(m_Device), &cacheInfo, NULL, &m_PipelineCache);
+
+  if(vkr != VK_SUCCESS && !initialData.empty())
+  {
+    RDCWARN("Couldn't create pipeline cache from stored data: %s", ToStr(vkr).c_str());
+
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = NULL;
+    m_PipelineCacheHash = 0;
+
+    vkr = ObjDisp(m_Device)->CreatePipelineCache(Unwrap(m_Device), &cacheInfo, NULL,
+                                                 &m_PipelineCache);
+  }
+
+  if(vkr != VK_SUCCESS)
+  {
+    RDCERR("Couldn't create pipeline cache: %s", ToStr(vkr).c_str());
+    m_PipelineCache = VK_NULL_HANDLE;
+  }
+}
+
+void VulkanShaderCache::SavePipelineCache()
+{
+  VkDevice dev = Unwrap(m_Device);
+  const VkDevDispatchTable *vt = ObjDisp(m_Device);
+
+  bytebuf data;
+  size_t size = 0;
+  VkResult vkr = vt->GetPipelineCacheData(dev, m_PipelineCache, &size, NULL);
+
+  if(vkr == VK_SUCCESS && size > 0)
+  {
+    data.resize(size);
+    vkr = vt->GetPipelineCacheData(dev, m_PipelineCache, &size, data.data());
+    data.resize(size);
+  }
+
+  vt->DestroyPipelineCache(dev, m_PipelineCache, NULL);
+  m_PipelineCache = VK_NULL_HANDLE;
+
+  if(vkr != VK_SUCCESS || data.empty())
+    return;
+
+  rdcstr filename = FileIO::GetAppFolderFilename("vkpipeline.cache");
+
+  // driver caches can't be trimmed, so once it's too large start again from empty
+  if(data.size() > uint64_t(Vulkan_PipelineCacheSizeMB) * 1024 * 1024)
+  {
+    RDCLOG("Pipeline cache is %llu bytes, over the %u MB limit. Discarding", (uint64_t)data.size(),
+           Vulkan_PipelineCacheSizeMB);
+    FileIO::Delete(filename.c_str());
+    return;
+  }
+
+  uint64_t hash = XXH64(data.data(), data.size(), 0);
+
+  if(hash == m_PipelineCacheHash)
+    return;
+
+  const VkPhysicalDeviceProperties &props = m_pDriver->GetDeviceProps();
+
+  PipelineCacheFileHeader header = {};
+  header.magic = m_PipelineCacheMagic;
+  header.version = m_PipelineCacheVersion;
+  header.vendorID = props.vendorID;
+  header.deviceID = props.deviceID;
+  header.driverVersion = props.driverVersion;
+  memcpy(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE);
+  header.dataSize = data.size();
+  header.dataHash = hash;
+
+  // as with the shader caches, write to a temporary file and move it into place once complete
+  rdcstr tmpfilename = StringFormat::Fmt("%s.%u.tmp", filename.c_str(), Process::GetCurrentPID());
+
+  FILE *f = FileIO::fopen(tmpfilename.c_str(), "wb");
+
+  if(!f)
+  {
+    RDCERR("Error opening pipeline cache for write");
+    return;
+  }
+
+  bool success = FileIO::fwrite(&header, 1, sizeof(header), f) == sizeof(header) &&
+                 FileIO::fwrite(data.data(), 1, data.size(), f) == data.size();
+
+  FileIO::fclose(f);
+
+  if(!success || !FileIO::Move(tmpfilename.c_str(), filename.c_str(), true))
+  {
+    RDCERR("Error writing pipeline cache");
+    FileIO::Delete(tmpfilename.c_str());
+  }
+}
+
 rdcstr VulkanShaderCache::GetSPIRVBlob(const rdcspv::CompilationSettings &settings,
                                        const rdcstr &src, SPIRVBlob &outBlob)
 {
   RDCASSERT(!src.empty());
 
-  uint32_t hash = strhash(src.c_str());
-
-  char typestr[3] = {'a', 'a', 0};
-  typestr[0] += (char)settings.stage;
-  typestr[1] += (char)settings.lang;
-  hash = strhash(typestr, hash);
+  uint32_t hash = HashSPIRVSource(settings, src);
 
   if(m_ShaderCache.find(hash) != m_ShaderCache.end())
   {
@@ -260,31 +576,108 @@ rdcstr VulkanShaderCache::GetSPIRVBlob(const rdcspv::CompilationSettings &settin
     return "";
   }
 
-  SPIRVBlob spirv = new rdcarray<uint32_t>();
-  rdcstr errors = rdcspv::Compile(settings, {src}, *spirv);
+  rdcstr errors = CompileSPIRVBlob(settings, src, outBlob);
 
-  if(!errors.empty())
+  if(outBlob && m_CacheShaders)
   {
-    rdcstr logerror = errors;
-    if(logerror.length() > 1024)
-      logerror = logerror.substr(0, 1024) + "...";
+    m_ShaderCache[hash] = outBlob;
+    m_ShaderCacheDirty = true;
+  }
 
-    RDCWARN("Shader compile error:\n%s", logerror.c_str());
+  return errors;
+}
 
-    delete spirv;
-    outBlob = NULL;
-    return errors;
+bool VulkanShaderCache::GetReflection(const ShaderContentHash &key,
+                                      VulkanCreationInfo::ShaderModuleReflection &refl)
+{
+  if(Vulkan_ReflectionCacheSizeMB == 0)
+    return false;
+
+  SCOPED_LOCK(m_ReflectionCacheLock);
+
+  auto it = m_ReflectionCache.find(key);
+  if(it == m_ReflectionCache.end())
+    return false;
+
+  bytebuf &blob = *it->second;
+
+  {
+    ReadSerialiser ser(
+        new StreamReader(blob.data() + sizeof(uint64_t), blob.size() - sizeof(uint64_t)),
+        Ownership::Stream);
+
+    ser.ReadChunk<uint32_t>();
+    SerialiseCachedReflection(ser, refl);
+    ser.EndChunk();
+
+    if(ser.IsErrored())
+    {
+      RDCWARN("Corrupt reflection cache entry, discarding");
+
+      VulkanReflectionCacheCallbacks.Destroy(it->second);
+      m_ReflectionCache.erase(it);
+      m_ReflectionCacheDirty = true;
+
+      refl.refl = ShaderReflection();
+      refl.mapping = ShaderBindpointMapping();
+      refl.patchData = SPIRVPatchData();
+      return false;
+    }
   }
 
-  outBlob = spirv;
+  // only refresh the LRU timestamp once a day, so that reading a cache doesn't mean re-writing it
+  // every session.
+  uint64_t now = Timing::GetUnixTimestamp();
+  if(now > VulkanReflectionCacheCallbacks.GetLastUse(it->second) + 24 * 60 * 60)
+  {
+    memcpy(blob.data(), &now, sizeof(now));
+    m_ReflectionCacheDirty = true;
+  }
+
+  return true;
+}
+
+void VulkanShaderCache::SetReflection(const ShaderContentHash &key,
+                                      const VulkanCreationInfo::ShaderModuleReflection &refl)
+{
+  if(Vulkan_ReflectionCacheSizeMB == 0)
+    return;
+
+  // don't store the SPIR-V itself or anything else that's specific to this capture
+  VulkanCreationInfo::ShaderModuleReflection stripped;
+  stripped.refl = refl.refl;
+  stripped.refl.rawBytes.clear();
+  stripped.refl.resourceId = ResourceId();
+  stripped.mapping = refl.mapping;
+  stripped.patchData = refl.patchData;
+
+  StreamWriter writer(StreamWriter::DefaultScratchSize);
 
-  if(m_CacheShaders)
   {
-    m_ShaderCache[hash] = spirv;
-    m_ShaderCacheDirty = true;
+    WriteSerialiser ser(&writer, Ownership::Nothing);
+
+    SCOPED_SERIALISE_CHUNK(1);
+    SerialiseCachedReflection(ser, stripped);
   }
 
-  return errors;
+  if(writer.IsErrored())
+    return;
+
+  uint64_t now = Timing::GetUnixTimestamp();
+
+  ReflectionBlob blob = new bytebuf();
+  blob->resize(sizeof(now) + (size_t)writer.GetOffset());
+  memcpy(blob->data(), &now, sizeof(now));
+  memcpy(blob->data() + sizeof(now), writer.GetData(), (size_t)writer.GetOffset());
+
+  SCOPED_LOCK(m_ReflectionCacheLock);
+
+  auto it = m_ReflectionCache.find(key);
+  if(it != m_ReflectionCache.end())
+    VulkanReflectionCacheCallbacks.Destroy(it->second);
+
+  m_ReflectionCache[key] = blob;
+  m_ReflectionCacheDirty = true;
 }
 
 void VulkanShaderCache::MakeGraphicsPipelineInfo(VkGraphicsPipelineCreateInfo &pipeCreateInfo,
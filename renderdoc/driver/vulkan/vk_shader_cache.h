@@ -30,6 +30,9 @@
 
 typedef rdcarray<uint32_t> *SPIRVBlob;
 
+// serialised reflection data, prefixed with a uint64_t timestamp of when it was last used
+typedef bytebuf *ReflectionBlob;
+
 enum class BuiltinShader
 {
   BlitVS,
@@ -77,12 +80,30 @@ public:
   void MakeGraphicsPipelineInfo(VkGraphicsPipelineCreateInfo &pipeCreateInfo, ResourceId pipeline);
   void MakeComputePipelineInfo(VkComputePipelineCreateInfo &pipeCreateInfo, ResourceId pipeline);
 
+  // on replay, a driver pipeline cache that persists between sessions, used for every pipeline we
+  // create. Otherwise or if the cache is disabled this is VK_NULL_HANDLE. This is unwrapped.
+  VkPipelineCache GetPipelineCache() { return m_PipelineCache; }
   rdcstr GetGlobalDefines() { return m_GlobalDefines; }
   void SetCaching(bool enabled) { m_CacheShaders = enabled; }
+  // persistent cache of application shader reflection, keyed by a hash of the SPIR-V, entry point,
+  // stage and specialisation constants. Safe to call from any thread.
+  bool GetReflection(const ShaderContentHash &key, VulkanCreationInfo::ShaderModuleReflection &refl);
+  void SetReflection(const ShaderContentHash &key,
+                     const VulkanCreationInfo::ShaderModuleReflection &refl);
+
 private:
   static const uint32_t m_ShaderCacheMagic = 0xf00d00d5;
   static const uint32_t m_ShaderCacheVersion = 1;
 
+  static const uint32_t m_ReflectionCacheMagic = 0xf00d00d6;
+  static const uint32_t m_ReflectionCacheVersion = 1;
+
+  static const uint32_t m_PipelineCacheMagic = 0xf00d00d7;
+  static const uint32_t m_PipelineCacheVersion = 1;
+
+  void CreatePipelineCache();
+  void SavePipelineCache();
+
   WrappedVulkan *m_pDriver = NULL;
   VkDevice m_Device = VK_NULL_HANDLE;
 
@@ -91,6 +112,14 @@ private:
   bool m_ShaderCacheDirty = false, m_CacheShaders = false;
   std::map<uint32_t, SPIRVBlob> m_ShaderCache;
 
+  Threading::CriticalSection m_ReflectionCacheLock;
+  bool m_ReflectionCacheDirty = false;
+  std::map<ShaderContentHash, ReflectionBlob> m_ReflectionCache;
+
+  VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+  // hash of the data the pipeline cache was created with, so it's only written back if it changed
+  uint64_t m_PipelineCacheHash = 0;
+
   SPIRVBlob m_BuiltinShaderBlobs[arraydim<BuiltinShader>()] = {NULL};
   VkShaderModule m_BuiltinShaderModules[arraydim<BuiltinShader>()] = {VK_NULL_HANDLE};
 };
@@ -221,6 +221,8 @@ rdcstr DoStringise(const MemoryScope &el)
   {
     STRINGISE_ENUM_CLASS(InitialContents);
     STRINGISE_ENUM_CLASS(IndirectReadback);
+    STRINGISE_ENUM_CLASS(PostVS);
+    STRINGISE_ENUM_CLASS(HostInitialContents);
   }
   END_ENUM_STRINGISE()
 }
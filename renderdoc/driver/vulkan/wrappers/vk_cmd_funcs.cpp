@@ -454,6 +454,9 @@ bool WrappedVulkan::Serialise_vkCreateCommandPool(SerialiserType &ser, VkDevice
     // remap the queue family index
     CreateInfo.queueFamilyIndex = m_QueueRemapping[CreateInfo.queueFamilyIndex][0].family;
 
+    // command buffers re-recorded from this pool are reset individually to be reused across replays
+    CreateInfo.flags |= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
     InsertCommandQueueFamily(CmdPool, CreateInfo.queueFamilyIndex);
 
     VkResult ret = ObjDisp(device)->CreateCommandPool(Unwrap(device), &CreateInfo, NULL, &pool);
@@ -814,18 +817,34 @@ bool WrappedVulkan::Serialise_vkBeginCommandBuffer(SerialiserType &ser, VkComman
       if(rerecord)
       {
         VkCommandBuffer cmd = VK_NULL_HANDLE;
-        VkCommandBufferAllocateInfo unwrappedInfo = AllocateInfo;
-        unwrappedInfo.commandPool = Unwrap(unwrappedInfo.commandPool);
-        VkResult ret = ObjDisp(device)->AllocateCommandBuffers(Unwrap(device), &unwrappedInfo, &cmd);
 
-        if(ret != VK_SUCCESS)
+        rdcarray<VkCommandBuffer> &recycled =
+            m_RecycledRerecordCmds[AllocateInfo.level == VK_COMMAND_BUFFER_LEVEL_SECONDARY ? 1 : 0]
+                                  [AllocateInfo.commandPool];
+
+        if(!recycled.empty())
         {
-          RDCERR("Failed on resource serialise-creation, VkResult: %s", ToStr(ret).c_str());
-          return false;
+          cmd = recycled.back();
+          recycled.pop_back();
+
+          ObjDisp(cmd)->ResetCommandBuffer(Unwrap(cmd), 0);
         }
         else
         {
-          GetResourceManager()->WrapResource(Unwrap(device), cmd);
+          VkCommandBufferAllocateInfo unwrappedInfo = AllocateInfo;
+          unwrappedInfo.commandPool = Unwrap(unwrappedInfo.commandPool);
+          VkResult ret =
+              ObjDisp(device)->AllocateCommandBuffers(Unwrap(device), &unwrappedInfo, &cmd);
+
+          if(ret != VK_SUCCESS)
+          {
+            RDCERR("Failed on resource serialise-creation, VkResult: %s", ToStr(ret).c_str());
+            return false;
+          }
+          else
+          {
+            GetResourceManager()->WrapResource(Unwrap(device), cmd);
+          }
         }
 
 #if ENABLED(VERBOSE_PARTIAL_REPLAY)
@@ -2689,7 +2708,7 @@ bool WrappedVulkan::Serialise_vkCmdUpdateBuffer(SerialiserType &ser, VkCommandBu
 
   // serialise as void* so it goes through as a buffer, not an actual array of integers.
   const void *Data = (const void *)pData;
-  SERIALISE_ELEMENT_ARRAY(Data, dataSize);
+  SERIALISE_ELEMENT_ARRAY_IN_PLACE(Data, dataSize);
 
   Serialise_DebugMessages(ser);
 
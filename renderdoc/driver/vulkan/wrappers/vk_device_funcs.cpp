@@ -783,6 +783,15 @@ void WrappedVulkan::Shutdown()
 
   m_PersistentEvents.clear();
 
+  // free the re-recorded command buffers that were kept to be reused
+  for(size_t level = 0; level < ARRAY_COUNT(m_RecycledRerecordCmds); level++)
+  {
+    for(auto it = m_RecycledRerecordCmds[level].begin(); it != m_RecycledRerecordCmds[level].end();
+        ++it)
+      vkFreeCommandBuffers(GetDev(), it->first, (uint32_t)it->second.size(), it->second.data());
+    m_RecycledRerecordCmds[level].clear();
+  }
+
   // since we didn't create proper registered resources for our command buffers,
   // they won't be taken down properly with the pool. So we release them (just our
   // data) here.
@@ -816,6 +825,7 @@ void WrappedVulkan::Shutdown()
     }
   }
 
+  FreeHostInitialContents();
   FreeAllMemory(MemoryScope::InitialContents);
 
   // we do more in Shutdown than the equivalent vkDestroyInstance since on replay there's
@@ -828,10 +838,17 @@ void WrappedVulkan::Shutdown()
 
   m_Replay->DestroyResources();
 
+  LogMemoryStatistics();
+
+  // free any memory blocks still held, such as empty blocks kept around for reuse
+  for(MemoryScope scope : values<MemoryScope>())
+    FreeAllMemory(scope);
+
   m_IndirectBuffer.Destroy();
 
   // destroy debug manager and any objects it created
   SAFE_DELETE(m_DebugManager);
+  m_CreationInfo.m_ReflectionCache = NULL;
   SAFE_DELETE(m_ShaderCache);
 
   if(m_Instance && ObjDisp(m_Instance)->DestroyDebugReportCallbackEXT &&
@@ -3023,6 +3040,8 @@ bool WrappedVulkan::Serialise_vkCreateDevice(SerialiserType &ser, VkPhysicalDevi
 
     m_ShaderCache = new VulkanShaderCache(this);
 
+    m_CreationInfo.m_ReflectionCache = m_ShaderCache;
+
     m_DebugManager = new VulkanDebugManager(this);
 
     m_Replay->CreateResources();
@@ -3544,6 +3563,9 @@ void WrappedVulkan::vkDestroyDevice(VkDevice device, const VkAllocationCallbacks
 
   m_InternalCmds.Reset();
 
+  for(MemoryScope scope : values<MemoryScope>())
+    FreeAllMemory(scope);
+
   m_QueueFamilyIdx = ~0U;
   m_PrevQueue = m_Queue = VK_NULL_HANDLE;
 
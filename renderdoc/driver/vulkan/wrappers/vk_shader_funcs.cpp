@@ -418,7 +418,7 @@ bool WrappedVulkan::Serialise_vkCreateGraphicsPipelines(
     VkRenderPass origRP = CreateInfo.renderPass;
     VkPipelineCache origCache = pipelineCache;
 
-    // don't use pipeline caches on replay
+    // don't use the application's pipeline caches on replay, we have our own persistent cache
     pipelineCache = VK_NULL_HANDLE;
 
     // if we have pipeline executable properties, capture the data
@@ -429,8 +429,8 @@ bool WrappedVulkan::Serialise_vkCreateGraphicsPipelines(
     }
 
     VkGraphicsPipelineCreateInfo *unwrapped = UnwrapInfos(&CreateInfo, 1);
-    VkResult ret = ObjDisp(device)->CreateGraphicsPipelines(Unwrap(device), Unwrap(pipelineCache),
-                                                            1, unwrapped, NULL, &pipe);
+    VkResult ret = ObjDisp(device)->CreateGraphicsPipelines(
+        Unwrap(device), GetReplayPipelineCache(), 1, unwrapped, NULL, &pipe);
 
     if(ret != VK_SUCCESS)
     {
@@ -467,7 +467,7 @@ bool WrappedVulkan::Serialise_vkCreateGraphicsPipelines(
         CreateInfo.subpass = 0;
 
         unwrapped = UnwrapInfos(&CreateInfo, 1);
-        ret = ObjDisp(device)->CreateGraphicsPipelines(Unwrap(device), Unwrap(pipelineCache), 1,
+        ret = ObjDisp(device)->CreateGraphicsPipelines(Unwrap(device), GetReplayPipelineCache(), 1,
                                                        unwrapped, NULL, &pipeInfo.subpass0pipe);
         RDCASSERTEQUAL(ret, VK_SUCCESS);
 
@@ -504,10 +504,15 @@ VkResult WrappedVulkan::vkCreateGraphicsPipelines(VkDevice device, VkPipelineCac
                                                   VkPipeline *pPipelines)
 {
   VkGraphicsPipelineCreateInfo *unwrapped = UnwrapInfos(pCreateInfos, count);
+
+  // our own pipelines created on replay use the persistent pipeline cache
+  VkPipelineCache cache = Unwrap(pipelineCache);
+  if(IsReplayMode(m_State) && cache == VK_NULL_HANDLE)
+    cache = GetReplayPipelineCache();
+
   VkResult ret;
-  SERIALISE_TIME_CALL(
-      ret = ObjDisp(device)->CreateGraphicsPipelines(Unwrap(device), Unwrap(pipelineCache), count,
-                                                     unwrapped, pAllocator, pPipelines));
+  SERIALISE_TIME_CALL(ret = ObjDisp(device)->CreateGraphicsPipelines(
+                          Unwrap(device), cache, count, unwrapped, pAllocator, pPipelines));
 
   if(ret == VK_SUCCESS)
   {
@@ -619,7 +624,7 @@ bool WrappedVulkan::Serialise_vkCreateComputePipelines(SerialiserType &ser, VkDe
 
     VkPipelineCache origCache = pipelineCache;
 
-    // don't use pipeline caches on replay
+    // don't use the application's pipeline caches on replay, we have our own persistent cache
     pipelineCache = VK_NULL_HANDLE;
 
     // if we have pipeline executable properties, capture the data
@@ -630,8 +635,8 @@ bool WrappedVulkan::Serialise_vkCreateComputePipelines(SerialiserType &ser, VkDe
     }
 
     VkComputePipelineCreateInfo *unwrapped = UnwrapInfos(&CreateInfo, 1);
-    VkResult ret = ObjDisp(device)->CreateComputePipelines(Unwrap(device), Unwrap(pipelineCache), 1,
-                                                           unwrapped, NULL, &pipe);
+    VkResult ret = ObjDisp(device)->CreateComputePipelines(
+        Unwrap(device), GetReplayPipelineCache(), 1, unwrapped, NULL, &pipe);
 
     if(ret != VK_SUCCESS)
     {
@@ -684,10 +689,15 @@ VkResult WrappedVulkan::vkCreateComputePipelines(VkDevice device, VkPipelineCach
                                                  const VkAllocationCallbacks *pAllocator,
                                                  VkPipeline *pPipelines)
 {
+  // our own pipelines created on replay use the persistent pipeline cache
+  VkPipelineCache cache = Unwrap(pipelineCache);
+  if(IsReplayMode(m_State) && cache == VK_NULL_HANDLE)
+    cache = GetReplayPipelineCache();
+
   VkResult ret;
   SERIALISE_TIME_CALL(ret = ObjDisp(device)->CreateComputePipelines(
-                          Unwrap(device), Unwrap(pipelineCache), count,
-                          UnwrapInfos(pCreateInfos, count), pAllocator, pPipelines));
+                          Unwrap(device), cache, count, UnwrapInfos(pCreateInfos, count),
+                          pAllocator, pPipelines));
 
   if(ret == VK_SUCCESS)
   {
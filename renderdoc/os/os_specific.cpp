@@ -115,6 +115,26 @@ rdcstr OSUtility::MakeMachineIdentString(uint64_t ident)
   return ret;
 }
 
+uint32_t Network::Socket::ReadQueuedData(void *data, uint32_t length)
+{
+  size_t avail = recvQueue.size() - recvQueueOffset;
+  uint32_t ret = avail < length ? (uint32_t)avail : length;
+
+  if(ret > 0)
+  {
+    memcpy(data, recvQueue.data() + recvQueueOffset, ret);
+    recvQueueOffset += ret;
+
+    if(recvQueueOffset == recvQueue.size())
+    {
+      recvQueue.clear();
+      recvQueueOffset = 0;
+    }
+  }
+
+  return ret;
+}
+
 #if ENABLED(ENABLE_UNIT_TESTS)
 
 #include "catch/catch.hpp"
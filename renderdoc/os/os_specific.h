@@ -137,6 +137,25 @@ public:
   data m_Data;
 };
 
+template <class data>
+class SemaphoreTemplate
+{
+public:
+  SemaphoreTemplate();
+  ~SemaphoreTemplate();
+
+  // increment the count, waking up to that many waiting threads
+  void Release(uint32_t count = 1);
+  // block until the count is non-zero, then decrement it
+  void Wait();
+
+  // no copying
+  SemaphoreTemplate &operator=(const SemaphoreTemplate &other) = delete;
+  SemaphoreTemplate(const SemaphoreTemplate &other) = delete;
+
+  data m_Data;
+};
+
 void Init();
 void Shutdown();
 uint64_t AllocateTLSSlot();
@@ -155,6 +174,7 @@ void JoinThread(ThreadHandle handle);
 void DetachThread(ThreadHandle handle);
 void CloseThread(ThreadHandle handle);
 void Sleep(uint32_t milliseconds);
+uint32_t NumberOfCores();
 
 // kind of windows specific, to handle this case:
 // http://blogs.msdn.com/b/oldnewthing/archive/2013/11/05/10463645.aspx
@@ -181,18 +201,54 @@ public:
 
   bool IsRecvDataWaiting();
 
+  // when enabled, anything the other side sends while a send is waiting is read into a queue that
+  // later receives are served from, so two sides sending to each other at once can't deadlock -
+  // e.g. when requests are pipelined ahead of their responses. That means the socket can't be sent
+  // on and received from by different threads at the same time, so it's off by default.
+  void SetQueueIncomingWhileSending(bool queue) { queueWhileSending = queue; }
+
+  // the socket itself is always non-blocking, these wait for the whole transfer until there's been
+  // no progress for the timeout.
   bool SendDataBlocking(const void *buf, uint32_t length);
   bool RecvDataBlocking(void *data, uint32_t length);
   bool RecvDataNonBlocking(void *data, uint32_t &length);
 
 private:
+  enum class WaitResult
+  {
+    Ready,
+    Timeout,
+    Error,
+  };
+
+  // waits for the socket to be writable (or readable). If enabled, any incoming data is queued
+  // while waiting to write.
+  WaitResult WaitForIO(bool write, uint32_t timeoutMilliseconds);
+  bool QueueIncomingData();
+  uint32_t ReadQueuedData(void *data, uint32_t length);
+
   ptrdiff_t socket;
   uint32_t timeoutMS;
+
+  rdcarray<byte> recvQueue;
+  size_t recvQueueOffset = 0;
+  bool queueWhileSending = false;
 };
 
 Socket *CreateServerSocket(const char *addr, uint16_t port, int queuesize);
 Socket *CreateClientSocket(const char *host, uint16_t port, int timeoutMS);
 
+// a named block of memory that can be mapped by other processes on the same machine. Open returns
+// NULL if no block with that name exists here, e.g. because the creator is on another machine.
+// The creator can unlink the name once the other side has opened it, so that nothing is left
+// behind if either process dies, and existing mappings stay valid until closed.
+struct SharedMemory;
+SharedMemory *CreateSharedMemory(const rdcstr &name, uint64_t size);
+SharedMemory *OpenSharedMemory(const rdcstr &name, uint64_t size);
+void *GetSharedMemoryData(SharedMemory *mem);
+void UnlinkSharedMemory(SharedMemory *mem);
+void CloseSharedMemory(SharedMemory *mem);
+
 // ip is packed in HOST byte order
 inline uint32_t GetIPOctet(uint32_t ip, uint32_t octet)
 {
@@ -230,6 +286,7 @@ int64_t Inc64(volatile int64_t *i);
 int64_t Dec64(volatile int64_t *i);
 int64_t ExchAdd64(volatile int64_t *i, int64_t a);
 int32_t CmpExch32(volatile int32_t *dest, int32_t oldVal, int32_t newVal);
+int64_t CmpExch64(volatile int64_t *dest, int64_t oldVal, int64_t newVal);
 };
 
 namespace Callstack
@@ -296,6 +353,8 @@ uint64_t GetFileSize(const rdcstr &filename);
 bool Copy(const char *from, const char *to, bool allowOverwrite);
 bool Move(const char *from, const char *to, bool allowOverwrite);
 void Delete(const char *path);
+// deletes a directory, which must be empty
+void DeleteDirectory(const char *path);
 void GetFilesInDirectory(const char *path, rdcarray<PathEntry> &entries);
 
 FILE *fopen(const char *filename, const char *mode);
@@ -329,6 +388,14 @@ void logfile_close(LogFileHandle *logHandle, const char *deleteFilename);
 // whole of the file at some point. Useful since normal file reading may fail on the shared logfile
 rdcstr logfile_readall(const char *filename);
 
+// map a read-only view of length bytes at offset in an open file. Returns NULL if the file can't be
+// mapped, in which case it should be read normally. The mapping stays valid after the file is
+// closed, until fmap_close.
+struct FileMapping;
+FileMapping *fmap_open(FILE *f, uint64_t offset, uint64_t length);
+const void *fmap_data(FileMapping *mapping);
+void fmap_close(FileMapping *mapping);
+
 // utility functions
 inline bool WriteAll(const char *filename, const void *buffer, size_t size)
 {
@@ -27,16 +27,20 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include "api/replay/data_types.h"
 #include "common/common.h"
 #include "common/formatting.h"
+#include "common/timing.h"
 #include "os/os_specific.h"
 #include "strings/string_utils.h"
 
@@ -140,6 +144,74 @@ Socket *Socket::AcceptClient(uint32_t timeoutMilliseconds)
   return NULL;
 }
 
+Socket::WaitResult Socket::WaitForIO(bool write, uint32_t timeoutMilliseconds)
+{
+  pollfd pfd = {};
+  pfd.fd = (int)socket;
+  pfd.events = write ? POLLOUT : POLLIN;
+  if(write && queueWhileSending)
+    pfd.events |= POLLIN;
+
+  int ret = poll(&pfd, 1, (int)timeoutMilliseconds);
+
+  if(ret == 0)
+    return WaitResult::Timeout;
+
+  if(ret < 0)
+  {
+    int err = errno;
+
+    // treat EINTR as ready, the caller will try again
+    if(err == EINTR)
+      return WaitResult::Ready;
+
+    RDCWARN("poll: %s", errno_string(err).c_str());
+    Shutdown();
+    return WaitResult::Error;
+  }
+
+  // read anything the other side is sending so that it can make progress and eventually read
+  // what we're sending
+  if(write && queueWhileSending && (pfd.revents & POLLIN) && !QueueIncomingData())
+    return WaitResult::Error;
+
+  return WaitResult::Ready;
+}
+
+bool Socket::QueueIncomingData()
+{
+  byte buf[64 * 1024];
+
+  for(;;)
+  {
+    int ret = recv(socket, (char *)buf, sizeof(buf), 0);
+
+    if(ret > 0)
+    {
+      recvQueue.append(buf, (size_t)ret);
+      continue;
+    }
+
+    if(ret == 0)
+    {
+      Shutdown();
+      return false;
+    }
+
+    int err = errno;
+
+    if(err == EINTR)
+      continue;
+
+    if(err == EWOULDBLOCK || err == EAGAIN)
+      return true;
+
+    RDCWARN("recv: %s", errno_string(err).c_str());
+    Shutdown();
+    return false;
+  }
+}
+
 bool Socket::SendDataBlocking(const void *buf, uint32_t length)
 {
   if(length == 0)
@@ -149,54 +221,46 @@ bool Socket::SendDataBlocking(const void *buf, uint32_t length)
 
   char *src = (char *)buf;
 
-  int flags = fcntl(socket, F_GETFL, 0);
-  fcntl(socket, F_SETFL, flags & ~O_NONBLOCK);
-
-  timeval oldtimeout = {0};
-  socklen_t len = sizeof(oldtimeout);
-  getsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (char *)&oldtimeout, &len);
-
-  timeval timeout = {0};
-  timeout.tv_sec = (timeoutMS / 1000);
-  timeout.tv_usec = (timeoutMS % 1000) * 1000;
-  setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
+  // time since we last made progress
+  PerformanceTimer timer;
 
   while(sent < length)
   {
     int ret = send(socket, src, length - sent, 0);
 
-    if(ret <= 0)
+    if(ret > 0)
     {
-      int err = errno;
+      sent += ret;
+      src += ret;
+      timer.Restart();
+      continue;
+    }
 
-      if(err == EINTR)
-      {
-        // if we hit EINTR, just try again completely. Technically this restarts the timeout but we
-        // expect EINTR to be rare so it's not a big deal.
-        continue;
-      }
-      else if(err == EWOULDBLOCK || err == EAGAIN)
-      {
-        RDCWARN("Timeout in send");
-        Shutdown();
-        return false;
-      }
-      else
-      {
-        RDCWARN("send: %s", errno_string(err).c_str());
-        Shutdown();
-        return false;
-      }
+    int err = errno;
+
+    if(err == EINTR)
+      continue;
+
+    if(err != EWOULDBLOCK && err != EAGAIN)
+    {
+      RDCWARN("send: %s", errno_string(err).c_str());
+      Shutdown();
+      return false;
     }
 
-    sent += ret;
-    src += ret;
-  }
+    double remaining = double(timeoutMS) - timer.GetMilliseconds();
 
-  flags = fcntl(socket, F_GETFL, 0);
-  fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+    WaitResult wait = remaining > 0.0 ? WaitForIO(true, uint32_t(remaining)) : WaitResult::Timeout;
 
-  setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&oldtimeout, sizeof(oldtimeout));
+    if(wait == WaitResult::Timeout)
+    {
+      RDCWARN("Timeout in send");
+      Shutdown();
+    }
+
+    if(wait != WaitResult::Ready)
+      return false;
+  }
 
   RDCASSERT(sent == length);
 
@@ -208,6 +272,9 @@ bool Socket::SendDataBlocking(const void *buf, uint32_t length)
 
 bool Socket::IsRecvDataWaiting()
 {
+  if(recvQueueOffset < recvQueue.size())
+    return true;
+
   char dummy;
   int ret = recv(socket, &dummy, 1, MSG_PEEK);
 
@@ -240,7 +307,14 @@ bool Socket::RecvDataNonBlocking(void *buf, uint32_t &length)
   if(length == 0)
     return true;
 
-  // socket is already blocking, don't have to change anything
+  // return queued data first, the socket can be read next time
+  if(recvQueueOffset < recvQueue.size())
+  {
+    length = ReadQueuedData(buf, length);
+    return true;
+  }
+
+  // socket is already non-blocking, don't have to change anything
   int ret = recv(socket, (char *)buf, length, 0);
 
   if(ret > 0)
@@ -272,63 +346,56 @@ bool Socket::RecvDataBlocking(void *buf, uint32_t length)
   if(length == 0)
     return true;
 
-  uint32_t received = 0;
-
-  char *dst = (char *)buf;
+  uint32_t received = ReadQueuedData(buf, length);
 
-  int flags = fcntl(socket, F_GETFL, 0);
-  fcntl(socket, F_SETFL, flags & ~O_NONBLOCK);
+  char *dst = (char *)buf + received;
 
-  timeval oldtimeout = {0};
-  socklen_t len = sizeof(oldtimeout);
-  getsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&oldtimeout, &len);
-
-  timeval timeout = {0};
-  timeout.tv_sec = (timeoutMS / 1000);
-  timeout.tv_usec = (timeoutMS % 1000) * 1000;
-  setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+  // time since we last made progress
+  PerformanceTimer timer;
 
   while(received < length)
   {
     int ret = recv(socket, dst, length - received, 0);
 
+    if(ret > 0)
+    {
+      received += ret;
+      dst += ret;
+      timer.Restart();
+      continue;
+    }
+
     if(ret == 0)
     {
       Shutdown();
       return false;
     }
-    else if(ret <= 0)
-    {
-      int err = errno;
 
-      if(err == EINTR)
-      {
-        // if we hit EINTR, just try again completely. Technically this restarts the timeout but we
-        // expect EINTR to be rare so it's not a big deal.
-        continue;
-      }
-      else if(err == EWOULDBLOCK || err == EAGAIN)
-      {
-        RDCWARN("Timeout in recv");
-        Shutdown();
-        return false;
-      }
-      else
-      {
-        RDCWARN("recv: %s", errno_string(err).c_str());
-        Shutdown();
-        return false;
-      }
+    int err = errno;
+
+    if(err == EINTR)
+      continue;
+
+    if(err != EWOULDBLOCK && err != EAGAIN)
+    {
+      RDCWARN("recv: %s", errno_string(err).c_str());
+      Shutdown();
+      return false;
     }
 
-    received += ret;
-    dst += ret;
-  }
+    double remaining = double(timeoutMS) - timer.GetMilliseconds();
 
-  flags = fcntl(socket, F_GETFL, 0);
-  fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+    WaitResult wait = remaining > 0.0 ? WaitForIO(false, uint32_t(remaining)) : WaitResult::Timeout;
+
+    if(wait == WaitResult::Timeout)
+    {
+      RDCWARN("Timeout in recv");
+      Shutdown();
+    }
 
-  setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&oldtimeout, sizeof(oldtimeout));
+    if(wait != WaitResult::Ready)
+      return false;
+  }
 
   RDCASSERT(received == length);
 
@@ -533,4 +600,122 @@ bool ParseIPRangeCIDR(const char *str, uint32_t &ip, uint32_t &mask)
 
   return true;
 }
+
+struct SharedMemory
+{
+  rdcstr name;
+  void *data;
+  size_t size;
+  bool owner;
+};
+
+// shm_open names must start with a slash and have no others
+static rdcstr SharedMemoryName(const rdcstr &name)
+{
+  return "/" + name;
+}
+
+static SharedMemory *MapSharedMemory(const rdcstr &name, uint64_t size, bool create)
+{
+#if ENABLED(RDOC_ANDROID)
+  // bionic has no shm_open, and the other end of a connection is never on the same device
+  (void)name;
+  (void)size;
+  (void)create;
+  return NULL;
+#else
+  if(size == 0 || size > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  rdcstr shmName = SharedMemoryName(name);
+
+  int fd = shm_open(shmName.c_str(), create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+
+  if(fd < 0)
+  {
+    if(create)
+      RDCWARN("Couldn't create shared memory '%s': %s", shmName.c_str(),
+              errno_string(errno).c_str());
+    return NULL;
+  }
+
+  if(create && ftruncate(fd, (off_t)size) != 0)
+  {
+    RDCWARN("Couldn't size shared memory '%s' to %llu bytes: %s", shmName.c_str(), size,
+            errno_string(errno).c_str());
+    close(fd);
+    shm_unlink(shmName.c_str());
+    return NULL;
+  }
+
+  // the size comes from the other process, make sure the object really is that large. Touching
+  // pages mapped past the end of it would raise SIGBUS instead of failing here.
+  if(!create)
+  {
+    struct stat st = {};
+    if(fstat(fd, &st) != 0 || st.st_size < 0 || (uint64_t)st.st_size < size)
+    {
+      RDCWARN("Shared memory '%s' is smaller than the expected %llu bytes", shmName.c_str(), size);
+      close(fd);
+      return NULL;
+    }
+  }
+
+  void *data = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // the mapping keeps the memory alive, we don't need the descriptor
+  close(fd);
+
+  if(data == MAP_FAILED)
+  {
+    RDCWARN("Couldn't map shared memory '%s': %s", shmName.c_str(), errno_string(errno).c_str());
+    if(create)
+      shm_unlink(shmName.c_str());
+    return NULL;
+  }
+
+  SharedMemory *ret = new SharedMemory;
+  ret->name = shmName;
+  ret->data = data;
+  ret->size = (size_t)size;
+  ret->owner = create;
+  return ret;
+#endif
+}
+
+SharedMemory *CreateSharedMemory(const rdcstr &name, uint64_t size)
+{
+  return MapSharedMemory(name, size, true);
+}
+
+SharedMemory *OpenSharedMemory(const rdcstr &name, uint64_t size)
+{
+  return MapSharedMemory(name, size, false);
+}
+
+void *GetSharedMemoryData(SharedMemory *mem)
+{
+  return mem ? mem->data : NULL;
+}
+
+void UnlinkSharedMemory(SharedMemory *mem)
+{
+#if DISABLED(RDOC_ANDROID)
+  if(mem && mem->owner)
+  {
+    shm_unlink(mem->name.c_str());
+    mem->owner = false;
+  }
+#endif
+}
+
+void CloseSharedMemory(SharedMemory *mem)
+{
+  if(mem == NULL)
+    return;
+
+  UnlinkSharedMemory(mem);
+  munmap(mem->data, mem->size);
+  delete mem;
+}
 };
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -327,6 +328,11 @@ void Delete(const char *path)
   unlink(path);
 }
 
+void DeleteDirectory(const char *path)
+{
+  rmdir(path);
+}
+
 void GetFilesInDirectory(const char *path, rdcarray<PathEntry> &ret)
 {
   ret.clear();
@@ -450,6 +456,56 @@ int fclose(FILE *f)
   return ::fclose(f);
 }
 
+struct FileMapping
+{
+  void *base;
+  size_t size;
+  const byte *data;
+};
+
+FileMapping *fmap_open(FILE *f, uint64_t offset, uint64_t length)
+{
+  if(f == NULL || length == 0)
+    return NULL;
+
+  // mmap offsets must be page aligned, so map from the page containing offset
+  uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t alignedOffset = offset - (offset % pageSize);
+  uint64_t mapSize = length + (offset - alignedOffset);
+
+  if(mapSize > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  void *base =
+      ::mmap(NULL, (size_t)mapSize, PROT_READ, MAP_PRIVATE, ::fileno(f), (off_t)alignedOffset);
+
+  if(base == MAP_FAILED)
+  {
+    RDCWARN("Couldn't map %llu bytes of file: %d", length, errno);
+    return NULL;
+  }
+
+  FileMapping *ret = new FileMapping;
+  ret->base = base;
+  ret->size = (size_t)mapSize;
+  ret->data = (const byte *)base + (offset - alignedOffset);
+  return ret;
+}
+
+const void *fmap_data(FileMapping *mapping)
+{
+  return mapping ? mapping->data : NULL;
+}
+
+void fmap_close(FileMapping *mapping)
+{
+  if(mapping == NULL)
+    return;
+
+  ::munmap(mapping->base, mapping->size);
+  delete mapping;
+}
+
 bool exists(const char *filename)
 {
   struct ::stat st;
@@ -70,6 +70,11 @@ int32_t CmpExch32(volatile int32_t *dest, int32_t oldVal, int32_t newVal)
 {
   return __sync_val_compare_and_swap(dest, oldVal, newVal);
 }
+
+int64_t CmpExch64(volatile int64_t *dest, int64_t oldVal, int64_t newVal)
+{
+  return __sync_val_compare_and_swap(dest, oldVal, newVal);
+}
 };
 
 namespace Threading
@@ -157,6 +162,43 @@ void RWLock::ReadUnlock()
   pthread_rwlock_unlock(&m_Data.rwlock);
 }
 
+template <>
+Semaphore::SemaphoreTemplate()
+{
+  pthread_mutex_init(&m_Data.lock, NULL);
+  pthread_cond_init(&m_Data.cond, NULL);
+  m_Data.count = 0;
+}
+
+template <>
+Semaphore::~SemaphoreTemplate()
+{
+  pthread_cond_destroy(&m_Data.cond);
+  pthread_mutex_destroy(&m_Data.lock);
+}
+
+template <>
+void Semaphore::Release(uint32_t count)
+{
+  pthread_mutex_lock(&m_Data.lock);
+  m_Data.count += count;
+  if(count == 1)
+    pthread_cond_signal(&m_Data.cond);
+  else
+    pthread_cond_broadcast(&m_Data.cond);
+  pthread_mutex_unlock(&m_Data.lock);
+}
+
+template <>
+void Semaphore::Wait()
+{
+  pthread_mutex_lock(&m_Data.lock);
+  while(m_Data.count == 0)
+    pthread_cond_wait(&m_Data.cond, &m_Data.lock);
+  m_Data.count--;
+  pthread_mutex_unlock(&m_Data.lock);
+}
+
 struct ThreadInitData
 {
   std::function<void()> entryFunc;
@@ -303,4 +345,10 @@ void Sleep(uint32_t milliseconds)
 {
   usleep(milliseconds * 1000);
 }
+
+uint32_t NumberOfCores()
+{
+  long ret = sysconf(_SC_NPROCESSORS_ONLN);
+  return ret > 0 ? (uint32_t)ret : 1;
+}
 };
@@ -28,6 +28,7 @@
 #include "api/replay/stringise.h"
 #include "common/common.h"
 #include "common/formatting.h"
+#include "common/timing.h"
 #include "os/os_specific.h"
 
 #ifndef WSA_FLAG_NO_HANDLE_INHERIT
@@ -180,6 +181,65 @@ Socket *Socket::AcceptClient(uint32_t timeoutMilliseconds)
   return NULL;
 }
 
+Socket::WaitResult Socket::WaitForIO(bool write, uint32_t timeoutMilliseconds)
+{
+  WSAPOLLFD pfd = {};
+  pfd.fd = (SOCKET)socket;
+  pfd.events = write ? POLLOUT : POLLIN;
+  if(write && queueWhileSending)
+    pfd.events |= POLLIN;
+
+  int ret = WSAPoll(&pfd, 1, (INT)timeoutMilliseconds);
+
+  if(ret == 0)
+    return WaitResult::Timeout;
+
+  if(ret == SOCKET_ERROR)
+  {
+    RDCWARN("WSAPoll: %s", wsaerr_string(WSAGetLastError()).c_str());
+    Shutdown();
+    return WaitResult::Error;
+  }
+
+  // read anything the other side is sending so that it can make progress and eventually read
+  // what we're sending
+  if(write && queueWhileSending && (pfd.revents & POLLIN) && !QueueIncomingData())
+    return WaitResult::Error;
+
+  return WaitResult::Ready;
+}
+
+bool Socket::QueueIncomingData()
+{
+  byte buf[64 * 1024];
+
+  for(;;)
+  {
+    int ret = recv(socket, (char *)buf, sizeof(buf), 0);
+
+    if(ret > 0)
+    {
+      recvQueue.append(buf, (size_t)ret);
+      continue;
+    }
+
+    if(ret == 0)
+    {
+      Shutdown();
+      return false;
+    }
+
+    int err = WSAGetLastError();
+
+    if(err == WSAEWOULDBLOCK)
+      return true;
+
+    RDCWARN("recv: %s", wsaerr_string(err).c_str());
+    Shutdown();
+    return false;
+  }
+}
+
 bool Socket::SendDataBlocking(const void *buf, uint32_t length)
 {
   if(length == 0)
@@ -189,46 +249,43 @@ bool Socket::SendDataBlocking(const void *buf, uint32_t length)
 
   char *src = (char *)buf;
 
-  u_long enable = 0;
-  ioctlsocket(socket, FIONBIO, &enable);
-
-  DWORD oldtimeout = 0;
-  int len = sizeof(oldtimeout);
-  getsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (char *)&oldtimeout, &len);
-
-  DWORD timeout = timeoutMS;
-  setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout));
+  // time since we last made progress
+  PerformanceTimer timer;
 
   while(sent < length)
   {
     int ret = send(socket, src, length - sent, 0);
 
-    if(ret <= 0)
+    if(ret > 0)
     {
-      int err = WSAGetLastError();
+      sent += ret;
+      src += ret;
+      timer.Restart();
+      continue;
+    }
 
-      if(err == WSAEWOULDBLOCK || err == WSAETIMEDOUT)
-      {
-        RDCWARN("Timeout in send");
-        Shutdown();
-        return false;
-      }
-      else
-      {
-        RDCWARN("send: %s", wsaerr_string(err).c_str());
-        Shutdown();
-        return false;
-      }
+    int err = WSAGetLastError();
+
+    if(err != WSAEWOULDBLOCK)
+    {
+      RDCWARN("send: %s", wsaerr_string(err).c_str());
+      Shutdown();
+      return false;
     }
 
-    sent += ret;
-    src += ret;
-  }
+    double remaining = double(timeoutMS) - timer.GetMilliseconds();
 
-  enable = 1;
-  ioctlsocket(socket, FIONBIO, &enable);
+    WaitResult wait = remaining > 0.0 ? WaitForIO(true, uint32_t(remaining)) : WaitResult::Timeout;
 
-  setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char *)&oldtimeout, sizeof(oldtimeout));
+    if(wait == WaitResult::Timeout)
+    {
+      RDCWARN("Timeout in send");
+      Shutdown();
+    }
+
+    if(wait != WaitResult::Ready)
+      return false;
+  }
 
   RDCASSERT(sent == length);
 
@@ -237,6 +294,9 @@ bool Socket::SendDataBlocking(const void *buf, uint32_t length)
 
 bool Socket::IsRecvDataWaiting()
 {
+  if(recvQueueOffset < recvQueue.size())
+    return true;
+
   char dummy;
   int ret = recv(socket, &dummy, 1, MSG_PEEK);
 
@@ -269,7 +329,14 @@ bool Socket::RecvDataNonBlocking(void *buf, uint32_t &length)
   if(length == 0)
     return true;
 
-  // socket is already blocking, don't have to change anything
+  // return queued data first, the socket can be read next time
+  if(recvQueueOffset < recvQueue.size())
+  {
+    length = ReadQueuedData(buf, length);
+    return true;
+  }
+
+  // socket is already non-blocking, don't have to change anything
   int ret = recv(socket, (char *)buf, length, 0);
 
   if(ret > 0)
@@ -301,55 +368,53 @@ bool Socket::RecvDataBlocking(void *buf, uint32_t length)
   if(length == 0)
     return true;
 
-  uint32_t received = 0;
-
-  char *dst = (char *)buf;
+  uint32_t received = ReadQueuedData(buf, length);
 
-  u_long enable = 0;
-  ioctlsocket(socket, FIONBIO, &enable);
+  char *dst = (char *)buf + received;
 
-  DWORD oldtimeout = 0;
-  int len = sizeof(oldtimeout);
-  getsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&oldtimeout, &len);
-
-  DWORD timeout = timeoutMS;
-  setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout));
+  // time since we last made progress
+  PerformanceTimer timer;
 
   while(received < length)
   {
     int ret = recv(socket, dst, length - received, 0);
 
+    if(ret > 0)
+    {
+      received += ret;
+      dst += ret;
+      timer.Restart();
+      continue;
+    }
+
     if(ret == 0)
     {
       Shutdown();
       return false;
     }
-    else if(ret <= 0)
-    {
-      int err = WSAGetLastError();
 
-      if(err == WSAEWOULDBLOCK || err == WSAETIMEDOUT)
-      {
-        RDCWARN("Timeout in recv");
-        Shutdown();
-        return false;
-      }
-      else
-      {
-        RDCWARN("recv: %s", wsaerr_string(err).c_str());
-        Shutdown();
-        return false;
-      }
+    int err = WSAGetLastError();
+
+    if(err != WSAEWOULDBLOCK)
+    {
+      RDCWARN("recv: %s", wsaerr_string(err).c_str());
+      Shutdown();
+      return false;
     }
 
-    received += ret;
-    dst += ret;
-  }
+    double remaining = double(timeoutMS) - timer.GetMilliseconds();
+
+    WaitResult wait = remaining > 0.0 ? WaitForIO(false, uint32_t(remaining)) : WaitResult::Timeout;
 
-  enable = 1;
-  ioctlsocket(socket, FIONBIO, &enable);
+    if(wait == WaitResult::Timeout)
+    {
+      RDCWARN("Timeout in recv");
+      Shutdown();
+    }
 
-  setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char *)&oldtimeout, sizeof(oldtimeout));
+    if(wait != WaitResult::Ready)
+      return false;
+  }
 
   RDCASSERT(received == length);
 
@@ -518,4 +583,99 @@ bool ParseIPRangeCIDR(const char *str, uint32_t &ip, uint32_t &mask)
 
   return true;
 }
+
+struct SharedMemory
+{
+  HANDLE handle;
+  void *data;
+};
+
+static SharedMemory *MapSharedMemory(const rdcstr &name, uint64_t size, bool create)
+{
+  if(size == 0 || size > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  rdcwstr wideName = StringFormat::UTF82Wide("Local\\" + name);
+
+  HANDLE handle = NULL;
+
+  if(create)
+  {
+    handle = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, DWORD(size >> 32),
+                                DWORD(size & 0xffffffff), wideName.c_str());
+
+    // don't share memory with a stale mapping of the same name
+    if(handle && GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+      CloseHandle(handle);
+      handle = NULL;
+    }
+
+    if(handle == NULL)
+      RDCWARN("Couldn't create shared memory '%s': %u", name.c_str(), GetLastError());
+  }
+  else
+  {
+    handle = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, wideName.c_str());
+  }
+
+  if(handle == NULL)
+    return NULL;
+
+  // if the size given by the other process is larger than the mapping this fails, rather than
+  // mapping pages past the end
+  void *data = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size);
+
+  if(data == NULL)
+  {
+    RDCWARN("Couldn't map shared memory '%s': %u", name.c_str(), GetLastError());
+    CloseHandle(handle);
+    return NULL;
+  }
+
+  SharedMemory *ret = new SharedMemory;
+  ret->handle = handle;
+  ret->data = data;
+
+  // the view keeps the memory alive, so the opener doesn't need to keep the name around
+  if(!create)
+    UnlinkSharedMemory(ret);
+
+  return ret;
+}
+
+SharedMemory *CreateSharedMemory(const rdcstr &name, uint64_t size)
+{
+  return MapSharedMemory(name, size, true);
+}
+
+SharedMemory *OpenSharedMemory(const rdcstr &name, uint64_t size)
+{
+  return MapSharedMemory(name, size, false);
+}
+
+void *GetSharedMemoryData(SharedMemory *mem)
+{
+  return mem ? mem->data : NULL;
+}
+
+void UnlinkSharedMemory(SharedMemory *mem)
+{
+  // the name goes away once every handle is closed, mapped views stay valid
+  if(mem && mem->handle)
+  {
+    CloseHandle(mem->handle);
+    mem->handle = NULL;
+  }
+}
+
+void CloseSharedMemory(SharedMemory *mem)
+{
+  if(mem == NULL)
+    return;
+
+  UnlinkSharedMemory(mem);
+  UnmapViewOfFile(mem->data);
+  delete mem;
+}
 };
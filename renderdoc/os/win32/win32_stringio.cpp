@@ -458,15 +458,12 @@ bool Move(const char *from, const char *to, bool allowOverwrite)
   rdcwstr wfrom = StringFormat::UTF82Wide(from);
   rdcwstr wto = StringFormat::UTF82Wide(to);
 
-  if(exists(to))
-  {
-    if(allowOverwrite)
-      Delete(to);
-    else
-      return false;
-  }
+  if(exists(to) && !allowOverwrite)
+    return false;
 
-  return ::MoveFileW(wfrom.c_str(), wto.c_str()) != 0;
+  // replace the destination in one step rather than deleting it first, so it's never missing
+  return ::MoveFileExW(wfrom.c_str(), wto.c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_COPY_ALLOWED) != 0;
 }
 
 void Delete(const char *path)
@@ -475,6 +472,12 @@ void Delete(const char *path)
   ::DeleteFileW(wpath.c_str());
 }
 
+void DeleteDirectory(const char *path)
+{
+  rdcwstr wpath = StringFormat::UTF82Wide(path);
+  ::RemoveDirectoryW(wpath.c_str());
+}
+
 void GetFilesInDirectory(const char *path, rdcarray<PathEntry> &ret)
 {
   ret.clear();
@@ -653,6 +656,70 @@ int fclose(FILE *f)
   return ::fclose(f);
 }
 
+struct FileMapping
+{
+  HANDLE mapping;
+  void *base;
+  const byte *data;
+};
+
+FileMapping *fmap_open(FILE *f, uint64_t offset, uint64_t length)
+{
+  if(f == NULL || length == 0)
+    return NULL;
+
+  // views must start on the allocation granularity, so map from the boundary before offset
+  SYSTEM_INFO sysInfo = {};
+  GetSystemInfo(&sysInfo);
+
+  uint64_t alignedOffset = offset - (offset % sysInfo.dwAllocationGranularity);
+  uint64_t mapSize = length + (offset - alignedOffset);
+
+  if(mapSize > (uint64_t)SIZE_MAX)
+    return NULL;
+
+  HANDLE file = (HANDLE)::_get_osfhandle(::_fileno(f));
+
+  HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+  if(mapping == NULL)
+  {
+    RDCWARN("Couldn't create file mapping: %u", GetLastError());
+    return NULL;
+  }
+
+  void *base = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(alignedOffset >> 32),
+                             DWORD(alignedOffset & 0xffffffff), (SIZE_T)mapSize);
+
+  if(base == NULL)
+  {
+    RDCWARN("Couldn't map %llu bytes of file: %u", length, GetLastError());
+    CloseHandle(mapping);
+    return NULL;
+  }
+
+  FileMapping *ret = new FileMapping;
+  ret->mapping = mapping;
+  ret->base = base;
+  ret->data = (const byte *)base + (offset - alignedOffset);
+  return ret;
+}
+
+const void *fmap_data(FileMapping *mapping)
+{
+  return mapping ? mapping->data : NULL;
+}
+
+void fmap_close(FileMapping *mapping)
+{
+  if(mapping == NULL)
+    return;
+
+  UnmapViewOfFile(mapping->base);
+  CloseHandle(mapping->mapping);
+  delete mapping;
+}
+
 LogFileHandle *logfile_open(const char *filename)
 {
   rdcwstr wfn = StringFormat::UTF82Wide(filename);
@@ -0,0 +1,253 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "analysis_cache.h"
+#include "serialise/serialiser.h"
+
+void AnalysisCache::Clear()
+{
+  m_Counters.clear();
+  m_Usage.clear();
+}
+
+// the maps are flattened into arrays for serialising. Counters are stored separately from their
+// results so that counters with no results are still cached, and each resource's usage is stored as
+// a count into one combined array.
+template <typename SerialiserType>
+static void SerialiseCacheContents(SerialiserType &ser, rdcarray<GPUCounter> &counters,
+                                   rdcarray<CounterResult> &results,
+                                   rdcarray<ResourceId> &usageIds,
+                                   rdcarray<uint32_t> &usageCounts, rdcarray<EventUsage> &usage)
+{
+  SERIALISE_ELEMENT(counters);
+  SERIALISE_ELEMENT(results);
+  SERIALISE_ELEMENT(usageIds);
+  SERIALISE_ELEMENT(usageCounts);
+  SERIALISE_ELEMENT(usage);
+}
+
+bool AnalysisCache::Load(const bytebuf &data)
+{
+  Clear();
+
+  uint32_t version = 0;
+  rdcstr identity;
+  rdcarray<GPUCounter> counters;
+  rdcarray<CounterResult> results;
+  rdcarray<ResourceId> usageIds;
+  rdcarray<uint32_t> usageCounts;
+  rdcarray<EventUsage> usage;
+
+  {
+    ReadSerialiser ser(new StreamReader(data), Ownership::Stream);
+
+    ser.ReadChunk<uint32_t>();
+
+    SERIALISE_ELEMENT(version);
+
+    if(version != CacheVersion)
+    {
+      RDCLOG("Discarding analysis cache with unsupported version %u", version);
+      return false;
+    }
+
+    SERIALISE_ELEMENT(identity);
+    SerialiseCacheContents(ser, counters, results, usageIds, usageCounts, usage);
+
+    ser.EndChunk();
+
+    if(ser.IsErrored() || usageIds.size() != usageCounts.size())
+    {
+      RDCWARN("Corrupt analysis cache, discarding");
+      return false;
+    }
+  }
+
+  if(identity != m_Identity)
+  {
+    RDCLOG("Discarding analysis cache computed on '%s', replaying on '%s'", identity.c_str(),
+           m_Identity.c_str());
+    return false;
+  }
+
+  for(GPUCounter c : counters)
+    m_Counters[c];
+
+  for(const CounterResult &r : results)
+    m_Counters[r.counter].push_back(r);
+
+  size_t offs = 0;
+  for(size_t i = 0; i < usageIds.size(); i++)
+  {
+    if(offs + usageCounts[i] > usage.size())
+    {
+      RDCWARN("Corrupt analysis cache, discarding");
+      Clear();
+      return false;
+    }
+
+    rdcarray<EventUsage> &dst = m_Usage[usageIds[i]];
+    dst.assign(usage.data() + offs, usageCounts[i]);
+    offs += usageCounts[i];
+  }
+
+  return true;
+}
+
+bytebuf AnalysisCache::Save() const
+{
+  uint32_t version = CacheVersion;
+  rdcstr identity = m_Identity;
+  rdcarray<GPUCounter> counters;
+  rdcarray<CounterResult> results;
+  rdcarray<ResourceId> usageIds;
+  rdcarray<uint32_t> usageCounts;
+  rdcarray<EventUsage> usage;
+
+  for(auto it = m_Counters.begin(); it != m_Counters.end(); ++it)
+  {
+    counters.push_back(it->first);
+    results.append(it->second);
+  }
+
+  for(auto it = m_Usage.begin(); it != m_Usage.end(); ++it)
+  {
+    usageIds.push_back(it->first);
+    usageCounts.push_back((uint32_t)it->second.size());
+    usage.append(it->second);
+  }
+
+  StreamWriter writer(StreamWriter::DefaultScratchSize);
+
+  {
+    WriteSerialiser ser(&writer, Ownership::Nothing);
+
+    SCOPED_SERIALISE_CHUNK(1);
+    SERIALISE_ELEMENT(version);
+    SERIALISE_ELEMENT(identity);
+    SerialiseCacheContents(ser, counters, results, usageIds, usageCounts, usage);
+  }
+
+  if(writer.IsErrored())
+    return bytebuf();
+
+  return bytebuf(writer.GetData(), (size_t)writer.GetOffset());
+}
+
+bool AnalysisCache::FindCounterResults(GPUCounter counter, rdcarray<CounterResult> &results) const
+{
+  auto it = m_Counters.find(counter);
+  if(it == m_Counters.end())
+    return false;
+
+  results = it->second;
+  return true;
+}
+
+void AnalysisCache::StoreCounterResults(GPUCounter counter, const rdcarray<CounterResult> &results)
+{
+  m_Counters[counter] = results;
+}
+
+bool AnalysisCache::FindUsage(ResourceId id, rdcarray<EventUsage> &usage) const
+{
+  auto it = m_Usage.find(id);
+  if(it == m_Usage.end())
+    return false;
+
+  usage = it->second;
+  return true;
+}
+
+void AnalysisCache::StoreUsage(ResourceId id, const rdcarray<EventUsage> &usage)
+{
+  m_Usage[id] = usage;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Test analysis cache round-tripping", "[analysiscache]")
+{
+  AnalysisCache cache;
+  cache.SetIdentity("Vulkan AMD 1.2.3");
+
+  rdcarray<CounterResult> results;
+  results.push_back(CounterResult(10, GPUCounter::EventGPUDuration, 1.5));
+  results.push_back(CounterResult(20, GPUCounter::EventGPUDuration, 2.5));
+
+  rdcarray<EventUsage> usage;
+  usage.push_back(EventUsage(10, ResourceUsage::VertexBuffer));
+
+  ResourceId id = ResourceIDGen::GetNewUniqueID();
+
+  cache.StoreCounterResults(GPUCounter::EventGPUDuration, results);
+  cache.StoreUsage(id, usage);
+
+  bytebuf data = cache.Save();
+  CHECK(!data.empty());
+
+  SECTION("Same identity")
+  {
+    AnalysisCache loaded;
+    loaded.SetIdentity("Vulkan AMD 1.2.3");
+    CHECK(loaded.Load(data));
+
+    rdcarray<CounterResult> cachedResults;
+    CHECK(loaded.FindCounterResults(GPUCounter::EventGPUDuration, cachedResults));
+    REQUIRE(cachedResults.size() == 2);
+    CHECK(cachedResults[0].eventId == 10);
+    CHECK(cachedResults[1].eventId == 20);
+    CHECK(cachedResults[1].value.d == 2.5);
+    CHECK_FALSE(loaded.FindCounterResults(GPUCounter::SamplesPassed, cachedResults));
+
+    rdcarray<EventUsage> cachedUsage;
+    CHECK(loaded.FindUsage(id, cachedUsage));
+    REQUIRE(cachedUsage.size() == 1);
+    CHECK(cachedUsage[0].eventId == 10);
+    CHECK(cachedUsage[0].usage == ResourceUsage::VertexBuffer);
+    CHECK_FALSE(loaded.FindUsage(ResourceId(), cachedUsage));
+  };
+
+  SECTION("Different identity")
+  {
+    AnalysisCache loaded;
+    loaded.SetIdentity("Vulkan AMD 1.2.4");
+    CHECK_FALSE(loaded.Load(data));
+    CHECK(loaded.IsEmpty());
+  };
+
+  SECTION("Corrupt data")
+  {
+    data.resize(data.size() / 2);
+
+    AnalysisCache loaded;
+    loaded.SetIdentity("Vulkan AMD 1.2.3");
+    CHECK_FALSE(loaded.Load(data));
+    CHECK(loaded.IsEmpty());
+  };
+};
+
+#endif
@@ -0,0 +1,59 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include "api/replay/renderdoc_replay.h"
+
+// results of expensive analysis on a capture, which can be stored in the capture's AnalysisCache
+// section so that reopening it doesn't need to recompute them. Since results like counters depend on
+// the replaying GPU and driver, the cache is tagged with an identity string describing them and is
+// discarded when loaded under a different identity.
+class AnalysisCache
+{
+public:
+  void SetIdentity(const rdcstr &identity) { m_Identity = identity; }
+  const rdcstr &GetIdentity() const { return m_Identity; }
+  bool IsEmpty() const { return m_Counters.empty() && m_Usage.empty(); }
+  void Clear();
+
+  // replace the contents with a serialised cache. If the data is corrupt or was computed under a
+  // different identity, the cache is left empty and false is returned.
+  bool Load(const bytebuf &data);
+  bytebuf Save() const;
+
+  bool FindCounterResults(GPUCounter counter, rdcarray<CounterResult> &results) const;
+  void StoreCounterResults(GPUCounter counter, const rdcarray<CounterResult> &results);
+
+  bool FindUsage(ResourceId id, rdcarray<EventUsage> &usage) const;
+  void StoreUsage(ResourceId id, const rdcarray<EventUsage> &usage);
+
+private:
+  static const uint32_t CacheVersion = 1;
+
+  rdcstr m_Identity;
+  std::map<GPUCounter, rdcarray<CounterResult>> m_Counters;
+  std::map<ResourceId, rdcarray<EventUsage>> m_Usage;
+};
@@ -26,6 +26,7 @@
 #include "jpeg-compressor/jpgd.h"
 #include "jpeg-compressor/jpge.h"
 #include "replay/replay_controller.h"
+#include "serialise/blockstore.h"
 #include "serialise/rdcfile.h"
 #include "serialise/serialiser.h"
 #include "stb/stb_image.h"
@@ -127,6 +128,8 @@ public:
 
   ReplayStatus Convert(const char *filename, const char *filetype, const SDFile *file,
                        RENDERDOC_ProgressCallback progress);
+  ReplayStatus RelocateContentBlocks(const char *filename, const char *storePath,
+                                     RENDERDOC_ProgressCallback progress);
 
   rdcarray<CaptureFileFormat> GetCaptureFileFormats()
   {
@@ -541,6 +544,78 @@ ReplayStatus CaptureFile::Convert(const char *filename, const char *filetype, co
   return ReplayStatus::Succeeded;
 }
 
+ReplayStatus CaptureFile::RelocateContentBlocks(const char *filename, const char *storePath,
+                                                RENDERDOC_ProgressCallback progress)
+{
+  if(!m_RDC || m_RDC->SectionIndex(SectionType::FrameCapture) == -1)
+  {
+    RDCERR("Capture must be opened from an RDC file to relocate its content blocks.");
+    return ReplayStatus::FileCorrupted;
+  }
+
+  if(!progress)
+    progress = [](float) {};
+
+  RDCFile output;
+
+  output.SetData(m_RDC->GetDriver(), m_RDC->GetDriverName().c_str(), m_RDC->GetMachineIdent(),
+                 &m_RDC->GetThumbnail());
+
+  output.Create(filename);
+
+  if(output.ErrorCode() != ContainerError::NoError)
+  {
+    switch(output.ErrorCode())
+    {
+      case ContainerError::FileNotFound: return ReplayStatus::FileNotFound;
+      case ContainerError::FileIO: return ReplayStatus::FileIOFailed;
+      default: break;
+    }
+    return ReplayStatus::InternalError;
+  }
+
+  // copy every section as-is apart from the content blocks. The frame capture must be first
+  int frameCaptureIndex = m_RDC->SectionIndex(SectionType::FrameCapture);
+
+  rdcarray<int> sections;
+  sections.push_back(frameCaptureIndex);
+  for(int i = 0; i < m_RDC->NumSections(); i++)
+    if(i != frameCaptureIndex)
+      sections.push_back(i);
+
+  for(int i : sections)
+  {
+    const SectionProperties &props = m_RDC->GetSectionProperties(i);
+
+    if(props.type == SectionType::ContentBlocks)
+    {
+      if(!ContentBlockStore::CopySection(m_RDC, output, storePath ? storePath : "", progress))
+        return ReplayStatus::FileIOFailed;
+
+      continue;
+    }
+
+    StreamWriter *writer = output.WriteSection(props);
+    StreamReader *reader = m_RDC->ReadSection(i);
+
+    StreamTransfer(writer, reader, NULL);
+
+    writer->Finish();
+
+    bool success = !writer->IsErrored() && !reader->IsErrored();
+
+    delete reader;
+    delete writer;
+
+    if(!success)
+      return ReplayStatus::FileIOFailed;
+  }
+
+  progress(1.0f);
+
+  return ReplayStatus::Succeeded;
+}
+
 Thumbnail CaptureFile::GetThumbnail(FileType type, uint32_t maxsize)
 {
   Thumbnail ret;
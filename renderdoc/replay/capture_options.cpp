@@ -184,4 +184,10 @@ CaptureOptions::CaptureOptions()
   refAllResources = false;
   captureAllCmdLists = false;
   debugOutputMute = true;
+  hitchCaptureThreshold = 0.0f;
+  hitchCaptureMedianFactor = 0.0f;
+  hitchCaptureCooldown = 60;
+  hitchCaptureMaxCount = 1;
+  captureCompression = SectionFlags::LZ4Compressed;
+  captureCompressionLevel = 0;
 }
@@ -0,0 +1,774 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "mesh_picker.h"
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include "common/common.h"
+#include "maths/camera.h"
+#include "replay_driver.h"
+
+// points further than this many pixels from the cursor can't be picked
+static const float MaxPointPickDistance = 35.0f;
+
+static float &Component(FloatVector &v, uint32_t c)
+{
+  return (&v.x)[c];
+}
+
+static float Component(const FloatVector &v, uint32_t c)
+{
+  return (&v.x)[c];
+}
+
+static bool IsTriangleTopology(Topology topo)
+{
+  return topo == Topology::TriangleList || topo == Topology::TriangleStrip ||
+         topo == Topology::TriangleFan || topo == Topology::TriangleList_Adj ||
+         topo == Topology::TriangleStrip_Adj;
+}
+
+void MeshPicker::Clear()
+{
+  m_Key = 0;
+  m_Triangles = false;
+  m_FanDecode = false;
+  m_Positions.clear();
+  m_Prims.clear();
+  m_Nodes.clear();
+}
+
+void MeshPicker::AddInstance(HighlightCache &cache, uint32_t eventId, const MeshDisplay &cfg,
+                             uint32_t instance, bool flipY)
+{
+  cache.CacheHighlightingData(eventId, cfg);
+
+  uint32_t count = cache.idxData ? (uint32_t)cache.indices.size() : cfg.position.numIndices;
+
+  const byte *data = cache.vertexData.data();
+  const byte *dataEnd = data + cache.vertexData.size();
+
+  rdcarray<FloatVector> positions;
+  rdcarray<bool> valid;
+  positions.resize(count);
+  valid.resize(count);
+
+  for(uint32_t i = 0; i < count; i++)
+  {
+    bool vertValid = true;
+    positions[i] = cache.InterpretVertex(data, i, cfg, dataEnd, true, vertValid);
+    valid[i] = vertValid;
+  }
+
+  AddInstance(cfg, instance, flipY, positions, valid);
+}
+
+void MeshPicker::AddInstance(const MeshDisplay &cfg, uint32_t instance, bool flipY,
+                             const rdcarray<FloatVector> &positions, const rdcarray<bool> &valid)
+{
+  Topology topo = cfg.position.topology;
+
+  m_Triangles = IsTriangleTopology(topo);
+
+  // indexed fans with primitive restart are decomposed into lists by the highlight cache, and the
+  // picked vertex is mapped back the same way the GPU picking does
+  m_FanDecode = topo == Topology::TriangleFan && cfg.position.allowRestart &&
+                cfg.position.indexByteStride != 0 && cfg.type != MeshDataStage::GSOut;
+  if(m_FanDecode)
+    topo = Topology::TriangleList;
+
+  uint32_t base = (uint32_t)m_Positions.size();
+  uint32_t count = (uint32_t)positions.size();
+
+  // vertices with non-finite positions can't be hit, and would break the ordering the BVH build
+  // relies on, so primitives using them are skipped like invalid vertices
+  rdcarray<bool> pickable = valid;
+
+  // store positions in the space they're picked in, so this work isn't repeated for every pick.
+  // Triangles are intersected after the perspective divide when unprojecting, whereas points are
+  // transformed with their W
+  m_Positions.reserve(m_Positions.size() + count);
+  for(uint32_t i = 0; i < count; i++)
+  {
+    FloatVector pos = positions[i];
+
+    if(cfg.position.unproject)
+    {
+      if(flipY)
+        pos.y = -pos.y;
+
+      if(m_Triangles)
+      {
+        pos.x /= pos.w;
+        pos.y /= pos.w;
+        pos.z /= pos.w;
+      }
+    }
+
+    if(m_Triangles)
+      pos.w = 1.0f;
+
+    if(!std::isfinite(pos.x) || !std::isfinite(pos.y) || !std::isfinite(pos.z) ||
+       !std::isfinite(pos.w))
+      pickable[i] = false;
+
+    m_Positions.push_back(pos);
+  }
+
+  if(!m_Triangles)
+  {
+    for(uint32_t i = 0; i < count; i++)
+    {
+      if(!pickable[i])
+        continue;
+
+      Prim prim = {};
+      prim.pos[0] = base + i;
+      prim.vert[0] = i;
+      prim.instance = instance;
+      m_Prims.push_back(prim);
+    }
+
+    return;
+  }
+
+  auto addTri = [&](uint32_t a, uint32_t b, uint32_t c) {
+    if(!pickable[a] || !pickable[b] || !pickable[c])
+      return;
+
+    Prim prim;
+    prim.pos[0] = base + a;
+    prim.pos[1] = base + b;
+    prim.pos[2] = base + c;
+    prim.vert[0] = a;
+    prim.vert[1] = b;
+    prim.vert[2] = c;
+    prim.instance = instance;
+    m_Prims.push_back(prim);
+  };
+
+  switch(topo)
+  {
+    case Topology::TriangleList:
+      for(uint32_t i = 0; i + 2 < count; i += 3)
+        addTri(i, i + 1, i + 2);
+      break;
+    case Topology::TriangleStrip:
+      for(uint32_t i = 0; i + 2 < count; i++)
+        addTri(i, i + 1, i + 2);
+      break;
+    case Topology::TriangleFan:
+      for(uint32_t i = 1; i + 1 < count; i++)
+        addTri(0, i, i + 1);
+      break;
+    case Topology::TriangleList_Adj:
+      for(uint32_t i = 0; i + 5 < count; i += 6)
+        addTri(i, i + 2, i + 4);
+      break;
+    case Topology::TriangleStrip_Adj:
+      for(uint32_t i = 0; i + 4 < count; i += 2)
+        addTri(i, i + 2, i + 4);
+      break;
+    default: break;
+  }
+}
+
+void MeshPicker::PrimBounds(const Prim &prim, FloatVector &boundsMin, FloatVector &boundsMax) const
+{
+  boundsMin = boundsMax = m_Positions[prim.pos[0]];
+
+  if(!m_Triangles)
+    return;
+
+  for(uint32_t v = 1; v < 3; v++)
+  {
+    const FloatVector &pos = m_Positions[prim.pos[v]];
+    for(uint32_t c = 0; c < 4; c++)
+    {
+      Component(boundsMin, c) = RDCMIN(Component(boundsMin, c), Component(pos, c));
+      Component(boundsMax, c) = RDCMAX(Component(boundsMax, c), Component(pos, c));
+    }
+  }
+}
+
+void MeshPicker::Build()
+{
+  m_Nodes.clear();
+
+  if(m_Prims.empty())
+    return;
+
+  uint32_t count = (uint32_t)m_Prims.size();
+
+  rdcarray<FloatVector> centres;
+  rdcarray<uint32_t> order;
+  centres.resize(count);
+  order.resize(count);
+
+  for(uint32_t i = 0; i < count; i++)
+  {
+    FloatVector boundsMin, boundsMax;
+    PrimBounds(m_Prims[i], boundsMin, boundsMax);
+
+    for(uint32_t c = 0; c < 4; c++)
+      Component(centres[i], c) = (Component(boundsMin, c) + Component(boundsMax, c)) * 0.5f;
+
+    order[i] = i;
+  }
+
+  m_Nodes.reserve(count * 2 / MaxLeafPrims + 1);
+
+  BuildNode(order, centres, 0, count);
+
+  // store the primitives in the order the leaves reference them
+  rdcarray<Prim> sorted;
+  sorted.reserve(count);
+  for(uint32_t i = 0; i < count; i++)
+    sorted.push_back(m_Prims[order[i]]);
+  m_Prims.swap(sorted);
+}
+
+uint32_t MeshPicker::BuildNode(rdcarray<uint32_t> &order, const rdcarray<FloatVector> &centres,
+                               uint32_t first, uint32_t count)
+{
+  uint32_t idx = (uint32_t)m_Nodes.size();
+  m_Nodes.push_back(Node());
+
+  FloatVector boundsMin, boundsMax, centreMin, centreMax;
+  PrimBounds(m_Prims[order[first]], boundsMin, boundsMax);
+  centreMin = centreMax = centres[order[first]];
+
+  for(uint32_t i = first + 1; i < first + count; i++)
+  {
+    FloatVector primMin, primMax;
+    PrimBounds(m_Prims[order[i]], primMin, primMax);
+
+    const FloatVector &centre = centres[order[i]];
+
+    for(uint32_t c = 0; c < 4; c++)
+    {
+      Component(boundsMin, c) = RDCMIN(Component(boundsMin, c), Component(primMin, c));
+      Component(boundsMax, c) = RDCMAX(Component(boundsMax, c), Component(primMax, c));
+      Component(centreMin, c) = RDCMIN(Component(centreMin, c), Component(centre, c));
+      Component(centreMax, c) = RDCMAX(Component(centreMax, c), Component(centre, c));
+    }
+  }
+
+  m_Nodes[idx].boundsMin = boundsMin;
+  m_Nodes[idx].boundsMax = boundsMax;
+
+  if(count <= MaxLeafPrims)
+  {
+    m_Nodes[idx].first = first;
+    m_Nodes[idx].count = count;
+    return idx;
+  }
+
+  // split at the median along the axis where the primitives are most spread out. This keeps the
+  // tree balanced so its depth is logarithmic even for badly distributed meshes.
+  uint32_t axis = 0;
+  for(uint32_t c = 1; c < 4; c++)
+  {
+    if(Component(centreMax, c) - Component(centreMin, c) >
+       Component(centreMax, axis) - Component(centreMin, axis))
+      axis = c;
+  }
+
+  uint32_t half = count / 2;
+  uint32_t *o = order.data();
+  std::nth_element(o + first, o + first + half, o + first + count, [&](uint32_t a, uint32_t b) {
+    return Component(centres[a], axis) < Component(centres[b], axis);
+  });
+
+  // the first child is built immediately after this node
+  BuildNode(order, centres, first, half);
+  uint32_t second = BuildNode(order, centres, first + half, count - half);
+
+  m_Nodes[idx].first = second;
+  m_Nodes[idx].count = 0;
+
+  return idx;
+}
+
+rdcpair<uint32_t, uint32_t> MeshPicker::Pick(const MeshDisplay &cfg, int32_t width, int32_t height,
+                                             uint32_t x, uint32_t y) const
+{
+  rdcpair<uint32_t, uint32_t> ret = {~0U, ~0U};
+
+  if(m_Nodes.empty())
+    return ret;
+
+  // this matches the ray and matrix calculation in the drivers' GPU picking
+  Matrix4f projMat = Matrix4f::Perspective(90.0f, 0.1f, 100000.0f, float(width) / float(height));
+
+  Matrix4f camMat = cfg.cam ? ((Camera *)cfg.cam)->GetMatrix() : Matrix4f::Identity();
+  Matrix4f pickMVP = projMat.Mul(camMat);
+
+  Matrix4f pickMVPProj;
+  if(cfg.position.unproject)
+  {
+    Matrix4f guessProj =
+        cfg.position.farPlane != FLT_MAX
+            ? Matrix4f::Perspective(cfg.fov, cfg.position.nearPlane, cfg.position.farPlane, cfg.aspect)
+            : Matrix4f::ReversePerspective(cfg.fov, cfg.position.nearPlane, cfg.aspect);
+
+    if(cfg.ortho)
+      guessProj = Matrix4f::Orthographic(cfg.position.nearPlane, cfg.position.farPlane);
+
+    pickMVPProj = projMat.Mul(camMat.Mul(guessProj.Inverse()));
+  }
+
+  if(m_Triangles)
+  {
+    Vec3f rayPos;
+    Vec3f rayDir;
+
+    Matrix4f inversePickMVP = pickMVP.Inverse();
+
+    float pickXCanonical = RDCLERP(-1.0f, 1.0f, ((float)x) / ((float)width));
+    float pickYCanonical = RDCLERP(1.0f, -1.0f, ((float)y) / ((float)height));
+
+    Vec3f nearPos = inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
+    Vec3f farPos = inversePickMVP.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
+
+    Vec3f testDir = (farPos - nearPos);
+    testDir.Normalise();
+
+    if(cfg.position.unproject)
+    {
+      Matrix4f inversePickMVPGuess = pickMVPProj.Inverse();
+
+      Vec3f nearPosProj =
+          inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, -1), 1);
+      Vec3f farPosProj = inversePickMVPGuess.Transform(Vec3f(pickXCanonical, pickYCanonical, 1), 1);
+
+      rayDir = (farPosProj - nearPosProj);
+      rayDir.Normalise();
+
+      if(testDir.z < 0)
+        rayDir = -rayDir;
+
+      rayPos = nearPosProj;
+    }
+    else
+    {
+      rayDir = testDir;
+      rayPos = nearPos;
+    }
+
+    ret.first = PickTriangle(rayPos, rayDir, ret.second);
+
+    // undo the triangle list expansion
+    if(m_FanDecode && ret.first != ~0U && ret.first > 2)
+      ret.first = (ret.first + 3) / 3 + 1;
+  }
+  else
+  {
+    ret.first = PickPoint(cfg.position.unproject ? pickMVPProj : pickMVP, cfg.position.unproject,
+                          Vec2f((float)x, (float)y), Vec2f((float)width, (float)height),
+                          ret.second);
+  }
+
+  if(ret.first == ~0U)
+    ret.second = ~0U;
+
+  return ret;
+}
+
+static bool RayHitsBox(const Vec3f &rayPos, const Vec3f &invDir, const FloatVector &boundsMin,
+                       const FloatVector &boundsMax, float maxDist)
+{
+  float t0 = (boundsMin.x - rayPos.x) * invDir.x;
+  float t1 = (boundsMax.x - rayPos.x) * invDir.x;
+  float tmin = RDCMIN(t0, t1);
+  float tmax = RDCMAX(t0, t1);
+
+  t0 = (boundsMin.y - rayPos.y) * invDir.y;
+  t1 = (boundsMax.y - rayPos.y) * invDir.y;
+  tmin = RDCMAX(tmin, RDCMIN(t0, t1));
+  tmax = RDCMIN(tmax, RDCMAX(t0, t1));
+
+  t0 = (boundsMin.z - rayPos.z) * invDir.z;
+  t1 = (boundsMax.z - rayPos.z) * invDir.z;
+  tmin = RDCMAX(tmin, RDCMIN(t0, t1));
+  tmax = RDCMIN(tmax, RDCMAX(t0, t1));
+
+  return tmax >= RDCMAX(tmin, 0.0f) && tmin <= maxDist;
+}
+
+static bool TriangleRayIntersect(const Vec3f &A, const Vec3f &B, const Vec3f &C,
+                                 const Vec3f &rayPos, const Vec3f &rayDir, float &dist)
+{
+  if((A.x == B.x && A.y == B.y && A.z == B.z) || (A.x == C.x && A.y == C.y && A.z == C.z) ||
+     (B.x == C.x && B.y == C.y && B.z == C.z))
+    return false;
+
+  Vec3f v0v1 = B - A;
+  Vec3f v0v2 = C - A;
+  Vec3f pvec = rayDir.Cross(v0v2);
+  float det = v0v1.Dot(pvec);
+
+  // backfacing triangles are still picked
+  if(fabsf(det) > 0.0f)
+  {
+    float invDet = 1.0f / det;
+
+    Vec3f tvec = rayPos - A;
+    Vec3f qvec = tvec.Cross(v0v1);
+    float u = tvec.Dot(pvec) * invDet;
+    float v = rayDir.Dot(qvec) * invDet;
+
+    if(u >= 0.0f && u <= 1.0f && v >= 0.0f && u + v <= 1.0f)
+    {
+      // rayDir is normalised, so t is the distance to the hit
+      dist = v0v2.Dot(qvec) * invDet;
+      return dist > 0.0f;
+    }
+  }
+
+  return false;
+}
+
+uint32_t MeshPicker::PickTriangle(const Vec3f &rayPos, const Vec3f &rayDir, uint32_t &instance) const
+{
+  Vec3f invDir(1.0f / rayDir.x, 1.0f / rayDir.y, 1.0f / rayDir.z);
+
+  uint32_t ret = ~0U;
+  float closest = FLT_MAX;
+
+  // the tree is balanced, so its depth is at most log2 of the number of nodes
+  uint32_t stack[64];
+  uint32_t stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while(stackSize > 0)
+  {
+    uint32_t idx = stack[--stackSize];
+    const Node &node = m_Nodes[idx];
+
+    if(!RayHitsBox(rayPos, invDir, node.boundsMin, node.boundsMax, closest))
+      continue;
+
+    if(node.count == 0)
+    {
+      stack[stackSize++] = node.first;
+      stack[stackSize++] = idx + 1;
+      continue;
+    }
+
+    for(uint32_t p = node.first; p < node.first + node.count; p++)
+    {
+      const Prim &prim = m_Prims[p];
+
+      Vec3f pos[3];
+      for(uint32_t v = 0; v < 3; v++)
+      {
+        const FloatVector &f = m_Positions[prim.pos[v]];
+        pos[v] = Vec3f(f.x, f.y, f.z);
+      }
+
+      float dist = 0.0f;
+      if(!TriangleRayIntersect(pos[0], pos[1], pos[2], rayPos, rayDir, dist))
+        continue;
+
+      // return the vertex closest to the intersection
+      Vec3f hit = rayPos + rayDir * dist;
+
+      float dist0 = (pos[0] - hit).Length();
+      float dist1 = (pos[1] - hit).Length();
+      float dist2 = (pos[2] - hit).Length();
+
+      uint32_t vert = prim.vert[0];
+      if(dist1 < dist0 && dist1 < dist2)
+        vert = prim.vert[1];
+      else if(dist2 < dist0 && dist2 < dist1)
+        vert = prim.vert[2];
+
+      // break ties consistently so overlapping geometry doesn't flicker between picks
+      if(dist < closest ||
+         (dist == closest && (prim.instance < instance || (prim.instance == instance && vert < ret))))
+      {
+        closest = dist;
+        ret = vert;
+        instance = prim.instance;
+      }
+    }
+  }
+
+  return ret;
+}
+
+uint32_t MeshPicker::PickPoint(const Matrix4f &mvp, bool unproject, const Vec2f &coords,
+                               const Vec2f &viewport, uint32_t &instance) const
+{
+  const float *m = mvp.Data();
+
+  uint32_t ret = ~0U;
+  float closestLen = MaxPointPickDistance;
+  float closestDepth = FLT_MAX;
+
+  uint32_t stack[64];
+  uint32_t stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while(stackSize > 0)
+  {
+    uint32_t idx = stack[--stackSize];
+    const Node &node = m_Nodes[idx];
+
+    // bound the transformed box with interval arithmetic. If it can't be bounded on screen because
+    // it crosses W=0 then it has to be descended into
+    FloatVector lo, hi;
+    for(uint32_t r = 0; r < 4; r++)
+    {
+      float rlo = 0.0f, rhi = 0.0f;
+      for(uint32_t c = 0; c < 4; c++)
+      {
+        float a = m[r + c * 4] * Component(node.boundsMin, c);
+        float b = m[r + c * 4] * Component(node.boundsMax, c);
+        rlo += RDCMIN(a, b);
+        rhi += RDCMAX(a, b);
+      }
+      Component(lo, r) = rlo;
+      Component(hi, r) = rhi;
+    }
+
+    bool bounded = true;
+    if(unproject)
+    {
+      if(lo.w <= 0.0f && hi.w >= 0.0f)
+      {
+        bounded = false;
+      }
+      else
+      {
+        for(uint32_t c = 0; c < 2; c++)
+        {
+          float d[4] = {
+              Component(lo, c) / lo.w, Component(lo, c) / hi.w, Component(hi, c) / lo.w,
+              Component(hi, c) / hi.w,
+          };
+          Component(lo, c) = RDCMIN(RDCMIN(d[0], d[1]), RDCMIN(d[2], d[3]));
+          Component(hi, c) = RDCMAX(RDCMAX(d[0], d[1]), RDCMAX(d[2], d[3]));
+        }
+      }
+    }
+
+    if(bounded)
+    {
+      float scrMinX = (lo.x + 1.0f) * 0.5f * viewport.x;
+      float scrMaxX = (hi.x + 1.0f) * 0.5f * viewport.x;
+      // Y is flipped
+      float scrMinY = (-hi.y + 1.0f) * 0.5f * viewport.y;
+      float scrMaxY = (-lo.y + 1.0f) * 0.5f * viewport.y;
+
+      float dx = RDCMAX(RDCMAX(scrMinX - coords.x, coords.x - scrMaxX), 0.0f);
+      float dy = RDCMAX(RDCMAX(scrMinY - coords.y, coords.y - scrMaxY), 0.0f);
+
+      if(sqrtf(dx * dx + dy * dy) > closestLen)
+        continue;
+    }
+
+    if(node.count == 0)
+    {
+      stack[stackSize++] = node.first;
+      stack[stackSize++] = idx + 1;
+      continue;
+    }
+
+    for(uint32_t p = node.first; p < node.first + node.count; p++)
+    {
+      const Prim &prim = m_Prims[p];
+      const FloatVector &pos = m_Positions[prim.pos[0]];
+
+      FloatVector wpos;
+      for(uint32_t r = 0; r < 4; r++)
+        Component(wpos, r) =
+            m[r] * pos.x + m[r + 4] * pos.y + m[r + 8] * pos.z + m[r + 12] * pos.w;
+
+      if(unproject)
+      {
+        wpos.x /= wpos.w;
+        wpos.y /= wpos.w;
+        wpos.z /= wpos.w;
+      }
+
+      wpos.y = -wpos.y;
+
+      float scrX = (wpos.x + 1.0f) * 0.5f * viewport.x - coords.x;
+      float scrY = (wpos.y + 1.0f) * 0.5f * viewport.y - coords.y;
+
+      float len = sqrtf(scrX * scrX + scrY * scrY);
+      if(len >= MaxPointPickDistance)
+        continue;
+
+      // keep the picking order consistent when multiple vertices have identical positions, by
+      // preferring the nearest then the earliest vertex
+      uint32_t vert = prim.vert[0];
+      if(len < closestLen || (len == closestLen && wpos.z < closestDepth) ||
+         (len == closestLen && wpos.z == closestDepth &&
+          (prim.instance < instance || (prim.instance == instance && vert < ret))))
+      {
+        closestLen = len;
+        closestDepth = wpos.z;
+        ret = vert;
+        instance = prim.instance;
+      }
+    }
+  }
+
+  return ret;
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Test CPU mesh picking", "[meshpick]")
+{
+  MeshDisplay cfg;
+  cfg.position.unproject = false;
+
+  MeshPicker picker;
+
+  SECTION("Triangle grid")
+  {
+    cfg.position.topology = Topology::TriangleList;
+
+    // a grid of quads covering [-1, 1] at z=5, with a second identical grid behind it at z=10. The
+    // camera looks down +Z so the front grid should always be picked
+    const uint32_t gridSize = 16;
+    rdcarray<FloatVector> positions;
+    for(float z : {10.0f, 5.0f})
+    {
+      for(uint32_t gy = 0; gy < gridSize; gy++)
+      {
+        for(uint32_t gx = 0; gx < gridSize; gx++)
+        {
+          float x0 = -1.0f + 2.0f * float(gx) / float(gridSize);
+          float x1 = -1.0f + 2.0f * float(gx + 1) / float(gridSize);
+          float y0 = -1.0f + 2.0f * float(gy) / float(gridSize);
+          float y1 = -1.0f + 2.0f * float(gy + 1) / float(gridSize);
+
+          positions.push_back(FloatVector(x0, y0, z, 1.0f));
+          positions.push_back(FloatVector(x1, y0, z, 1.0f));
+          positions.push_back(FloatVector(x1, y1, z, 1.0f));
+
+          positions.push_back(FloatVector(x0, y0, z, 1.0f));
+          positions.push_back(FloatVector(x1, y1, z, 1.0f));
+          positions.push_back(FloatVector(x0, y1, z, 1.0f));
+        }
+      }
+    }
+
+    rdcarray<bool> valid;
+    valid.fill(positions.size(), true);
+
+    picker.AddInstance(cfg, 0, false, positions, valid);
+    picker.Build();
+
+    const uint32_t frontStart = gridSize * gridSize * 6;
+
+    // the centre of the screen hits the origin, which is shared by several triangles
+    rdcpair<uint32_t, uint32_t> pick = picker.Pick(cfg, 100, 100, 50, 50);
+    REQUIRE(pick.first != ~0U);
+    CHECK(pick.first >= frontStart);
+    CHECK(pick.second == 0);
+    const FloatVector &picked = positions[pick.first];
+    CHECK(fabsf(picked.x) < 0.001f);
+    CHECK(fabsf(picked.y) < 0.001f);
+
+    // off the side of the grid nothing is hit
+    pick = picker.Pick(cfg, 100, 100, 1, 1);
+    CHECK(pick.first == ~0U);
+    CHECK(pick.second == ~0U);
+
+    // a second instance in front is picked instead
+    rdcarray<FloatVector> nearer = positions;
+    for(FloatVector &pos : nearer)
+      pos.z -= 2.0f;
+    picker.AddInstance(cfg, 3, false, nearer, valid);
+    picker.Build();
+
+    pick = picker.Pick(cfg, 100, 100, 50, 50);
+    CHECK(pick.first >= frontStart);
+    CHECK(pick.second == 3);
+  }
+
+  SECTION("Points")
+  {
+    cfg.position.topology = Topology::PointList;
+
+    rdcarray<FloatVector> positions;
+    for(uint32_t i = 0; i < 1000; i++)
+      positions.push_back(FloatVector(-1.0f + float(i) * 0.002f, 0.0f, 5.0f, 1.0f));
+
+    rdcarray<bool> valid;
+    valid.fill(positions.size(), true);
+    // an invalid vertex is never picked, even if it's the closest
+    valid[500] = false;
+
+    picker.AddInstance(cfg, 0, false, positions, valid);
+    picker.Build();
+
+    rdcpair<uint32_t, uint32_t> pick = picker.Pick(cfg, 100, 100, 50, 50);
+    CHECK(pick.first != 500);
+    CHECK((pick.first == 499 || pick.first == 501));
+
+    // far from the line of points nothing is picked
+    pick = picker.Pick(cfg, 100, 100, 50, 95);
+    CHECK(pick.first == ~0U);
+  }
+
+  SECTION("Non-finite positions")
+  {
+    cfg.position.topology = Topology::TriangleList;
+
+    // a quad covering the screen, and triangles with NaN and infinite positions in front of it
+    rdcarray<FloatVector> positions = {
+        FloatVector(-1.0f, -1.0f, 5.0f, 1.0f),     FloatVector(1.0f, -1.0f, 5.0f, 1.0f),
+        FloatVector(1.0f, 1.0f, 5.0f, 1.0f),       FloatVector(-1.0f, -1.0f, 5.0f, 1.0f),
+        FloatVector(1.0f, 1.0f, 5.0f, 1.0f),       FloatVector(-1.0f, 1.0f, 5.0f, 1.0f),
+        FloatVector(-1.0f, -1.0f, NAN, 1.0f),      FloatVector(1.0f, -1.0f, 1.0f, 1.0f),
+        FloatVector(0.0f, 1.0f, 1.0f, 1.0f),       FloatVector(-1.0f, -1.0f, 1.0f, 1.0f),
+        FloatVector(INFINITY, -1.0f, 1.0f, 1.0f),  FloatVector(0.0f, 1.0f, 1.0f, 1.0f),
+        FloatVector(-INFINITY, -1.0f, 1.0f, 1.0f), FloatVector(1.0f, -1.0f, 1.0f, 1.0f),
+        FloatVector(0.0f, NAN, 1.0f, 1.0f),
+    };
+
+    rdcarray<bool> valid;
+    valid.fill(positions.size(), true);
+
+    picker.AddInstance(cfg, 0, false, positions, valid);
+    picker.Build();
+
+    // only the quad can be hit
+    rdcpair<uint32_t, uint32_t> pick = picker.Pick(cfg, 100, 100, 50, 50);
+    REQUIRE(pick.first != ~0U);
+    CHECK(pick.first < 6);
+  }
+}
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
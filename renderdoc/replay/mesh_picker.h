@@ -0,0 +1,99 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "api/replay/renderdoc_replay.h"
+#include "maths/matrix.h"
+#include "maths/vec.h"
+
+struct HighlightCache;
+
+// picks vertices in a mesh on the CPU, matching the drivers' GPU picking. The positions of one or
+// more instances are added once and a bounding volume hierarchy is built over their primitives,
+// then picks from any camera only walk the hierarchy instead of testing every primitive.
+class MeshPicker
+{
+public:
+  void Clear();
+  bool IsEmpty() const { return m_Nodes.empty(); }
+  // identifies the mesh configuration the picker was built for
+  uint64_t GetKey() const { return m_Key; }
+  void SetKey(uint64_t key) { m_Key = key; }
+  // fetches an instance's positions through the highlight cache and adds its primitives. flipY is
+  // set for APIs where unprojected positions have Y pointing down, as in the picking shaders.
+  void AddInstance(HighlightCache &cache, uint32_t eventId, const MeshDisplay &cfg,
+                   uint32_t instance, bool flipY);
+
+  // adds an instance's primitives, with one position for each vertex in the index buffer (or each
+  // vertex, if the mesh isn't indexed). valid is false for any vertices that couldn't be read,
+  // such as restart indices.
+  void AddInstance(const MeshDisplay &cfg, uint32_t instance, bool flipY,
+                   const rdcarray<FloatVector> &positions, const rdcarray<bool> &valid);
+
+  void Build();
+
+  // returns the picked vertex and its instance, or ~0U for both if nothing is under the cursor. If
+  // several instances have a candidate, the closest is picked.
+  rdcpair<uint32_t, uint32_t> Pick(const MeshDisplay &cfg, int32_t width, int32_t height,
+                                   uint32_t x, uint32_t y) const;
+
+private:
+  struct Prim
+  {
+    // indices into m_Positions, only the first is used for points
+    uint32_t pos[3];
+    // the vertices to return when each position is picked
+    uint32_t vert[3];
+    uint32_t instance;
+  };
+
+  struct Node
+  {
+    FloatVector boundsMin, boundsMax;
+    // for leaves, the first primitive in m_Prims. For other nodes, the index of the second child -
+    // the first child always immediately follows its parent.
+    uint32_t first;
+    // the number of primitives in a leaf, or 0 for other nodes
+    uint32_t count;
+  };
+
+  static const uint32_t MaxLeafPrims = 4;
+
+  uint32_t BuildNode(rdcarray<uint32_t> &order, const rdcarray<FloatVector> &centres,
+                     uint32_t first, uint32_t count);
+  void PrimBounds(const Prim &prim, FloatVector &boundsMin, FloatVector &boundsMax) const;
+
+  uint32_t PickTriangle(const Vec3f &rayPos, const Vec3f &rayDir, uint32_t &instance) const;
+  uint32_t PickPoint(const Matrix4f &mvp, bool unproject, const Vec2f &coords,
+                     const Vec2f &viewport, uint32_t &instance) const;
+
+  uint64_t m_Key = 0;
+  bool m_Triangles = false;
+  bool m_FanDecode = false;
+
+  rdcarray<FloatVector> m_Positions;
+  rdcarray<Prim> m_Prims;
+  rdcarray<Node> m_Nodes;
+};
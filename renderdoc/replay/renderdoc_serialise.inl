@@ -111,8 +111,14 @@ void DoSerialise(SerialiserType &ser, CaptureOptions &el)
   SERIALISE_MEMBER(refAllResources);
   SERIALISE_MEMBER(captureAllCmdLists);
   SERIALISE_MEMBER(debugOutputMute);
+  SERIALISE_MEMBER(hitchCaptureThreshold);
+  SERIALISE_MEMBER(hitchCaptureMedianFactor);
+  SERIALISE_MEMBER(hitchCaptureCooldown);
+  SERIALISE_MEMBER(hitchCaptureMaxCount);
+  SERIALISE_MEMBER(captureCompression);
+  SERIALISE_MEMBER(captureCompressionLevel);
 
-  SIZE_CHECK(20);
+  SIZE_CHECK(44);
 }
 
 template <typename SerialiserType>
@@ -750,6 +756,29 @@ void DoSerialise(SerialiserType &ser, FrameStatistics &el)
   SIZE_CHECK(1432);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, ChunkLoadStatistics &el)
+{
+  SERIALISE_MEMBER(name);
+  SERIALISE_MEMBER(count);
+  SERIALISE_MEMBER(totalSize);
+  SERIALISE_MEMBER(totalTime);
+
+  SIZE_CHECK(48);
+}
+
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, LoadStatistics &el)
+{
+  SERIALISE_MEMBER(fileReadTime);
+  SERIALISE_MEMBER(decompressTime);
+  SERIALISE_MEMBER(chunkProcessingTime);
+  SERIALISE_MEMBER(initialContentsTime);
+  SERIALISE_MEMBER(chunks);
+
+  SIZE_CHECK(56);
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, FrameDescription &el)
 {
@@ -762,8 +791,9 @@ void DoSerialise(SerialiserType &ser, FrameDescription &el)
   SERIALISE_MEMBER(captureTime);
   SERIALISE_MEMBER(stats);
   SERIALISE_MEMBER(debugMessages);
+  SERIALISE_MEMBER(loadStatistics);
 
-  SIZE_CHECK(1512);
+  SIZE_CHECK(1568);
 }
 
 template <typename SerialiserType>
@@ -772,7 +802,7 @@ void DoSerialise(SerialiserType &ser, FrameRecord &el)
   SERIALISE_MEMBER(frameInfo);
   SERIALISE_MEMBER(drawcallList);
 
-  SIZE_CHECK(1536);
+  SIZE_CHECK(1592);
 }
 
 template <typename SerialiserType>
@@ -889,6 +919,16 @@ void DoSerialise(SerialiserType &ser, PixelModification &el)
   SIZE_CHECK(100);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, PixelRegionHistory &el)
+{
+  SERIALISE_MEMBER(x);
+  SERIALISE_MEMBER(y);
+  SERIALISE_MEMBER(modifications);
+
+  SIZE_CHECK(32);
+}
+
 template <typename SerialiserType>
 void DoSerialise(SerialiserType &ser, EventUsage &el)
 {
@@ -941,6 +981,17 @@ void DoSerialise(SerialiserType &ser, ReplayOptions &el)
   SIZE_CHECK(48);
 }
 
+template <typename SerialiserType>
+void DoSerialise(SerialiserType &ser, CallProfileEntry &el)
+{
+  SERIALISE_MEMBER(name);
+  SERIALISE_MEMBER(callCount);
+  SERIALISE_MEMBER(totalMicroseconds);
+  SERIALISE_MEMBER(serialisedBytes);
+
+  SIZE_CHECK(48);
+}
+
 #pragma region Common pipeline state
 
 template <typename SerialiserType>
@@ -2297,6 +2348,8 @@ INSTANTIATE_SERIALISE_TYPE(DepthStencilStats)
 INSTANTIATE_SERIALISE_TYPE(RasterizationStats)
 INSTANTIATE_SERIALISE_TYPE(OutputTargetStats)
 INSTANTIATE_SERIALISE_TYPE(FrameStatistics)
+INSTANTIATE_SERIALISE_TYPE(ChunkLoadStatistics)
+INSTANTIATE_SERIALISE_TYPE(LoadStatistics)
 INSTANTIATE_SERIALISE_TYPE(FrameDescription)
 INSTANTIATE_SERIALISE_TYPE(FrameRecord)
 INSTANTIATE_SERIALISE_TYPE(MeshFormat)
@@ -2306,11 +2359,13 @@ INSTANTIATE_SERIALISE_TYPE(CounterDescription)
 INSTANTIATE_SERIALISE_TYPE(PixelValue)
 INSTANTIATE_SERIALISE_TYPE(Subresource)
 INSTANTIATE_SERIALISE_TYPE(PixelModification)
+INSTANTIATE_SERIALISE_TYPE(PixelRegionHistory)
 INSTANTIATE_SERIALISE_TYPE(EventUsage)
 INSTANTIATE_SERIALISE_TYPE(CounterResult)
 INSTANTIATE_SERIALISE_TYPE(CounterValue)
 INSTANTIATE_SERIALISE_TYPE(GPUDevice)
 INSTANTIATE_SERIALISE_TYPE(ReplayOptions)
+INSTANTIATE_SERIALISE_TYPE(CallProfileEntry)
 INSTANTIATE_SERIALISE_TYPE(D3D11Pipe::Layout)
 INSTANTIATE_SERIALISE_TYPE(D3D11Pipe::InputAssembly)
 INSTANTIATE_SERIALISE_TYPE(D3D11Pipe::View)
@@ -26,7 +26,9 @@
 #include "replay_controller.h"
 #include <string.h>
 #include <time.h>
+#include "api/replay/version.h"
 #include "common/dds_readwrite.h"
+#include "common/jobsystem.h"
 #include "driver/ihv/amd/amd_isa.h"
 #include "driver/ihv/amd/amd_rgp.h"
 #include "jpeg-compressor/jpgd.h"
@@ -45,6 +47,24 @@ static void fileWriteFunc(void *context, void *data, int size)
   FileIO::fwrite(data, 1, size, (FILE *)context);
 }
 
+// the number of rows converted at once when processing texture data to save
+static const uint32_t RowBlockSize = 32;
+
+static void ParallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t)> func)
+{
+  Threading::JobSystem *jobs = RenderDoc::Inst().GetJobSystem();
+
+  if(jobs)
+  {
+    jobs->ParallelFor(count, func, grainSize);
+  }
+  else
+  {
+    for(uint32_t i = 0; i < count; i++)
+      func(i);
+  }
+}
+
 ReplayController::ReplayController()
 {
   m_ThreadID = Threading::GetCurrentID();
@@ -418,7 +438,42 @@ rdcarray<CounterResult> ReplayController::FetchCounters(const rdcarray<GPUCounte
 {
   CHECK_REPLAY_THREAD();
 
-  return m_pDevice->FetchCounters(counters);
+  // with replacements active the results don't reflect the capture, so bypass the cache entirely
+  if(!m_ReplacedResources.empty())
+    return m_pDevice->FetchCounters(counters);
+
+  rdcarray<CounterResult> ret;
+  rdcarray<GPUCounter> missing;
+
+  for(GPUCounter c : counters)
+  {
+    rdcarray<CounterResult> cached;
+    if(m_AnalysisCache.FindCounterResults(c, cached))
+      ret.append(cached);
+    else
+      missing.push_back(c);
+  }
+
+  if(missing.empty())
+    return ret;
+
+  rdcarray<CounterResult> fetched = m_pDevice->FetchCounters(missing);
+
+  std::map<GPUCounter, rdcarray<CounterResult>> perCounter;
+  for(GPUCounter c : missing)
+    perCounter[c];
+  for(const CounterResult &r : fetched)
+    perCounter[r.counter].push_back(r);
+
+  for(auto it = perCounter.begin(); it != perCounter.end(); ++it)
+    m_AnalysisCache.StoreCounterResults(it->first, it->second);
+
+  // if nothing was cached, return results in the order the driver produced them
+  if(ret.empty())
+    return fetched;
+
+  ret.append(fetched);
+  return ret;
 }
 
 rdcarray<GPUCounter> ReplayController::EnumerateCounters()
@@ -482,10 +537,26 @@ rdcarray<EventUsage> ReplayController::GetUsage(ResourceId id)
 {
   CHECK_REPLAY_THREAD();
 
-  id = m_pDevice->GetLiveID(id);
-  if(id == ResourceId())
-    return rdcarray<EventUsage>();
-  return m_pDevice->GetUsage(id);
+  rdcarray<EventUsage> ret;
+
+  // the cache is keyed by original ID, which is stable between replays of the capture
+  if(m_AnalysisCache.FindUsage(id, ret))
+    return ret;
+
+  ResourceId liveId = m_pDevice->GetLiveID(id);
+  if(liveId == ResourceId())
+    return ret;
+
+  ret = m_pDevice->GetUsage(liveId);
+  m_AnalysisCache.StoreUsage(id, ret);
+  return ret;
+}
+
+bytebuf ReplayController::GetAnalysisCache()
+{
+  CHECK_REPLAY_THREAD();
+
+  return m_AnalysisCache.Save();
 }
 
 MeshFormat ReplayController::GetPostVSData(uint32_t instID, uint32_t viewID, MeshDataStage stage)
@@ -548,11 +619,13 @@ bytebuf ReplayController::GetTextureData(ResourceId tex, const Subresource &sub)
   return ret;
 }
 
-bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path)
+bool ReplayController::PrepareTextureSave(const TextureSave &saveData,
+                                          PreparedTextureSave &prepared)
 {
   CHECK_REPLAY_THREAD();
 
-  TextureSave sd = saveData;    // mutable copy
+  TextureSave &sd = prepared.sd;
+  sd = saveData;    // mutable copy
   ResourceId liveid = m_pDevice->GetLiveID(sd.resourceId);
 
   if(liveid == ResourceId())
@@ -561,9 +634,8 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     return false;
   }
 
-  TextureDescription td = m_pDevice->GetTexture(liveid);
-
-  bool success = false;
+  TextureDescription &td = prepared.td;
+  td = m_pDevice->GetTexture(liveid);
 
   // clamp sample/mip/slice indices
   if(td.msSamp == 1)
@@ -647,12 +719,15 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
   // down a multisampled texture for writing as a single 'image' elsewhere)
   uint32_t sliceOffset = 0;
   uint32_t sliceStride = 1;
-  uint32_t numSlices = td.arraysize * td.depth;
+  uint32_t &numSlices = prepared.numSlices;
+  numSlices = td.arraysize * td.depth;
 
   uint32_t mipOffset = 0;
-  uint32_t numMips = td.mips;
+  uint32_t &numMips = prepared.numMips;
+  numMips = td.mips;
 
-  bool singleSlice = (sd.slice.sliceIndex != -1);
+  bool &singleSlice = prepared.singleSlice;
+  singleSlice = (sd.slice.sliceIndex != -1);
 
   // set which slices/mips we need
   if(multisampled)
@@ -714,7 +789,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     // otherwise take all mips, as by default
   }
 
-  rdcarray<byte *> subdata;
+  rdcarray<byte *> &subdata = prepared.subdata;
 
   bool downcast = false;
 
@@ -783,7 +858,8 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     }
   }
 
-  uint32_t rowPitch = 0;
+  uint32_t &rowPitch = prepared.rowPitch;
+  rowPitch = 0;
   uint32_t slicePitch = 0;
 
   bool blockformat = false;
@@ -861,10 +937,6 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
       if(data.empty())
       {
         RDCERR("Couldn't get bytes for mip %u, slice %u", mip, slice);
-
-        for(size_t i = 0; i < subdata.size(); i++)
-          delete[] subdata[i];
-
         return false;
       }
 
@@ -923,6 +995,18 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     }
   }
 
+  return true;
+}
+
+bool ReplayController::EncodeTextureSave(PreparedTextureSave &prepared, const char *path)
+{
+  TextureSave &sd = prepared.sd;
+  TextureDescription &td = prepared.td;
+  rdcarray<byte *> &subdata = prepared.subdata;
+  uint32_t rowPitch = prepared.rowPitch;
+
+  bool success = false;
+
   // should have been handled above, but verify incoming data is RGBA8 or RGBA32
   if(sd.slice.slicesAsGrid && (td.format.compByteWidth == 1 || td.format.compByteWidth == 4) &&
      td.format.compCount == 4 && !td.format.Special())
@@ -943,10 +1027,9 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
 
     memset(combinedData, 0, td.width * td.height * pixelStride);
 
-    for(size_t i = 0; i < subdata.size(); i++)
-    {
-      uint32_t gridx = (uint32_t)i % sd.slice.sliceGridWidth;
-      uint32_t gridy = (uint32_t)i / sd.slice.sliceGridWidth;
+    ParallelFor((uint32_t)subdata.size(), 1, [&](uint32_t i) {
+      uint32_t gridx = i % sd.slice.sliceGridWidth;
+      uint32_t gridy = i / sd.slice.sliceGridWidth;
 
       uint32_t yoffs = gridy * sliceHeight;
       uint32_t xoffs = gridx * sliceWidth;
@@ -964,7 +1047,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
       }
 
       delete[] subdata[i];
-    }
+    });
 
     subdata.resize(1);
     subdata[0] = combinedData;
@@ -1005,8 +1088,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     uint32_t gridx[6] = {2, 0, 1, 1, 1, 3};
     uint32_t gridy[6] = {1, 1, 0, 2, 1, 1};
 
-    for(size_t i = 0; i < subdata.size(); i++)
-    {
+    ParallelFor((uint32_t)subdata.size(), 1, [&](uint32_t i) {
       uint32_t yoffs = gridy[i] * sliceHeight;
       uint32_t xoffs = gridx[i] * sliceWidth;
 
@@ -1023,7 +1105,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
       }
 
       delete[] subdata[i];
-    }
+    });
 
     subdata.resize(1);
     subdata[0] = combinedData;
@@ -1042,11 +1124,11 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     uint32_t compWidth = td.format.compByteWidth;
     uint32_t compCount = td.format.compCount;
 
-    uint32_t val = 0;
-    uint32_t max = ~0U;
+    const uint32_t max = ~0U;
+
+    ParallelFor(td.height, RowBlockSize, [&](uint32_t y) {
+      uint32_t val = 0;
 
-    for(uint32_t y = 0; y < td.height; y++)
-    {
       for(uint32_t x = 0; x < td.width; x++)
       {
         memcpy(&val, &subdata[0][(y * td.width + x) * pixelStride + sd.channelExtract * compWidth],
@@ -1072,7 +1154,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
             break;
         }
       }
-    }
+    });
   }
 
   // handle formats that don't support alpha
@@ -1080,8 +1162,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
   {
     byte *nonalpha = new byte[td.width * td.height * 3];
 
-    for(uint32_t y = 0; y < td.height; y++)
-    {
+    ParallelFor(td.height, RowBlockSize, [&](uint32_t y) {
       for(uint32_t x = 0; x < td.width; x++)
       {
         byte r = subdata[0][(y * td.width + x) * 4 + 0];
@@ -1119,7 +1200,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
         nonalpha[(y * td.width + x) * 3 + 1] = g;
         nonalpha[(y * td.width + x) * 3 + 2] = b;
       }
-    }
+    });
 
     delete[] subdata[0];
 
@@ -1135,8 +1216,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
   {
     byte *rg0 = new byte[td.width * td.height * 3];
 
-    for(uint32_t y = 0; y < td.height; y++)
-    {
+    ParallelFor(td.height, RowBlockSize, [&](uint32_t y) {
       for(uint32_t x = 0; x < td.width; x++)
       {
         byte r = subdata[0][(y * td.width + x) * 2 + 0];
@@ -1150,7 +1230,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
         if(sd.channelExtract >= 0)
           rg0[(y * td.width + x) * 3 + 2] = r;
       }
-    }
+    });
 
     delete[] subdata[0];
 
@@ -1182,12 +1262,12 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
       ddsData.height = td.height;
       ddsData.depth = td.depth;
       ddsData.format = saveFmt;
-      ddsData.mips = numMips;
-      ddsData.slices = numSlices / td.depth;
+      ddsData.mips = prepared.numMips;
+      ddsData.slices = prepared.numSlices / td.depth;
       ddsData.subdata = &subdata[0];
-      ddsData.cubemap = td.cubemap && numSlices == 6;
+      ddsData.cubemap = td.cubemap && prepared.numSlices == 6;
 
-      if(singleSlice)
+      if(prepared.singleSlice)
         ddsData.depth = ddsData.slices = 1;
 
       success = write_dds_to_file(f, ddsData);
@@ -1259,8 +1339,6 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
         abgr[3] = new float[td.width * td.height];
       }
 
-      byte *srcData = subdata[0];
-
       ResourceFormat saveFmt = td.format;
       if(saveFmt.compType == CompType::Typeless)
         saveFmt.compType = sd.typeCast;
@@ -1273,8 +1351,9 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
       if(saveFmt.compType == CompType::Depth && pixStride == 3)
         pixStride = 4;
 
-      for(uint32_t y = 0; y < td.height; y++)
-      {
+      ParallelFor(td.height, RowBlockSize, [&](uint32_t y) {
+        byte *srcData = subdata[0] + y * td.width * pixStride;
+
         for(uint32_t x = 0; x < td.width; x++)
         {
           FloatVector pixel = ConvertComponents(saveFmt, srcData);
@@ -1325,7 +1404,7 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
             abgr[3][(y * td.width + x)] = pixel.x;
           }
         }
-      }
+      });
 
       if(sd.destType == FileType::HDR)
       {
@@ -1401,56 +1480,118 @@ bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path
     FileIO::fclose(f);
   }
 
-  for(size_t i = 0; i < subdata.size(); i++)
-    delete[] subdata[i];
-
   return success;
 }
 
-rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, uint32_t x, uint32_t y,
-                                                           const Subresource &sub, CompType typeCast)
+bool ReplayController::SaveTexture(const TextureSave &saveData, const char *path)
 {
   CHECK_REPLAY_THREAD();
 
-  rdcarray<PixelModification> ret;
+  PreparedTextureSave prepared;
 
-  Subresource subresource = sub;
+  if(!PrepareTextureSave(saveData, prepared))
+    return false;
 
+  return EncodeTextureSave(prepared, path);
+}
+
+bool ReplayController::SaveTextures(const rdcarray<TextureSave> &saveData,
+                                    const rdcarray<rdcstr> &paths)
+{
+  CHECK_REPLAY_THREAD();
+
+  if(saveData.size() != paths.size())
+  {
+    RDCERR("Mismatched number of textures (%zu) and paths (%zu) to save", saveData.size(),
+           paths.size());
+    return false;
+  }
+
+  Threading::JobSystem *jobs = RenderDoc::Inst().GetJobSystem();
+
+  // read back each texture here on the replay thread, and hand it off to be converted and encoded
+  // while the next one is read back. Only keep a few textures in flight at once so that large
+  // textures don't use unbounded memory.
+  const size_t maxInFlight = jobs ? jobs->GetNumWorkers() + 1 : 1;
+
+  rdcarray<Threading::Job> encodes;
+  rdcarray<int32_t> succeeded;
+  succeeded.resize(saveData.size());
+
+  for(size_t i = 0; i < saveData.size(); i++)
+  {
+    if(encodes.size() >= maxInFlight)
+      encodes[encodes.size() - maxInFlight].Wait();
+
+    PreparedTextureSave *prepared = new PreparedTextureSave;
+
+    if(!PrepareTextureSave(saveData[i], *prepared))
+    {
+      delete prepared;
+      continue;
+    }
+
+    rdcstr path = paths[i];
+    int32_t *result = &succeeded[i];
+
+    auto encode = [prepared, path, result]() {
+      *result = EncodeTextureSave(*prepared, path.c_str()) ? 1 : 0;
+      delete prepared;
+    };
+
+    if(jobs)
+      encodes.push_back(jobs->Submit(encode));
+    else
+      encode();
+  }
+
+  if(jobs)
+    jobs->Wait(encodes);
+
+  bool ret = true;
+  for(size_t i = 0; i < succeeded.size(); i++)
+  {
+    if(!succeeded[i])
+    {
+      RDCERR("Failed to save %s to %s", ToStr(saveData[i].resourceId).c_str(), paths[i].c_str());
+      ret = false;
+    }
+  }
+
+  return ret;
+}
+
+const TextureDescription *ReplayController::GetPixelHistoryTexture(ResourceId target,
+                                                                  Subresource &sub)
+{
   for(size_t t = 0; t < m_Textures.size(); t++)
   {
     if(m_Textures[t].resourceId == target)
     {
-      if(x >= m_Textures[t].width || y >= m_Textures[t].height)
-      {
-        RDCDEBUG("PixelHistory out of bounds on %s (%u,%u) vs (%u,%u)", ToStr(target).c_str(), x, y,
-                 m_Textures[t].width, m_Textures[t].height);
-        return ret;
-      }
-
       if(m_Textures[t].msSamp == 1)
-        subresource.sample = ~0U;
+        sub.sample = ~0U;
 
       if(m_Textures[t].dimension == 3)
       {
-        subresource.slice = RDCCLAMP(subresource.slice, 0U, m_Textures[t].depth >> subresource.mip);
+        sub.slice = RDCCLAMP(sub.slice, 0U, m_Textures[t].depth >> sub.mip);
       }
       else
       {
-        subresource.slice = RDCCLAMP(subresource.slice, 0U, m_Textures[t].arraysize);
+        sub.slice = RDCCLAMP(sub.slice, 0U, m_Textures[t].arraysize);
       }
 
-      subresource.mip = RDCCLAMP(subresource.mip, 0U, m_Textures[t].mips - 1);
+      sub.mip = RDCCLAMP(sub.mip, 0U, m_Textures[t].mips - 1);
 
-      break;
+      return &m_Textures[t];
     }
   }
 
-  ResourceId id = m_pDevice->GetLiveID(target);
-
-  if(id == ResourceId())
-    return ret;
+  return NULL;
+}
 
-  rdcarray<EventUsage> usage = m_pDevice->GetUsage(id);
+rdcarray<EventUsage> ReplayController::GetPixelHistoryEvents(ResourceId liveId, ResourceId target)
+{
+  rdcarray<EventUsage> usage = m_pDevice->GetUsage(liveId);
 
   rdcarray<EventUsage> events;
 
@@ -1514,16 +1655,39 @@ rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, ui
   }
 
   if(events.empty())
-  {
     RDCDEBUG("Target %s not written to before %u", ToStr(target).c_str(), m_EventID);
+
+  return events;
+}
+
+rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, uint32_t x, uint32_t y,
+                                                           const Subresource &sub, CompType typeCast)
+{
+  CHECK_REPLAY_THREAD();
+
+  rdcarray<PixelModification> ret;
+
+  Subresource subresource = sub;
+
+  const TextureDescription *tex = GetPixelHistoryTexture(target, subresource);
+
+  if(tex && (x >= tex->width || y >= tex->height))
+  {
+    RDCDEBUG("PixelHistory out of bounds on %s (%u,%u) vs (%u,%u)", ToStr(target).c_str(), x, y,
+             tex->width, tex->height);
     return ret;
   }
 
-  id = m_pDevice->GetLiveID(target);
+  ResourceId id = m_pDevice->GetLiveID(target);
 
   if(id == ResourceId())
     return ret;
 
+  rdcarray<EventUsage> events = GetPixelHistoryEvents(id, target);
+
+  if(events.empty())
+    return ret;
+
   ret = m_pDevice->PixelHistory(events, id, x, y, subresource, typeCast);
 
   SetFrameEvent(m_EventID, true);
@@ -1531,6 +1695,65 @@ rdcarray<PixelModification> ReplayController::PixelHistory(ResourceId target, ui
   return ret;
 }
 
+rdcarray<PixelRegionHistory> ReplayController::PixelHistoryRegion(ResourceId target, uint32_t x,
+                                                                  uint32_t y, uint32_t width,
+                                                                  uint32_t height,
+                                                                  const Subresource &sub,
+                                                                  CompType typeCast)
+{
+  CHECK_REPLAY_THREAD();
+
+  rdcarray<PixelRegionHistory> ret;
+
+  Subresource subresource = sub;
+
+  const TextureDescription *tex = GetPixelHistoryTexture(target, subresource);
+
+  if(tex)
+  {
+    if(x >= tex->width || y >= tex->height)
+    {
+      RDCDEBUG("PixelHistoryRegion out of bounds on %s (%u,%u) vs (%u,%u)", ToStr(target).c_str(),
+               x, y, tex->width, tex->height);
+      return ret;
+    }
+
+    width = RDCMIN(width, tex->width - x);
+    height = RDCMIN(height, tex->height - y);
+  }
+
+  if(width == 0 || height == 0)
+    return ret;
+
+  ResourceId id = m_pDevice->GetLiveID(target);
+
+  if(id == ResourceId())
+    return ret;
+
+  rdcarray<EventUsage> events = GetPixelHistoryEvents(id, target);
+
+  if(events.empty())
+  {
+    // nothing wrote to the region, but still return an entry for each pixel
+    ret.resize(width * height);
+    for(uint32_t py = 0; py < height; py++)
+    {
+      for(uint32_t px = 0; px < width; px++)
+      {
+        ret[py * width + px].x = x + px;
+        ret[py * width + px].y = y + py;
+      }
+    }
+    return ret;
+  }
+
+  ret = m_pDevice->PixelHistoryRegion(events, id, x, y, width, height, subresource, typeCast);
+
+  SetFrameEvent(m_EventID, true);
+
+  return ret;
+}
+
 PixelValue ReplayController::PickPixel(ResourceId tex, uint32_t x, uint32_t y,
                                        const Subresource &sub, CompType typeCast)
 {
@@ -1939,6 +2162,7 @@ void ReplayController::ReplaceResource(ResourceId from, ResourceId to)
   CHECK_REPLAY_THREAD();
 
   m_pDevice->ReplaceResource(from, to);
+  m_ReplacedResources.insert(from);
 
   SetFrameEvent(m_EventID, true);
 
@@ -1952,6 +2176,7 @@ void ReplayController::RemoveReplacement(ResourceId id)
   CHECK_REPLAY_THREAD();
 
   m_pDevice->RemoveReplacement(id);
+  m_ReplacedResources.erase(id);
 
   SetFrameEvent(m_EventID, true);
 
@@ -2004,6 +2229,8 @@ ReplayStatus ReplayController::PostCreateInit(IReplayDriver *device, RDCFile *rd
 
   m_APIProps = m_pDevice->GetAPIProperties();
 
+  LoadAnalysisCache(rdc);
+
   // fetch GCN ISA targets
   GCNISA::GetTargets(m_APIProps.pipelineType, m_GCNTargets);
 
@@ -2024,6 +2251,33 @@ ReplayStatus ReplayController::PostCreateInit(IReplayDriver *device, RDCFile *rd
   return ReplayStatus::Succeeded;
 }
 
+void ReplayController::LoadAnalysisCache(RDCFile *rdc)
+{
+  DriverInformation driver = m_pDevice->GetDriverInfo();
+
+  // results are only valid on the same GPU and driver, replayed by the same build. Each driver's
+  // version string names the device it's replaying on, alongside the driver version itself.
+  m_AnalysisCache.SetIdentity(StringFormat::Fmt(
+      "%s %s/%s %s / RenderDoc %s %s", ToStr(m_APIProps.localRenderer).c_str(),
+      ToStr(m_APIProps.vendor).c_str(), ToStr(driver.vendor).c_str(), driver.version,
+      MAJOR_MINOR_VERSION_STRING, GitVersionHash));
+
+  int idx = rdc ? rdc->SectionIndex(SectionType::AnalysisCache) : -1;
+  if(idx < 0)
+    return;
+
+  StreamReader *reader = rdc->ReadSection(idx);
+
+  bytebuf data;
+  data.resize((size_t)reader->GetSize());
+  bool success = reader->Read(data.data(), reader->GetSize());
+
+  delete reader;
+
+  if(success && m_AnalysisCache.Load(data))
+    RDCLOG("Loaded analysis cache from capture");
+}
+
 void ReplayController::FileChanged()
 {
   CHECK_REPLAY_THREAD();
@@ -29,6 +29,8 @@
 #include "api/replay/renderdoc_replay.h"
 #include "common/common.h"
 #include "core/core.h"
+#include "replay/analysis_cache.h"
+#include "replay/mesh_picker.h"
 #include "replay/replay_driver.h"
 
 #define CHECK_REPLAY_THREAD() RDCASSERT(Threading::GetCurrentID() == m_ThreadID);
@@ -119,6 +121,9 @@ private:
     MeshDisplay meshDisplay;
   } m_RenderData;
 
+  // CPU picking structure for the mesh last picked in, rebuilt when the mesh changes
+  MeshPicker m_MeshPicker;
+
   friend struct ReplayController;
 };
 
@@ -185,6 +190,9 @@ public:
                                   float minval, float maxval, bool channels[4]);
   rdcarray<PixelModification> PixelHistory(ResourceId target, uint32_t x, uint32_t y,
                                            const Subresource &sub, CompType typeCast);
+  rdcarray<PixelRegionHistory> PixelHistoryRegion(ResourceId target, uint32_t x, uint32_t y,
+                                                  uint32_t width, uint32_t height,
+                                                  const Subresource &sub, CompType typeCast);
   ShaderDebugTrace *DebugVertex(uint32_t vertid, uint32_t instid, uint32_t idx);
   ShaderDebugTrace *DebugPixel(uint32_t x, uint32_t y, uint32_t sample, uint32_t primitive);
   ShaderDebugTrace *DebugThread(const uint32_t groupid[3], const uint32_t threadid[3]);
@@ -194,11 +202,13 @@ public:
   MeshFormat GetPostVSData(uint32_t instID, uint32_t viewID, MeshDataStage stage);
 
   rdcarray<EventUsage> GetUsage(ResourceId id);
+  bytebuf GetAnalysisCache();
 
   bytebuf GetBufferData(ResourceId buff, uint64_t offset, uint64_t len);
   bytebuf GetTextureData(ResourceId buff, const Subresource &sub);
 
   bool SaveTexture(const TextureSave &saveData, const char *path);
+  bool SaveTextures(const rdcarray<TextureSave> &saveData, const rdcarray<rdcstr> &paths);
 
   rdcarray<ShaderVariable> GetCBufferVariableContents(ResourceId pipeline, ResourceId shader,
                                                       const char *entryPoint, uint32_t cbufslot,
@@ -219,6 +229,7 @@ public:
 
 private:
   ReplayStatus PostCreateInit(IReplayDriver *device, RDCFile *rdc);
+  void LoadAnalysisCache(RDCFile *rdc);
 
   void FetchPipelineState(uint32_t eventId);
 
@@ -226,6 +237,35 @@ private:
   bool ContainsMarker(const rdcarray<DrawcallDescription> &draws);
   bool PassEquivalent(const DrawcallDescription &a, const DrawcallDescription &b);
 
+  const TextureDescription *GetPixelHistoryTexture(ResourceId target, Subresource &sub);
+  rdcarray<EventUsage> GetPixelHistoryEvents(ResourceId liveId, ResourceId target);
+
+  // a texture that has been read back for saving, ready to be converted and encoded to a file
+  struct PreparedTextureSave
+  {
+    PreparedTextureSave() = default;
+    PreparedTextureSave(const PreparedTextureSave &) = delete;
+    PreparedTextureSave &operator=(const PreparedTextureSave &) = delete;
+    ~PreparedTextureSave()
+    {
+      for(byte *b : subdata)
+        delete[] b;
+    }
+
+    TextureSave sd;
+    TextureDescription td;
+    rdcarray<byte *> subdata;
+    uint32_t rowPitch = 0;
+    uint32_t numMips = 1;
+    uint32_t numSlices = 1;
+    bool singleSlice = false;
+  };
+
+  // reading back the texture must happen on the replay thread, but encoding it only touches the
+  // prepared data so it can happen anywhere
+  bool PrepareTextureSave(const TextureSave &saveData, PreparedTextureSave &prepared);
+  static bool EncodeTextureSave(PreparedTextureSave &prepared, const char *path);
+
   IReplayDriver *GetDevice() { return m_pDevice; }
   FrameRecord m_FrameRecord;
   rdcarray<DrawcallDescription *> m_Drawcalls;
@@ -256,6 +296,9 @@ private:
 
   std::set<ResourceId> m_TargetResources;
   std::set<ResourceId> m_CustomShaders;
+  std::set<ResourceId> m_ReplacedResources;
+
+  AnalysisCache m_AnalysisCache;
 
   friend struct ReplayOutput;
 };
@@ -547,6 +547,30 @@ void StandardFillCBufferVariables(ResourceId shader, const rdcarray<ShaderConsta
   StandardFillCBufferVariables(shader, invars, outvars, data, 0);
 }
 
+rdcarray<PixelRegionHistory> StandardPixelHistoryRegion(IRemoteDriver *driver,
+                                                        const rdcarray<EventUsage> &events,
+                                                        ResourceId target, uint32_t x, uint32_t y,
+                                                        uint32_t width, uint32_t height,
+                                                        const Subresource &sub, CompType typeCast)
+{
+  rdcarray<PixelRegionHistory> ret;
+  ret.reserve(width * height);
+
+  for(uint32_t py = y; py < y + height; py++)
+  {
+    for(uint32_t px = x; px < x + width; px++)
+    {
+      PixelRegionHistory pixel;
+      pixel.x = px;
+      pixel.y = py;
+      pixel.modifications = driver->PixelHistory(events, target, px, py, sub, typeCast);
+      ret.push_back(pixel);
+    }
+  }
+
+  return ret;
+}
+
 uint64_t CalcMeshOutputSize(uint64_t curSize, uint64_t requiredOutput)
 {
   // resize exponentially up to 256MB to avoid repeated resizes
@@ -608,6 +632,28 @@ FloatVector HighlightCache::InterpretVertex(const byte *data, uint32_t vert,
   return ConvertComponents(fmt, data);
 }
 
+void FinaliseLoadStatistics(LoadStatistics &stats, StreamReader *reader)
+{
+  double readTime = reader->GetExternalReadTime();
+
+  // a decompressing stream's read time includes reading the compressed data from disk
+  StreamReader *compressed = reader->GetCompressedStream();
+  if(compressed)
+  {
+    stats.fileReadTime = compressed->GetExternalReadTime();
+    stats.decompressTime = RDCMAX(0.0, readTime - stats.fileReadTime);
+  }
+  else
+  {
+    stats.fileReadTime = readTime;
+    stats.decompressTime = 0.0;
+  }
+
+  stats.chunkProcessingTime = 0.0;
+  for(const ChunkLoadStatistics &chunk : stats.chunks)
+    stats.chunkProcessingTime += chunk.totalTime;
+}
+
 uint64_t inthash(uint64_t val, uint64_t seed)
 {
   return (seed << 5) + seed + val; /* hash * 33 + c */
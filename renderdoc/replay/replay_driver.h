@@ -179,6 +179,11 @@ public:
   virtual rdcarray<PixelModification> PixelHistory(rdcarray<EventUsage> events, ResourceId target,
                                                    uint32_t x, uint32_t y, const Subresource &sub,
                                                    CompType typeCast) = 0;
+  virtual rdcarray<PixelRegionHistory> PixelHistoryRegion(rdcarray<EventUsage> events,
+                                                          ResourceId target, uint32_t x, uint32_t y,
+                                                          uint32_t width, uint32_t height,
+                                                          const Subresource &sub,
+                                                          CompType typeCast) = 0;
   virtual ShaderDebugTrace *DebugVertex(uint32_t eventId, uint32_t vertid, uint32_t instid,
                                         uint32_t idx) = 0;
   virtual ShaderDebugTrace *DebugPixel(uint32_t eventId, uint32_t x, uint32_t y, uint32_t sample,
@@ -295,6 +300,43 @@ void StandardFillCBufferVariable(ResourceId shader, const ShaderVariableDescript
 void StandardFillCBufferVariables(ResourceId shader, const rdcarray<ShaderConstant> &invars,
                                   rdcarray<ShaderVariable> &outvars, const bytebuf &data);
 
+// for drivers that can only fetch pixel history for a single pixel at a time, fetches a region by
+// querying each pixel in turn
+rdcarray<PixelRegionHistory> StandardPixelHistoryRegion(IRemoteDriver *driver,
+                                                        const rdcarray<EventUsage> &events,
+                                                        ResourceId target, uint32_t x, uint32_t y,
+                                                        uint32_t width, uint32_t height,
+                                                        const Subresource &sub, CompType typeCast);
+
+// fills in the time spent reading and decompressing a capture's data from the stream it was read
+// with, and totals the time spent processing chunks
+void FinaliseLoadStatistics(LoadStatistics &stats, StreamReader *reader);
+
+// records the per-chunk timings a driver gathered while loading a capture, then finalises them
+template <typename ChunkType, typename ChunkInfo>
+void FillLoadStatistics(LoadStatistics &stats, const std::map<ChunkType, ChunkInfo> &chunkInfos,
+                        rdcstr (*getChunkName)(uint32_t), StreamReader *reader)
+{
+  for(auto it = chunkInfos.begin(); it != chunkInfos.end(); ++it)
+  {
+    ChunkLoadStatistics chunk;
+    chunk.name = getChunkName((uint32_t)it->first);
+    chunk.count = (uint32_t)it->second.count;
+    chunk.totalSize = it->second.totalsize;
+    chunk.totalTime = it->second.total;
+    stats.chunks.push_back(chunk);
+  }
+
+  auto initIt = chunkInfos.find((ChunkType)SystemChunk::InitialContents);
+  stats.initialContentsTime = initIt != chunkInfos.end() ? initIt->second.total : 0.0;
+
+  FinaliseLoadStatistics(stats, reader);
+}
+
+// djb2-style hash combining, used to key caches on the properties they depend on
+uint64_t inthash(uint64_t val, uint64_t seed);
+uint64_t inthash(ResourceId id, uint64_t seed);
+
 // simple cache for when we need buffer data for highlighting
 // vertices, typical use will be lots of vertices in the same
 // mesh, not jumping back and forth much between meshes.
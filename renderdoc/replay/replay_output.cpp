@@ -24,11 +24,16 @@
  ******************************************************************************/
 
 #include "common/common.h"
+#include "core/settings.h"
 #include "maths/formatpacking.h"
 #include "maths/matrix.h"
 #include "strings/string_utils.h"
 #include "replay_controller.h"
 
+RDOC_CONFIG(bool, Replay_CPUVertexPicking, true,
+            "Pick vertices in meshes on the CPU, using a hierarchy built once for each mesh, "
+            "instead of testing every vertex on the GPU for each pick.");
+
 static uint64_t GetHandle(WindowingData window)
 {
 #if ENABLED(RDOC_LINUX)
@@ -212,6 +217,9 @@ void ReplayOutput::SetFrameEvent(int eventId)
 
   m_EventID = eventId;
 
+  // the mesh data may have changed even if the event hasn't, e.g. if a shader was edited
+  m_MeshPicker.Clear();
+
   m_OverlayDirty = (m_RenderData.texDisplay.overlay != DebugOverlay::NoOverlay);
   m_MainOutput.dirty = true;
 
@@ -411,12 +419,15 @@ rdcpair<uint32_t, uint32_t> ReplayOutput::PickVertex(uint32_t x, uint32_t y)
 
   // input data either doesn't vary with instance, or is trivial (all verts the same for that
   // element), so only care about fetching the right instance for post-VS stages
-  if((draw->flags & DrawFlags::Instanced) && m_RenderData.meshDisplay.type != MeshDataStage::VSIn)
-  {
-    // if no special options are enabled, just look at the current instance
-    uint32_t firstInst = m_RenderData.meshDisplay.curInstance;
-    uint32_t maxInst = m_RenderData.meshDisplay.curInstance + 1;
+  bool instanced =
+      (draw->flags & DrawFlags::Instanced) && m_RenderData.meshDisplay.type != MeshDataStage::VSIn;
+
+  // if no special options are enabled, just look at the current instance
+  uint32_t firstInst = m_RenderData.meshDisplay.curInstance;
+  uint32_t maxInst = m_RenderData.meshDisplay.curInstance + 1;
 
+  if(instanced)
+  {
     if(m_RenderData.meshDisplay.showPrevInstances)
     {
       firstInst = 0;
@@ -427,7 +438,76 @@ rdcpair<uint32_t, uint32_t> ReplayOutput::PickVertex(uint32_t x, uint32_t y)
       firstInst = 0;
       maxInst = RDCMAX(1U, draw->numInstances);
     }
+  }
+
+  if(Replay_CPUVertexPicking)
+  {
+    uint64_t key = 5381;
+    key = inthash(m_EventID, key);
+    key = inthash((uint64_t)cfg.type, key);
+    key = inthash(cfg.curView, key);
+    key = inthash(instanced ? firstInst : ~0U, key);
+    key = inthash(instanced ? maxInst : ~0U, key);
+    key = inthash((uint64_t)cfg.position.unproject, key);
+    key = inthash(cfg.position.indexByteStride, key);
+    key = inthash(cfg.position.indexByteOffset, key);
+    key = inthash(cfg.position.numIndices, key);
+    key = inthash((uint64_t)cfg.position.baseVertex, key);
+    key = inthash((uint64_t)cfg.position.topology, key);
+    key = inthash(cfg.position.vertexByteOffset, key);
+    key = inthash(cfg.position.vertexByteStride, key);
+    key = inthash(cfg.position.indexResourceId, key);
+    key = inthash(cfg.position.vertexResourceId, key);
+    key = inthash((uint64_t)cfg.position.format.type, key);
+    key = inthash((uint64_t)cfg.position.format.compType, key);
+    key = inthash((uint64_t)cfg.position.format.compCount, key);
+    key = inthash((uint64_t)cfg.position.format.compByteWidth, key);
+    key = inthash((uint64_t)cfg.position.allowRestart, key);
+    key = inthash((uint64_t)cfg.position.restartIndex, key);
+
+    // the picking hierarchy doesn't depend on the camera, so it's only rebuilt when the mesh
+    // changes. Once it's built picks don't need any data from the replay device.
+    if(m_MeshPicker.GetKey() != key)
+    {
+      m_MeshPicker.Clear();
+      m_MeshPicker.SetKey(key);
+
+      HighlightCache cache;
+      cache.driver = m_pDevice;
+
+      // unprojected positions in Vulkan have Y pointing down
+      bool flipY = m_pRenderer->m_APIProps.pipelineType == GraphicsAPI::Vulkan;
+
+      if(instanced)
+      {
+        MeshFormat fmt = m_pDevice->GetPostVSBuffers(draw->eventId, cfg.curInstance, cfg.curView,
+                                                     cfg.type);
+        uint64_t elemOffset = cfg.position.vertexByteOffset - fmt.vertexByteOffset;
+
+        for(uint32_t inst = firstInst; inst < maxInst; inst++)
+        {
+          MeshDisplay instCfg = cfg;
+
+          fmt = m_pDevice->GetPostVSBuffers(draw->eventId, inst, cfg.curView, cfg.type);
+          if(fmt.vertexResourceId != ResourceId())
+            instCfg.position.vertexByteOffset = fmt.vertexByteOffset + elemOffset;
+
+          m_MeshPicker.AddInstance(cache, m_EventID, instCfg, inst, flipY);
+        }
+      }
+      else
+      {
+        m_MeshPicker.AddInstance(cache, m_EventID, cfg, cfg.curInstance, flipY);
+      }
+
+      m_MeshPicker.Build();
+    }
 
+    return m_MeshPicker.Pick(cfg, m_Width, m_Height, x, y);
+  }
+
+  if(instanced)
+  {
     // used for post-VS output, calculate the offset of the element we're using as position,
     // relative to 0
     MeshFormat fmt =
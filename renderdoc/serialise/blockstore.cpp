@@ -0,0 +1,680 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "blockstore.h"
+#include "common/formatting.h"
+#include "core/settings.h"
+#include "lz4/lz4.h"
+#include "rdcfile.h"
+
+RDOC_CONFIG(bool, Capture_DeduplicateInitialContents, true,
+            "Split large initial contents such as buffer and texture data into blocks when "
+            "writing a capture, and only store each unique block once.");
+
+RDOC_CONFIG(rdcstr, Capture_ContentBlockStore, "",
+            "A directory to store deduplicated initial contents blocks in, shared between "
+            "captures, instead of inside each capture. Captures using it are not standalone "
+            "until packed with 'renderdoccmd pack'. When replaying, if set this overrides the "
+            "store directory recorded in the capture.");
+
+RDOC_CONFIG(uint32_t, Capture_ContentBlockMemoryMB, 256,
+            "The most memory in MB that unique initial contents blocks can use while a capture is "
+            "being written, before they are moved to a temporary file until the capture is "
+            "finished.");
+
+static const uint32_t ContentBlocksSectionVersion = 2;
+
+uint64_t ContentBlockStore::GetSerialisedSize(uint64_t byteSize)
+{
+  return ((byteSize + BlockSize - 1) / BlockSize) * sizeof(ContentBlockHash);
+}
+
+ContentBlockStore *ContentBlockStore::CreateForCapture()
+{
+  if(!Capture_DeduplicateInitialContents)
+    return NULL;
+
+  ContentBlockStore *ret = new ContentBlockStore;
+
+  rdcstr storePath = Capture_ContentBlockStore;
+
+  if(!storePath.empty())
+  {
+    storePath = FileIO::GetFullPathname(storePath);
+
+    // if the store can't be created, fall back to keeping the blocks in the capture
+    FileIO::CreateParentDirectory(storePath + "/store");
+
+    if(FileIO::exists(storePath.c_str()))
+    {
+      ret->m_StorePath = storePath;
+      ret->m_Flags = SharedStore;
+    }
+    else
+    {
+      RDCERR("Couldn't create content block store '%s', storing blocks in the capture",
+             storePath.c_str());
+    }
+  }
+
+  return ret;
+}
+
+ContentBlockStore::~ContentBlockStore()
+{
+  SAFE_DELETE(m_Reader);
+
+  if(m_SpillFile)
+  {
+    FileIO::fclose(m_SpillFile);
+    FileIO::Delete(m_SpillFilename.c_str());
+  }
+}
+
+ContentBlockHash ContentBlockStore::HashBlock(const byte *data, uint32_t size)
+{
+  return HashShaderContent(data, size);
+}
+
+rdcstr ContentBlockStore::GetBlockFilename(const rdcstr &storePath, const ContentBlockHash &hash)
+{
+  // split into subdirectories by the top byte so no single directory gets too large
+  return StringFormat::Fmt("%s/%02x/%016llx%016llx.blk", storePath.c_str(),
+                           uint32_t(hash.hash[0] >> 56), hash.hash[0], hash.hash[1]);
+}
+
+bool ContentBlockStore::WriteStoreBlock(const rdcstr &storePath, const ContentBlockHash &hash,
+                                        const byte *stored, uint32_t storedSize)
+{
+  rdcstr filename = GetBlockFilename(storePath, hash);
+
+  // another capture already stored this block
+  if(FileIO::exists(filename.c_str()))
+    return true;
+
+  FileIO::CreateParentDirectory(filename);
+
+  // write to a temporary file and move it into place, so a concurrent reader or writer never sees
+  // a partial block
+  rdcstr tmpname = StringFormat::Fmt("%s.%u.tmp", filename.c_str(), Process::GetCurrentPID());
+
+  if(!FileIO::WriteAll(tmpname.c_str(), stored, storedSize))
+  {
+    RDCERR("Couldn't write content block to '%s'", tmpname.c_str());
+    FileIO::Delete(tmpname.c_str());
+    return false;
+  }
+
+  if(!FileIO::Move(tmpname.c_str(), filename.c_str(), true))
+  {
+    FileIO::Delete(tmpname.c_str());
+    return FileIO::exists(filename.c_str());
+  }
+
+  return true;
+}
+
+void ContentBlockStore::AddBlock(const byte *data, uint32_t size, ContentBlockHash &hash)
+{
+  hash = HashBlock(data, size);
+
+  if(m_Lookup.find(hash) != m_Lookup.end())
+  {
+    m_DuplicateBytes += size;
+    return;
+  }
+
+  m_Scratch.resize(LZ4_compressBound(BlockSize));
+
+  int compSize = LZ4_compress_default((const char *)data, (char *)m_Scratch.data(), (int)size,
+                                      (int)m_Scratch.size());
+
+  // store uncompressed if compression doesn't help
+  const byte *stored = data;
+  uint32_t storedSize = size;
+
+  if(compSize > 0 && uint32_t(compSize) < size)
+  {
+    stored = m_Scratch.data();
+    storedSize = uint32_t(compSize);
+  }
+
+  BlockEntry entry = {hash, 0, storedSize, size};
+
+  // if the store can't be written to, fall back to keeping the blocks in the capture
+  if((m_Flags & SharedStore) && !WriteStoreBlock(m_StorePath, hash, stored, storedSize))
+    StopUsingStore();
+
+  if(!(m_Flags & SharedStore))
+  {
+    entry.offset = m_PendingOffset + m_PendingBlocks.size();
+    m_PendingBlocks.append(stored, storedSize);
+
+    if(m_PendingBlocks.size() >= uint64_t(Capture_ContentBlockMemoryMB) * 1024 * 1024)
+      SpillPendingBlocks();
+  }
+
+  m_Lookup[hash] = (uint32_t)m_Entries.size();
+  m_Entries.push_back(entry);
+}
+
+void ContentBlockStore::StopUsingStore()
+{
+  RDCERR("Couldn't write to content block store '%s', storing blocks in the capture",
+         m_StorePath.c_str());
+
+  // blocks already in the store are read back, so the capture has every block it references
+  for(BlockEntry &entry : m_Entries)
+  {
+    bytebuf stored;
+    rdcstr filename = GetBlockFilename(m_StorePath, entry.hash);
+
+    if(!FileIO::ReadAll(filename.c_str(), stored) || stored.size() != entry.storedSize)
+    {
+      RDCERR("Couldn't read back content block '%s'", filename.c_str());
+      m_WriteFailed = true;
+      stored.resize(entry.storedSize);
+    }
+
+    entry.offset = m_PendingOffset + m_PendingBlocks.size();
+    m_PendingBlocks.append(stored);
+  }
+
+  m_StorePath.clear();
+  m_Flags &= ~SharedStore;
+}
+
+void ContentBlockStore::SpillPendingBlocks()
+{
+  if(!m_SpillFile)
+  {
+    m_SpillFilename = StringFormat::Fmt("%srdoc_blocks_%u_%p.tmp",
+                                        FileIO::GetTempFolderFilename().c_str(),
+                                        Process::GetCurrentPID(), this);
+    m_SpillFile = FileIO::fopen(m_SpillFilename.c_str(), "w+b");
+
+    // if we can't spill, keep holding the blocks in memory
+    if(!m_SpillFile)
+    {
+      RDCERR("Couldn't create '%s' for content blocks", m_SpillFilename.c_str());
+      return;
+    }
+  }
+
+  // write at the end of what's been spilled successfully, not the end of the file
+  FileIO::fseek64(m_SpillFile, m_PendingOffset, SEEK_SET);
+  if(FileIO::fwrite(m_PendingBlocks.data(), 1, m_PendingBlocks.size(), m_SpillFile) !=
+     m_PendingBlocks.size())
+  {
+    RDCERR("Couldn't write content blocks to '%s'", m_SpillFilename.c_str());
+    m_WriteFailed = true;
+    return;
+  }
+
+  m_PendingOffset += m_PendingBlocks.size();
+  m_PendingBlocks.clear();
+}
+
+bool ContentBlockStore::WriteBlocks(StreamWriter *writer, const byte *data, uint64_t byteSize)
+{
+  for(uint64_t offs = 0; offs < byteSize; offs += BlockSize)
+  {
+    ContentBlockHash hash;
+    AddBlock(data + offs, (uint32_t)RDCMIN<uint64_t>(BlockSize, byteSize - offs), hash);
+
+    if(!writer->Write(hash))
+      return false;
+  }
+
+  return true;
+}
+
+bool ContentBlockStore::WriteSection(RDCFile &output, const rdcstr &storePath,
+                                     rdcarray<BlockEntry> entries,
+                                     RENDERDOC_ProgressCallback progress,
+                                     StoredBlockCallback getStored)
+{
+  SectionProperties props;
+  props.type = SectionType::ContentBlocks;
+  props.version = ContentBlocksSectionVersion;
+  // not compressed as a whole - the blocks are compressed individually so they can be read in
+  // place in any order
+  props.flags = SectionFlags::NoFlags;
+
+  uint32_t flags = storePath.empty() ? NoFlags : SharedStore;
+
+  uint64_t offset = 0;
+  for(BlockEntry &entry : entries)
+  {
+    entry.offset = (flags & SharedStore) ? 0 : offset;
+    offset += entry.storedSize;
+  }
+
+  StreamWriter *writer = output.WriteSection(props);
+
+  uint32_t blockSize = BlockSize;
+  uint32_t pathLength = (uint32_t)storePath.length();
+  uint64_t numBlocks = entries.size();
+
+  writer->Write(blockSize);
+  writer->Write(flags);
+  writer->Write(pathLength);
+  writer->Write(storePath.c_str(), pathLength);
+  writer->Write(numBlocks);
+  writer->Write(entries.data(), entries.byteSize());
+
+  bool success = !writer->IsErrored();
+
+  if(!(flags & SharedStore))
+  {
+    bytebuf storage;
+
+    for(size_t i = 0; success && i < entries.size(); i++)
+    {
+      const byte *stored = NULL;
+      success = getStored(entries[i], storage, stored) &&
+                writer->Write(stored, entries[i].storedSize);
+
+      if(progress && (i % 256) == 0)
+        progress(float(i) / float(entries.size()));
+    }
+  }
+
+  success = writer->Finish() && success && !writer->IsErrored();
+
+  delete writer;
+
+  if(progress)
+    progress(1.0f);
+
+  return success;
+}
+
+bool ContentBlockStore::WriteSection(RDCFile *rdc)
+{
+  uint64_t uniqueBytes = 0;
+  for(const BlockEntry &entry : m_Entries)
+    uniqueBytes += entry.size;
+
+  RDCLOG("Deduplicated initial contents: %llu MB in %zu unique blocks, %llu MB duplicated",
+         uniqueBytes / (1024 * 1024), m_Entries.size(), m_DuplicateBytes / (1024 * 1024));
+
+  bool success = WriteSection(
+      *rdc, m_StorePath, m_Entries, RENDERDOC_ProgressCallback(),
+      [this](const BlockEntry &entry, bytebuf &storage, const byte *&stored) {
+        if(entry.offset >= m_PendingOffset)
+        {
+          stored = m_PendingBlocks.data() + (entry.offset - m_PendingOffset);
+          return true;
+        }
+
+        // the block was spilled, read it back
+        storage.resize(entry.storedSize);
+        FileIO::fseek64(m_SpillFile, entry.offset, SEEK_SET);
+        stored = storage.data();
+        return FileIO::fread(storage.data(), 1, entry.storedSize, m_SpillFile) == entry.storedSize;
+      });
+
+  // a failed spill or store read-back means the section may be missing blocks
+  if(m_WriteFailed)
+  {
+    RDCERR("Not all content blocks could be written, the capture's initial contents may be "
+           "incomplete");
+    success = false;
+  }
+
+  m_PendingBlocks.clear();
+  m_PendingOffset = 0;
+  m_WriteFailed = false;
+
+  if(m_SpillFile)
+  {
+    FileIO::fclose(m_SpillFile);
+    FileIO::Delete(m_SpillFilename.c_str());
+    m_SpillFile = NULL;
+  }
+
+  return success;
+}
+
+ReplayStatus ContentBlockStore::Open(RDCFile *rdc)
+{
+  int sectionIdx = rdc->SectionIndex(SectionType::ContentBlocks);
+
+  if(sectionIdx < 0)
+    return ReplayStatus::Succeeded;
+
+  if(rdc->GetSectionProperties(sectionIdx).version != ContentBlocksSectionVersion)
+  {
+    RDCERR("Content blocks section is version %llu, only %u is supported",
+           rdc->GetSectionProperties(sectionIdx).version, ContentBlocksSectionVersion);
+    return ReplayStatus::FileIncompatibleVersion;
+  }
+
+  StreamReader *reader = rdc->ReadSection(sectionIdx);
+
+  uint32_t blockSize = 0, pathLength = 0;
+  uint64_t numBlocks = 0;
+
+  reader->Read(blockSize);
+  reader->Read(m_Flags);
+  reader->Read(pathLength);
+
+  if(reader->IsErrored() || blockSize != BlockSize || pathLength > reader->GetSize())
+  {
+    RDCERR("Invalid content blocks section, block size %u", blockSize);
+    delete reader;
+    return ReplayStatus::FileCorrupted;
+  }
+
+  m_StorePath.resize(pathLength);
+  reader->Read(m_StorePath.data(), pathLength);
+  reader->Read(numBlocks);
+
+  if(reader->IsErrored() || numBlocks > reader->GetSize() / sizeof(BlockEntry))
+  {
+    RDCERR("Invalid content blocks section with %llu blocks", numBlocks);
+    delete reader;
+    return ReplayStatus::FileCorrupted;
+  }
+
+  m_Entries.resize((size_t)numBlocks);
+  reader->Read(m_Entries.data(), m_Entries.byteSize());
+
+  if(m_Flags & SharedStore)
+  {
+    // a store configured for this machine takes precedence over the one the capture was made with
+    rdcstr storePath = Capture_ContentBlockStore;
+    if(!storePath.empty())
+      m_StorePath = FileIO::GetFullPathname(storePath);
+
+    if(!FileIO::exists(m_StorePath.c_str()))
+    {
+      RDCERR("Capture's initial contents are in the content block store '%s' which is missing. "
+             "Set Capture.ContentBlockStore to its location, or pack the capture where it was "
+             "made.",
+             m_StorePath.c_str());
+      delete reader;
+      return ReplayStatus::FileNotFound;
+    }
+  }
+  else
+  {
+    m_BlockDataSize = reader->GetSize() - reader->GetOffset();
+
+    // read the blocks in place from a mapped or in-memory section, otherwise load them
+    m_BlockData = reader->ReadInPlace(m_BlockDataSize);
+
+    if(!m_BlockData)
+    {
+      m_BlockDataStorage.resize((size_t)m_BlockDataSize);
+      reader->Read(m_BlockDataStorage.data(), m_BlockDataSize);
+      m_BlockData = m_BlockDataStorage.data();
+    }
+  }
+
+  if(reader->IsErrored())
+  {
+    RDCERR("Failed to read content blocks section");
+    delete reader;
+    return ReplayStatus::FileIOFailed;
+  }
+
+  for(size_t i = 0; i < m_Entries.size(); i++)
+    m_Lookup[m_Entries[i].hash] = (uint32_t)i;
+
+  m_Reader = reader;
+
+  return ReplayStatus::Succeeded;
+}
+
+bool ContentBlockStore::GetStoredBlock(const BlockEntry &entry, bytebuf &storage,
+                                       const byte *&stored)
+{
+  if(m_Flags & SharedStore)
+  {
+    rdcstr filename = GetBlockFilename(m_StorePath, entry.hash);
+
+    if(!FileIO::ReadAll(filename.c_str(), storage) || storage.size() != entry.storedSize)
+    {
+      RDCERR("Couldn't read content block '%s'", filename.c_str());
+      return false;
+    }
+
+    stored = storage.data();
+    return true;
+  }
+
+  if(entry.offset + entry.storedSize > m_BlockDataSize)
+  {
+    RDCERR("Content block at %llu (%u bytes) is outside the section's %llu bytes", entry.offset,
+           entry.storedSize, m_BlockDataSize);
+    return false;
+  }
+
+  stored = m_BlockData + entry.offset;
+  return true;
+}
+
+bool ContentBlockStore::ReadBlocks(StreamReader *reader, byte *data, uint64_t byteSize)
+{
+  for(uint64_t offs = 0; offs < byteSize; offs += BlockSize)
+  {
+    ContentBlockHash hash;
+    if(!reader->Read(hash))
+      return false;
+
+    if(data == NULL)
+      continue;
+
+    uint32_t size = (uint32_t)RDCMIN<uint64_t>(BlockSize, byteSize - offs);
+
+    auto it = m_Lookup.find(hash);
+
+    if(it == m_Lookup.end() || m_Entries[it->second].size != size)
+    {
+      RDCERR("Missing content block %016llx%016llx of %u bytes", hash.hash[0], hash.hash[1], size);
+      return false;
+    }
+
+    const BlockEntry &entry = m_Entries[it->second];
+
+    const byte *stored = NULL;
+    if(!GetStoredBlock(entry, m_Scratch, stored))
+      return false;
+
+    if(entry.storedSize == entry.size)
+    {
+      memcpy(data + offs, stored, size);
+    }
+    else
+    {
+      int decompSize = LZ4_decompress_safe((const char *)stored, (char *)data + offs,
+                                           (int)entry.storedSize, (int)size);
+
+      if(decompSize != (int)size)
+      {
+        RDCERR("Content block %016llx%016llx is corrupt", hash.hash[0], hash.hash[1]);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool ContentBlockStore::CopySection(RDCFile *input, RDCFile &output, const rdcstr &storePath,
+                                    RENDERDOC_ProgressCallback progress)
+{
+  ContentBlockStore source;
+
+  if(source.Open(input) != ReplayStatus::Succeeded)
+    return false;
+
+  // nothing to copy
+  if(!source.IsOpen())
+    return true;
+
+  rdcstr fullStorePath = storePath.empty() ? rdcstr() : FileIO::GetFullPathname(storePath);
+
+  bytebuf storage;
+
+  // move the blocks into the shared store first, the section then only needs the index
+  if(!fullStorePath.empty())
+  {
+    for(size_t i = 0; i < source.m_Entries.size(); i++)
+    {
+      const BlockEntry &entry = source.m_Entries[i];
+
+      const byte *stored = NULL;
+      if(!source.GetStoredBlock(entry, storage, stored) ||
+         !WriteStoreBlock(fullStorePath, entry.hash, stored, entry.storedSize))
+        return false;
+
+      if(progress && (i % 256) == 0)
+        progress(float(i) / float(source.m_Entries.size()));
+    }
+  }
+
+  return WriteSection(output, fullStorePath, source.m_Entries, progress,
+                      [&source](const BlockEntry &entry, bytebuf &storage, const byte *&stored) {
+                        return source.GetStoredBlock(entry, storage, stored);
+                      });
+}
+
+#if ENABLED(ENABLE_UNIT_TESTS)
+
+#include "catch/catch.hpp"
+
+TEST_CASE("Test content block deduplication", "[blockstore]")
+{
+  // three payloads where the second repeats the first and the third shares its first block
+  bytebuf a, b, c;
+  a.resize(ContentBlockStore::BlockSize * 2 + 100);
+  for(size_t i = 0; i < a.size(); i++)
+    a[i] = byte((i * 37) >> 3);
+  b = a;
+  c.resize(ContentBlockStore::BlockSize + 5);
+  memcpy(c.data(), a.data(), c.size());
+
+  StreamWriter stream(StreamWriter::DefaultScratchSize);
+
+  ContentBlockStore writeStore;
+  CHECK(writeStore.WriteBlocks(&stream, a.data(), a.size()));
+  CHECK(writeStore.WriteBlocks(&stream, b.data(), b.size()));
+  CHECK(writeStore.WriteBlocks(&stream, c.data(), c.size()));
+
+  CHECK(stream.GetOffset() == ContentBlockStore::GetSerialisedSize(a.size()) * 2 +
+                                  ContentBlockStore::GetSerialisedSize(c.size()));
+
+  RDCFile rdc;
+  rdc.SetData(RDCDriver::Unknown, "test", 0, NULL);
+  CHECK(writeStore.WriteSection(&rdc));
+
+  ContentBlockStore readStore;
+  CHECK(readStore.Open(&rdc) == ReplayStatus::Succeeded);
+  REQUIRE(readStore.IsOpen());
+
+  StreamReader reader(stream.GetData(), stream.GetOffset());
+
+  bytebuf readA, readB, readC;
+  readA.resize(a.size());
+  readB.resize(b.size());
+  readC.resize(c.size());
+
+  CHECK(readStore.ReadBlocks(&reader, readA.data(), readA.size()));
+  CHECK(readStore.ReadBlocks(&reader, readB.data(), readB.size()));
+  CHECK(readStore.ReadBlocks(&reader, readC.data(), readC.size()));
+
+  CHECK((readA == a));
+  CHECK((readB == b));
+  CHECK((readC == c));
+
+  // the section holds the four unique blocks: two full blocks and the tail of a and c
+  int idx = rdc.SectionIndex(SectionType::ContentBlocks);
+  REQUIRE(idx >= 0);
+  CHECK(rdc.GetSectionProperties(idx).uncompressedSize < a.size() + c.size());
+
+  SECTION("Unpack to a shared store and pack again")
+  {
+    rdcstr storePath = StringFormat::Fmt("%s/blockstore_%u",
+                                         FileIO::GetTempFolderFilename().c_str(),
+                                         Process::GetCurrentPID());
+
+    RDCFile unpacked;
+    unpacked.SetData(RDCDriver::Unknown, "test", 0, NULL);
+    CHECK(ContentBlockStore::CopySection(&rdc, unpacked, storePath, RENDERDOC_ProgressCallback()));
+
+    RDCFile packed;
+    packed.SetData(RDCDriver::Unknown, "test", 0, NULL);
+    CHECK(
+        ContentBlockStore::CopySection(&unpacked, packed, rdcstr(), RENDERDOC_ProgressCallback()));
+
+    // only the index is in the unpacked capture
+    int unpackedIdx = unpacked.SectionIndex(SectionType::ContentBlocks);
+    REQUIRE(unpackedIdx >= 0);
+    CHECK(unpacked.GetSectionProperties(unpackedIdx).uncompressedSize < 1024);
+
+    for(RDCFile *file : {&unpacked, &packed})
+    {
+      ContentBlockStore store;
+      CHECK(store.Open(file) == ReplayStatus::Succeeded);
+      REQUIRE(store.IsOpen());
+
+      StreamReader reread(stream.GetData(), stream.GetOffset());
+
+      readA.fill(readA.size(), 0);
+      readB.fill(readB.size(), 0);
+      readC.fill(readC.size(), 0);
+
+      CHECK(store.ReadBlocks(&reread, readA.data(), readA.size()));
+      CHECK(store.ReadBlocks(&reread, readB.data(), readB.size()));
+      CHECK(store.ReadBlocks(&reread, readC.data(), readC.size()));
+
+      CHECK((readA == a));
+      CHECK((readB == b));
+      CHECK((readC == c));
+    }
+
+    // remove the store, which has a subdirectory per leading hash byte
+    rdcarray<PathEntry> subdirs;
+    FileIO::GetFilesInDirectory(storePath.c_str(), subdirs);
+    for(const PathEntry &subdir : subdirs)
+    {
+      rdcstr subdirPath = storePath + "/" + subdir.filename;
+
+      rdcarray<PathEntry> blocks;
+      FileIO::GetFilesInDirectory(subdirPath.c_str(), blocks);
+      for(const PathEntry &block : blocks)
+        FileIO::Delete((subdirPath + "/" + block.filename).c_str());
+
+      FileIO::DeleteDirectory(subdirPath.c_str());
+    }
+    FileIO::DeleteDirectory(storePath.c_str());
+
+    CHECK_FALSE(FileIO::exists(storePath.c_str()));
+  }
+};
+
+#endif    // ENABLED(ENABLE_UNIT_TESTS)
@@ -0,0 +1,146 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include "common/shader_cache.h"
+#include "core/core.h"
+#include "streamio.h"
+
+class RDCFile;
+
+// blocks are identified by the same 128-bit content hash as persistent shader caches, strong
+// enough that identical hashes are treated as identical data without comparing the bytes.
+typedef ShaderContentHash ContentBlockHash;
+
+// content-addressed storage for large payloads such as resource initial contents, serialised with
+// SerialiserFlags::Deduplicate. Each payload is split into fixed-size blocks and only the hashes of
+// the blocks are written in the stream, while each unique block is stored once - either in a
+// SectionType::ContentBlocks section in the capture, or in a store directory on disk that is shared
+// between captures so that repeated captures of the same content only store it once.
+//
+// Blocks are LZ4 compressed individually so that any block can be read on its own.
+class ContentBlockStore
+{
+public:
+  static const uint32_t BlockSize = 64 * 1024;
+
+  // payloads smaller than a block are written to the stream as normal
+  static bool IsDeduplicated(uint64_t byteSize) { return byteSize >= BlockSize; }
+  // the number of bytes a deduplicated payload of this size takes in the stream
+  static uint64_t GetSerialisedSize(uint64_t byteSize);
+
+  // returns a store to attach to a capture's serialiser, following the capture settings. Returns
+  // NULL if deduplication is disabled.
+  static ContentBlockStore *CreateForCapture();
+
+  ContentBlockStore() = default;
+  ~ContentBlockStore();
+
+  // no copies
+  ContentBlockStore(const ContentBlockStore &) = delete;
+
+  // writes the hashes of the blocks in data to the stream, and stores any blocks not seen before
+  bool WriteBlocks(StreamWriter *writer, const byte *data, uint64_t byteSize);
+  // writes the index of blocks, and the blocks themselves if they're not in a shared store, as the
+  // content blocks section. This must be written for any capture that had blocks written, even if
+  // none were.
+  bool WriteSection(RDCFile *rdc);
+
+  // loads the content blocks section from a capture if it has one. Returns an error if the section
+  // or a shared store it refers to is invalid.
+  ReplayStatus Open(RDCFile *rdc);
+  bool IsOpen() const { return m_Reader != NULL; }
+  // reads the block hashes for a payload and fills data with the blocks' contents. If data is NULL
+  // the hashes are skipped.
+  bool ReadBlocks(StreamReader *reader, byte *data, uint64_t byteSize);
+
+  // writes the content blocks section from input to output, storing the blocks in the capture if
+  // storePath is empty, or otherwise moving them to that shared store.
+  static bool CopySection(RDCFile *input, RDCFile &output, const rdcstr &storePath,
+                          RENDERDOC_ProgressCallback progress);
+
+private:
+  struct BlockEntry
+  {
+    ContentBlockHash hash;
+    // the offset of the stored block in the section's data, when not in a shared store
+    uint64_t offset;
+    // the size of the stored block, equal to size if the block is stored uncompressed
+    uint32_t storedSize;
+    uint32_t size;
+  };
+
+  enum StoreFlags : uint32_t
+  {
+    NoFlags = 0x0,
+    // the blocks are in the shared store directory, not in the section
+    SharedStore = 0x1,
+  };
+
+  typedef std::function<bool(const BlockEntry &entry, bytebuf &storage, const byte *&stored)>
+      StoredBlockCallback;
+
+  static ContentBlockHash HashBlock(const byte *data, uint32_t size);
+  static rdcstr GetBlockFilename(const rdcstr &storePath, const ContentBlockHash &hash);
+  static bool WriteStoreBlock(const rdcstr &storePath, const ContentBlockHash &hash,
+                              const byte *stored, uint32_t storedSize);
+  static bool WriteSection(RDCFile &output, const rdcstr &storePath, rdcarray<BlockEntry> entries,
+                           RENDERDOC_ProgressCallback progress, StoredBlockCallback getStored);
+
+  void AddBlock(const byte *data, uint32_t size, ContentBlockHash &hash);
+  // moves any blocks already written to the shared store into the capture, and stores the rest
+  // there too
+  void StopUsingStore();
+  // writes the pending blocks out to the spill file and frees them
+  void SpillPendingBlocks();
+  // fetches the stored (possibly compressed) bytes of a block, pointing into the section if
+  // possible
+  bool GetStoredBlock(const BlockEntry &entry, bytebuf &storage, const byte *&stored);
+
+  rdcstr m_StorePath;
+  uint32_t m_Flags = NoFlags;
+
+  rdcarray<BlockEntry> m_Entries;
+  std::map<ContentBlockHash, uint32_t> m_Lookup;
+
+  // when writing, the compressed unique blocks waiting to be written into the section, in section
+  // order. Blocks before m_PendingOffset have been spilled to a temporary file to bound memory use
+  bytebuf m_PendingBlocks;
+  uint64_t m_PendingOffset = 0;
+  FILE *m_SpillFile = NULL;
+  rdcstr m_SpillFilename;
+  // set if any block couldn't be written, so the section is incomplete
+  bool m_WriteFailed = false;
+
+  // when reading, the section and the stored blocks in it
+  StreamReader *m_Reader = NULL;
+  const byte *m_BlockData = NULL;
+  uint64_t m_BlockDataSize = 0;
+  bytebuf m_BlockDataStorage;
+
+  bytebuf m_Scratch;
+  uint64_t m_DuplicateBytes = 0;
+};
@@ -320,7 +320,8 @@ static ReplayStatus Structured2XML(const char *filename, const RDCFile &file, ui
   {
     const SectionProperties &props = file.GetSectionProperties(i);
 
-    if(props.type == SectionType::FrameCapture)
+    // the deduplicated contents are reassembled into the frame capture's buffers
+    if(props.type == SectionType::FrameCapture || props.type == SectionType::ContentBlocks)
       continue;
 
     StreamReader *reader = file.ReadSection(i);
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  ******************************************************************************/
 
+#include "common/timing.h"
 #include "lz4io.h"
 #include "serialiser.h"
 #include "zstdio.h"
@@ -190,4 +191,90 @@ TEST_CASE("Test ZSTD compression/decompression", "[streamio][zstd]")
   delete[] randomData;
 };
 
+static bytebuf CompressZSTD(const bytebuf &data, uint32_t numThreads, uint32_t chunkSize,
+                            double *ms = NULL)
+{
+  StreamWriter buf(StreamWriter::DefaultScratchSize);
+
+  PerformanceTimer timer;
+
+  {
+    StreamWriter writer(new ZSTDCompressor(&buf, Ownership::Nothing, 7, numThreads),
+                        Ownership::Stream);
+
+    for(size_t offs = 0; offs < data.size(); offs += chunkSize)
+      writer.Write(data.data() + offs, RDCMIN<size_t>(chunkSize, data.size() - offs));
+
+    writer.Finish();
+
+    CHECK_FALSE(writer.IsErrored());
+  }
+
+  if(ms)
+    *ms = timer.GetMilliseconds();
+
+  return bytebuf(buf.GetData(), (size_t)buf.GetOffset());
+}
+
+static bytebuf MakeCompressibleData(size_t size)
+{
+  bytebuf data;
+  data.resize(size);
+
+  // a mix of runs, ramps and noise, so blocks compress differently
+  for(size_t i = 0; i < data.size(); i++)
+  {
+    size_t block = i / 10000;
+    if(block % 3 == 0)
+      data[i] = byte(block);
+    else if(block % 3 == 1)
+      data[i] = byte(i);
+    else
+      data[i] = byte(rand() & 0xff);
+  }
+
+  return data;
+}
+
+TEST_CASE("Test ZSTD multithreaded compression", "[streamio][zstd]")
+{
+  bytebuf data = MakeCompressibleData(5 * 1024 * 1024 + 12345);
+
+  bytebuf single = CompressZSTD(data, 1, 100000);
+
+  // blocks are compressed independently, so the output is identical regardless of threads or how
+  // the writes are split up
+  for(uint32_t threads : {2U, 3U, 8U})
+  {
+    bytebuf multi = CompressZSTD(data, threads, 777777);
+    CHECK((multi == single));
+  }
+
+  StreamReader reader(new ZSTDDecompressor(new StreamReader(single), Ownership::Stream),
+                      data.size(), Ownership::Stream);
+
+  bytebuf readData;
+  readData.resize(data.size());
+  reader.Read(readData.data(), readData.size());
+
+  CHECK_FALSE(reader.IsErrored());
+  CHECK(reader.AtEnd());
+  CHECK((readData == data));
+};
+
+TEST_CASE("Benchmark ZSTD compression threads", "[.][benchmark][zstd]")
+{
+  bytebuf data = MakeCompressibleData(64 * 1024 * 1024);
+
+  for(uint32_t threads : {1U, 2U, 4U, 8U})
+  {
+    double ms = 0.0;
+    bytebuf compressed = CompressZSTD(data, threads, 1024 * 1024, &ms);
+
+    RDCLOG("%u threads: %.2f ms, %.1f MB/s, ratio %.2f", threads, ms,
+           double(data.size()) / (1024.0 * 1024.0) / (ms / 1000.0),
+           double(data.size()) / double(compressed.size()));
+  }
+};
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
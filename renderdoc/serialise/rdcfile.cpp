@@ -27,6 +27,7 @@
 #include "api/replay/version.h"
 #include "common/dds_readwrite.h"
 #include "common/formatting.h"
+#include "core/settings.h"
 #include "jpeg-compressor/jpge.h"
 #include "stb/stb_image.h"
 #include "lz4io.h"
@@ -787,6 +788,19 @@ int RDCFile::SectionIndex(const char *name) const
   return -1;
 }
 
+void RDCFile::SetFrameCaptureCompression(SectionFlags flags, uint32_t zstdLevel)
+{
+  if(flags != SectionFlags::NoFlags && flags != SectionFlags::LZ4Compressed &&
+     flags != SectionFlags::ZstdCompressed)
+  {
+    RDCWARN("Unrecognised capture compression %s, using lz4", ToStr(flags).c_str());
+    flags = SectionFlags::LZ4Compressed;
+  }
+
+  m_FrameCompression = flags;
+  m_ZstdLevel = zstdLevel;
+}
+
 StreamReader *RDCFile::ReadSection(int index) const
 {
   if(m_Error != ContainerError::NoError)
@@ -1141,8 +1155,10 @@ StreamWriter *RDCFile::WriteSection(const SectionProperties &props)
   }
   else if(props.flags & SectionFlags::ZstdCompressed)
   {
-    compWriter =
-        new StreamWriter(new ZSTDCompressor(fileWriter, Ownership::Stream), Ownership::Stream);
+    Compressor *comp = m_ZstdLevel > 0
+                           ? new ZSTDCompressor(fileWriter, Ownership::Stream, (int)m_ZstdLevel)
+                           : new ZSTDCompressor(fileWriter, Ownership::Stream);
+    compWriter = new StreamWriter(comp, Ownership::Stream);
   }
 
   uint64_t dataOffset = FileIO::ftell64(m_File);
@@ -96,6 +96,11 @@ public:
   StreamReader *ReadSection(int index) const;
   StreamWriter *WriteSection(const SectionProperties &props);
 
+  // sets the compression used for the frame capture section written by a capturing application,
+  // from its capture options. A zstd level of 0 uses the Zstd_CompressionLevel config setting
+  void SetFrameCaptureCompression(SectionFlags flags, uint32_t zstdLevel);
+  SectionFlags GetFrameCaptureCompression() const { return m_FrameCompression; }
+
   // Only valid if GetDriver returns RDCDriver::Image, passes over the underlying FILE * for use
   // loading the image directly, since the RDC container isn't there to read from a section.
   FILE *StealImageFileHandle(rdcstr &filename);
@@ -109,6 +114,9 @@ private:
 
   SectionProperties m_CurrentWritingProps;
 
+  SectionFlags m_FrameCompression = SectionFlags::LZ4Compressed;
+  uint32_t m_ZstdLevel = 0;
+
   uint32_t m_SerVer = 0;
 
   RDCDriver m_Driver = RDCDriver::Unknown;
@@ -26,7 +26,9 @@
 
 #include <set>
 #include "api/replay/structured_data.h"
+#include "common/call_profiler.h"
 #include "common/formatting.h"
+#include "blockstore.h"
 #include "streamio.h"
 
 // function to deallocate anything from a serialise. Default impl
@@ -55,6 +57,13 @@ enum class SerialiserFlags
 {
   NoFlags = 0x0,
   AllocateMemory = 0x1,
+  // when reading a buffer from a stream that's entirely in memory, point at the data in place
+  // instead of allocating and copying. Only for consumers that don't modify or keep the buffer.
+  ReadInPlace = 0x2,
+  // store the buffer in the serialiser's content block store if it has one and the buffer is
+  // large enough, writing only the hashes of its blocks in the stream. Only for data serialised
+  // into a capture's file.
+  Deduplicate = 0x4,
 };
 
 BITMASK_OPERATORS(SerialiserFlags);
@@ -118,6 +127,9 @@ public:
   bool IsDummy() { return m_Dummy; }
   StreamWriter *GetWriter() { return m_Write; }
   StreamReader *GetReader() { return m_Read; }
+  // returns true if a buffer was read with ReadInPlace and points into the stream, so mustn't be
+  // freed
+  bool IsReadInPlace(const void *el) const { return IsReading() && m_Read->Contains(el); }
   uint32_t GetChunkMetadataRecording() { return m_ChunkFlags; }
   void SetChunkMetadataRecording(uint32_t flags);
 
@@ -131,6 +143,9 @@ public:
   void *GetUserData() { return m_pUserData; }
   void SetUserData(void *userData) { m_pUserData = userData; }
   void SetStringDatabase(std::set<rdcstr> *db) { m_ExtStringDB = db; }
+  // buffers serialised with SerialiserFlags::Deduplicate are stored in this store, if set
+  void SetContentBlocks(ContentBlockStore *store) { m_ContentBlocks = store; }
+  ContentBlockStore *GetContentBlocks() { return m_ContentBlocks; }
   // jumps to the byte after the current chunk, can be called any time after BeginChunk
   void SkipCurrentChunk();
 
@@ -249,9 +264,23 @@ public:
       m_InternalElement = false;
     }
 
+    const bool dedup = m_ContentBlocks && (flags & SerialiserFlags::Deduplicate) &&
+                       ContentBlockStore::IsDeduplicated(byteSize);
+
     if(IsReading())
     {
-      VerifyArraySize(byteSize);
+      if(dedup)
+      {
+        // only the block hashes are in the stream
+        uint64_t storedSize = ContentBlockStore::GetSerialisedSize(byteSize);
+        VerifyArraySize(storedSize);
+        if(storedSize == 0)
+          byteSize = 0;
+      }
+      else
+      {
+        VerifyArraySize(byteSize);
+      }
     }
 
     if(ExportStructure())
@@ -281,7 +310,9 @@ public:
         // ensure byte alignment
         m_Write->AlignTo<ChunkAlignment>();
 
-        if(el)
+        if(el && dedup)
+          m_ContentBlocks->WriteBlocks(m_Write, el, byteSize);
+        else if(el)
           m_Write->Write(el, byteSize);
         else
           RDCASSERT(byteSize == 0);
@@ -291,11 +322,18 @@ public:
         // ensure byte alignment
         m_Read->AlignTo<ChunkAlignment>();
 
+        const byte *inPlace = NULL;
+        if(!m_Dummy && !dedup && (flags & SerialiserFlags::ReadInPlace))
+          inPlace = m_Read->ReadInPlace(byteSize);
+
+        if(inPlace)
+          el = (byte *)inPlace;
+
 // Coverity is unable to tie this allocation together with the automatic scoped deallocation in the
 // ScopedDeseralise* classes. We can verify with e.g. valgrind that there are no leaks, so to keep
 // the analysis non-spammy we just don't allocate for coverity builds
 #if !defined(__COVERITY__)
-        if(!m_Dummy && (flags & SerialiserFlags::AllocateMemory))
+        if(!inPlace && !m_Dummy && (flags & SerialiserFlags::AllocateMemory))
         {
           if(byteSize > 0)
             el = AllocAlignedBuffer(byteSize);
@@ -315,7 +353,15 @@ public:
         }
 #endif
 
-        m_Read->Read(el, byteSize);
+        if(dedup)
+        {
+          if(!m_ContentBlocks->ReadBlocks(m_Read, el, byteSize))
+            InvalidateStream();
+        }
+        else if(!inPlace)
+        {
+          m_Read->Read(el, byteSize);
+        }
       }
     }
 
@@ -1276,19 +1322,24 @@ private:
       RDCERR("Reading invalid array or byte buffer - %llu larger than total stream size %llu.",
              count, size);
 
-      // if we owned the previous stream, delete it
-      if(m_Ownership == Ownership::Stream)
-        delete m_Read;
-
-      // replace our stream with an invalid one so all subsequent reads fail
-      m_Read = new StreamReader(StreamReader::InvalidStream);
-      m_Ownership = Ownership::Stream;
+      InvalidateStream();
 
       // set the count to 0
       count = 0;
     }
   }
 
+  void InvalidateStream()
+  {
+    // if we owned the previous stream, delete it
+    if(m_Ownership == Ownership::Stream)
+      delete m_Read;
+
+    // replace our stream with an invalid one so all subsequent reads fail
+    m_Read = new StreamReader(StreamReader::InvalidStream);
+    m_Ownership = Ownership::Stream;
+  }
+
   void *m_pUserData = NULL;
   uint64_t m_Version = 0;
 
@@ -1304,6 +1355,8 @@ private:
   bool m_DrawChunk = false;
   bool m_Dummy = false;
 
+  ContentBlockStore *m_ContentBlocks = NULL;
+
   uint64_t m_LastChunkOffset = 0;
   uint64_t m_ChunkFixup = 0;
 
@@ -1551,7 +1604,9 @@ public:
   Chunk *Get()
   {
     End();
-    return new Chunk(m_Ser, m_Idx);
+    Chunk *ret = new Chunk(m_Ser, m_Idx);
+    CallProfiler::RecordBytes(ret->m_Length);
+    return ret;
   }
 
 private:
@@ -1630,7 +1685,7 @@ struct ScopedDeserialiseArray<SerialiserType, void *>
   ScopedDeserialiseArray(const SerialiserType &ser, void **el, uint64_t) : m_Ser(ser), m_El(el) {}
   ~ScopedDeserialiseArray()
   {
-    if(m_Ser.IsReading())
+    if(m_Ser.IsReading() && !m_Ser.IsReadInPlace(*m_El))
       FreeAlignedBuffer((byte *)*m_El);
   }
   const SerialiserType &m_Ser;
@@ -1646,7 +1701,7 @@ struct ScopedDeserialiseArray<SerialiserType, const void *>
   }
   ~ScopedDeserialiseArray()
   {
-    if(m_Ser.IsReading())
+    if(m_Ser.IsReading() && !m_Ser.IsReadInPlace(*m_El))
       FreeAlignedBuffer((byte *)*m_El);
   }
   const SerialiserType &m_Ser;
@@ -1659,7 +1714,7 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
   ScopedDeserialiseArray(const SerialiserType &ser, byte **el, uint64_t) : m_Ser(ser), m_El(el) {}
   ~ScopedDeserialiseArray()
   {
-    if(m_Ser.IsReading())
+    if(m_Ser.IsReading() && !m_Ser.IsReadInPlace(*m_El))
       FreeAlignedBuffer(*m_El);
   }
   const SerialiserType &m_Ser;
@@ -1698,6 +1753,14 @@ struct ScopedDeserialiseArray<SerialiserType, byte *>
       GET_SERIALISER, &obj, count);                                                               \
   GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj, count, SerialiserFlags::AllocateMemory)
 
+// as SERIALISE_ELEMENT_ARRAY, but when replaying from memory the buffer may point into the stream
+// rather than being a copy, so it must only be read and not kept past the serialise function.
+#define SERIALISE_ELEMENT_ARRAY_IN_PLACE(obj, count)                                              \
+  ScopedDeserialiseArray<decltype(GET_SERIALISER), decltype(obj)> CONCAT(deserialise_, __LINE__)( \
+      GET_SERIALISER, &obj, count);                                                               \
+  GET_SERIALISER.Serialise(STRING_LITERAL(#obj), obj, count,                                      \
+                           SerialiserFlags::AllocateMemory | SerialiserFlags::ReadInPlace)
+
 #define SERIALISE_ELEMENT_OPT(obj)                                           \
   ScopedDeserialiseNullable<decltype(GET_SERIALISER), decltype(obj)> CONCAT( \
       deserialise_, __LINE__)(GET_SERIALISER, &obj);                         \
@@ -585,6 +585,54 @@ TEST_CASE("Read/writing large buffers", "[serialiser]")
   FileIO::Delete(filename.c_str());
 };
 
+TEST_CASE("Read buffers in place", "[serialiser]")
+{
+  StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
+
+  byte data[100];
+  for(size_t i = 0; i < sizeof(data); i++)
+    data[i] = byte(i);
+
+  {
+    WriteSerialiser ser(buf, Ownership::Nothing);
+
+    ser.WriteChunk(5);
+
+    void *a = data;
+    const void *b = data + 10;
+    SERIALISE_ELEMENT_ARRAY_IN_PLACE(a, 10);
+    SERIALISE_ELEMENT_ARRAY(b, 90);
+
+    ser.EndChunk();
+  }
+
+  {
+    ReadSerialiser ser(new StreamReader(buf->GetData(), buf->GetOffset()), Ownership::Stream);
+
+    ser.ReadChunk<uint32_t>();
+
+    void *a = NULL;
+    const void *b = NULL;
+    {
+      SERIALISE_ELEMENT_ARRAY_IN_PLACE(a, 10);
+      SERIALISE_ELEMENT_ARRAY(b, 90);
+
+      // a points into the stream, b was copied out
+      CHECK(ser.IsReadInPlace(a));
+      CHECK_FALSE(ser.IsReadInPlace(b));
+
+      CHECK(memcmp(a, data, 10) == 0);
+      CHECK(memcmp(b, data + 10, 90) == 0);
+    }
+
+    ser.EndChunk();
+
+    CHECK_FALSE(ser.IsErrored());
+  }
+
+  delete buf;
+};
+
 TEST_CASE("Read/write chunk metadata", "[serialiser]")
 {
   StreamWriter *buf = new StreamWriter(StreamWriter::DefaultScratchSize);
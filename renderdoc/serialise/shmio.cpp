@@ -0,0 +1,256 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#include "shmio.h"
+#include "common/formatting.h"
+#include "common/timing.h"
+
+static const uint32_t SharedMemoryRingMagic = MAKE_FOURCC('R', 'D', 'S', 'M');
+
+// the counters are the total number of bytes ever written and read, so the difference is how much
+// is in the ring. Each is on its own cache line since the two sides update them constantly.
+struct SharedMemoryRing::Header
+{
+  uint32_t magic;
+  uint32_t padding;
+  uint64_t key;
+  uint64_t capacity;
+  byte padding1[40];
+
+  volatile int64_t written;
+  byte padding2[56];
+
+  volatile int64_t read;
+  byte padding3[56];
+};
+
+SharedMemoryRing *SharedMemoryRing::Create(uint64_t capacity)
+{
+  RDCCOMPILE_ASSERT(sizeof(Header) == 192, "Shared memory header has changed size");
+
+  static volatile int32_t counter = 0;
+
+  uint32_t pid = Process::GetCurrentPID();
+  uint32_t index = (uint32_t)Atomic::Inc32(&counter);
+
+  SharedMemoryRing *ret = new SharedMemoryRing;
+  ret->m_Name = StringFormat::Fmt("renderdoc_%u_%u", pid, index);
+  ret->m_Capacity = capacity;
+  ret->m_Memory = Network::CreateSharedMemory(ret->m_Name, sizeof(Header) + capacity);
+
+  if(ret->m_Memory == NULL)
+  {
+    delete ret;
+    return NULL;
+  }
+
+  // the key only needs to tell apart two rings that happened to get the same name on different
+  // machines, it isn't a secret
+  ret->m_Key = (Timing::GetTick() * 0x9E3779B97F4A7C15ULL) ^ (uint64_t(pid) << 32) ^ index;
+
+  ret->m_Header = (Header *)Network::GetSharedMemoryData(ret->m_Memory);
+  ret->m_Data = (byte *)(ret->m_Header + 1);
+
+  ret->m_Header->magic = SharedMemoryRingMagic;
+  ret->m_Header->key = ret->m_Key;
+  ret->m_Header->capacity = capacity;
+  ret->m_Header->written = 0;
+  ret->m_Header->read = 0;
+
+  return ret;
+}
+
+SharedMemoryRing *SharedMemoryRing::Open(const rdcstr &name, uint64_t capacity, uint64_t key)
+{
+  Network::SharedMemory *mem = Network::OpenSharedMemory(name, sizeof(Header) + capacity);
+
+  if(mem == NULL)
+    return NULL;
+
+  Header *header = (Header *)Network::GetSharedMemoryData(mem);
+
+  if(header->magic != SharedMemoryRingMagic || header->key != key || header->capacity != capacity)
+  {
+    RDCWARN("Shared memory '%s' doesn't match the expected ring", name.c_str());
+    Network::CloseSharedMemory(mem);
+    return NULL;
+  }
+
+  SharedMemoryRing *ret = new SharedMemoryRing;
+  ret->m_Name = name;
+  ret->m_Key = key;
+  ret->m_Capacity = capacity;
+  ret->m_Memory = mem;
+  ret->m_Header = header;
+  ret->m_Data = (byte *)(header + 1);
+  return ret;
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+  Network::CloseSharedMemory(m_Memory);
+}
+
+void SharedMemoryRing::Unlink()
+{
+  Network::UnlinkSharedMemory(m_Memory);
+}
+
+bool SharedMemoryRing::WaitFor(const volatile int64_t *counter, int64_t limit, bool isRead)
+{
+  PerformanceTimer timer;
+
+  // the other side is normally actively copying, so spin briefly before yielding the thread
+  uint32_t spins = 0;
+
+  while(*counter < limit)
+  {
+    if(timer.GetMilliseconds() > m_TimeoutMS)
+    {
+      RDCERR("Timed out waiting to %s shared memory, no progress for %u ms",
+             isRead ? "read from" : "write to", m_TimeoutMS);
+      m_Errored = true;
+      return false;
+    }
+
+    if(++spins > 1000)
+      Threading::Sleep(0);
+  }
+
+  return true;
+}
+
+bool SharedMemoryRing::Write(const void *data, uint64_t numBytes)
+{
+  if(m_Errored)
+    return false;
+
+  const byte *src = (const byte *)data;
+
+  while(numBytes > 0)
+  {
+    int64_t written = m_Header->written;
+
+    // wait until there's at least some space, i.e. the reader is less than a full ring behind
+    if(!WaitFor(&m_Header->read, written - (int64_t)m_Capacity + 1, false))
+      return false;
+
+    int64_t read = Atomic::ExchAdd64(&m_Header->read, 0);
+
+    uint64_t chunkSize = RDCMIN(numBytes, m_Capacity - uint64_t(written - read));
+
+    // copy in up to two pieces if the space wraps around the end of the ring
+    uint64_t offset = uint64_t(written) % m_Capacity;
+    uint64_t firstSize = RDCMIN(chunkSize, m_Capacity - offset);
+
+    memcpy(m_Data + offset, src, (size_t)firstSize);
+    memcpy(m_Data, src + firstSize, size_t(chunkSize - firstSize));
+
+    // the atomic add publishes the data to the reader
+    Atomic::ExchAdd64(&m_Header->written, (int64_t)chunkSize);
+
+    src += chunkSize;
+    numBytes -= chunkSize;
+  }
+
+  return true;
+}
+
+bool SharedMemoryRing::Read(void *data, uint64_t numBytes)
+{
+  if(m_Errored)
+    return false;
+
+  byte *dst = (byte *)data;
+
+  while(numBytes > 0)
+  {
+    int64_t read = m_Header->read;
+
+    // wait until there's at least some data
+    if(!WaitFor(&m_Header->written, read + 1, true))
+      return false;
+
+    int64_t written = Atomic::ExchAdd64(&m_Header->written, 0);
+
+    uint64_t chunkSize = RDCMIN(numBytes, uint64_t(written - read));
+
+    uint64_t offset = uint64_t(read) % m_Capacity;
+    uint64_t firstSize = RDCMIN(chunkSize, m_Capacity - offset);
+
+    // don't actually read if the destination buffer is NULL
+    if(dst)
+    {
+      memcpy(dst, m_Data + offset, (size_t)firstSize);
+      memcpy(dst + firstSize, m_Data, size_t(chunkSize - firstSize));
+      dst += chunkSize;
+    }
+
+    // the atomic add hands the space back to the writer
+    Atomic::ExchAdd64(&m_Header->read, (int64_t)chunkSize);
+
+    numBytes -= chunkSize;
+  }
+
+  return true;
+}
+
+SharedMemoryWriter::SharedMemoryWriter(SharedMemoryRing *ring, StreamWriter *write, Ownership own)
+    : Compressor(write, own), m_Ring(ring)
+{
+}
+
+bool SharedMemoryWriter::Write(const void *data, uint64_t numBytes)
+{
+  if(!m_Flushed)
+  {
+    m_Flushed = true;
+    if(!m_Write->Flush())
+      return false;
+  }
+
+  return m_Ring->Write(data, numBytes);
+}
+
+bool SharedMemoryWriter::Finish()
+{
+  return !m_Ring->IsErrored();
+}
+
+SharedMemoryReader::SharedMemoryReader(SharedMemoryRing *ring, StreamReader *read, Ownership own)
+    : Decompressor(read, own), m_Ring(ring)
+{
+}
+
+bool SharedMemoryReader::Recompress(Compressor *)
+{
+  // the ring has no end, so there's no way to know how much to recompress
+  RDCERR("Can't recompress a shared memory stream");
+  return false;
+}
+
+bool SharedMemoryReader::Read(void *data, uint64_t numBytes)
+{
+  return m_Ring->Read(data, numBytes);
+}
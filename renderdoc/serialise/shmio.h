@@ -0,0 +1,100 @@
+/******************************************************************************
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019-2020 Baldur Karlsson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+#pragma once
+
+#include "streamio.h"
+
+// a single-producer single-consumer ring buffer in memory shared between two processes on the same
+// machine, to move bulk data between them without compressing it and sending it over a socket.
+//
+// One side creates the ring and sends its name and key to the other over an existing connection.
+// The other side opens it by name and checks the key, which fails if it's on a different machine
+// (e.g. a forwarded port to a device) in which case the socket should be used as normal.
+class SharedMemoryRing
+{
+public:
+  static SharedMemoryRing *Create(uint64_t capacity);
+  static SharedMemoryRing *Open(const rdcstr &name, uint64_t capacity, uint64_t key);
+  ~SharedMemoryRing();
+
+  const rdcstr &GetName() const { return m_Name; }
+  uint64_t GetKey() const { return m_Key; }
+  uint64_t GetCapacity() const { return m_Capacity; }
+  // once both sides have opened the ring its name can be removed, so nothing is left behind
+  void Unlink();
+
+  // how long a read or write waits without the other side making any progress before failing
+  void SetTimeout(uint32_t milliseconds) { m_TimeoutMS = milliseconds; }
+  bool IsErrored() const { return m_Errored; }
+
+  // block until all the data has been written or read. If the ring fails the data being read or
+  // written is lost, so it stays errored and every later read or write fails too.
+  bool Write(const void *data, uint64_t numBytes);
+  bool Read(void *data, uint64_t numBytes);
+
+private:
+  struct Header;
+
+  SharedMemoryRing() = default;
+  bool WaitFor(const volatile int64_t *counter, int64_t limit, bool isRead);
+
+  Network::SharedMemory *m_Memory = NULL;
+  Header *m_Header = NULL;
+  byte *m_Data = NULL;
+
+  rdcstr m_Name;
+  uint64_t m_Key = 0;
+  uint64_t m_Capacity = 0;
+  uint32_t m_TimeoutMS = 5000;
+  bool m_Errored = false;
+};
+
+// streams data through a shared memory ring in place of compressing it into a socket. The stream
+// the transfer is announced on is flushed before any data goes through the ring, so the reader is
+// already waiting - otherwise the writer would stall on a transfer larger than the ring.
+class SharedMemoryWriter : public Compressor
+{
+public:
+  SharedMemoryWriter(SharedMemoryRing *ring, StreamWriter *write, Ownership own);
+
+  bool Write(const void *data, uint64_t numBytes);
+  bool Finish();
+
+private:
+  SharedMemoryRing *m_Ring;
+  bool m_Flushed = false;
+};
+
+class SharedMemoryReader : public Decompressor
+{
+public:
+  SharedMemoryReader(SharedMemoryRing *ring, StreamReader *read, Ownership own);
+
+  bool Recompress(Compressor *comp);
+  bool Read(void *data, uint64_t numBytes);
+
+private:
+  SharedMemoryRing *m_Ring;
+};
@@ -26,6 +26,11 @@
 #include <errno.h>
 #include "api/replay/stringise.h"
 #include "common/timing.h"
+#include "core/settings.h"
+
+RDOC_CONFIG(bool, Replay_MapFiles, true,
+            "Read capture sections and image files through a read-only memory mapping of the "
+            "file where possible, instead of buffered reads.");
 
 Compressor::~Compressor()
 {
@@ -40,6 +45,9 @@ Decompressor::~Decompressor()
 }
 
 static const uint64_t initialBufferSize = 64 * 1024;
+
+// smaller files are read in one go into the initial buffer anyway, so mapping them gains nothing
+static const uint64_t MinMappedFileSize = initialBufferSize;
 const byte StreamWriter::empty[128] = {};
 
 StreamReader::StreamReader(const byte *buffer, uint64_t bufferSize)
@@ -113,6 +121,11 @@ StreamReader::StreamReader(FILE *file, uint64_t fileSize, Ownership own)
     return;
   }
 
+  m_Ownership = own;
+
+  if(MapFile(file, FileIO::ftell64(file), fileSize))
+    return;
+
   m_File = file;
   m_InputSize = fileSize;
 
@@ -120,8 +133,6 @@ StreamReader::StreamReader(FILE *file, uint64_t fileSize, Ownership own)
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
   ReadFromExternal(m_BufferBase, RDCMIN(m_InputSize, m_BufferSize));
-
-  m_Ownership = own;
 }
 
 StreamReader::StreamReader(FILE *file)
@@ -138,17 +149,21 @@ StreamReader::StreamReader(FILE *file)
   }
 
   FileIO::fseek64(file, 0, SEEK_END);
-  m_InputSize = FileIO::ftell64(file);
+  uint64_t fileSize = FileIO::ftell64(file);
   FileIO::fseek64(file, 0, SEEK_SET);
 
+  m_Ownership = Ownership::Stream;
+
+  if(MapFile(file, 0, fileSize))
+    return;
+
   m_File = file;
+  m_InputSize = fileSize;
 
   m_BufferSize = initialBufferSize;
   m_BufferHead = m_BufferBase = AllocAlignedBuffer(m_BufferSize);
 
   ReadFromExternal(m_BufferBase, RDCMIN(m_InputSize, m_BufferSize));
-
-  m_Ownership = Ownership::Stream;
 }
 
 StreamReader::StreamReader(StreamReader *reader, uint64_t bufferSize)
@@ -179,7 +194,10 @@ StreamReader::~StreamReader()
   for(StreamCloseCallback cb : m_Callbacks)
     cb();
 
-  FreeAlignedBuffer(m_BufferBase);
+  if(m_Mapping)
+    FileIO::fmap_close(m_Mapping);
+  else
+    FreeAlignedBuffer(m_BufferBase);
 
   if(m_Ownership == Ownership::Stream)
   {
@@ -202,6 +220,26 @@ void StreamReader::SetOffset(uint64_t offs)
   m_BufferHead = m_BufferBase + offs;
 }
 
+bool StreamReader::MapFile(FILE *file, uint64_t offset, uint64_t fileSize)
+{
+  if(!Replay_MapFiles || fileSize < MinMappedFileSize)
+    return false;
+
+  m_Mapping = FileIO::fmap_open(file, offset, fileSize);
+
+  if(!m_Mapping)
+    return false;
+
+  // the mapping is independent of the file, so if we own it we're done with it already
+  if(m_Ownership == Ownership::Stream)
+    FileIO::fclose(file);
+
+  m_InputSize = m_BufferSize = fileSize;
+  m_BufferHead = m_BufferBase = (byte *)FileIO::fmap_data(m_Mapping);
+
+  return true;
+}
+
 bool StreamReader::Reserve(uint64_t numBytes)
 {
   RDCASSERT(m_Sock || m_File || m_Decompressor);
@@ -364,6 +402,8 @@ bool StreamReader::ReadFromExternal(void *buffer, uint64_t length)
 {
   bool success = true;
 
+  PerformanceTimer timer;
+
   if(m_Decompressor)
   {
     success = m_Decompressor->Read(buffer, length);
@@ -407,6 +447,8 @@ bool StreamReader::ReadFromExternal(void *buffer, uint64_t length)
     return false;
   }
 
+  m_ExternalReadTime += timer.GetMilliseconds();
+
   if(!success)
   {
     if(m_File)
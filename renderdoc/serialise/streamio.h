@@ -61,6 +61,8 @@ public:
   virtual bool Recompress(Compressor *comp) = 0;
   virtual bool Read(void *data, uint64_t numBytes) = 0;
 
+  StreamReader *GetCompressedStream() { return m_Read; }
+
 protected:
   StreamReader *m_Read;
   Ownership m_Ownership;
@@ -228,7 +230,40 @@ public:
     return Read(&data, sizeof(T));
   }
 
+  // if the whole stream is in memory (a buffer or a mapped file), returns a pointer to the next
+  // numBytes in place and skips past them. Otherwise returns NULL without reading anything, and the
+  // data must be read normally. The pointer is valid for as long as the stream.
+  const byte *ReadInPlace(uint64_t numBytes)
+  {
+    if(numBytes == 0 || m_Dummy || !m_BufferBase || m_File || m_Sock || m_Decompressor)
+      return NULL;
+
+    // let Read() handle the error for reading off the end
+    if(GetOffset() + numBytes > GetSize())
+      return NULL;
+
+    const byte *ret = m_BufferHead;
+    m_BufferHead += numBytes;
+    return ret;
+  }
+
+  // returns true if data points into this stream's own storage, e.g. from ReadInPlace()
+  bool Contains(const void *data)
+  {
+    const byte *ptr = (const byte *)data;
+    return ptr && m_BufferBase && ptr >= m_BufferBase && ptr < m_BufferBase + m_BufferSize;
+  }
+
   void AddCloseCallback(StreamCloseCallback callback) { m_Callbacks.push_back(callback); }
+  // the total time in milliseconds spent reading from the file, socket or decompressor behind the
+  // buffer. For a decompressing stream this includes reading the compressed stream.
+  double GetExternalReadTime() { return m_ExternalReadTime; }
+  // the stream compressed data is read from, if this stream is decompressing
+  StreamReader *GetCompressedStream()
+  {
+    return m_Decompressor ? m_Decompressor->GetCompressedStream() : NULL;
+  }
+
 private:
   inline uint64_t Available()
   {
@@ -239,6 +274,7 @@ private:
   bool Reserve(uint64_t numBytes);
   bool ReadLargeBuffer(void *buffer, uint64_t length);
   bool ReadFromExternal(void *buffer, uint64_t length);
+  bool MapFile(FILE *file, uint64_t offset, uint64_t fileSize);
 
   // base of the buffer allocation
   byte *m_BufferBase;
@@ -257,6 +293,10 @@ private:
   // file pointer, if we're reading from a file
   FILE *m_File = NULL;
 
+  // if the file was mapped into memory, it's read like any other in-memory buffer and m_File is
+  // NULL. The buffer points into the mapping so must not be freed
+  FileIO::FileMapping *m_Mapping = NULL;
+
   // socket, if we're reading from a socket
   Network::Socket *m_Sock = NULL;
 
@@ -266,6 +306,9 @@ private:
   // the offset in the file/decompressor that corresponds to the start of m_BufferBase
   uint64_t m_ReadOffset = 0;
 
+  // time spent in ReadFromExternal
+  double m_ExternalReadTime = 0.0;
+
   // flag indicating if an error has been encountered and the stream is now invalid
   bool m_HasError = false;
 
@@ -24,6 +24,9 @@
 
 #include "streamio.h"
 #include "common/timing.h"
+#include "lz4io.h"
+#include "serialiser.h"
+#include "shmio.h"
 
 #if ENABLED(ENABLE_UNIT_TESTS)
 
@@ -94,6 +97,80 @@ TEST_CASE("Test basic stream I/O operations", "[streamio]")
   CHECK(reader.IsErrored());
 };
 
+TEST_CASE("Test reading mapped files and in place", "[streamio]")
+{
+  rdcstr filename = FileIO::GetTempFolderFilename() + "/streamio_mapped.bin";
+
+  rdcarray<uint32_t> values;
+  values.resize(256 * 1024);
+  for(size_t i = 0; i < values.size(); i++)
+    values[i] = uint32_t(i * 7);
+
+  FileIO::WriteAll(filename.c_str(), values);
+
+  SECTION("Whole file")
+  {
+    StreamReader reader(FileIO::fopen(filename.c_str(), "rb"));
+
+    CHECK(reader.GetSize() == values.byteSize());
+
+    uint32_t test = 0;
+    reader.Read(test);
+    CHECK(test == 0);
+    reader.Read(test);
+    CHECK(test == 7);
+
+    const byte *inPlace = reader.ReadInPlace(sizeof(uint32_t) * 1000);
+    REQUIRE(inPlace);
+    CHECK(reader.Contains(inPlace));
+    CHECK(memcmp(inPlace, values.data() + 2, sizeof(uint32_t) * 1000) == 0);
+
+    CHECK(reader.GetOffset() == sizeof(uint32_t) * 1002);
+
+    reader.Read(test);
+    CHECK(test == 1002 * 7);
+
+    CHECK_FALSE(reader.Contains(&test));
+
+    // can't read in place off the end, and a normal read will then fail
+    CHECK(reader.ReadInPlace(values.byteSize()) == NULL);
+    CHECK_FALSE(reader.IsErrored());
+
+    bytebuf overrun;
+    overrun.resize(values.byteSize());
+    CHECK_FALSE(reader.Read(overrun.data(), overrun.size()));
+    CHECK(reader.IsErrored());
+  }
+
+  SECTION("Part of a file")
+  {
+    FILE *f = FileIO::fopen(filename.c_str(), "rb");
+
+    const uint64_t offset = sizeof(uint32_t) * 12345;
+    const uint64_t size = sizeof(uint32_t) * 100000;
+
+    FileIO::fseek64(f, offset, SEEK_SET);
+
+    {
+      StreamReader reader(f, size, Ownership::Nothing);
+
+      CHECK(reader.GetSize() == size);
+
+      rdcarray<uint32_t> readValues;
+      readValues.resize(100000);
+      reader.Read(readValues.data(), size);
+
+      CHECK(memcmp(readValues.data(), values.data() + 12345, (size_t)size) == 0);
+      CHECK(reader.AtEnd());
+      CHECK_FALSE(reader.IsErrored());
+    }
+
+    FileIO::fclose(f);
+  }
+
+  FileIO::Delete(filename.c_str());
+};
+
 TEST_CASE("Test stream I/O operations over the network", "[streamio][network]")
 {
   uint16_t port = 8235;
@@ -160,6 +237,53 @@ TEST_CASE("Test stream I/O operations over the network", "[streamio][network]")
     CHECK_FALSE(reader.IsErrored());
   };
 
+  SECTION("Send large blocks in both directions at once")
+  {
+    // each side sends far more than the socket buffers can hold before it receives anything, which
+    // only makes progress if incoming data is queued while waiting to send
+    const uint32_t size = 32 * 1024 * 1024;
+
+    sender->SetQueueIncomingWhileSending(true);
+    receiver->SetQueueIncomingWhileSending(true);
+
+    bytebuf senderData, receiverData;
+    senderData.resize(size);
+    receiverData.resize(size);
+
+    for(uint32_t i = 0; i < size; i++)
+    {
+      senderData[i] = byte(i * 7);
+      receiverData[i] = byte(i * 13 + 1);
+    }
+
+    bytebuf senderReceived, receiverReceived;
+    senderReceived.resize(size);
+    receiverReceived.resize(size);
+
+    bool senderSuccess = false, receiverSuccess = false;
+
+    Threading::ThreadHandle senderThread = Threading::CreateThread([&]() {
+      senderSuccess = sender->SendDataBlocking(senderData.data(), size) &&
+                      sender->RecvDataBlocking(senderReceived.data(), size);
+    });
+
+    Threading::ThreadHandle receiverThread = Threading::CreateThread([&]() {
+      receiverSuccess = receiver->SendDataBlocking(receiverData.data(), size) &&
+                        receiver->RecvDataBlocking(receiverReceived.data(), size);
+    });
+
+    Threading::JoinThread(senderThread);
+    Threading::CloseThread(senderThread);
+
+    Threading::JoinThread(receiverThread);
+    Threading::CloseThread(receiverThread);
+
+    CHECK(senderSuccess);
+    CHECK(receiverSuccess);
+    CHECK((senderReceived == receiverData));
+    CHECK((receiverReceived == senderData));
+  };
+
   SECTION("Send/receive multiple values")
   {
     StreamWriter writer(sender, Ownership::Nothing);
@@ -307,4 +431,236 @@ TEST_CASE("Test stream I/O operations over the network", "[streamio][network]")
   delete server;
 };
 
+// streams data from a writer thread to the reader on this thread, in different size pieces on each
+// side so that reads and writes don't line up with each other or the end of the ring
+static bytebuf TransferThroughRing(SharedMemoryRing *writeRing, SharedMemoryRing *readRing,
+                                   const bytebuf &data, double *ms = NULL)
+{
+  bytebuf received;
+  received.resize(data.size());
+
+  PerformanceTimer timer;
+
+  Threading::ThreadHandle sendThread = Threading::CreateThread([writeRing, &data]() {
+    size_t offs = 0;
+    while(offs < data.size())
+    {
+      size_t chunk = RDCMIN(data.size() - offs, size_t(1000 + (offs % 7777)));
+      if(!writeRing->Write(data.data() + offs, chunk))
+        break;
+      offs += chunk;
+    }
+  });
+
+  size_t offs = 0;
+  while(offs < received.size())
+  {
+    size_t chunk = RDCMIN(received.size() - offs, size_t(3000 + (offs % 5555)));
+    if(!readRing->Read(received.data() + offs, chunk))
+      break;
+    offs += chunk;
+  }
+
+  Threading::JoinThread(sendThread);
+  Threading::CloseThread(sendThread);
+
+  if(ms)
+    *ms = timer.GetMilliseconds();
+
+  return received;
+}
+
+static bytebuf MakeTransferData(size_t size)
+{
+  bytebuf data;
+  data.resize(size);
+
+  // a mix of flat and noisy data, like a typical texture
+  for(size_t i = 0; i < data.size(); i++)
+    data[i] = ((i / 4096) % 2) ? byte(i * 7 + (i >> 9)) : byte(i / 4096);
+
+  return data;
+}
+
+TEST_CASE("Test shared memory ring transfers", "[streamio][network]")
+{
+  SharedMemoryRing *ring = SharedMemoryRing::Create(4096);
+
+  REQUIRE(ring);
+
+  SECTION("Opening needs the right key")
+  {
+    SharedMemoryRing *wrong =
+        SharedMemoryRing::Open(ring->GetName(), ring->GetCapacity(), ring->GetKey() + 1);
+
+    CHECK(wrong == NULL);
+
+    SharedMemoryRing *missing =
+        SharedMemoryRing::Open(ring->GetName() + "_missing", ring->GetCapacity(), ring->GetKey());
+
+    CHECK(missing == NULL);
+
+    // claiming the ring is larger than it is must fail, not map past the end of it
+    SharedMemoryRing *oversized =
+        SharedMemoryRing::Open(ring->GetName(), ring->GetCapacity() * 64, ring->GetKey());
+
+    CHECK(oversized == NULL);
+  };
+
+  SharedMemoryRing *other =
+      SharedMemoryRing::Open(ring->GetName(), ring->GetCapacity(), ring->GetKey());
+
+  REQUIRE(other);
+
+  // both sides have it now, the name can go
+  ring->Unlink();
+
+  SECTION("Data larger than the ring")
+  {
+    bytebuf data = MakeTransferData(1024 * 1024 + 123);
+
+    bytebuf received = TransferThroughRing(ring, other, data);
+
+    CHECK_FALSE(ring->IsErrored());
+    CHECK_FALSE(other->IsErrored());
+    CHECK((received == data));
+  };
+
+  SECTION("Serialising through the ring")
+  {
+    StreamWriter announce(StreamWriter::DefaultScratchSize);
+    StreamReader announced(StreamReader::DummyStream);
+
+    rdcarray<uint64_t> values = {1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144, 233, 377, 610, 987};
+    bytebuf blob = MakeTransferData(50000);
+
+    rdcarray<uint64_t> readValues;
+    bytebuf readBlob;
+
+    // the reader needs to know exactly how much is coming
+    uint64_t size = 0;
+    {
+      WriteSerialiser ser(new StreamWriter(StreamWriter::InvalidStream), Ownership::Stream);
+      SERIALISE_ELEMENT(values);
+      SERIALISE_ELEMENT(blob);
+      size = ser.GetWriter()->GetOffset();
+    }
+
+    Threading::ThreadHandle sendThread = Threading::CreateThread([&]() {
+      WriteSerialiser ser(
+          new StreamWriter(new SharedMemoryWriter(ring, &announce, Ownership::Nothing),
+                           Ownership::Stream),
+          Ownership::Stream);
+      SERIALISE_ELEMENT(values);
+      SERIALISE_ELEMENT(blob);
+    });
+
+    {
+      ReadSerialiser ser(
+          new StreamReader(new SharedMemoryReader(other, &announced, Ownership::Nothing), size,
+                           Ownership::Stream),
+          Ownership::Stream);
+      SERIALISE_ELEMENT(readValues);
+      SERIALISE_ELEMENT(readBlob);
+
+      CHECK_FALSE(ser.IsErrored());
+      CHECK(ser.GetReader()->AtEnd());
+    }
+
+    Threading::JoinThread(sendThread);
+    Threading::CloseThread(sendThread);
+
+    CHECK(readValues == values);
+    CHECK((readBlob == blob));
+  };
+
+  SECTION("Reads time out without a writer")
+  {
+    other->SetTimeout(50);
+
+    uint32_t value = 0;
+    CHECK_FALSE(other->Read(&value, sizeof(value)));
+    CHECK(other->IsErrored());
+  };
+
+  delete other;
+  delete ring;
+};
+
+TEST_CASE("Benchmark shared memory against a loopback socket", "[.][benchmark][network]")
+{
+  bytebuf data = MakeTransferData(256 * 1024 * 1024);
+
+  {
+    SharedMemoryRing *ring = SharedMemoryRing::Create(32 * 1024 * 1024);
+    REQUIRE(ring);
+    SharedMemoryRing *other =
+        SharedMemoryRing::Open(ring->GetName(), ring->GetCapacity(), ring->GetKey());
+    REQUIRE(other);
+
+    double ms = 0.0;
+    bytebuf received = TransferThroughRing(ring, other, data, &ms);
+    CHECK((received == data));
+
+    RDCLOG("Shared memory: %.2f ms, %.1f MB/s", ms,
+           double(data.size()) / (1024.0 * 1024.0) / (ms / 1000.0));
+
+    delete other;
+    delete ring;
+  }
+
+  {
+    uint16_t port = 8335;
+    Network::Socket *server = NULL;
+
+    for(uint16_t probe = 0; probe < 20 && !server; probe++)
+      server = Network::CreateServerSocket("localhost", port++, 2);
+
+    REQUIRE(server);
+
+    Network::Socket *sender = Network::CreateClientSocket("localhost", port - 1, 10);
+    REQUIRE(sender);
+    Network::Socket *receiver = server->AcceptClient(250);
+    REQUIRE(receiver);
+
+    sender->SetTimeout(30000);
+    receiver->SetTimeout(30000);
+
+    bytebuf received;
+    received.resize(data.size());
+
+    PerformanceTimer timer;
+
+    // the same path as the replay proxy uses for bulk data over the network
+    Threading::ThreadHandle sendThread = Threading::CreateThread([sender, &data]() {
+      StreamWriter sockWriter(sender, Ownership::Nothing);
+      StreamWriter writer(new LZ4Compressor(&sockWriter, Ownership::Nothing), Ownership::Stream);
+      writer.Write(data.data(), data.size());
+      writer.Finish();
+      sockWriter.Flush();
+    });
+
+    {
+      StreamReader sockReader(receiver, Ownership::Nothing);
+      StreamReader reader(new LZ4Decompressor(&sockReader, Ownership::Nothing), data.size(),
+                          Ownership::Stream);
+      reader.Read(received.data(), received.size());
+    }
+
+    Threading::JoinThread(sendThread);
+    Threading::CloseThread(sendThread);
+
+    double ms = timer.GetMilliseconds();
+
+    CHECK((received == data));
+
+    RDCLOG("LZ4 over loopback socket: %.2f ms, %.1f MB/s", ms,
+           double(data.size()) / (1024.0 * 1024.0) / (ms / 1000.0));
+
+    delete sender;
+    delete receiver;
+    delete server;
+  }
+};
+
 #endif    // ENABLED(ENABLE_UNIT_TESTS)
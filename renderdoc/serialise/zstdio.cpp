@@ -24,23 +24,63 @@
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstdio.h"
+#include "common/jobsystem.h"
+#include "core/settings.h"
+
+RDOC_CONFIG(uint32_t, Zstd_CompressionLevel, 7,
+            "The zstd compression level used when writing zstd-compressed data, such as when "
+            "converting captures. From 1 (fastest) to 19 (smallest), higher levels up to 22 use "
+            "much more memory.");
+
+RDOC_CONFIG(uint32_t, Zstd_CompressionThreads, 4,
+            "The number of threads used to compress zstd data. Data is compressed in independent "
+            "blocks, so the output is the same regardless of the number of threads. Set to 1 to "
+            "compress only on the thread writing the data.");
 
 static const uint64_t zstdBlockSize = 128 * 1024;
 static const uint64_t compressBlockSize = ZSTD_compressBound(zstdBlockSize);
 
-ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own) : Compressor(write, own)
+// when compressing on multiple threads, how many blocks each thread gets from a page
+static const uint32_t blocksPerThread = 4;
+static const uint32_t maxThreads = 64;
+
+ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own)
+    : ZSTDCompressor(write, own, (int)Zstd_CompressionLevel, Zstd_CompressionThreads)
 {
-  m_Page = AllocAlignedBuffer(zstdBlockSize);
-  m_CompressBuffer = AllocAlignedBuffer(compressBlockSize);
+}
+
+ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own, int level)
+    : ZSTDCompressor(write, own, level, Zstd_CompressionThreads)
+{
+}
+
+ZSTDCompressor::ZSTDCompressor(StreamWriter *write, Ownership own, int level, uint32_t numThreads)
+    : Compressor(write, own)
+{
+  m_Level = RDCCLAMP(level, 1, ZSTD_maxCLevel());
+  m_NumThreads = RDCCLAMP(numThreads, 1U, maxThreads);
+
+  m_NumBlocks = m_NumThreads > 1 ? m_NumThreads * blocksPerThread : 1;
+  m_PageSize = zstdBlockSize * m_NumBlocks;
+
+  m_Page = AllocAlignedBuffer(m_PageSize);
+  m_CompressBuffer = AllocAlignedBuffer(compressBlockSize * m_NumBlocks);
 
   m_PageOffset = 0;
 
-  m_Stream = ZSTD_createCStream();
+  m_CompressedSizes.resize(m_NumBlocks);
+
+  m_Contexts.resize(m_NumThreads);
+  for(ZSTD_CCtx *&ctx : m_Contexts)
+    ctx = ZSTD_createCCtx();
 }
 
 ZSTDCompressor::~ZSTDCompressor()
 {
-  ZSTD_freeCStream(m_Stream);
+  delete m_Jobs;
+
+  for(ZSTD_CCtx *ctx : m_Contexts)
+    ZSTD_freeCCtx(ctx);
 
   FreeAlignedBuffer(m_Page);
   FreeAlignedBuffer(m_CompressBuffer);
@@ -59,7 +99,7 @@ bool ZSTDCompressor::Write(const void *data, uint64_t numBytes)
   // The only difference is that the lz4 streaming compression assumes a history of 64kb, where
   // here we use a larger block size but no history must be maintained.
 
-  if(m_PageOffset + numBytes <= zstdBlockSize)
+  if(m_PageOffset + numBytes <= m_PageSize)
   {
     // simplest path, no page wrapping/spanning at all
     memcpy(m_Page + m_PageOffset, data, (size_t)numBytes);
@@ -73,7 +113,7 @@ bool ZSTDCompressor::Write(const void *data, uint64_t numBytes)
 
     // copy whatever will fit on this page
     {
-      uint64_t firstBytes = zstdBlockSize - m_PageOffset;
+      uint64_t firstBytes = m_PageSize - m_PageOffset;
       memcpy(m_Page + m_PageOffset, src, (size_t)firstBytes);
 
       m_PageOffset += firstBytes;
@@ -92,7 +132,7 @@ bool ZSTDCompressor::Write(const void *data, uint64_t numBytes)
         return success;
 
       // how many bytes can we copy in this page?
-      uint64_t partialBytes = RDCMIN(zstdBlockSize, numBytes);
+      uint64_t partialBytes = RDCMIN(m_PageSize, numBytes);
       memcpy(m_Page, src, (size_t)partialBytes);
 
       // advance the source pointer, dest offset, and remove the bytes we read
@@ -108,90 +148,78 @@ bool ZSTDCompressor::Write(const void *data, uint64_t numBytes)
 bool ZSTDCompressor::Finish()
 {
   // This function just writes the current page and closes zstd. Since we assume all blocks are
-  // precisely 64kb in size
-  // only the last one can be smaller, so we only write a partial page when finishing.
+  // precisely 128kb in size only the last one can be smaller, so we only write a partial page when
+  // finishing.
   // Calling Write() after Finish() is illegal
 
   return FlushPage();
 }
 
-bool ZSTDCompressor::FlushPage()
+void ZSTDCompressor::CompressBlocks(uint32_t thread, uint32_t numBlocks)
 {
-  // if we encountered a stream error this will be NULL
-  if(!m_CompressBuffer)
-    return false;
-
-  ZSTD_inBuffer in = {m_Page, (size_t)m_PageOffset, 0};
-  ZSTD_outBuffer out = {m_CompressBuffer, ZSTD_CStreamOutSize(), 0};
-
-  bool success = true;
+  for(uint32_t b = thread; b < numBlocks; b += m_NumThreads)
+  {
+    uint64_t offs = b * zstdBlockSize;
 
-  success &= CompressZSTDFrame(in, out);
+    m_CompressedSizes[b] =
+        ZSTD_compressCCtx(m_Contexts[thread], m_CompressBuffer + b * compressBlockSize,
+                          (size_t)compressBlockSize, m_Page + offs,
+                          (size_t)RDCMIN(zstdBlockSize, m_PageOffset - offs), m_Level);
+  }
+}
 
-  // if there was an error, bail
+bool ZSTDCompressor::FlushPage()
+{
+  // if we encountered a stream error this will be NULL
   if(!m_CompressBuffer)
     return false;
 
-  // a bit redundant to write this but it means we can read the entire frame without
-  // doing multiple reads
-  success &= m_Write->Write((uint32_t)out.pos);
-  success &= m_Write->Write(m_CompressBuffer, out.pos);
+  // always write at least one frame, even if it's empty
+  uint32_t numBlocks = RDCMAX(1U, uint32_t((m_PageOffset + zstdBlockSize - 1) / zstdBlockSize));
 
-  // start writing to the start of the page again
-  m_PageOffset = 0;
+  uint32_t numJobs = RDCMIN(m_NumThreads, numBlocks);
 
-  return success;
-}
+  if(numJobs > 1)
+  {
+    if(!m_Jobs)
+      m_Jobs = new Threading::JobSystem(m_NumThreads - 1);
 
-bool ZSTDCompressor::CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out)
-{
-  size_t err = ZSTD_initCStream(m_Stream, 7);
+    rdcarray<Threading::Job> jobs;
+    for(uint32_t t = 0; t < numJobs; t++)
+      jobs.push_back(m_Jobs->Submit([this, t, numBlocks]() { CompressBlocks(t, numBlocks); }));
 
-  if(ZSTD_isError(err))
+    m_Jobs->Wait(jobs);
+  }
+  else
   {
-    RDCERR("Error compressing: %s", ZSTD_getErrorName(err));
-    FreeAlignedBuffer(m_Page);
-    FreeAlignedBuffer(m_CompressBuffer);
-    m_Page = m_CompressBuffer = NULL;
-    return false;
+    CompressBlocks(0, numBlocks);
   }
 
-  // keep calling compressStream until everything is consumed
-  while(in.pos < in.size)
-  {
-    size_t inpos = in.pos;
-    size_t outpos = out.pos;
+  bool success = true;
 
-    err = ZSTD_compressStream(m_Stream, &out, &in);
+  for(uint32_t b = 0; b < numBlocks; b++)
+  {
+    size_t size = m_CompressedSizes[b];
 
-    if(ZSTD_isError(err) || (inpos == in.pos && outpos == out.pos))
+    if(ZSTD_isError(size))
     {
-      if(ZSTD_isError(err))
-        RDCERR("Error compressing: %s", ZSTD_getErrorName(err));
-      else
-        RDCERR("Error compressing, no progress made");
+      RDCERR("Error compressing: %s", ZSTD_getErrorName(size));
       FreeAlignedBuffer(m_Page);
       FreeAlignedBuffer(m_CompressBuffer);
       m_Page = m_CompressBuffer = NULL;
       return false;
     }
-  }
-
-  err = ZSTD_endStream(m_Stream, &out);
 
-  if(ZSTD_isError(err) || err != 0)
-  {
-    if(ZSTD_isError(err))
-      RDCERR("Error compressing: %s", ZSTD_getErrorName(err));
-    else
-      RDCERR("Error compressing, couldn't end stream");
-    FreeAlignedBuffer(m_Page);
-    FreeAlignedBuffer(m_CompressBuffer);
-    m_Page = m_CompressBuffer = NULL;
-    return false;
+    // a bit redundant to write this but it means we can read the entire frame without
+    // doing multiple reads
+    success &= m_Write->Write((uint32_t)size);
+    success &= m_Write->Write(m_CompressBuffer + b * compressBlockSize, size);
   }
 
-  return true;
+  // start writing to the start of the page again
+  m_PageOffset = 0;
+
+  return success;
 }
 
 ZSTDDecompressor::ZSTDDecompressor(StreamReader *read, Ownership own) : Decompressor(read, own)
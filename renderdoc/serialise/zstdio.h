@@ -27,10 +27,19 @@
 #include "zstd/zstd.h"
 #include "streamio.h"
 
+namespace Threading
+{
+class JobSystem;
+};
+
 class ZSTDCompressor : public Compressor
 {
 public:
+  // uses the Zstd_CompressionLevel and Zstd_CompressionThreads config settings
   ZSTDCompressor(StreamWriter *write, Ownership own);
+  // uses the Zstd_CompressionThreads config setting
+  ZSTDCompressor(StreamWriter *write, Ownership own, int level);
+  ZSTDCompressor(StreamWriter *write, Ownership own, int level, uint32_t numThreads);
   ~ZSTDCompressor();
 
   bool Write(const void *data, uint64_t numBytes);
@@ -39,13 +48,24 @@ public:
 private:
   bool FlushPage();
 
-  bool CompressZSTDFrame(ZSTD_inBuffer &in, ZSTD_outBuffer &out);
+  void CompressBlocks(uint32_t thread, uint32_t numBlocks);
 
+  // the page holds m_NumBlocks blocks, each of which is compressed as an independent zstd frame,
+  // so with multiple threads a page's blocks are compressed in parallel.
   byte *m_Page;
   byte *m_CompressBuffer;
   uint64_t m_PageOffset;
+  uint64_t m_PageSize;
+  uint32_t m_NumBlocks;
+
+  int m_Level;
+  uint32_t m_NumThreads;
+
+  rdcarray<size_t> m_CompressedSizes;
+  rdcarray<ZSTD_CCtx *> m_Contexts;
 
-  ZSTD_CStream *m_Stream;
+  // created on first use, with one fewer worker than m_NumThreads since the writing thread helps
+  Threading::JobSystem *m_Jobs = NULL;
 };
 
 class ZSTDDecompressor : public Decompressor
@@ -133,6 +133,12 @@ inline std::string readable_typename<uint32_t>()
   return "uint";
 }
 
+template <>
+inline std::string readable_typename<float>()
+{
+  return "float";
+}
+
 } // detail
 
 //-----
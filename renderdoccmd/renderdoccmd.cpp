@@ -26,7 +26,13 @@
 #include "renderdoccmd.h"
 #include <app/renderdoc_app.h>
 #include <replay/version.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
 #include <string>
+#include <thread>
 
 rdcstr conv(const std::string &s)
 {
@@ -40,6 +46,47 @@ std::string conv(const rdcstr &s)
 
 static int command_usage(std::string command = "");
 
+// overrides the zstd settings used when writing captures. 0 leaves the configured value in place
+static void SetZstdSettings(uint32_t level, uint32_t threads)
+{
+  if(level > 0)
+  {
+    SDObject *setting = RENDERDOC_SetConfigSetting("Zstd.CompressionLevel");
+    if(setting)
+      setting->data.basic.u = level;
+  }
+
+  if(threads > 0)
+  {
+    SDObject *setting = RENDERDOC_SetConfigSetting("Zstd.CompressionThreads");
+    if(setting)
+      setting->data.basic.u = threads;
+  }
+}
+
+// replaces 'original' with the capture written to 'outfile', once that has been written
+// successfully. The original is never removed before the replacement has happened, and if the
+// replacement fails the new capture is left in place so that nothing is lost.
+static ReplayStatus ReplaceCapture(ReplayStatus status, const std::string &outfile,
+                                   const std::string &original)
+{
+  if(status != ReplayStatus::Succeeded)
+  {
+    // only a partially written capture is cleaned up, the original is untouched
+    std::remove(outfile.c_str());
+    return status;
+  }
+
+  if(!ReplaceWithFile(outfile, original))
+  {
+    std::cerr << "Couldn't replace '" << original << "', new capture left at '" << outfile << "'"
+              << std::endl;
+    return ReplayStatus::FileIOFailed;
+  }
+
+  return ReplayStatus::Succeeded;
+}
+
 // normally this is in the renderdoc core library, but it's needed for the 'unknown enum' path,
 // so we implement it here using ostringstream. It's not great, but this is a very uncommon path -
 // either for invalid values or for when a new enum is added and the code isn't updated
@@ -687,6 +734,8 @@ private:
   std::string outfile;
   std::string infmt;
   std::string outfmt;
+  uint32_t zstdLevel = 0;
+  uint32_t zstdThreads = 0;
 
 public:
   ConvertCommand() : Command() {}
@@ -699,6 +748,13 @@ public:
     parser.add<std::string>("convert-format", 'c', "The format of the output file.", false, "",
                             formats_reader(false));
     parser.add("list-formats", '\0', "Print a list of target formats.");
+    parser.add<uint32_t>("zstd-level", '\0',
+                         "The zstd level to use when writing captures, from 1 (fastest) to 19 "
+                         "(smallest).",
+                         false, 0);
+    parser.add<uint32_t>("threads", '\0',
+                         "The number of threads to use for zstd compression when writing captures.",
+                         false, 0);
     parser.stop_at_rest(true);
   }
   virtual const char *Description() { return "Convert between capture formats."; }
@@ -731,6 +787,9 @@ public:
     infmt = parser.get<std::string>("input-format");
     outfmt = parser.get<std::string>("convert-format");
 
+    zstdLevel = parser.get<uint32_t>("zstd-level");
+    zstdThreads = parser.get<uint32_t>("threads");
+
     return true;
   }
 
@@ -799,6 +858,8 @@ public:
       return 1;
     }
 
+    SetZstdSettings(zstdLevel, zstdThreads);
+
     ICaptureFile *file = RENDERDOC_OpenCaptureFile();
 
     ReplayStatus st = file->OpenFile(infile.c_str(), infmt.c_str(), NULL);
@@ -825,6 +886,684 @@ public:
   }
 };
 
+struct RecompressCommand : public Command
+{
+private:
+  std::vector<std::string> files;
+  std::string outdir;
+  uint32_t jobs = 2;
+  uint32_t zstdLevel = 0;
+  uint32_t zstdThreads = 0;
+
+  typedef std::chrono::high_resolution_clock clock;
+
+  static uint64_t fileSize(const std::string &filename)
+  {
+    std::ifstream f(filename, std::ios::binary | std::ios::ate);
+    if(!f)
+      return 0;
+    return (uint64_t)f.tellg();
+  }
+
+  static std::string ratioString(uint64_t before, uint64_t after, double seconds)
+  {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2) << double(before) / (1024.0 * 1024.0) << " MB -> "
+        << double(after) / (1024.0 * 1024.0) << " MB ("
+        << (before > 0 ? double(after) * 100.0 / double(before) : 0.0) << "%), "
+        << (seconds > 0.0 ? double(before) / (1024.0 * 1024.0) / seconds : 0.0) << " MB/s";
+    return oss.str();
+  }
+
+public:
+  RecompressCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<capture.rdc> [<capture.rdc> ...]");
+    parser.add<std::string>("output", 'o',
+                            "The directory to write recompressed captures to. By default each "
+                            "capture is replaced once it has been recompressed successfully.",
+                            false);
+    parser.add<uint32_t>("jobs", 'j', "The number of captures to recompress at once.", false, 2);
+    parser.add<uint32_t>("zstd-level", '\0',
+                         "The zstd level to recompress with, from 1 (fastest) to 19 (smallest).",
+                         false, 0);
+    parser.add<uint32_t>("threads", '\0',
+                         "The number of threads to use for zstd compression of each capture.",
+                         false, 0);
+  }
+  virtual const char *Description()
+  {
+    return "Recompress captures with zstd, reporting the compression ratio and throughput.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    files = parser.rest();
+
+    if(files.empty())
+    {
+      std::cerr << "Need at least one capture to recompress." << std::endl << std::endl;
+      std::cerr << parser.usage() << std::endl;
+      return false;
+    }
+
+    outdir = parser.get<std::string>("output");
+    jobs = std::max(1U, parser.get<uint32_t>("jobs"));
+    zstdLevel = parser.get<uint32_t>("zstd-level");
+    zstdThreads = parser.get<uint32_t>("threads");
+
+    return true;
+  }
+
+  virtual int Execute(const CaptureOptions &)
+  {
+    SetZstdSettings(zstdLevel, zstdThreads);
+
+    std::atomic<size_t> nextFile(0);
+    std::atomic<uint32_t> failures(0);
+    std::mutex lock;
+    uint64_t totalBefore = 0, totalAfter = 0;
+
+    clock::time_point start = clock::now();
+
+    auto worker = [&]() {
+      for(size_t i = nextFile++; i < files.size(); i = nextFile++)
+      {
+        const std::string &infile = files[i];
+        std::string outfile;
+
+        if(outdir.empty())
+        {
+          outfile = infile + ".recompress.tmp";
+        }
+        else
+        {
+          size_t slash = infile.find_last_of("/\\");
+          outfile = outdir + "/" + (slash == std::string::npos ? infile : infile.substr(slash + 1));
+        }
+
+        clock::time_point fileStart = clock::now();
+
+        ICaptureFile *file = RENDERDOC_OpenCaptureFile();
+
+        ReplayStatus st = file->OpenFile(infile.c_str(), "rdc", NULL);
+
+        if(st == ReplayStatus::Succeeded)
+          st = file->Convert(outfile.c_str(), "rdc", NULL, NULL);
+
+        file->Shutdown();
+
+        double seconds = std::chrono::duration<double>(clock::now() - fileStart).count();
+
+        uint64_t before = fileSize(infile);
+        uint64_t after = fileSize(outfile);
+
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(outdir.empty())
+          st = ReplaceCapture(st, outfile, infile);
+
+        if(st != ReplayStatus::Succeeded)
+        {
+          failures++;
+          std::cerr << "Couldn't recompress '" << infile << "': " << ToStr(st) << std::endl;
+          continue;
+        }
+
+        totalBefore += before;
+        totalAfter += after;
+
+        std::cout << "'" << infile << "': " << ratioString(before, after, seconds) << std::endl;
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for(uint32_t i = 1; i < std::min<size_t>(jobs, files.size()); i++)
+      threads.push_back(std::thread(worker));
+
+    worker();
+
+    for(std::thread &t : threads)
+      t.join();
+
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    std::cout << "Recompressed " << (files.size() - failures) << " of " << files.size()
+              << " captures: " << ratioString(totalBefore, totalAfter, seconds) << std::endl;
+
+    return failures > 0 ? 1 : 0;
+  }
+};
+
+struct SaveTexturesCommand : public Command
+{
+private:
+  std::string infile;
+  std::string outdir;
+  std::string format;
+  uint32_t eventId = 0;
+
+public:
+  SaveTexturesCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<capture.rdc>");
+    parser.add<std::string>("out", 'o', "The directory to save the textures to.", false, ".");
+    parser.add<std::string>(
+        "format", 'f', "The format of the output files.", false, "png",
+        cmdline::oneof<std::string>("dds", "png", "jpg", "bmp", "tga", "hdr", "exr"));
+    parser.add<uint32_t>("event", 'e',
+                         "The event to save the textures' contents at. Default is the last event.",
+                         false, 0);
+  }
+  virtual const char *Description()
+  {
+    return "Saves the contents of every texture in a capture to disk.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+    if(rest.empty())
+    {
+      std::cerr << "Error: savetextures command requires a capture filename." << std::endl
+                << std::endl
+                << parser.usage();
+      return false;
+    }
+
+    infile = rest[0];
+
+    rest.erase(rest.begin());
+
+    parser.set_rest(rest);
+
+    outdir = parser.get<std::string>("out");
+    format = parser.get<std::string>("format");
+    eventId = parser.get<uint32_t>("event");
+
+    return true;
+  }
+
+  virtual int Execute(const CaptureOptions &)
+  {
+    FileType type = FileType::PNG;
+
+    if(format == "dds")
+      type = FileType::DDS;
+    else if(format == "jpg")
+      type = FileType::JPG;
+    else if(format == "bmp")
+      type = FileType::BMP;
+    else if(format == "tga")
+      type = FileType::TGA;
+    else if(format == "hdr")
+      type = FileType::HDR;
+    else if(format == "exr")
+      type = FileType::EXR;
+
+    ICaptureFile *file = RENDERDOC_OpenCaptureFile();
+
+    if(file->OpenFile(infile.c_str(), "rdc", NULL) != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't load '" << infile << "'." << std::endl;
+      file->Shutdown();
+      return 1;
+    }
+
+    IReplayController *renderer = NULL;
+    ReplayStatus status = ReplayStatus::InternalError;
+    rdctie(status, renderer) = file->OpenCapture(ReplayOptions(), NULL);
+
+    file->Shutdown();
+
+    if(status != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't load and replay '" << infile << "': " << ToStr(status) << std::endl;
+      return 1;
+    }
+
+    if(eventId == 0)
+    {
+      const DrawcallDescription *draw = NULL;
+      for(const rdcarray<DrawcallDescription> *draws = &renderer->GetDrawcalls(); !draws->empty();
+          draws = &draw->children)
+        draw = &draws->back();
+
+      if(draw)
+        eventId = draw->eventId;
+    }
+
+    renderer->SetFrameEvent(eventId, true);
+
+    std::map<ResourceId, std::string> names;
+    for(const ResourceDescription &res : renderer->GetResources())
+      names[res.resourceId] = conv(res.name);
+
+    rdcarray<TextureSave> saves;
+    rdcarray<rdcstr> paths;
+
+    for(const TextureDescription &tex : renderer->GetTextures())
+    {
+      TextureSave save;
+      save.resourceId = tex.resourceId;
+      save.destType = type;
+      save.alpha = AlphaMapping::Preserve;
+
+      // DDS can hold every subresource, other formats just get the first
+      if(type == FileType::DDS)
+      {
+        save.mip = -1;
+        save.slice.sliceIndex = -1;
+      }
+
+      // prefix names with the index to keep them unique, and make sure they're valid filenames
+      std::string name = names[tex.resourceId];
+      for(char &c : name)
+        if(!isalnum(c) && c != '-' && c != '_')
+          c = '_';
+
+      name = std::to_string(saves.size()) + "_" + name;
+
+      saves.push_back(save);
+      paths.push_back(conv(outdir + "/" + name + "." + format));
+    }
+
+    std::cout << "Saving " << saves.size() << " textures from '" << infile << "' at event "
+              << eventId << " to '" << outdir << "'." << std::endl;
+
+    bool success = renderer->SaveTextures(saves, paths);
+
+    renderer->Shutdown();
+
+    if(!success)
+    {
+      std::cerr << "Not all textures could be saved." << std::endl;
+      return 1;
+    }
+
+    return 0;
+  }
+};
+
+struct AnalyseCommand : public Command
+{
+private:
+  std::string infile;
+  bool counters = true;
+
+public:
+  AnalyseCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<capture.rdc>");
+    parser.add("no-counters", '\0', "Don't fetch GPU counters, only compute resource usage.");
+  }
+  virtual const char *Description()
+  {
+    return "Precomputes counters and resource usage and stores them in the capture, so that they "
+           "don't need to be recomputed when it's opened on this machine.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+    if(rest.empty())
+    {
+      std::cerr << "Error: analyse command requires a capture filename." << std::endl
+                << std::endl
+                << parser.usage();
+      return false;
+    }
+
+    infile = rest[0];
+
+    rest.erase(rest.begin());
+
+    parser.set_rest(rest);
+
+    counters = !parser.exist("no-counters");
+
+    return true;
+  }
+
+  virtual int Execute(const CaptureOptions &)
+  {
+    ICaptureFile *file = RENDERDOC_OpenCaptureFile();
+
+    if(file->OpenFile(infile.c_str(), "rdc", NULL) != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't load '" << infile << "'." << std::endl;
+      file->Shutdown();
+      return 1;
+    }
+
+    IReplayController *renderer = NULL;
+    ReplayStatus status = ReplayStatus::InternalError;
+    rdctie(status, renderer) = file->OpenCapture(ReplayOptions(), NULL);
+
+    if(status != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't load and replay '" << infile << "': " << ToStr(status) << std::endl;
+      file->Shutdown();
+      return 1;
+    }
+
+    if(counters)
+    {
+      rdcarray<GPUCounter> available = renderer->EnumerateCounters();
+
+      std::cout << "Fetching " << available.size() << " counters." << std::endl;
+
+      renderer->FetchCounters(available);
+    }
+
+    const rdcarray<ResourceDescription> &resources = renderer->GetResources();
+
+    std::cout << "Computing usage of " << resources.size() << " resources." << std::endl;
+
+    for(const ResourceDescription &res : resources)
+      renderer->GetUsage(res.resourceId);
+
+    bytebuf cache = renderer->GetAnalysisCache();
+
+    renderer->Shutdown();
+
+    SectionProperties props;
+    props.type = SectionType::AnalysisCache;
+    props.name = ToStr(props.type);
+    props.flags = SectionFlags::LZ4Compressed;
+
+    bool success = file->WriteSection(props, cache);
+
+    file->Shutdown();
+
+    if(!success)
+    {
+      std::cerr << "Couldn't write analysis cache to '" << infile << "'." << std::endl;
+      return 1;
+    }
+
+    std::cout << "Wrote " << cache.size() << " bytes of analysis cache to '" << infile << "'."
+              << std::endl;
+
+    return 0;
+  }
+};
+
+struct BenchmarkCommand : public Command
+{
+private:
+  std::string infile;
+  std::string outfile;
+  uint32_t replays = 5;
+  uint32_t seeks = 8;
+  std::string seekEvents;
+  uint32_t readbacks = 16;
+
+  typedef std::chrono::high_resolution_clock clock;
+
+  static double msSince(clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+  }
+
+  static std::string jsonString(const std::string &str)
+  {
+    std::string ret = "\"";
+    for(char c : str)
+    {
+      if(c == '"' || c == '\\')
+      {
+        ret += '\\';
+        ret += c;
+      }
+      else if((unsigned char)c < 0x20)
+      {
+        char buf[8];
+        snprintf(buf, sizeof(buf), "\\u%04x", (unsigned int)c);
+        ret += buf;
+      }
+      else
+      {
+        ret += c;
+      }
+    }
+    return ret + "\"";
+  }
+
+  static void gatherEvents(const rdcarray<DrawcallDescription> &draws, rdcarray<uint32_t> &events)
+  {
+    for(const DrawcallDescription &d : draws)
+    {
+      gatherEvents(d.children, events);
+      if(d.children.empty())
+        events.push_back(d.eventId);
+    }
+  }
+
+public:
+  BenchmarkCommand() : Command() {}
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<capture.rdc>");
+    parser.add<std::string>("out", 'o', "The file to write JSON results to. Default is stdout.",
+                            false, "");
+    parser.add<uint32_t>("replays", 'n', "The number of full replays to time.", false, 5);
+    parser.add<uint32_t>("seeks", 's', "The number of evenly spaced events to time seeking to.",
+                         false, 8);
+    parser.add<std::string>(
+        "events", 'e', "A comma-separated list of events to time seeking to, instead of --seeks.",
+        false, "");
+    parser.add<uint32_t>("readbacks", 'r', "The maximum number of textures to time reading back.",
+                         false, 16);
+  }
+  virtual const char *Description()
+  {
+    return "Times loading and replaying a capture, and outputs the results as JSON.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+    if(rest.empty())
+    {
+      std::cerr << "Error: benchmark command requires a capture filename." << std::endl
+                << std::endl
+                << parser.usage();
+      return false;
+    }
+
+    infile = rest[0];
+
+    rest.erase(rest.begin());
+
+    parser.set_rest(rest);
+
+    outfile = parser.get<std::string>("out");
+    replays = parser.get<uint32_t>("replays");
+    seeks = parser.get<uint32_t>("seeks");
+    seekEvents = parser.get<std::string>("events");
+    readbacks = parser.get<uint32_t>("readbacks");
+
+    return true;
+  }
+
+  virtual int Execute(const CaptureOptions &)
+  {
+    clock::time_point start = clock::now();
+
+    ICaptureFile *file = RENDERDOC_OpenCaptureFile();
+
+    if(file->OpenFile(infile.c_str(), "rdc", NULL) != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't load '" << infile << "'." << std::endl;
+      file->Shutdown();
+      return 1;
+    }
+
+    double openFileTime = msSince(start);
+
+    IReplayController *renderer = NULL;
+    ReplayStatus status = ReplayStatus::InternalError;
+    rdctie(status, renderer) = file->OpenCapture(ReplayOptions(), NULL);
+
+    file->Shutdown();
+
+    if(status != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't load and replay '" << infile << "': " << ToStr(status) << std::endl;
+      return 1;
+    }
+
+    double loadTime = msSince(start);
+
+    FrameDescription frame = renderer->GetFrameInfo();
+
+    rdcarray<uint32_t> events;
+    gatherEvents(renderer->GetDrawcalls(), events);
+
+    uint32_t lastEvent = events.empty() ? 0 : events.back();
+
+    // time replaying the whole frame from the start
+    rdcarray<double> replayTimes;
+    for(uint32_t i = 0; i < replays; i++)
+    {
+      clock::time_point replayStart = clock::now();
+      renderer->SetFrameEvent(lastEvent, true);
+      replayTimes.push_back(msSince(replayStart));
+    }
+
+    // time seeking from one event to the next, as when stepping through the frame in the UI
+    rdcarray<uint32_t> seekPoints;
+    if(!seekEvents.empty())
+    {
+      std::istringstream list(seekEvents);
+      std::string eid;
+      while(std::getline(list, eid, ','))
+        seekPoints.push_back((uint32_t)strtoul(eid.c_str(), NULL, 10));
+    }
+    else if(!events.empty())
+    {
+      for(uint32_t i = 0; i < seeks; i++)
+        seekPoints.push_back(events[size_t(i) * events.size() / seeks]);
+    }
+
+    rdcarray<double> seekTimes;
+    for(uint32_t eid : seekPoints)
+    {
+      clock::time_point seekStart = clock::now();
+      renderer->SetFrameEvent(eid, false);
+      seekTimes.push_back(msSince(seekStart));
+    }
+
+    renderer->SetFrameEvent(lastEvent, false);
+
+    // time reading back texture contents at the end of the frame
+    uint32_t readbackCount = 0;
+    uint64_t readbackBytes = 0;
+    double readbackTime = 0.0;
+    for(const TextureDescription &tex : renderer->GetTextures())
+    {
+      if(readbackCount >= readbacks)
+        break;
+
+      clock::time_point readStart = clock::now();
+      bytebuf data = renderer->GetTextureData(tex.resourceId, Subresource());
+      readbackTime += msSince(readStart);
+
+      readbackCount++;
+      readbackBytes += data.size();
+    }
+
+    // time reflecting every shader
+    uint32_t reflectCount = 0;
+    double reflectTime = 0.0;
+    for(const ResourceDescription &res : renderer->GetResources())
+    {
+      if(res.type != ResourceType::Shader)
+        continue;
+
+      clock::time_point reflectStart = clock::now();
+      for(const ShaderEntryPoint &entry : renderer->GetShaderEntryPoints(res.resourceId))
+      {
+        renderer->GetShader(ResourceId(), res.resourceId, entry);
+        reflectCount++;
+      }
+      reflectTime += msSince(reflectStart);
+    }
+
+    GraphicsAPI api = renderer->GetAPIProperties().pipelineType;
+
+    renderer->Shutdown();
+
+    std::ofstream outstream;
+    if(!outfile.empty())
+    {
+      outstream.open(outfile.c_str());
+      if(!outstream)
+      {
+        std::cerr << "Couldn't open '" << outfile << "' for writing." << std::endl;
+        return 1;
+      }
+    }
+
+    std::ostream &out = outfile.empty() ? std::cout : outstream;
+
+    const LoadStatistics &load = frame.loadStatistics;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{" << std::endl;
+    out << "  \"capture\": " << jsonString(infile) << "," << std::endl;
+    out << "  \"api\": " << jsonString(conv(ToStr(api))) << "," << std::endl;
+    out << "  \"load\": {" << std::endl;
+    out << "    \"total_ms\": " << loadTime << "," << std::endl;
+    out << "    \"open_file_ms\": " << openFileTime << "," << std::endl;
+    out << "    \"file_read_ms\": " << load.fileReadTime << "," << std::endl;
+    out << "    \"decompress_ms\": " << load.decompressTime << "," << std::endl;
+    out << "    \"chunk_processing_ms\": " << load.chunkProcessingTime << "," << std::endl;
+    out << "    \"initial_contents_ms\": " << load.initialContentsTime << "," << std::endl;
+    out << "    \"compressed_bytes\": " << frame.compressedFileSize << "," << std::endl;
+    out << "    \"uncompressed_bytes\": " << frame.uncompressedFileSize << "," << std::endl;
+    out << "    \"chunks\": [";
+    for(size_t i = 0; i < load.chunks.size(); i++)
+    {
+      const ChunkLoadStatistics &chunk = load.chunks[i];
+      out << (i == 0 ? "" : ",") << std::endl;
+      out << "      {\"name\": " << jsonString(conv(chunk.name)) << ", \"count\": " << chunk.count
+          << ", \"bytes\": " << chunk.totalSize << ", \"ms\": " << chunk.totalTime << "}";
+    }
+    out << std::endl << "    ]" << std::endl;
+    out << "  }," << std::endl;
+
+    out << "  \"replays_ms\": [";
+    for(size_t i = 0; i < replayTimes.size(); i++)
+      out << (i == 0 ? "" : ", ") << replayTimes[i];
+    out << "]," << std::endl;
+
+    out << "  \"seeks\": [";
+    for(size_t i = 0; i < seekTimes.size(); i++)
+    {
+      out << (i == 0 ? "" : ",") << std::endl;
+      out << "    {\"event\": " << seekPoints[i] << ", \"ms\": " << seekTimes[i] << "}";
+    }
+    out << std::endl << "  ]," << std::endl;
+
+    out << "  \"readbacks\": {\"count\": " << readbackCount << ", \"bytes\": " << readbackBytes
+        << ", \"ms\": " << readbackTime << "}," << std::endl;
+    out << "  \"reflection\": {\"count\": " << reflectCount << ", \"ms\": " << reflectTime << "}"
+        << std::endl;
+    out << "}" << std::endl;
+
+    return 0;
+  }
+};
+
 struct TestCommand : public Command
 {
 private:
@@ -1252,6 +1991,94 @@ public:
   }
 };
 
+struct ContentBlocksCommand : public Command
+{
+private:
+  bool m_Unpack = false;
+  std::string rdc;
+  std::string output;
+  std::string store;
+
+public:
+  ContentBlocksCommand(bool unpack) : Command() { m_Unpack = unpack; }
+  virtual void AddOptions(cmdline::parser &parser)
+  {
+    parser.set_footer("<capture.rdc>");
+    parser.add<std::string>("output", 'o',
+                            "The file to write the capture to. By default the capture is replaced "
+                            "once it has been written successfully.",
+                            false);
+    parser.add<std::string>("store", 's',
+                            m_Unpack ? "The content block store directory to move blocks into."
+                                     : "The content block store directory the capture's blocks "
+                                       "are in, if it has moved since the capture was made.",
+                            m_Unpack);
+  }
+  virtual const char *Description()
+  {
+    if(m_Unpack)
+      return "Move a capture's deduplicated initial contents into a shared content block store.";
+    else
+      return "Copy a capture's initial contents from a shared content block store back into it.";
+  }
+  virtual bool IsInternalOnly() { return false; }
+  virtual bool IsCaptureCommand() { return false; }
+  virtual bool Parse(cmdline::parser &parser, GlobalEnvironment &)
+  {
+    std::vector<std::string> rest = parser.rest();
+    if(rest.empty())
+    {
+      std::cerr << "Error: this command requires a filename to load." << std::endl
+                << std::endl
+                << parser.usage();
+      return false;
+    }
+
+    rdc = rest[0];
+
+    output = parser.get<std::string>("output");
+    store = parser.get<std::string>("store");
+
+    return true;
+  }
+  virtual int Execute(const CaptureOptions &)
+  {
+    // when packing, the store given overrides the one recorded in the capture
+    if(!m_Unpack && !store.empty())
+    {
+      SDObject *setting = RENDERDOC_SetConfigSetting("Capture.ContentBlockStore");
+      if(setting)
+        setting->data.str = store.c_str();
+    }
+
+    std::string outfile = output.empty() ? rdc + ".blocks.tmp" : output;
+
+    ICaptureFile *capfile = RENDERDOC_OpenCaptureFile();
+
+    ReplayStatus status = capfile->OpenFile(rdc.c_str(), "rdc", NULL);
+
+    if(status == ReplayStatus::Succeeded)
+      status = capfile->RelocateContentBlocks(outfile.c_str(), m_Unpack ? store.c_str() : "", NULL);
+
+    capfile->Shutdown();
+
+    if(output.empty())
+      status = ReplaceCapture(status, outfile, rdc);
+
+    if(status != ReplayStatus::Succeeded)
+    {
+      std::cerr << "Couldn't " << (m_Unpack ? "unpack" : "pack") << " '" << rdc
+                << "': " << ToStr(status) << std::endl;
+      return 1;
+    }
+
+    std::cout << (m_Unpack ? "Unpacked '" : "Packed '") << rdc << "'"
+              << (output.empty() ? "" : " to '" + output + "'") << "." << std::endl;
+
+    return 0;
+  }
+};
+
 struct VulkanRegisterCommand : public Command
 {
 private:
@@ -1557,8 +2384,14 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
     add_command("capaltbit", new CapAltBitCommand());
     add_command("test", new TestCommand());
     add_command("convert", new ConvertCommand());
+    add_command("recompress", new RecompressCommand());
+    add_command("savetextures", new SaveTexturesCommand());
+    add_command("analyse", new AnalyseCommand());
+    add_command("benchmark", new BenchmarkCommand());
     add_command("embed", new EmbeddedSectionCommand(false));
     add_command("extract", new EmbeddedSectionCommand(true));
+    add_command("pack", new ContentBlocksCommand(false));
+    add_command("unpack", new ContentBlocksCommand(true));
 
     if(argv.size() <= 1)
     {
@@ -1633,6 +2466,27 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
               "Capturing Option: Include all live resources, not just those used by a frame.");
       cmd.add("opt-capture-all-cmd-lists", 0,
               "Capturing Option: In D3D11, record all command lists from application start.");
+      cmd.add<float>("opt-hitch-threshold", 0,
+                     "Capturing Option: Capture the frame after one taking longer than this many "
+                     "milliseconds.",
+                     false, 0.0f, cmdline::range(0.0f, 100000.0f));
+      cmd.add<float>("opt-hitch-median-factor", 0,
+                     "Capturing Option: Capture the frame after one taking longer than this "
+                     "multiple of the median recent frame time.",
+                     false, 0.0f, cmdline::range(0.0f, 1000.0f));
+      cmd.add<int>("opt-hitch-cooldown", 0,
+                   "Capturing Option: Frames to wait after a hitch capture before another.", false,
+                   60, cmdline::range(0, 1000000));
+      cmd.add<int>("opt-hitch-max-captures", 0,
+                   "Capturing Option: Maximum number of hitch captures, or 0 for no limit.", false,
+                   1, cmdline::range(0, 1000000));
+      cmd.add<std::string>("opt-compression", 0,
+                           "Capturing Option: Compress captures with lz4 (the default), zstd for "
+                           "smaller captures, or none.",
+                           false, "lz4", cmdline::oneof<std::string>("lz4", "zstd", "none"));
+      cmd.add<int>("opt-compression-level", 0,
+                   "Capturing Option: The zstd level for --opt-compression zstd, from 1 to 19.",
+                   false, 0, cmdline::range(0, 22));
     }
 
     cmd.parse_check(argv, true);
@@ -1664,6 +2518,17 @@ int renderdoccmd(GlobalEnvironment &env, std::vector<std::string> &argv)
         opts.captureAllCmdLists = true;
 
       opts.delayForDebugger = (uint32_t)cmd.get<int>("opt-delay-for-debugger");
+      opts.hitchCaptureThreshold = cmd.get<float>("opt-hitch-threshold");
+      opts.hitchCaptureMedianFactor = cmd.get<float>("opt-hitch-median-factor");
+      opts.hitchCaptureCooldown = (uint32_t)cmd.get<int>("opt-hitch-cooldown");
+      opts.hitchCaptureMaxCount = (uint32_t)cmd.get<int>("opt-hitch-max-captures");
+
+      std::string compression = cmd.get<std::string>("opt-compression");
+      if(compression == "zstd")
+        opts.captureCompression = SectionFlags::ZstdCompressed;
+      else if(compression == "none")
+        opts.captureCompression = SectionFlags::NoFlags;
+      opts.captureCompressionLevel = (uint32_t)cmd.get<int>("opt-compression-level");
     }
 
     if(!it->second->HandlesUsageManually() && cmd.exist("help"))
@@ -58,3 +58,5 @@ void DisplayRendererPreview(IReplayController *renderer, TextureDisplay &display
                             uint32_t height, uint32_t numLoops);
 WindowingData DisplayRemoteServerPreview(bool active, const rdcarray<WindowingSystem> &systems);
 void Daemonise();
+// atomically replaces 'to' with 'from', leaving both files untouched if that fails
+bool ReplaceWithFile(const std::string &from, const std::string &to);
@@ -28,6 +28,7 @@
 #include <GLES2/gl2ext.h>
 #include <dlfcn.h>
 #include <locale.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <string>
@@ -74,6 +75,12 @@ void Daemonise()
 {
 }
 
+bool ReplaceWithFile(const std::string &from, const std::string &to)
+{
+  // rename() atomically replaces any existing file
+  return rename(from.c_str(), to.c_str()) == 0;
+}
+
 void DisplayGenericSplash()
 {
   ANDROID_LOG("Trying to splash");
@@ -24,6 +24,7 @@
 
 #include "renderdoccmd.h"
 #include <locale.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <string>
@@ -32,6 +33,12 @@ void Daemonise()
 {
 }
 
+bool ReplaceWithFile(const std::string &from, const std::string &to)
+{
+  // rename() atomically replaces any existing file
+  return rename(from.c_str(), to.c_str()) == 0;
+}
+
 WindowingData DisplayRemoteServerPreview(bool active, const rdcarray<WindowingSystem> &systems)
 {
   WindowingData ret = {WindowingSystem::Unknown};
@@ -24,6 +24,7 @@
 
 #include "renderdoccmd.h"
 #include <signal.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -48,6 +49,12 @@ void Daemonise()
   daemon(1, 0);
 }
 
+bool ReplaceWithFile(const std::string &from, const std::string &to)
+{
+  // rename() atomically replaces any existing file
+  return rename(from.c_str(), to.c_str()) == 0;
+}
+
 WindowingData DisplayRemoteServerPreview(bool active, const rdcarray<WindowingSystem> &systems)
 {
   static WindowingData remoteServerPreview = {WindowingSystem::Unknown};
@@ -130,6 +130,12 @@ void Daemonise()
   // nothing really to do, windows version of renderdoccmd is already 'detached'
 }
 
+bool ReplaceWithFile(const std::string &from, const std::string &to)
+{
+  return MoveFileExW(conv(from).c_str(), conv(to).c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
 WindowingData DisplayRemoteServerPreview(bool active, const rdcarray<WindowingSystem> &systems)
 {
   static WindowingData remoteServerPreview = {WindowingSystem::Unknown};
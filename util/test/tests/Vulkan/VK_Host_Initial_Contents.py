@@ -0,0 +1,38 @@
+import renderdoc as rd
+import rdtest
+import struct
+
+
+class VK_Host_Initial_Contents(rdtest.TestCase):
+    demos_test_name = 'VK_Large_Buffer'
+
+    # Need to keep initial contents on the host before opening the capture
+    def run(self):
+        obj: rd.SDObject = rd.SetConfigSetting("Vulkan.HostInitialContentsBudgetMB")
+        if obj is not None:
+            obj.data.basic.u = 256
+        super().run()
+
+    def check_capture(self):
+        draw = self.find_draw("Draw")
+
+        self.controller.SetFrameEvent(draw.eventId, False)
+
+        pipe: rd.PipeState = self.controller.GetPipelineState()
+
+        vb = pipe.GetVBuffers()[0].resourceId
+
+        # select an event before the vertex buffer is first used. Its initial contents are skipped
+        # when replaying, but reading the buffer must still return them
+        self.controller.SetFrameEvent(self.get_first_draw().eventId, True)
+
+        # position, colour and UV of the vertex at index 1000000
+        stride = 4 * (3 + 4 + 2)
+        data: bytes = self.controller.GetBufferData(vb, 1000000 * stride, stride)
+
+        vert = struct.unpack_from('=9f', data, 0)
+
+        if not rdtest.value_compare(vert, [0.0, 0.5, 0.0, 0.0, 1.0, 0.0, 1.0, 0.0, 1.0]):
+            raise rdtest.TestFailureException("Vertex data {} is not as expected".format(vert))
+
+        rdtest.log.success("Buffer contents are correct before the buffer's first use")